@@ -27,6 +27,18 @@
 
 #define PARSE_TIMEOUT 1000  // default number of milli-seconds to wait
 
+// appends to a String growing its capacity geometrically instead of by the appended size
+static void appendString(String &s, const char *data, size_t length, size_t &capacity)
+{
+  size_t need = s.length() + length;
+  if (need > capacity) {
+    capacity = need < 32 ? 32 : need + need / 2;
+    s.reserve(capacity);
+  }
+  s.concat(data, length);
+}
+
+
 // protected method to read stream with timeout
 int Stream::timedRead()
 {
@@ -81,9 +93,38 @@ int Stream::peekNextDigit(LookaheadMode lookahead, bool detectDecimal)
   }
 }
 
+// protected method to implement readAvailable() on top of peekSpan() / consume()
+size_t Stream::readSpans(char *buffer, size_t length)
+{
+  size_t count = 0;
+  const char *data;
+  size_t n;
+  while (count < length && (n = peekSpan(&data)) > 0) {
+    if (n > length - count)
+      n = length - count;
+    memcpy(buffer + count, data, n);
+    consume(n);
+    count += n;
+  }
+  return count;
+}
+
 // Public Methods
 //////////////////////////////////////////////////////////////
 
+// copies up to length bytes that are already received, never waits
+// streams with a bulk read or contiguous buffer override this
+size_t Stream::readAvailable(char *buffer, size_t length)
+{
+  size_t count = 0;
+  while (count < length && available() > 0) {
+    int c = read();
+    if (c < 0) break;
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
 void Stream::setTimeout(unsigned long timeout)  // sets the maximum number of milliseconds to wait
 {
   _timeout = timeout;
@@ -203,10 +244,14 @@ size_t Stream::readBytes(char *buffer, size_t length)
 {
   size_t count = 0;
   while (count < length) {
+    size_t n = readAvailable(buffer + count, length - count);
+    if (n) {
+      count += n;
+      continue;
+    }
     int c = timedRead();
     if (c < 0) break;
-    *buffer++ = (char)c;
-    count++;
+    buffer[count++] = (char)c;
   }
   return count;
 }
@@ -221,10 +266,22 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
   if (length < 1) return 0;
   size_t index = 0;
   while (index < length) {
+    const char *data;
+    size_t n = peekSpan(&data);
+    if (n) {
+      if (n > length - index)
+        n = length - index;
+      const char *t = (const char *)memchr(data, terminator, n);
+      size_t m = t ? (size_t)(t - data) : n;
+      memcpy(buffer + index, data, m);
+      index += m;
+      consume(t ? m + 1 : m);
+      if (t) break;
+      continue;
+    }
     int c = timedRead();
     if (c < 0 || c == terminator) break;
-    *buffer++ = (char)c;
-    index++;
+    buffer[index++] = (char)c;
   }
   return index; // return number of characters, not including null terminator
 }
@@ -232,11 +289,18 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
 String Stream::readString()
 {
   String ret;
-  int c = timedRead();
-  while (c >= 0)
-  {
-    ret += (char)c;
-    c = timedRead();
+  size_t capacity = 0;
+  char chunk[64];
+  while (1) {
+    size_t n = readAvailable(chunk, sizeof(chunk));
+    if (n) {
+      appendString(ret, chunk, n, capacity);
+      continue;
+    }
+    int c = timedRead();
+    if (c < 0) break;
+    chunk[0] = (char)c;
+    appendString(ret, chunk, 1, capacity);
   }
   return ret;
 }
@@ -244,11 +308,22 @@ String Stream::readString()
 String Stream::readStringUntil(char terminator)
 {
   String ret;
-  int c = timedRead();
-  while (c >= 0 && c != terminator)
-  {
-    ret += (char)c;
-    c = timedRead();
+  size_t capacity = 0;
+  while (1) {
+    const char *data;
+    size_t n = peekSpan(&data);
+    if (n) {
+      const char *t = (const char *)memchr(data, terminator, n);
+      size_t m = t ? (size_t)(t - data) : n;
+      appendString(ret, data, m, capacity);
+      consume(t ? m + 1 : m);
+      if (t) break;
+      continue;
+    }
+    int c = timedRead();
+    if (c < 0 || c == terminator) break;
+    char ch = (char)c;
+    appendString(ret, &ch, 1, capacity);
   }
   return ret;
 }
@@ -262,58 +337,84 @@ int Stream::findMulti( struct Stream::MultiTarget *targets, int tCount) {
   }
 
   while (1) {
+    const char *data;
+    size_t n = peekSpan(&data);
+    if (n) {
+      size_t i = 0;
+      // single target waiting for its first character: skip ahead with memchr
+      if (tCount == 1 && targets->index == 0) {
+        const char *p = (const char *)memchr(data, targets->str[0], n);
+        i = p ? (size_t)(p - data) : n;
+      }
+      for (; i < n; i++) {
+        int r = findMultiChar(targets, tCount, (unsigned char)data[i]);
+        if (r >= 0) {
+          consume(i + 1);
+          return r;
+        }
+      }
+      consume(n);
+      continue;
+    }
+
     int c = timedRead();
     if (c < 0)
       return -1;
+    int r = findMultiChar(targets, tCount, c);
+    if (r >= 0)
+      return r;
+  }
+  // unreachable
+  return -1;
+}
 
-    for (struct MultiTarget *t = targets; t < targets+tCount; ++t) {
-      // the simple case is if we match, deal with that first.
-      if (c == t->str[t->index]) {
-        if (++t->index == t->len)
-          return t - targets;
-        else
-          continue;
-      }
+int Stream::findMultiChar( struct Stream::MultiTarget *targets, int tCount, int c) {
+  for (struct MultiTarget *t = targets; t < targets+tCount; ++t) {
+    // the simple case is if we match, deal with that first.
+    if (c == t->str[t->index]) {
+      if (++t->index == t->len)
+        return t - targets;
+      else
+        continue;
+    }
 
-      // if not we need to walk back and see if we could have matched further
-      // down the stream (ie '1112' doesn't match the first position in '11112'
-      // but it will match the second position so we can't just reset the current
-      // index to 0 when we find a mismatch.
-      if (t->index == 0)
+    // if not we need to walk back and see if we could have matched further
+    // down the stream (ie '1112' doesn't match the first position in '11112'
+    // but it will match the second position so we can't just reset the current
+    // index to 0 when we find a mismatch.
+    if (t->index == 0)
+      continue;
+
+    int origIndex = t->index;
+    do {
+      --t->index;
+      // first check if current char works against the new current index
+      if (c != t->str[t->index])
         continue;
 
-      int origIndex = t->index;
-      do {
-        --t->index;
-        // first check if current char works against the new current index
-        if (c != t->str[t->index])
-          continue;
+      // if it's the only char then we're good, nothing more to check
+      if (t->index == 0) {
+        t->index++;
+        break;
+      }
 
-        // if it's the only char then we're good, nothing more to check
-        if (t->index == 0) {
-          t->index++;
+      // otherwise we need to check the rest of the found string
+      int diff = origIndex - t->index;
+      size_t i;
+      for (i = 0; i < t->index; ++i) {
+        if (t->str[i] != t->str[i + diff])
           break;
-        }
-
-        // otherwise we need to check the rest of the found string
-        int diff = origIndex - t->index;
-        size_t i;
-        for (i = 0; i < t->index; ++i) {
-          if (t->str[i] != t->str[i + diff])
-            break;
-        }
+      }
 
-        // if we successfully got through the previous loop then our current
-        // index is good.
-        if (i == t->index) {
-          t->index++;
-          break;
-        }
+      // if we successfully got through the previous loop then our current
+      // index is good.
+      if (i == t->index) {
+        t->index++;
+        break;
+      }
 
-        // otherwise we just try the next index
-      } while (t->index);
-    }
+      // otherwise we just try the next index
+    } while (t->index);
   }
-  // unreachable
   return -1;
 }
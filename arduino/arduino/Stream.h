@@ -54,6 +54,7 @@ class Stream : public Print
     int timedRead();    // read stream with timeout
     int timedPeek();    // peek stream with timeout
     int peekNextDigit(LookaheadMode lookahead, bool detectDecimal); // returns the next numeric digit in the stream or -1 if timeout
+    size_t readSpans(char *buffer, size_t length); // readAvailable() built on peekSpan() / consume()
 
   public:
     virtual int available() = 0;
@@ -62,6 +63,12 @@ class Stream : public Print
 
     Stream() {_timeout=1000;}
 
+// bulk access, used by the parsing methods below
+
+  virtual size_t readAvailable(char *buffer, size_t length); // copies up to length bytes already received, never waits
+  virtual size_t peekSpan(const char **data) { return 0; }   // received bytes as one contiguous block, not consumed; 0 if none or unsupported
+  virtual void consume(size_t length) { while (length--) read(); } // drops bytes seen through peekSpan()
+
 // parsing methods
 
   void setTimeout(unsigned long timeout);  // sets maximum milliseconds to wait for stream data, default is 1 second
@@ -123,6 +130,10 @@ class Stream : public Print
   // This allows you to search for an arbitrary number of strings.
   // Returns index of the target that is found first or -1 if timeout occurs.
   int findMulti(struct MultiTarget *targets, int tCount);
+
+  private:
+  // feeds one character to the findMulti() matcher, returns the index of a completed target or -1
+  int findMultiChar(struct MultiTarget *targets, int tCount, int c);
 };
 
 #undef NO_IGNORE_CHAR
@@ -59,8 +59,11 @@ public:
   virtual int read(void)
   {
     uint8_t b;
-    return read(&b, 1) > -1 ? b : -1;
+    return read(&b, 1) > 0 ? b : -1;
   }
+  virtual size_t readAvailable(char *buf, size_t size) { return uart_read(uart, buf, size); }
+  virtual size_t peekSpan(const char **data) { return uart_borrow(uart, data); }
+  virtual void consume(size_t size) { uart_release(uart, size); }
 
   virtual size_t write(const uint8_t *buf, size_t size) { return uart_write(uart, (char *)buf, size); }
   virtual size_t write(uint8_t c) { return write(&c, 1); }
@@ -20,6 +20,9 @@
 #include <os_uart.h>
 #include <os_timer.h>
 #include <os_eint.h>
+#ifdef __OCPU_RIL_SOCKET_SUPPORT__
+#include "ril_socket.h"
+#endif
 
 extern void initVariant();
 extern void setup();
@@ -47,6 +50,9 @@ extern "C" void proc_main_task(int taskId)
         {
         case MSG_ID_RIL_READY:
             Ql_RIL_Initialize();
+#ifdef __OCPU_RIL_SOCKET_SUPPORT__
+            RIL_SOC_Initialize(); // before any task can send
+#endif
             if (arduino_task_handle)
                 Ql_OS_TaskResume(arduino_task_handle); // run arduino task
             continue;
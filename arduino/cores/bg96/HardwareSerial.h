@@ -27,11 +27,12 @@ class HardwareSerial : public Stream
 {
 private:
     UART uart;
+    bool borrowed; // uart_borrow() holds the reader lock until consume()
 
 public:
-	HardwareSerial(qapi_UART_Port_Id_e id, void *config) { uart = uart_create(id, config); }
+	HardwareSerial(qapi_UART_Port_Id_e id, void *config) { uart = uart_create(id, config); borrowed = false; }
 
-	HardwareSerial(qapi_UART_Port_Id_e id) { uart = uart_create(id, NULL); }
+	HardwareSerial(qapi_UART_Port_Id_e id) { uart = uart_create(id, NULL); borrowed = false; }
 
 	~HardwareSerial() { 
 		uart_close(uart);
@@ -59,6 +60,22 @@ public:
 
 	virtual int read(void) { return uart_getchar(uart); }
 	virtual int read(uint8_t * buf, size_t size) { return uart_read(uart, (char *)buf, size); }
+	virtual size_t readAvailable(char *buf, size_t size) { return uart_read(uart, buf, size); }
+	virtual size_t peekSpan(const char **data) {
+		if (borrowed)
+			uart_release(uart, 0);
+		size_t size = uart_borrow(uart, data);
+		borrowed = size > 0;
+		return size;
+	}
+	virtual void consume(size_t size) {
+		if (borrowed) {
+			borrowed = false;
+			uart_release(uart, size);
+		} else {
+			Stream::consume(size);
+		}
+	}
 
 	virtual int available(void) { return uart_available(uart); }
 	virtual int peek(void) { return uart_peek(uart); }
@@ -17,6 +17,7 @@ extern "C"
 #include <snprintf.h>
 
 #include "dbg.h"
+#include "../../../common/heap_class.h"
 #include <qurt_timetick.h>
 #include <qapi_types.h>
 #include <qapi.h>
@@ -10,7 +10,9 @@
 #define DEBUG_RIL
 //DBG
 
-extern "C" char *strdup(const char *s);
+#define RING_MASK (INTERNAL_RECEIVE_SIZE - 1)
+#define ARENA_ALIGN(n) (((n) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#define TIMETICK_TO_US(t) ((uint32_t)(((uint64_t)(t) * 10) / 192)) /* 19.2 MHz */
 
 static const char *s_finalResponsesError[] = {"ERROR",
 											  "+CMS ERROR:",
@@ -76,6 +78,7 @@ Ril::Ril(qapi_at_port_t id)
 	stack = NULL;
 	stream = -1;
 	port_id = id;
+	memset(&stats, 0, sizeof(stats));
 }
 
 void Ril::ctor()
@@ -160,7 +163,6 @@ void Ril::entry(void *p)
 			//DEBUG_RIL("[R] %s\n", line);
 			THIS->processLine(line);
 		}
-		qapi_Timer_Sleep(1, QAPI_TIMER_UNIT_TICK, 1); // YEILD
 	}
 }
 
@@ -206,31 +208,28 @@ Ril::~Ril()
 	tx_event_flags_delete(event);
 }
 
-size_t Ril::save(char c)
-{
-	ENTER_CRITICAL();
-	uint32_t i = (uint32_t)(rx_ring_head + 1) % sizeof(rx_ring_buff);
-	size_t saved = 0;
-	if (i != rx_ring_tail)
-	{
-		rx_ring_buff[rx_ring_head] = c;
-		rx_ring_head = i;
-		saved = 1; // saved one char
-	}
-	EXIT_CRITICAL();
-	return saved; // full
-}
-
+/* AT port callback, the only producer */
 size_t Ril::save(char *buffer, size_t size)
 {
 	if (!size || !buffer)
 		return 0;
-	size_t saved = 0;
-	for (size_t i = 0; i < size; i++, saved++)
-		if (0 == save(buffer[i]))
-			break;
+	uint32_t head = rx_ring_head;
+	uint32_t room = INTERNAL_RECEIVE_SIZE - (head - rx_ring_tail);
+	if (size > room)
+	{
+		stats.dropped += size - room;
+		size = room;
+	}
+	uint32_t pos = head & RING_MASK;
+	uint32_t n = INTERNAL_RECEIVE_SIZE - pos;
+	if (n > size)
+		n = size;
+	memcpy(rx_ring_buff + pos, buffer, n);
+	memcpy(rx_ring_buff, buffer + n, size - n);
+	__sync_synchronize(); // data before index
+	rx_ring_head = head + size;
 	tx_event_flags_set(event, RIL_RECEIVE_EVENT_MASK, TX_OR);
-	return saved;
+	return size;
 }
 
 size_t Ril::write(const char *s)
@@ -239,24 +238,27 @@ size_t Ril::write(const char *s)
 		return 0;
 	tx_mutex_get(w_mutex, TX_WAIT_FOREVER);
 	int rc = qapi_QT_Apps_Send_AT(stream, s) == QAPI_QT_ERR_OK ? strlen(s) : 0;
-	qapi_Timer_Sleep(1, QAPI_TIMER_UNIT_TICK, 1); // FUCK QUECTEL
+#if RIL_WRITE_GUARD_TICKS > 0
+	qapi_Timer_Sleep(RIL_WRITE_GUARD_TICKS, QAPI_TIMER_UNIT_TICK, 1);
+#endif
 	tx_mutex_put(w_mutex);
 	return rc;
 }
 
 size_t Ril::available(void)
 {
-	return (uint32_t)(sizeof(rx_ring_buff) + rx_ring_head - rx_ring_tail) % sizeof(rx_ring_buff);
+	return rx_ring_head - rx_ring_tail;
 }
 
 int Ril::read(void)
 {
-	if (rx_ring_head == rx_ring_tail)
+	uint32_t tail = rx_ring_tail;
+	if (rx_ring_head == tail)
 		return -1;
-	ENTER_CRITICAL();
-	uint8_t rc = rx_ring_buff[rx_ring_tail];
-	rx_ring_tail = (uint32_t)(rx_ring_tail + 1) % sizeof(rx_ring_buff);
-	EXIT_CRITICAL();
+	__sync_synchronize(); // index before data
+	uint8_t rc = rx_ring_buff[tail & RING_MASK];
+	__sync_synchronize(); // data before index
+	rx_ring_tail = tail + 1;
 	return rc;
 }
 
@@ -264,44 +266,93 @@ int Ril::writeCtrlZ(const char *s)
 {
 	if (!s)
 		return AT_ERROR_GENERIC;
-	/* the main string */
-	if (0 == write(s))
+	/* the main string and the ^Z in one write */
+	size_t len = strlen(s);
+	char *buf = (char *)arena_alloc(sp_response, len + 2);
+	if (NULL == buf)
 		return AT_ERROR_GENERIC;
-	/* the ^Z  */
-	if (0 == write("\032"))
+	memcpy(buf, s, len);
+	buf[len] = '\032';
+	buf[len + 1] = '\0';
+	if (0 == write(buf))
 		return AT_ERROR_GENERIC;
 	return AT_NO_ERROR;
 }
 
 void Ril::clearLine(void)
 {
-	memset(lineBuffer, 0, sizeof(lineBuffer));
+	lineBuffer[0] = '\0';
 	lineBufferCur = lineBuffer;
 }
 
+/* the response and its first arena block are one allocation */
 ATResponse *Ril::response_new(void)
 {
-	return (ATResponse *)calloc(1, sizeof(ATResponse));
+	ATResponse *p_response = (ATResponse *)malloc(sizeof(ATResponse) + sizeof(ATArena) + RIL_ARENA_SIZE);
+	if (p_response == NULL)
+		return NULL;
+	memset(p_response, 0, sizeof(ATResponse));
+	p_response->arena = (ATArena *)(p_response + 1);
+	p_response->arena->next = NULL;
+	p_response->arena->size = RIL_ARENA_SIZE;
+	p_response->arena->used = 0;
+	return p_response;
 }
 
 void Ril::response_free(ATResponse *p_response)
 {
-	ATLine *p_line;
 	if (p_response == NULL)
 		return;
-	p_line = p_response->p_intermediates;
-	while (p_line != NULL)
+	ATArena *p_arena = p_response->arena;
+	while (p_arena != NULL && p_arena != (ATArena *)(p_response + 1))
 	{
-		ATLine *p_toFree;
-		p_toFree = p_line;
-		p_line = p_line->p_next;
-		free(p_toFree->line);
+		ATArena *p_toFree = p_arena;
+		p_arena = p_arena->next;
 		free(p_toFree);
 	}
-	free(p_response->finalResponse);
 	free(p_response);
 }
 
+void *Ril::arena_alloc(ATResponse *p_response, size_t size)
+{
+	ATArena *p_arena = p_response->arena;
+	size = ARENA_ALIGN(size);
+	if (p_arena->used + size > p_arena->size)
+	{
+		size_t n = size > RIL_ARENA_SIZE ? size : RIL_ARENA_SIZE;
+		p_arena = (ATArena *)malloc(sizeof(ATArena) + n);
+		if (p_arena == NULL)
+			return NULL;
+		p_arena->next = p_response->arena;
+		p_arena->size = n;
+		p_arena->used = 0;
+		p_response->arena = p_arena;
+	}
+	void *p = (char *)(p_arena + 1) + p_arena->used;
+	p_arena->used += size;
+	return p;
+}
+
+char *Ril::arena_strdup(ATResponse *p_response, const char *line)
+{
+	size_t len = strlen(line) + 1;
+	char *p = (char *)arena_alloc(p_response, len);
+	if (p)
+		memcpy(p, line, len);
+	return p;
+}
+
+void Ril::getStats(RilStats *p_stats)
+{
+	if (p_stats)
+		*p_stats = stats;
+}
+
+void Ril::resetStats(void)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
 void Ril::reverseIntermediates(ATResponse *p_response)
 {
 	ATLine *pcur, *pnext;
@@ -319,27 +370,49 @@ void Ril::reverseIntermediates(ATResponse *p_response)
 void Ril::addIntermediate(const char *line)
 {
 	ATLine *p_new;
-	p_new = (ATLine *)malloc(sizeof(ATLine));
-	p_new->line = strdup(line);
+	p_new = (ATLine *)arena_alloc(sp_response, sizeof(ATLine));
+	if (p_new == NULL || (p_new->line = arena_strdup(sp_response, line)) == NULL)
+	{
+		DEBUG_RIL("[RIL] no memory for line\n");
+		return;
+	}
 	p_new->p_next = sp_response->p_intermediates;
 	sp_response->p_intermediates = p_new;
 }
 
+/* the ril thread, the only consumer */
 const char *Ril::readLine(void)
 {
-	int rc;
-	while ((rc = read()) > -1)
+	uint32_t head = rx_ring_head;
+	uint32_t tail = rx_ring_tail;
+	__sync_synchronize(); // index before data
+	while (tail != head)
 	{
-		if (0 == sizeof(lineBuffer) - (lineBufferCur - lineBuffer)) /* LIMIT */
+		uint32_t pos = tail & RING_MASK;
+		uint32_t n = INTERNAL_RECEIVE_SIZE - pos; // contiguous part
+		if (n > head - tail)
+			n = head - tail;
+		const char *src = (const char *)rx_ring_buff + pos;
+		const char *eol = (const char *)memchr(src, '\n', n);
+		if (eol)
+			n = eol - src + 1;
+		if (n > sizeof(lineBuffer) - 1 - (lineBufferCur - lineBuffer)) /* LIMIT */
 		{
-			clearLine();
-			return NULL;
+			clearLine(); // drop the long line
+		}
+		else
+		{
+			memcpy(lineBufferCur, src, n);
+			lineBufferCur += n;
+			*lineBufferCur = '\0';
 		}
-		*lineBufferCur++ = (char)rc;
-		*lineBufferCur = '\0';
-		if ('\n' == (char)rc)
+		tail += n;
+		__sync_synchronize(); // data before index, the producer may reuse it
+		rx_ring_tail = tail;
+		if (eol && lineBufferCur != lineBuffer)
 		{
 			lineBufferCur = lineBuffer;
+			stats.lines++;
 			return lineBuffer;
 		}
 	}
@@ -349,7 +422,7 @@ const char *Ril::readLine(void)
 void Ril::processLine(const char *line)
 {
 	tx_mutex_get(l_mutex, TX_WAIT_FOREVER);
-	if (sp_response == NULL)
+	if (sp_response == NULL || sp_response->finalResponse != NULL)
 	{
 		/* no command pending */
 		handleUnsolicited(line);
@@ -412,14 +485,15 @@ void Ril::processLine(const char *line)
 		}
 	clearLine();
 	tx_mutex_put(l_mutex);
-	qapi_Timer_Sleep(1, QAPI_TIMER_UNIT_TICK, true); // IMPORTANT YIELD !!!
 }
 
 void Ril::handleFinalResponse(const char *line)
 {
 	if (!line)
 		return;
-	sp_response->finalResponse = strdup(line);
+	sp_response->finalResponse = arena_strdup(sp_response, line);
+	if (sp_response->finalResponse == NULL)
+		sp_response->finalResponse = (char *)"ERROR"; // the waiter must wake up
 	//DEBUG_RIL("[FINAL] %s", sp_response->finalResponse);
 	tx_event_flags_set(event, RIL_RESPONSE_EVENT_MASK, TX_OR);
 }
@@ -435,55 +509,77 @@ void Ril::handleUnsolicited(const char *line)
 
 void Ril::clearPendingCommand(void)
 {
+	tx_mutex_get(l_mutex, TX_WAIT_FOREVER);
 	if (sp_response != NULL)
 		response_free(sp_response);
 	sp_response = NULL;
 	s_responsePrefix = NULL;
 	s_smsPDU = NULL;
+	tx_mutex_put(l_mutex);
 }
 
 int Ril::send_nolock(const char *command, ATCommandType type, const char *responsePrefix, const char *smspdu, uint32_t timeoutMsec, ATResponse **pp_outResponse)
 {
 	int err = 0;
 	ULONG sig = 0;
+	ATResponse *p_response;
+	qurt_time_t start;
+	uint32_t us;
 	if (sp_response != NULL)
-	{
-		err = AT_ERROR_COMMAND_PENDING;
-		goto error;
-	}
+		return AT_ERROR_COMMAND_PENDING;
+	p_response = response_new();
+	if (p_response == NULL)
+		return AT_ERROR_GENERIC;
+	/* armed before the write, the answer may come before write() returns */
+	tx_event_flags_set(event, ~RIL_RESPONSE_EVENT_MASK, TX_AND);
+	tx_mutex_get(l_mutex, TX_WAIT_FOREVER);
+	s_type = type;
+	s_responsePrefix = responsePrefix;
+	s_smsPDU = smspdu;
+	sp_response = p_response;
+	tx_mutex_put(l_mutex);
+	start = qurt_timer_get_ticks();
 	if (0 == write(command))
 	{
 		err = AT_ERROR_GENERIC;
 		goto error;
 	}
-	s_type = type;
-	s_responsePrefix = responsePrefix;
-	s_smsPDU = smspdu;
-	sp_response = response_new();
 	if (timeoutMsec <= TICKS_PER_MSEC)
 		timeoutMsec = TX_WAIT_FOREVER;
 	else
 		timeoutMsec /= TICKS_PER_MSEC;
-	while (sp_response->finalResponse == NULL)
+	while (p_response->finalResponse == NULL)
 	{
 		tx_event_flags_get(event, RIL_RESPONSE_EVENT_MASK, TX_OR_CLEAR, &sig, timeoutMsec);
 		if (0 == (sig & RIL_RESPONSE_EVENT_MASK))
 		{
+			stats.timeouts++;
 			err = AT_ERROR_TIMEOUT;
 			goto error;
 		}
 	}
+	us = TIMETICK_TO_US(qurt_timer_get_ticks() - start);
+	stats.commands++;
+	stats.last_us = us;
+	stats.total_us += us;
+	if (us > stats.max_us)
+		stats.max_us = us;
+	/* detach, later lines are unsolicited */
+	tx_mutex_get(l_mutex, TX_WAIT_FOREVER);
+	sp_response = NULL;
+	s_responsePrefix = NULL;
+	s_smsPDU = NULL;
+	tx_mutex_put(l_mutex);
 	if (pp_outResponse == NULL)
 	{
-		response_free(sp_response);
+		response_free(p_response);
 	}
 	else
 	{
-		reverseIntermediates(sp_response);
-		*pp_outResponse = sp_response;
+		reverseIntermediates(p_response);
+		*pp_outResponse = p_response;
 	}
-	sp_response = NULL;
-	err = AT_NO_ERROR;
+	return AT_NO_ERROR;
 error:
 	clearPendingCommand();
 	return err;
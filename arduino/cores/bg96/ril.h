@@ -28,6 +28,14 @@ typedef enum
 	MULTILINE   /* multiple line intermediate response starting with a prefix */
 } ATCommandType;
 
+/** line storage of one response, released with it */
+typedef struct ATArena
+{
+	struct ATArena *next;
+	size_t size;
+	size_t used;
+} ATArena;
+
 /** a singly-lined list of intermediate responses */
 typedef struct ATLine
 {
@@ -41,12 +49,32 @@ typedef struct
 	int success;			 /* true if final response indicates success (eg "OK") */
 	char *finalResponse;	 /* eg OK, ERROR */
 	ATLine *p_intermediates; /* any intermediate responses */
+	ATArena *arena;			 /* lines and final response live here */
 } ATResponse;
 
+typedef struct
+{
+	uint32_t commands; /* completed round trips */
+	uint32_t timeouts;
+	uint32_t last_us; /* write to final response */
+	uint32_t max_us;
+	uint64_t total_us;
+	uint32_t lines;	   /* received lines */
+	uint32_t dropped;  /* bytes lost, receive ring full */
+} RilStats;
+
 #define RIL_STACK_SIZE (8 * 1024)
 #define RIL_RECEIVE_EVENT_MASK (0x00000001)
 #define RIL_RESPONSE_EVENT_MASK (0x10000000)
-#define INTERNAL_RECEIVE_SIZE (4 * 1024)
+#define INTERNAL_RECEIVE_SIZE (4 * 1024) /* power of two, ring mask */
+#define RIL_ARENA_SIZE (512)			  /* response block, more blocks are chained for long answers */
+#ifndef RIL_WRITE_GUARD_TICKS
+#define RIL_WRITE_GUARD_TICKS (1) /* sleep after each qapi_QT_Apps_Send_AT, define 0 to skip it */
+#endif
+
+#if (INTERNAL_RECEIVE_SIZE & (INTERNAL_RECEIVE_SIZE - 1))
+#error INTERNAL_RECEIVE_SIZE must be a power of two
+#endif
 
 class Ril
 {
@@ -68,11 +96,11 @@ protected:
 private:
 	qapi_at_port_t port_id;
 	qapi_at_stream_id_t stream;
-	uint32_t rx_ring_tail = 0;
-	uint32_t rx_ring_head = 0;
+	volatile uint32_t rx_ring_tail = 0; /* free running, consumer: ril thread */
+	volatile uint32_t rx_ring_head = 0; /* free running, producer: AT port callback */
 	UCHAR rx_ring_buff[INTERNAL_RECEIVE_SIZE];
+	RilStats stats;
 	void ctor();
-	size_t save(char c);
 	int writeCtrlZ(const char *s);
 	void clearLine(void);
 	const char *readLine(void);
@@ -82,6 +110,8 @@ private:
 	void clearPendingCommand(void);
 	void addIntermediate(const char *line);
 	void reverseIntermediates(ATResponse *p_response);
+	static void *arena_alloc(ATResponse *p_response, size_t size);
+	static char *arena_strdup(ATResponse *p_response, const char *line);
 	int send_nolock(const char *command, ATCommandType type, const char *responsePrefix, const char *smspdu, uint32_t timeoutMsec, ATResponse **pp_outResponse);
 	int send_full(const char *command, ATCommandType type, const char *responsePrefix, const char *smspdu, uint32_t timeoutMsec, ATResponse **pp_outResponse);
 
@@ -104,6 +134,8 @@ public:
 
 	ATResponse *response_new(void);
 	void response_free(ATResponse *p_response);
+	void getStats(RilStats *p_stats);
+	void resetStats(void);
 	void (*onURC)(const char *line);
 
 	bool getIMEI(char *imei, size_t size);
@@ -28,30 +28,46 @@
 
 TX_BYTE_POOL *heap;
 static char heap_buffer[HEAP]; // from -D, user defined
+static TX_MUTEX *heap_mutex;
 void heap_init(void)
 {
     if (txm_module_object_allocate(&heap, sizeof(TX_BYTE_POOL)))
         abort();
     if (tx_byte_pool_create(heap, "heap_byte_pool", heap_buffer, HEAP))
         abort();
+    if (txm_module_object_allocate(&heap_mutex, sizeof(TX_MUTEX)))
+        abort();
+    if (tx_mutex_create(heap_mutex, "heap_mutex", TX_NO_INHERIT))
+        abort();
 }
 
+static void *heap_os_alloc(size_t size)
+{
+    void *ptr;
+    if (tx_byte_allocate(heap, (VOID **)&ptr, size, TX_NO_WAIT))
+        return NULL;
+    return ptr;
+}
+
+#define HEAP_OS_ALLOC(S) heap_os_alloc(S)
+#define HEAP_OS_FREE(P) tx_byte_release(P)
+#define HEAP_LOCK() MUTEX_LOCK(heap_mutex)
+#define HEAP_UNLOCK() MUTEX_UNLOCK(heap_mutex)
+
+#define HEAP_CLASS_IMPLEMENTATION
+#include "../../../common/heap_class.h"
+
 extern void free(void *ptr)
 {
     if (ptr)
-        tx_byte_release(ptr);
+        heap_release(ptr);
 }
 
 extern void *malloc(size_t size)
 {
     if (!size)
         return NULL;
-    void *ptr;
-    if (tx_byte_allocate(heap, (VOID **)&ptr, size, TX_NO_WAIT))
-    {
-        return NULL;
-    }
-    return ptr;
+    return heap_alloc(size);
 }
 
 extern void *realloc(void *mem, size_t newsize)
@@ -61,17 +77,9 @@ extern void *realloc(void *mem, size_t newsize)
         free(mem);
         return NULL;
     }
-    void *p;
-    p = malloc(newsize);
-    if (p)
-    {
-        if (mem != NULL)
-        {
-            memcpy(p, mem, newsize); // newsize !
-            free(mem);
-        }
-    }
-    return p;
+    if (mem == NULL)
+        return malloc(newsize);
+    return heap_resize(mem, newsize);
 }
 
 extern void *calloc(size_t nmemb, size_t size)
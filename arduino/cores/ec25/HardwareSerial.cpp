@@ -35,17 +35,13 @@
 HardwareSerial::HardwareSerial() // for console
 {
     port_name = NULL;
-    fd = -1;
-    peeked = 0;
-    pk = 0;
+    port = NULL;
 }
 
 HardwareSerial::HardwareSerial(const char *name) // Serial(/dev/ttyUSB0")
 {
     port_name = (char *)name;
-    fd = -1;
-    peeked = 0;
-    pk = 0;
+    port = NULL;
 }
 
 void HardwareSerial::setName(const char *name)
@@ -55,7 +51,7 @@ void HardwareSerial::setName(const char *name)
 
 void HardwareSerial::begin(unsigned long brg)
 {
-    if (brg == 0 || port_name == NULL)
+    if (brg == 0 || port_name == NULL || port)
         return;
     switch (brg)
     {
@@ -153,7 +149,7 @@ void HardwareSerial::begin(unsigned long brg)
         SERIAL_DEBUG("[ERROR] Serial invalid brg\n");
         return;
     }
-    fd = open(port_name, O_RDWR | O_NOCTTY | O_NDELAY);
+    int fd = open(port_name, O_RDWR | O_NOCTTY | O_NDELAY);
     if (fd == -1)
     {
         SERIAL_DEBUG("[ERROR] Serial open %s ( %d )\n", port_name, fd);
@@ -181,81 +177,63 @@ void HardwareSerial::begin(unsigned long brg)
         SERIAL_DEBUG("[ERROR] Serial setting attributes\n");
     }
     /* Flush Port, then applies attributes */
-    tcflush(fd, TCIFLUSH);
-    flush();
+    tcflush(fd, TCIOFLUSH);
+    port = Ql_UART_Loop_Attach(fd, UART_RECEIVE_SIZE, UART_TRANSMIT_SIZE, NULL, NULL); // owns fd
+    if (NULL == port)
+        SERIAL_DEBUG("[ERROR] Serial attach %s\n", port_name);
 }
 
 void HardwareSerial::end()
 {
-    if (fd == -1)
+    if (NULL == port)
         return;
-    flush();    
-    close(fd);
-    fd = -1;
+    flush();
+    Ql_UART_Loop_Detach(port); // closes fd
+    port = NULL;
 }
 
 int HardwareSerial::read(void)
 {
-    if (fd == -1)
-        return 0;
-    if (peeked)
-    {
-        peeked = 0;
-        return pk;
-    }
-    char b;
-    return ::read(fd, &b, 1) == 1 ? b : -1;
+    const char *data;
+    if (0 == peekSpan(&data))
+        return -1;
+    int c = (uint8_t)*data;
+    consume(1);
+    return c;
 }
 
 size_t HardwareSerial::write(uint8_t b)
+{
+    return write(&b, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t size)
 {
     if (NULL == port_name)
-    {
-        ::printf("%c", b);
-        return 1;
-    }
-    if (fd == -1)
+        return fwrite(buf, 1, size, stdout);
+    if (NULL == port)
         return 0;
-    int w = ::write(fd, &b, sizeof(b));
-    return w == 1 ? w : 0;
+    int w = Ql_UART_Loop_Write(port, (const char *)buf, size, -1); // waits for room, never for the wire
+    return w > 0 ? w : 0;
 }
 
 int HardwareSerial::available(void)
 {
-    if (fd == -1)
-        return 0;
-    int avail;
-    int rc = ioctl(fd, FIONREAD, &avail);
-    return rc ? 0 : avail;
+    return port ? Ql_UART_Loop_Available(port) : 0;
 }
 
 int HardwareSerial::peek(void)
 {
-    if (fd == -1)
-        return -1;
-    if (!available())
+    const char *data;
+    if (0 == peekSpan(&data))
         return -1;
-    if (peeked)
-    {
-        return pk;
-    }
-    else
-    {
-        pk = read();
-        if (pk != -1)
-        {
-            peeked = 1;
-            return pk;
-        }
-    }
-    return -1;
+    return (uint8_t)*data;
 }
 
 void HardwareSerial::flush(void)
 {
-    if (fd == -1)
+    if (NULL == port)
         return;
-    //ioctl(fd, TCFLSH, 0); // flush receive
-    //ioctl(fd, TCFLSH, 1); // flush transmit
-    ioctl(fd, TCFLSH, 2); // flush both
+    Ql_UART_Loop_Drain(port, -1); // tx buffer to the tty
+    tcdrain(Ql_UART_Loop_GetFd(port));
 }
@@ -24,17 +24,21 @@
 
 #include "Stream.h"
 #include <stdint.h>
+#include "ql_uart_loop.h"
 
-#define UART_RECEIVE_SIZE (1024)
+#ifndef UART_RECEIVE_SIZE
+#define UART_RECEIVE_SIZE (4096)
+#endif
+#ifndef UART_TRANSMIT_SIZE
+#define UART_TRANSMIT_SIZE (4096)
+#endif
 
 class HardwareSerial : public Stream
 {
 protected:
 private:
 	char *port_name;
-	int fd;
-	int peeked;
-	char pk;
+	ST_UARTPort *port; // rx/tx run on the uart loop thread
 
 public:
 	void setName(const char *aname);
@@ -48,7 +52,12 @@ public:
 	virtual int read(void);
 	virtual void flush(void);
 	virtual size_t write(uint8_t);
+	virtual size_t write(const uint8_t *buf, size_t size);
 	using Print::write;
+	virtual size_t readAvailable(char *buf, size_t size) { return port ? Ql_UART_Loop_Read(port, buf, size) : 0; }
+	virtual size_t peekSpan(const char **data) { return port ? Ql_UART_Loop_Borrow(port, data) : 0; }
+	virtual void consume(size_t size) { Ql_UART_Loop_Release(port, size); }
+	bool getStats(ST_UARTPortStats &stats) { return port && 0 == Ql_UART_Loop_GetPortStats(port, &stats); }
 	operator bool() { return true; }
 };
 
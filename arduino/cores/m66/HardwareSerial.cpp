@@ -115,6 +115,24 @@ int HardwareSerial::read(void)
   }
 }
 
+size_t HardwareSerial::peekSpan(const char **data)
+{
+  buffer_index_t head = _rx_buffer_head;
+  buffer_index_t tail = _rx_buffer_tail;
+  if (head == tail)
+    return 0;
+  *data = (const char *)&_rx_buffer[tail];
+  return (head > tail ? head : SERIAL_RX_BUFFER_SIZE) - tail;
+}
+
+void HardwareSerial::consume(size_t length)
+{
+  size_t n = available();
+  if (length > n)
+    length = n;
+  _rx_buffer_tail = (buffer_index_t)((_rx_buffer_tail + length) % SERIAL_RX_BUFFER_SIZE);
+}
+
 void HardwareSerial::clear(int who)
 {
   if (who & 0x10)
@@ -20,7 +20,7 @@ protected:
 
   volatile buffer_index_t _rx_buffer_head;
   volatile buffer_index_t _rx_buffer_tail;
-  unsigned _rx_buffer[SERIAL_RX_BUFFER_SIZE];  
+  uint8_t _rx_buffer[SERIAL_RX_BUFFER_SIZE];
 
 public:
   int save(uint8_t c);
@@ -35,6 +35,9 @@ public:
   virtual int available(void);
   virtual int peek(void);
   virtual int read(void);
+  virtual size_t readAvailable(char *buffer, size_t length) { return readSpans(buffer, length); }
+  virtual size_t peekSpan(const char **data);
+  virtual void consume(size_t length);
   virtual void flush(void){};
   virtual size_t write(uint8_t);
   inline size_t write(unsigned long n) { return write((uint8_t)n); }
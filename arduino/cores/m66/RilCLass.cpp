@@ -6,9 +6,15 @@
 RilClass::RilClass(HardwareSerial &uart) : _uart(&uart),
                                            _atCommandState(AT_COMMAND_IDLE),
                                            _ready(1),
-                                           _responseDataStorage(NULL)
+                                           _prompt(false),
+                                           _lineLength(0),
+                                           _lineContinued(false),
+                                           _lineType(RIL_LINE_URC),
+                                           _responseDataStorage(NULL),
+                                           _responseLength(0),
+                                           _onLine(NULL),
+                                           _onLineUser(NULL)
 {
-    _buffer.reserve(256);
 }
 
 int RilClass::noop()
@@ -40,6 +46,7 @@ void RilClass::send(const char *command)
     _uart->println(command);
     _atCommandState = AT_COMMAND_IDLE;
     _ready = 0;
+    resetLine();
 }
 
 void RilClass::sendf(const char *fmt, ...)
@@ -54,7 +61,7 @@ void RilClass::sendf(const char *fmt, ...)
 
 int RilClass::waitForResponse(unsigned long timeout, String *responseDataStorage)
 {
-    _responseDataStorage = responseDataStorage;
+    setResponseDataStorage(responseDataStorage);
     for (unsigned long start = millis(); (millis() - start) < timeout;)
     {        
         int r = ready();
@@ -64,8 +71,9 @@ int RilClass::waitForResponse(unsigned long timeout, String *responseDataStorage
             return r;
         }
     }
+    flushResponse(); // what arrived before the timeout
     _responseDataStorage = NULL;
-    _buffer = "";
+    resetLine();
     return -1;
 }
 
@@ -74,7 +82,7 @@ int RilClass::waitForPrompt(unsigned long timeout)
     for (unsigned long start = millis(); (millis() - start) < timeout;)
     {
         ready();
-        if (_buffer.endsWith(">"))
+        if (_prompt)
             return 1;
     }
     return -1;
@@ -86,79 +94,162 @@ int RilClass::ready()
     return _ready;
 }
 
+static bool lineStartsWith(const char *line, size_t len, const char *prefix, size_t prefix_len)
+{
+    return len >= prefix_len && 0 == memcmp(line, prefix, prefix_len);
+}
+
+#define LINE_IS(S) (len == sizeof(S) - 1 && 0 == memcmp(line, S, sizeof(S) - 1))
+#define LINE_STARTS(S) lineStartsWith(line, len, S, sizeof(S) - 1)
+
+ril_line_type_t RilClass::classifyLine(const char *line, size_t len)
+{
+    if (_atCommandState == AT_COMMAND_IDLE)
+        return (_ready == 0 && LINE_STARTS("AT")) ? RIL_LINE_ECHO : RIL_LINE_URC;
+    if (LINE_IS("OK"))
+        return RIL_LINE_OK;
+    if (LINE_IS("ERROR") || LINE_STARTS("+CME ERROR") || LINE_STARTS("+CMS ERROR"))
+        return RIL_LINE_ERROR;
+    if (LINE_IS("NO CARRIER"))
+        return RIL_LINE_NO_CARRIER;
+    return RIL_LINE_INTERMEDIATE;
+}
+
+void RilClass::appendResponse(const char *data, size_t len)
+{
+    while (len)
+    {
+        if (_responseLength == sizeof(_response)) // a long response, leave room for more than this segment
+        {
+            if (_responseDataStorage)
+                _responseDataStorage->reserve(2 * (_responseDataStorage->length() + sizeof(_response)));
+            flushResponse();
+        }
+        size_t n = sizeof(_response) - _responseLength;
+        if (n > len)
+            n = len;
+        memcpy(_response + _responseLength, data, n);
+        _responseLength += n;
+        data += n;
+        len -= n;
+    }
+}
+
+/* one concat for the collected data, String grows to the exact size on every call */
+void RilClass::flushResponse()
+{
+    if (_responseDataStorage && _responseLength)
+        _responseDataStorage->concat(_response, _responseLength);
+    _responseLength = 0;
+}
+
+/* appends response data, a continued line is joined without separator */
+void RilClass::storeResponse(const char *line, size_t len)
+{
+    if (!_responseDataStorage || !len)
+        return;
+    if (!_lineContinued && (_responseLength || _responseDataStorage->length()))
+        appendResponse("\r\n", 2);
+    appendResponse(line, len);
+}
+
+/* _line is full and the line goes on: hand the segment out and reuse the buffer */
+void RilClass::flushLine()
+{
+    size_t len = _lineLength;
+    while (len && _line[len - 1] == '\r') // may be the start of "\r\n", keep it for the next segment
+        len--;
+    if (len == 0) // nothing but '\r'
+    {
+        _lineLength = 0;
+        return;
+    }
+    if (!_lineContinued)
+        _lineType = classifyLine(_line, len);
+    if (_onLine)
+        _onLine(RIL_LINE_PARTIAL, _line, len, _onLineUser);
+    if (_lineType == RIL_LINE_INTERMEDIATE)
+        storeResponse(_line, len);
+    _lineContinued = true;
+    _lineLength -= len;
+    memmove(_line, _line + len, _lineLength);
+}
+
+/* called once per completed line, _line is not zero terminated */
+void RilClass::processLine()
+{
+    const char *line = _line;
+    size_t len = _lineLength;
+    while (len && line[len - 1] == '\r')
+        len--;
+    ril_line_type_t type = _lineContinued ? _lineType : classifyLine(line, len);
+    if (_onLine)
+        _onLine(type, line, len, _onLineUser);
+    switch (type)
+    {
+    case RIL_LINE_ECHO:
+        _atCommandState = AT_RECEIVING_RESPONSE;
+        break;
+    case RIL_LINE_INTERMEDIATE:
+        storeResponse(line, len);
+        break;
+    case RIL_LINE_OK:
+        _ready = 1;
+        break;
+    case RIL_LINE_ERROR:
+        _ready = 2;
+        break;
+    case RIL_LINE_NO_CARRIER:
+        _ready = 3;
+        break;
+    default:
+        break;
+    }
+    if (_ready != 0 && _atCommandState == AT_RECEIVING_RESPONSE)
+    {
+        if (_responseDataStorage != NULL)
+        {
+            flushResponse();
+            _responseDataStorage->trim();
+            _responseDataStorage = NULL;
+        }
+        _atCommandState = AT_COMMAND_IDLE;
+    }
+}
+
 void RilClass::poll()
 {
     arduinoProcessMessages(50);
     while (_uart->available())
     {
         char c = _uart->read();
-        _buffer += c;
         TRACE("%c", c);
-        switch (_atCommandState)
+        if (c == '\n')
         {
-        case AT_COMMAND_IDLE:
-        default:
-        {
-            if (_buffer.startsWith("AT") && _buffer.endsWith("\r\n"))
-            {
-                _atCommandState = AT_RECEIVING_RESPONSE;
-                _buffer = "";
-            }
-            else if (_buffer.endsWith("\r\n"))
-            {
-                _buffer = "";
-            }
-            break;
+            processLine();
+            resetLine();
+            if (_ready != 0 && _atCommandState == AT_COMMAND_IDLE)
+                return;
+            continue;
         }
-
-        case AT_RECEIVING_RESPONSE:
+        if (_lineLength == sizeof(_line))
+            flushLine();
+        _line[_lineLength++] = c;
+        if (_lineLength == 1 && c == '>' && !_lineContinued && _atCommandState == AT_RECEIVING_RESPONSE)
         {
-            if (c == '\n')
-            {
-                int responseResultIndex = _buffer.lastIndexOf("OK\r\n");
-                if (responseResultIndex != -1)
-                {
-                    _ready = 1;
-                }
-                else
-                {
-                    responseResultIndex = _buffer.lastIndexOf("ERROR\r\n");
-                    if (responseResultIndex != -1)
-                    {
-                        _ready = 2;
-                    }
-                    else
-                    {
-                        responseResultIndex = _buffer.lastIndexOf("NO CARRIER\r\n");
-                        if (responseResultIndex != -1)
-                        {
-                            _ready = 3;
-                        }
-                    }
-                }
-                if (_ready != 0)
-                {
-                    if (_responseDataStorage != NULL)
-                    {
-                        _buffer.remove(responseResultIndex);
-                        _buffer.trim();
-                        *_responseDataStorage = _buffer;
-                        _responseDataStorage = NULL;
-                    }
-                    _atCommandState = AT_COMMAND_IDLE;
-                    _buffer = "";
-                    return;
-                }
-            }
-            break;
+            _prompt = true;
+            if (_onLine)
+                _onLine(RIL_LINE_PROMPT, _line, 1, _onLineUser);
         }
-        } //switch
-    }     //while
+    } //while
 }
 
 void RilClass::setResponseDataStorage(String *responseDataStorage)
 {
     _responseDataStorage = responseDataStorage;
+    _responseLength = 0;
+    if (_responseDataStorage && _responseDataStorage->length())
+        _responseDataStorage->remove(0); // keeps its buffer
 }
 
 RilClass Ril(Virtual1);
\ No newline at end of file
@@ -5,6 +5,31 @@
 #include <HardwareSerial.h>
 extern HardwareSerial Virtual1;
 
+#ifndef RIL_LINE_SIZE
+#define RIL_LINE_SIZE 256
+#endif
+
+#ifndef RIL_RESPONSE_SIZE
+#define RIL_RESPONSE_SIZE 512 // response data is collected here and copied to the caller's String once
+#endif
+
+typedef enum
+{
+  RIL_LINE_ECHO,         // command echo "AT..."
+  RIL_LINE_INTERMEDIATE, // response data of the running command
+  RIL_LINE_URC,          // unsolicited line, no command running
+  RIL_LINE_OK,           // final: OK
+  RIL_LINE_ERROR,        // final: ERROR, +CME ERROR, +CMS ERROR
+  RIL_LINE_NO_CARRIER,   // final: NO CARRIER
+  RIL_LINE_PROMPT,       // "> " data prompt
+  RIL_LINE_PARTIAL,      // leading RIL_LINE_SIZE segment of a longer line, the rest follows
+} ril_line_type_t;
+
+/* line is a view into the internal buffer, valid only during the call
+   a line longer than RIL_LINE_SIZE arrives as RIL_LINE_PARTIAL segments,
+   the last segment carries the type of the whole line */
+typedef void (*ril_line_cb_t)(ril_line_type_t type, const char *line, size_t len, void *user);
+
 class RilClass
 {
 public:
@@ -32,6 +57,11 @@ public:
   int ready();
   void poll();
   void setResponseDataStorage(String *responseDataStorage);
+  void setLineHandler(ril_line_cb_t cb, void *user = NULL)
+  {
+    _onLine = cb;
+    _onLineUser = user;
+  }
 
   int SMS_formatText(bool f);
   int SMS_characterSet(const char *cs);
@@ -46,8 +76,29 @@ private:
     AT_RECEIVING_RESPONSE
   } _atCommandState;
   int _ready;
-  String _buffer;
+  bool _prompt;
+  char _line[RIL_LINE_SIZE];
+  size_t _lineLength;
+  bool _lineContinued;
+  ril_line_type_t _lineType;
   String *_responseDataStorage;
+  char _response[RIL_RESPONSE_SIZE];
+  size_t _responseLength;
+  ril_line_cb_t _onLine;
+  void *_onLineUser;
+
+  void resetLine()
+  {
+    _lineLength = 0;
+    _lineContinued = false;
+    _prompt = false;
+  }
+  ril_line_type_t classifyLine(const char *line, size_t len);
+  void storeResponse(const char *line, size_t len);
+  void appendResponse(const char *data, size_t len);
+  void flushResponse();
+  void flushLine();
+  void processLine();
 };
 
 extern RilClass Ril;
@@ -22,6 +22,9 @@
 #include <Arduino.h>
 #include <os_http.h>
 #include <os_ssl.h>
+#include "sys/socket.h"
+#include "sys/select.h"
+#include "http_stream.h"
 
 class LHTTP
 {
@@ -29,6 +32,8 @@ class LHTTP
 private:
     httpclient_t client;
     httpclient_data_t data;
+    http_stream parser;
+    bool secure;
 
     unsigned int limit_len(int len)
     {
@@ -62,6 +67,133 @@ private:
         return true;
     }
 
+    bool stream_connect(const char *host, int port)
+    {
+        struct sockaddr_in a;
+        if (!os_resolve_address(host, &a))
+            return false;
+        a.sin_family = AF_INET;
+        a.sin_port = HTONS(port);
+        if ((client.socket = ::socket(AF_INET, SOCK_STREAM, 0)) < 0)
+            return false;
+        client.is_http = 1;
+        if (::connect(client.socket, (struct sockaddr *)&a, sizeof(a)))
+        {
+            stream_close();
+            return false;
+        }
+        return true;
+    }
+
+    void stream_close()
+    {
+        if (secure)
+            disconnect();
+        else if (client.socket >= 0)
+            ::closesocket(client.socket);
+        client.socket = -1;
+        client.is_http = 0;
+    }
+
+    bool stream_write(const char *buf, size_t len)
+    {
+        while (len)
+        {
+            int res = secure ? os_ssl_write(context(), (const unsigned char *)buf, len) : ::send(client.socket, buf, len, 0);
+            if (res <= 0)
+                return false;
+            buf += res;
+            len -= res;
+        }
+        return true;
+    }
+
+    /* > 0 bytes, 0 closed, < 0 error or timeout */
+    int stream_read(char *buf, size_t len)
+    {
+        if (secure)
+        {
+            os_ssl_conf_read_timeout((mbedtls_ssl_config *)context()->conf, client.timeout_in_sec * 1000);
+            int res = os_ssl_read(context(), (unsigned char *)buf, len);
+            return MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY == res ? 0 : res;
+        }
+        fd_set rd;
+        struct timeval tv;
+        FD_ZERO(&rd);
+        FD_SET(client.socket, &rd);
+        tv.tv_sec = client.timeout_in_sec;
+        tv.tv_usec = 0;
+        if (::select(client.socket + 1, &rd, NULL, NULL, &tv) <= 0)
+            return -1;
+        return ::recvfrom(client.socket, buf, len, 0, NULL, NULL);
+    }
+
+    int stream(const char *url, const char *method, const char *body, size_t size, http_body_cb cb, void *user)
+    {
+        char host[128];
+        const char *path;
+        char *custom = client.header;
+        int port, res, len;
+        bool https;
+
+        if (NULL == url || NULL == cb || NULL == data.response_buf || !http_parse_url(url, &https, host, sizeof(host), &port, &path))
+            return HTTP_ERROR_PARSE;
+        if (client.socket >= 0)
+            stream_close();
+        secure = https;
+        if (https)
+        {
+            res = handshake(url, client.server_cert, client.client_cert, client.client_pk, client.timeout_in_sec);
+            client.header = custom;
+            if (res < 0)
+                return HTTP_ERROR_CONN;
+        }
+        else if (!stream_connect(host, port))
+            return HTTP_ERROR_CONN;
+
+        len = snprintf(data.response_buf, data.response_buf_len, "%s %s%s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n",
+                       method, '/' == *path ? "" : "/", path, host);
+        if (body && len > 0 && len < data.response_buf_len)
+            len += snprintf(data.response_buf + len, data.response_buf_len - len, "Content-Type: %s\r\nContent-Length: %u\r\n",
+                            data.post_content_type ? data.post_content_type : "application/octet-stream", (unsigned)size);
+        if (len <= 0 || len >= data.response_buf_len)
+        {
+            stream_close();
+            return HTTP_ERROR_PARSE;
+        }
+        if (!stream_write(data.response_buf, len) ||
+            (custom && !stream_write(custom, strlen(custom))) ||
+            !stream_write("\r\n", 2) ||
+            (body && !stream_write(body, size)))
+        {
+            stream_close();
+            return HTTP_ERROR_CONN;
+        }
+
+        parser.begin(cb, user, data.header_buf, data.header_buf_len, false);
+        res = HTTP_ERROR_PRTCL;
+        while (!parser.done())
+        {
+            len = stream_read(data.response_buf, data.response_buf_len);
+            if (len <= 0)
+            {
+                if (0 == len && parser.finish())
+                    break;
+                res = len ? HTTP_ERROR_CONN : HTTP_CLOSED;
+                break;
+            }
+            if (parser.feed((const uint8_t *)data.response_buf, len) < 0)
+            {
+                res = HTTP_ERROR;
+                break;
+            }
+        }
+        stream_close();
+        if (parser.done())
+            res = client.response_code = parser.status;
+        return res;
+    }
+
 public:
     LHTTP(int bufers_size = DEFAUT_LEN)
     {
@@ -83,6 +215,7 @@ public:
         memset(&data, 0, sizeof(httpclient_data_t));
         client.timeout_in_sec = 60;
         client.socket = -1;
+        secure = false;
 
         if (bufers_size)
         {
@@ -153,6 +286,28 @@ public:
         return res;
     }
 
+    /*
+        Streaming mode: the body goes to cb in the pieces it is received in
+        (chunked transfer is decoded), it is never held whole, so there is no
+        4 KB cap. The response buffer is the receive buffer, the header buffer
+        keeps the response headers. return -error or response code
+    */
+    int get(const char *url, http_body_cb cb, void *user = NULL)
+    {
+        return stream(url, "GET", NULL, 0, cb, user);
+    }
+
+    /* return -error or response code */
+    int post(const char *url, const char *buffer, size_t size, http_body_cb cb, void *user = NULL)
+    {
+        if (NULL == buffer || 0 == size)
+            return -1;
+        return stream(url, "POST", buffer, size, cb, user);
+    }
+
+    /* body bytes of the last streamed response */
+    long long get_received() { return parser.received; }
+
     /*** ONLY FOR SSL ***/
 
     int socket()
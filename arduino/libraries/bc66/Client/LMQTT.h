@@ -19,6 +19,7 @@
 #include <os_api.h>
 #include <WString.h>
 #include <IPAddress.h>
+#include "mqtt_publish.h"
 
 #define DEBUG_MQTT
 //::printf
@@ -27,6 +28,7 @@ class LMQTT
 {
 private:
     size_t _sz;
+    size_t _rx_sz;
     uint8_t *_tx;
     uint8_t *_rx;
     unsigned int _cmd_timeout;
@@ -45,17 +47,25 @@ public:
         free(_rx);
     }
 
-    LMQTT(size_t size = 256)
+    /* rx_size: largest incoming packet, 0 = size, up to LMQTT_RX_MAX */
+    LMQTT(size_t size = 256, size_t rx_size = 0)
     {
         if (size > 1024)
             size = 1024;
         if (size < 64)
             size = 64;
+        if (0 == rx_size)
+            rx_size = size;
+        if (rx_size > LMQTT_RX_MAX)
+            rx_size = LMQTT_RX_MAX;
+        if (rx_size < 64)
+            rx_size = 64;
+        _rx_sz = rx_size;
         onDisconnect = NULL;
         _cmd_timeout = 10000;
         _sz = size;
         _tx = (uint8_t *)calloc(1, size);
-        _rx = (uint8_t *)calloc(1, size);
+        _rx = (uint8_t *)calloc(1, rx_size);
         memset(&NT, 0, sizeof(MqttNetwork));
         memset(&CL, 0, sizeof(MqttClient));
         memset(&CD, 0, sizeof(MQTTPacket_connectData));
@@ -108,7 +118,7 @@ public:
             DEBUG_MQTT("[MQTT] Network: %d\n", res);
             if (0 == res)
             {
-                os_mqtt_Client(&CL, &NT, _cmd_timeout, _tx, _sz, _rx, _sz);
+                os_mqtt_Client(&CL, &NT, _cmd_timeout, _tx, _sz, _rx, _rx_sz);
                 res = os_mqtt_Connect(&CL, &CD);
             }
         }
@@ -1,12 +1,14 @@
 //#pragma GCC error "LMQTTSecure is not ready yet"
 
 #include <LHTTP.h>
+#include "mqtt_publish.h"
 
 class LMQTTSecure : private LHTTP
 {
 
 private:
     size_t _sz;
+    size_t _rx_sz;
     uint8_t *_tx;
     uint8_t *_rx;
     unsigned int _cmd_timeout;
@@ -70,17 +72,25 @@ public:
         free(_rx);
     }
 
-    LMQTTSecure(size_t size = 256)
+    /* rx_size: largest incoming packet, 0 = size, up to LMQTT_RX_MAX */
+    LMQTTSecure(size_t size = 256, size_t rx_size = 0)
     {
         if (size > 1024)
             size = 1024;
         if (size < 256)
             size = 256;
+        if (0 == rx_size)
+            rx_size = size;
+        if (rx_size > LMQTT_RX_MAX)
+            rx_size = LMQTT_RX_MAX;
+        if (rx_size < 256)
+            rx_size = 256;
+        _rx_sz = rx_size;
         onDisconnect = NULL;
         _cmd_timeout = 10000;
         _sz = size;
         _tx = (uint8_t *)calloc(1, size);
-        _rx = (uint8_t *)calloc(1, size);
+        _rx = (uint8_t *)calloc(1, rx_size);
         memset(&NT, 0, sizeof(MqttNetwork));
         memset(&CL, 0, sizeof(MqttClient));
         memset(&CD, 0, sizeof(MQTTPacket_connectData));
@@ -118,7 +128,7 @@ public:
             if (NT.my_socket >= 0)
             {
                 NT.ssl.conf = (mbedtls_ssl_config *)this; //// we not use original mqtt.ssl... for now
-                os_mqtt_Client(&CL, &NT, _cmd_timeout, _tx, _sz, _rx, _sz);
+                os_mqtt_Client(&CL, &NT, _cmd_timeout, _tx, _sz, _rx, _rx_sz);
                 res = os_mqtt_Connect(&CL, &CD);
             }
             if (res < 0)
@@ -0,0 +1,37 @@
+/*
+ * Arduino.h
+ *
+ * Host stand-in for the BC66 core, only what LHTTP.h uses, for
+ * http_stream_server. The socket calls are the host's own.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+
+#define HTONS(x) htons(x)
+
+static inline int closesocket(int fd) { return close(fd); }
+
+static inline bool os_resolve_address(const char *server, struct sockaddr_in *addr)
+{
+    struct addrinfo hints, *ai;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (NULL == server || NULL == addr || getaddrinfo(server, NULL, &hints, &ai))
+        return false;
+    memcpy(addr, ai->ai_addr, sizeof(*addr));
+    freeaddrinfo(ai);
+    return true;
+}
+
+#endif
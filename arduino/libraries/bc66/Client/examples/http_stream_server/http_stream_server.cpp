@@ -0,0 +1,134 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   http_stream_server.cpp
+ *
+ * Description:
+ * ------------
+ *   Runs the streaming mode of LHTTP against server.py: the request goes
+ *   out and the response comes back over real sockets through
+ *   LHTTP::stream(), only the firmware headers are host stand-ins
+ *   (Arduino.h, os_http.h and os_ssl.h here, https is not run). Multi-MB
+ *   Content-Length, chunked and close-delimited bodies and a POST echo
+ *   must arrive byte for byte in pieces no larger than the response
+ *   buffer. A 404, a callback that aborts and a refused connection must
+ *   give their codes. Prints the pieces and the rate of each transfer:
+ *
+ *   g++ -O2 -I. -I../.. http_stream_server.cpp -o http_stream_server
+ *   python3 server.py 18080 &
+ *   ./http_stream_server 18080 [MB]
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "LHTTP.h"
+
+#define BUFFER_SIZE 512
+
+typedef struct
+{
+    long long bytes;
+    unsigned pieces;
+    size_t max_piece;
+    bool broken;
+    long long abort_at; // the callback fails past this, -1 never
+} ST_Body;
+
+static int on_body(const uint8_t *data, size_t size, void *user)
+{
+    ST_Body *b = (ST_Body *)user;
+    for (size_t i = 0; i < size; i++)
+        if (data[i] != (uint8_t)(((b->bytes + i) * 31 + 7) & 0xFF))
+            b->broken = true;
+    b->bytes += size;
+    b->pieces++;
+    if (size > b->max_piece)
+        b->max_piece = size;
+    return b->abort_at >= 0 && b->bytes > b->abort_at ? -1 : 0;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int check(LHTTP &http, const char *what, int res, int code, ST_Body &b, long long bytes, double t)
+{
+    bool ok = res == code && !b.broken && b.max_piece <= BUFFER_SIZE && (bytes < 0 || (b.bytes == bytes && http.get_received() == bytes));
+    printf("%-28s %4d, %9lld bytes in %6u pieces (max %3u)", what, res, b.bytes, b.pieces, (unsigned)b.max_piece);
+    if (t > 0 && b.bytes > 100000)
+        printf(", %6.1f MB/s", b.bytes / t / 1e6);
+    printf("%s\n", ok ? "" : "  FAILED");
+    return !ok;
+}
+
+int main(int argc, char **argv)
+{
+    int port = argc > 1 ? atoi(argv[1]) : 18080;
+    long long size = (argc > 2 ? atoll(argv[2]) : 3) * 1024 * 1024 + 17; // not a multiple of anything
+    static const char *kinds[] = {"length", "chunked", "close"};
+    char url[128];
+    int failed = 0;
+    static LHTTP http(BUFFER_SIZE); // zeroed like a sketch global, clean() frees the old buffers
+    http.set_timeout(10);
+
+    for (unsigned k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+    {
+        ST_Body b = {0, 0, 0, false, -1};
+        snprintf(url, sizeof(url), "http://127.0.0.1:%d/%s/%lld", port, kinds[k], size);
+        double t = now();
+        int res = http.get(url, on_body, &b);
+        failed += check(http, url + 16, res, 200, b, size, now() - t);
+    }
+    failed += NULL == strstr(http.get_header(), "Connection: close");
+
+    /* the request body comes back chunked */
+    {
+        long long n = size / 3;
+        char *body = (char *)malloc(n);
+        ST_Body b = {0, 0, 0, false, -1};
+        for (long long i = 0; i < n; i++)
+            body[i] = (char)((i * 31 + 7) & 0xFF);
+        snprintf(url, sizeof(url), "http://127.0.0.1:%d/echo", port);
+        double t = now();
+        int res = http.post(url, body, n, on_body, &b);
+        failed += check(http, "POST /echo", res, 200, b, n, now() - t);
+        free(body);
+    }
+
+    {
+        ST_Body b = {0, 0, 0, false, -1};
+        snprintf(url, sizeof(url), "http://127.0.0.1:%d/missing", port);
+        int res = http.get(url, on_body, &b);
+        b.broken = false; // "not found" is no pattern
+        failed += check(http, "/missing", res, 404, b, 9, 0);
+    }
+
+    {
+        ST_Body b = {0, 0, 0, false, 100000};
+        snprintf(url, sizeof(url), "http://127.0.0.1:%d/chunked/%lld", port, size);
+        int res = http.get(url, on_body, &b);
+        failed += check(http, "callback aborts", res, HTTP_ERROR, b, -1, 0);
+        failed += b.bytes > 100000 + BUFFER_SIZE;
+    }
+
+    {
+        ST_Body b = {0, 0, 0, false, -1};
+        snprintf(url, sizeof(url), "http://127.0.0.1:%d/length/1", port + 1);
+        int res = http.get(url, on_body, &b);
+        failed += check(http, "connection refused", res, HTTP_ERROR_CONN, b, -1, 0);
+        failed += 0 != b.pieces;
+    }
+
+    if (failed)
+    {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * os_http.h
+ *
+ * Host stand-in, the types of the SDK header. The firmware client
+ * (os_http_execute and the https connect) is not there on the host.
+ */
+
+#ifndef API_HTTP_H_
+#define API_HTTP_H_
+
+#include "os_ssl.h"
+
+typedef enum
+{
+    HTTP_GET,
+    HTTP_POST,
+    HTTP_PUT,
+    HTTP_DELETE,
+    HTTP_HEAD
+} HTTP_REQUEST_TYPE;
+
+typedef enum
+{
+    HTTP_ERROR_PARSE = -6,
+    HTTP_UNRESOLVED_DNS = -5,
+    HTTP_ERROR_PRTCL = -4,
+    HTTP_ERROR = -3,
+    HTTP_CLOSED = -2,
+    HTTP_ERROR_CONN = -1,
+    HTTP_OK = 0,
+    HTTP_RETRIEVE_MORE_DATA = 1
+} HTTP_RESULT;
+
+typedef struct
+{
+    int socket;
+    int remote_port;
+    int response_code;
+    char *header;
+    char *auth_user;
+    char *auth_password;
+    uint8_t is_http;
+    int method;
+    unsigned int timeout_in_sec;
+    int start_pos;
+    int total_len;
+    int retry_cnt;
+    const char *server_cert;
+    const char *client_cert;
+    const char *client_pk;
+    int server_cert_len;
+    int client_cert_len;
+    int client_pk_len;
+    void *ssl;
+    uint8_t is_disable_request_header_range_flag;
+    int reserved;
+} httpclient_t;
+
+typedef struct
+{
+    uint8_t is_more;
+    uint8_t is_chunked;
+    int retrieve_len;
+    int response_content_len;
+    int content_block_len;
+    int post_buf_len;
+    int response_buf_len;
+    int header_buf_len;
+    char *post_content_type;
+    char *post_buf;
+    char *response_buf;
+    char *header_buf;
+    int reserved;
+} httpclient_data_t;
+
+typedef struct
+{
+    mbedtls_ssl_context ssl_ctx;
+} httpclient_ssl_t;
+
+static inline int os_http_execute(httpclient_t *c, char *u, int m, httpclient_data_t *d) { return HTTP_ERROR_CONN; }
+static inline int os_http_connect(httpclient_t *c, char *u) { return HTTP_ERROR_CONN; }
+static inline void os_http_close(httpclient_t *c) {}
+
+#endif
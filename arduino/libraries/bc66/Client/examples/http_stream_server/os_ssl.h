@@ -0,0 +1,29 @@
+/*
+ * os_ssl.h
+ *
+ * Host stand-in, the https path of LHTTP is not run on the host.
+ */
+
+#ifndef API_SSL_H_
+#define API_SSL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY -0x7880
+
+typedef struct
+{
+    int unused;
+} mbedtls_ssl_config;
+
+typedef struct
+{
+    const mbedtls_ssl_config *conf;
+} mbedtls_ssl_context;
+
+static inline int os_ssl_read(mbedtls_ssl_context *s, unsigned char *b, size_t l) { return -1; }
+static inline int os_ssl_write(mbedtls_ssl_context *s, const unsigned char *b, size_t l) { return -1; }
+static inline void os_ssl_conf_read_timeout(mbedtls_ssl_config *c, uint32_t t) {}
+
+#endif
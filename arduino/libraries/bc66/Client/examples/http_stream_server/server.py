@@ -0,0 +1,121 @@
+#
+# HTTP server stub for http_stream_server.cpp
+#
+#   python3 server.py [port]
+#
+# One thread per connection, one request per connection. Body byte i is
+# (i * 31 + 7) & 0xFF everywhere.
+#
+#   GET /length/N    N bytes with Content-Length
+#   GET /chunked/N   N bytes chunked, random chunk sizes, some chunk
+#                    extensions and a trailer
+#   GET /close/N     N bytes, no length, the body ends with the connection
+#   GET /missing     404 with a short Content-Length body
+#   POST /echo       the request body back, chunked
+#
+# Writes go out in random pieces so the client sees every kind of split.
+#
+
+import random
+import socket
+import sys
+import threading
+
+
+def pattern(n):
+    return bytes((i * 31 + 7) & 0xFF for i in range(256)) * (n // 256) + \
+        bytes((i * 31 + 7) & 0xFF for i in range(n % 256))
+
+
+def send_pieces(c, data, rnd):
+    off = 0
+    while off < len(data):
+        n = rnd.randint(1, 16384)
+        c.sendall(data[off:off + n])
+        off += n
+
+
+def read_request(c):
+    data = b''
+    while b'\r\n\r\n' not in data:
+        d = c.recv(4096)
+        if not d:
+            return None, None, None
+        data += d
+    head, body = data.split(b'\r\n\r\n', 1)
+    lines = head.decode('latin-1').split('\r\n')
+    method, path = lines[0].split(' ')[:2]
+    length = 0
+    for line in lines[1:]:
+        k, v = line.split(':', 1)
+        if k.strip().lower() == 'content-length':
+            length = int(v)
+    while len(body) < length:
+        d = c.recv(65536)
+        if not d:
+            break
+        body += d
+    return method, path, body
+
+
+def chunked(body, rnd):
+    out, off = [], 0
+    while off < len(body):
+        n = rnd.randint(1, 8192)
+        ext = ';ext=%d' % n if rnd.random() < 0.1 else ''
+        out.append(b'%x%s\r\n' % (len(body[off:off + n]), ext.encode()))
+        out.append(body[off:off + n] + b'\r\n')
+        off += n
+    out.append(b'0\r\nX-Trailer: done\r\n\r\n')
+    return b''.join(out)
+
+
+def serve(c, seed):
+    rnd = random.Random(seed)
+    try:
+        method, path, body = read_request(c)
+        if method is None:
+            return
+        parts = path.strip('/').split('/')
+        if method == 'POST' and parts[0] == 'echo':
+            head = b'HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n'
+            send_pieces(c, head + chunked(body, rnd), rnd)
+        elif parts[0] == 'length':
+            body = pattern(int(parts[1]))
+            head = b'HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n' % len(body)
+            send_pieces(c, head + body, rnd)
+        elif parts[0] == 'chunked':
+            body = pattern(int(parts[1]))
+            head = b'HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n'
+            send_pieces(c, head + chunked(body, rnd), rnd)
+        elif parts[0] == 'close':
+            body = pattern(int(parts[1]))
+            head = b'HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n'
+            send_pieces(c, head + body, rnd)
+        else:
+            c.sendall(b'HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\n\r\nnot found')
+        print('%s %s' % (method, path))
+        sys.stdout.flush()
+    except (BrokenPipeError, ConnectionResetError):
+        print('%s %s: client went away' % (method, path))
+    finally:
+        c.close()
+
+
+def main():
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 18080
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.bind(('127.0.0.1', port))
+    s.listen(4)
+    print('listening on %d' % port)
+    sys.stdout.flush()
+    seed = 0
+    while True:
+        c, _ = s.accept()
+        seed += 1
+        threading.Thread(target=serve, args=(c, seed), daemon=True).start()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,143 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   http_stream_split.cpp
+ *
+ * Description:
+ * ------------
+ *   Drives the http_stream parser of the LHTTP streaming mode through a
+ *   Content-Length, a chunked and a close-delimited response. Every
+ *   response is fed split at every byte boundary, split in three at every
+ *   pair of boundaries and one byte at a time, the body must come out
+ *   unchanged each time. http_stream.h has no Arduino dependencies, so it
+ *   runs on any Linux box:
+ *
+ *   g++ -O2 -I../.. http_stream_split.cpp -o http_stream_split
+ *   ./http_stream_split
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "http_stream.h"
+
+typedef struct
+{
+    const char *name;
+    const char *response;
+    const char *body;
+    bool closes; // the body ends with the connection
+} ST_Case;
+
+static const ST_Case cases[] = {
+    {"content-length",
+     "HTTP/1.1 200 OK\r\n"
+     "Content-Type: application/octet-stream\r\n"
+     "Content-Length: 25\r\n"
+     "\r\n"
+     "line one\r\nline two\r\n\n\r0,;",
+     "line one\r\nline two\r\n\n\r0,;", false},
+    {"chunked",
+     "\r\nHTTP/1.1 100 Continue\r\n\r\n"
+     "HTTP/1.1 200 OK\r\n"
+     "Transfer-Encoding: gzip, chunked\r\n"
+     "X-Long: aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\r\n"
+     "\r\n"
+     "5\r\nhello\r\n"
+     "A;name=value\r\n, world\r\n!\r\n"
+     "1\r\n\n\r\n"
+     "0\r\n"
+     "X-Trailer: yes\r\n"
+     "\r\n",
+     "hello, world\r\n!\n", false},
+    {"close-delimited",
+     "HTTP/1.0 200 OK\r\n"
+     "Connection: close\r\n"
+     "\r\n"
+     "until the peer closes\r\n0\r\n\r\n",
+     "until the peer closes\r\n0\r\n\r\n", true},
+};
+
+#define CASES (sizeof(cases) / sizeof(cases[0]))
+
+typedef struct
+{
+    const char *expect;
+    size_t expect_len;
+    size_t offset;
+    bool bad;
+} ST_Body;
+
+static int on_body(const uint8_t *data, size_t size, void *user)
+{
+    ST_Body *b = (ST_Body *)user;
+    if (b->offset + size > b->expect_len || memcmp(b->expect + b->offset, data, size))
+        b->bad = true;
+    b->offset += size;
+    return 0;
+}
+
+/* feeds the response in the given pieces, true if the body came out right */
+static bool run(const ST_Case *c, const size_t *cut, int cuts)
+{
+    size_t size = strlen(c->response), from = 0;
+    ST_Body b = {c->body, strlen(c->body), 0, false};
+    http_stream p;
+    p.begin(on_body, &b, NULL, 0, false);
+    for (int i = 0; i <= cuts; i++)
+    {
+        size_t to = i < cuts ? cut[i] : size;
+        if (to > from && p.feed((const uint8_t *)c->response + from, to - from) != (int)(to - from))
+            return false;
+        from = to;
+    }
+    if (c->closes)
+        p.finish();
+    return p.done() && 200 == p.status && !b.bad && b.offset == b.expect_len && p.received == (long long)b.expect_len;
+}
+
+static int check(const ST_Case *c)
+{
+    size_t size = strlen(c->response), cut[2];
+    int feeds = 0;
+    for (cut[0] = 0; cut[0] <= size; cut[0]++)
+    {
+        if (!run(c, cut, 1))
+        {
+            printf("%s: split at %u failed\n", c->name, (unsigned)cut[0]);
+            return -1;
+        }
+        feeds++;
+        for (cut[1] = cut[0]; cut[1] <= size; cut[1]++, feeds++)
+            if (!run(c, cut, 2))
+            {
+                printf("%s: split at %u and %u failed\n", c->name, (unsigned)cut[0], (unsigned)cut[1]);
+                return -1;
+            }
+    }
+    {
+        ST_Body b = {c->body, strlen(c->body), 0, false};
+        http_stream p;
+        p.begin(on_body, &b, NULL, 0, false);
+        for (size_t i = 0; i < size; i++)
+            p.feed((const uint8_t *)c->response + i, 1);
+        if (c->closes)
+            p.finish();
+        if (!p.done() || b.bad || b.offset != b.expect_len)
+        {
+            printf("%s: one byte at a time failed\n", c->name);
+            return -1;
+        }
+        feeds++;
+    }
+    printf("%-16s %3u bytes, %6d ways fed, body unchanged\n", c->name, (unsigned)size, feeds);
+    return 0;
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < CASES; i++)
+        if (check(&cases[i]))
+            return 1;
+    return 0;
+}
@@ -0,0 +1,91 @@
+#
+# Broker stub for mqtt_publish_large.cpp
+#
+#   python3 broker.py [port]
+#
+# Accepts one client, acks every QOS1 PUBLISH, sends the client one QOS1
+# PUBLISH of its own before the first PUBACK (the client has to ack it
+# while it waits) and checks every payload byte: payload[i] is
+# (i * 31 + 7) & 0xFF. Prints one line per packet and the bytes on the wire.
+#
+
+import socket
+import sys
+
+
+def read_exact(c, n):
+    data = b''
+    while len(data) < n:
+        d = c.recv(n - len(data))
+        if not d:
+            return None
+        data += d
+    return data
+
+
+def read_packet(c):
+    h = read_exact(c, 1)
+    if h is None:
+        return None, None, 0
+    rem, mul, wire = 0, 1, 1
+    while True:
+        b = read_exact(c, 1)[0]
+        wire += 1
+        rem += (b & 127) * mul
+        mul *= 128
+        if not b & 128:
+            break
+    body = read_exact(c, rem) if rem else b''
+    return h[0], body, wire + rem
+
+
+def main():
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 18830
+    s = socket.socket()
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.bind(('127.0.0.1', port))
+    s.listen(1)
+    c, _ = s.accept()
+    wire, bad, sent_cmd, cmd_acked = 0, 0, False, False
+    while True:
+        t, body, n = read_packet(c)
+        if t is None:
+            break
+        wire += n
+        kind = t >> 4
+        if kind == 14:  # DISCONNECT
+            break
+        if kind == 4:  # PUBACK of the command below
+            cmd_acked = (body[0] << 8 | body[1]) == 77
+            print("PUBACK id=%d from the client" % (body[0] << 8 | body[1]))
+            continue
+        if kind != 3:
+            print("unexpected packet type %d" % kind)
+            bad += 1
+            continue
+        tl = body[0] << 8 | body[1]
+        topic = body[2:2 + tl].decode()
+        qos = (t >> 1) & 3
+        p = 2 + tl
+        pid = None
+        if qos:
+            pid = body[p] << 8 | body[p + 1]
+            p += 2
+        payload = body[p:]
+        ok = all(b == (i * 31 + 7) & 0xFF for i, b in enumerate(payload))
+        bad += not ok
+        print("PUBLISH %s q%d r%d id=%s %d bytes %s" % (topic, qos, t & 1, pid, len(payload), "ok" if ok else "BAD"))
+        if qos == 1:
+            if not sent_cmd:
+                c.sendall(bytes([0x32, 2 + 3 + 2 + 2, 0, 3]) + b'cmd' + bytes([0, 77]) + b'go')
+                sent_cmd = True
+            c.sendall(bytes([0x40, 2, pid >> 8, pid & 0xFF]))
+    c.close()
+    if sent_cmd and not cmd_acked:
+        print("the client did not ack the command")
+        bad += 1
+    print("%d bytes on the wire, %s" % (wire, "all payloads intact" if not bad else "%d BAD" % bad))
+    sys.exit(1 if bad else 0)
+
+
+main()
@@ -0,0 +1,345 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   mqtt_publish_large.cpp
+ *
+ * Description:
+ * ------------
+ *   Publishes through mqtt_common::publish_large() to broker.py and counts
+ *   what happens on the way. The firmware's Paho client is replaced by a
+ *   small host copy of its publish path: the PUBLISH is serialized into the
+ *   tx buffer, written with sendPacket (which restarts the keepalive timer)
+ *   and a QOS1 publish waits for its PUBACK in waitfor, acking what the
+ *   broker sends meanwhile. Payloads of 0..200000 bytes, partial writes, a
+ *   gathered payload and the packet id wrap are checked byte by byte by
+ *   the broker. Then an 8 KB batch is compared with 8 publish() of 1 KB:
+ *
+ *   g++ -O2 -I../.. mqtt_publish_large.cpp -o mqtt_publish_large
+ *   python3 broker.py 18830 &
+ *   ./mqtt_publish_large 18830
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "mqtt_publish.h"
+
+/* the parts of os_mqtt.h that mqtt_common uses */
+typedef enum
+{
+    QOS0,
+    QOS1,
+    QOS2
+} QoS;
+typedef struct
+{
+    char *cstring;
+} MQTTString;
+typedef struct
+{
+    int unused;
+} MQTTPacket_willOptions;
+typedef struct
+{
+    MQTTString clientID, username, password;
+    uint8_t willFlag, cleansession;
+    uint16_t keepAliveInterval;
+    MQTTPacket_willOptions will;
+} MQTTPacket_connectData;
+typedef struct
+{
+    QoS qos;
+    uint8_t retained, dup;
+    uint16_t id;
+    void *payload;
+    size_t payloadlen;
+} MQTTMessage;
+typedef struct
+{
+    MQTTMessage *message;
+} MessageData;
+typedef void (*messageHandler)(MessageData *);
+typedef struct MqttNetwork
+{
+    int my_socket;
+    int (*mqttread)(struct MqttNetwork *, uint8_t *, int, int);
+    int (*mqttwrite)(struct MqttNetwork *, uint8_t *, int, int);
+} MqttNetwork;
+typedef struct
+{
+    unsigned int systick_period;
+    unsigned int end_time;
+} MqttTimer;
+typedef struct
+{
+    unsigned int next_packetid;
+    unsigned int command_timeout_ms;
+    size_t buf_size;
+    size_t readbuf_size;
+    uint8_t *buf;
+    uint8_t *readbuf;
+    unsigned int keepAliveInterval;
+    uint8_t ping_outstanding;
+    int isconnected;
+    MqttNetwork *ipstack;
+    MqttTimer ping_timer;
+} MqttClient;
+class String
+{
+public:
+    const char *c_str() const { return ""; }
+};
+static void RIL_GetIMEI(char *imei) { strcpy(imei, "0"); }
+
+static unsigned int millis(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* what the network and the client did */
+static unsigned writes, ping_restarts, received_publish;
+static size_t wire_bytes, copied_bytes, write_cap = 1u << 30;
+
+static int tcp_read(MqttNetwork *n, uint8_t *buf, int len, int timeout_ms)
+{
+    int got = 0;
+    while (got < len)
+    {
+        int r = recv(n->my_socket, buf + got, len - got, 0);
+        if (r <= 0)
+            return got ? got : -1;
+        got += r;
+    }
+    return got;
+}
+
+static int tcp_write(MqttNetwork *n, uint8_t *buf, int len, int timeout_ms)
+{
+    if ((size_t)len > write_cap)
+        len = write_cap;
+    writes++;
+    len = write(n->my_socket, buf, len);
+    if (len > 0)
+        wire_bytes += len;
+    return len;
+}
+
+/* host copy of the Paho publish path of the firmware */
+static int sendPacket(MqttClient *c, int length)
+{
+    int rc = -1, sent = 0;
+    while (sent < length)
+    {
+        rc = c->ipstack->mqttwrite(c->ipstack, &c->buf[sent], length, c->command_timeout_ms);
+        if (rc < 0)
+            break;
+        sent += rc;
+    }
+    if (sent != length)
+        return -1;
+    c->ping_timer.end_time = millis() + c->keepAliveInterval * 1000; // TimerCountdown
+    ping_restarts++;
+    return 0;
+}
+
+static int readPacket(MqttClient *c, size_t *len)
+{
+    size_t rem = 0, n = 1;
+    unsigned shift = 0;
+    uint8_t b;
+    if (1 != c->ipstack->mqttread(c->ipstack, c->readbuf, 1, c->command_timeout_ms))
+        return -1;
+    do
+    {
+        if (1 != c->ipstack->mqttread(c->ipstack, &b, 1, c->command_timeout_ms))
+            return -1;
+        c->readbuf[n++] = b;
+        rem |= (size_t)(b & 0x7F) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    if (n + rem > c->readbuf_size || (rem && (int)rem != c->ipstack->mqttread(c->ipstack, c->readbuf + n, rem, c->command_timeout_ms)))
+        return -1;
+    *len = n + rem;
+    return c->readbuf[0] >> 4;
+}
+
+static int cycle(MqttClient *c)
+{
+    size_t len;
+    int type = readPacket(c, &len);
+    if (3 == type) /* PUBLISH, ack a QOS1 one */
+    {
+        size_t h = 1, tl;
+        while (c->readbuf[h++] & 0x80)
+            ;
+        tl = c->readbuf[h] << 8 | c->readbuf[h + 1];
+        received_publish++;
+        if (1 == ((c->readbuf[0] >> 1) & 3))
+        {
+            c->buf[0] = 0x40;
+            c->buf[1] = 2;
+            c->buf[2] = c->readbuf[h + 2 + tl];
+            c->buf[3] = c->readbuf[h + 3 + tl];
+            if (sendPacket(c, 4))
+                return -1;
+        }
+    }
+    else if (13 == type) /* PINGRESP */
+        c->ping_outstanding = 0;
+    return type;
+}
+
+static int os_mqtt_Publish(MqttClient *c, const char *topic, MQTTMessage *m)
+{
+    size_t tl = strlen(topic), rem = 2 + tl + (m->qos ? 2 : 0) + m->payloadlen, len = 1;
+    unsigned end = millis() + c->command_timeout_ms;
+    int rc;
+    if (!c->isconnected)
+        return -1;
+    if (m->qos)
+        m->id = c->next_packetid = (c->next_packetid == 65535) ? 1 : c->next_packetid + 1;
+    if (1 + 4 + rem > c->buf_size)
+        return -1; // MQTTPACKET_BUFFER_TOO_SHORT
+    c->buf[0] = 0x30 | (m->qos << 1) | (m->retained ? 1 : 0);
+    do
+    {
+        uint8_t b = rem & 0x7F;
+        rem >>= 7;
+        c->buf[len++] = rem ? b | 0x80 : b;
+    } while (rem);
+    c->buf[len++] = tl >> 8;
+    c->buf[len++] = tl & 0xFF;
+    memcpy(c->buf + len, topic, tl);
+    len += tl;
+    if (m->qos)
+    {
+        c->buf[len++] = m->id >> 8;
+        c->buf[len++] = m->id & 0xFF;
+    }
+    memcpy(c->buf + len, m->payload, m->payloadlen);
+    copied_bytes += m->payloadlen;
+    len += m->payloadlen;
+    if (sendPacket(c, len))
+        return -1;
+    if (QOS1 != m->qos)
+        return 0;
+    do /* waitfor PUBACK */
+        rc = cycle(c);
+    while (rc >= 0 && 4 != rc && (int)(end - millis()) > 0);
+    if (4 != rc || (c->readbuf[2] << 8 | c->readbuf[3]) != m->id)
+        return -1;
+    return 0;
+}
+
+static int os_mqtt_Subscribe(MqttClient *, const char *, QoS, messageHandler) { return -1; }
+static int os_mqtt_Unsubscribe(MqttClient *, const char *) { return -1; }
+static int os_mqtt_Yield(MqttClient *, int) { return -1; }
+
+class LMQTT_Host
+{
+public:
+    MqttNetwork NT;
+    MqttClient CL;
+    MQTTPacket_connectData CD;
+    unsigned int _cmd_timeout;
+#include "mqtt_common"
+};
+
+static uint8_t big[200000];
+static uint8_t tx[1024], rx[1024];
+
+static void reset(void)
+{
+    writes = ping_restarts = 0;
+    wire_bytes = copied_bytes = 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const size_t sizes[] = {0, 1, 100, 200, 240, 241, 256, 1000, 8192, 200000};
+    LMQTT_Host t;
+    struct sockaddr_in a;
+    int fails = 0;
+    memset(&t, 0, sizeof(t));
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_port = htons(argc > 1 ? atoi(argv[1]) : 18830);
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    t.NT.my_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(t.NT.my_socket, (struct sockaddr *)&a, sizeof(a)))
+    {
+        perror("connect");
+        return 1;
+    }
+    t.NT.mqttread = tcp_read;
+    t.NT.mqttwrite = tcp_write;
+    t._cmd_timeout = 2000;
+    t.CL.ipstack = &t.NT;
+    t.CL.command_timeout_ms = 2000;
+    t.CL.buf = tx;
+    t.CL.buf_size = sizeof(tx);
+    t.CL.readbuf = rx;
+    t.CL.readbuf_size = sizeof(rx);
+    t.CL.keepAliveInterval = 60;
+    t.CL.next_packetid = 65533; // wraps to 1 on the way
+    t.CL.isconnected = 1;
+    for (size_t i = 0; i < sizeof(big); i++)
+        big[i] = i * 31 + 7;
+
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++)
+    {
+        QoS qos = k & 2 ? QOS1 : QOS0;
+        bool ok;
+        reset();
+        write_cap = k & 1 ? 333 : 1u << 30;
+        ok = t.publish_large("dev/batch", big, sizes[k], qos, k & 4);
+        printf("%6u bytes QOS%d: %s, %u writes, keepalive restarted %u\n", (unsigned)sizes[k], qos, ok ? "ok" : "FAILED", writes, ping_restarts);
+        fails += !ok || 0 == ping_restarts || tcp_write != t.NT.mqttwrite;
+    }
+    {
+        mqtt_buffer_t v[] = {{big, 10}, {NULL, 0}, {big + 10, 300}, {big + 310, 7890}};
+        bool ok;
+        reset();
+        write_cap = 1u << 30;
+        ok = t.publish_large("dev/batch", v, 4, QOS1);
+        printf("gather of 4 QOS1: %s, %u writes\n", ok ? "ok" : "FAILED", writes);
+        fails += !ok;
+    }
+    fails += t.publish_large("x", big, 1, QOS2);
+    {
+        char topic[300];
+        memset(topic, 'a', sizeof(topic) - 1);
+        topic[sizeof(topic) - 1] = 0;
+        fails += t.publish_large(topic, big, 1);
+    }
+
+    reset();
+    t.publish_large("dev/batch", big, 8192, QOS1);
+    printf("8 KB publish_large:   %u writes, %6u bytes on the wire, %5u payload bytes copied\n", writes, (unsigned)wire_bytes, (unsigned)copied_bytes);
+    reset();
+    for (int i = 0; i < 8; i++)
+    {
+        MQTTMessage m;
+        memset(&m, 0, sizeof(m));
+        m.payload = big;
+        m.payloadlen = 1000;
+        m.qos = QOS1;
+        t.publish("dev/batch", &m);
+    }
+    printf("8 x 1 KB publish():   %u writes, %6u bytes on the wire, %5u payload bytes copied\n", writes, (unsigned)wire_bytes, (unsigned)copied_bytes);
+
+    tx[0] = 0xE0; /* DISCONNECT */
+    tx[1] = 0;
+    write(t.NT.my_socket, tx, 2);
+    close(t.NT.my_socket);
+    if (1 != received_publish)
+        fails++;
+    printf(fails ? "%d FAILED\n" : "client side ok\n", fails);
+    return fails != 0;
+}
@@ -0,0 +1,272 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2020 Georgi Angelov
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#ifndef HTTP_STREAM_H_
+#define HTTP_STREAM_H_
+
+/*
+    Incremental HTTP/1.1 response parser for the LHTTP streaming mode.
+    Bytes are fed as they arrive from the socket, the status line and the
+    headers are parsed line by line, the body (Content-Length, chunked or
+    until close) goes to the callback in the pieces it was received in.
+    Nothing but one header line is buffered. No Arduino dependencies.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+
+/* return < 0 to abort the transfer */
+typedef int (*http_body_cb)(const uint8_t *data, size_t size, void *user);
+
+class http_stream
+{
+#define HTTP_STREAM_LINE 128
+public:
+    enum
+    {
+        STATUS,
+        HEADER,
+        BODY,       // content_length bytes
+        BODY_CLOSE, // until the connection is closed
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_END,  // CRLF after the chunk data
+        TRAILER,
+        DONE,
+        FAILED
+    };
+
+    int state;
+    int status;
+    long long content_length; // -1 unknown
+    long long received;       // body bytes handed to the callback
+
+    http_stream() { begin(NULL, NULL, NULL, 0, false); }
+
+    /* header, if given, collects the raw header lines (get_header) */
+    void begin(http_body_cb cb, void *user, char *header, size_t header_size, bool no_body)
+    {
+        _cb = cb;
+        _user = user;
+        _header = header;
+        _header_size = header_size;
+        _header_len = 0;
+        if (_header && _header_size)
+            _header[0] = 0;
+        _no_body = no_body;
+        _line_len = 0;
+        _chunked = false;
+        _left = 0;
+        state = STATUS;
+        status = 0;
+        content_length = -1;
+        received = 0;
+    }
+
+    bool done() { return DONE == state; }
+
+    /* returns bytes used (the rest follows the response) or -1 */
+    int feed(const uint8_t *data, size_t size)
+    {
+        size_t i = 0;
+        while (i < size && state < DONE)
+        {
+            if (BODY == state || CHUNK_DATA == state || BODY_CLOSE == state)
+            {
+                size_t n = size - i;
+                if (BODY_CLOSE != state && (long long)n > _left)
+                    n = (size_t)_left;
+                if (_cb && _cb(data + i, n, _user) < 0)
+                    return fail();
+                received += n;
+                i += n;
+                if (BODY_CLOSE == state)
+                    continue;
+                _left -= n;
+                if (0 == _left)
+                    state = BODY == state ? DONE : CHUNK_END;
+                continue;
+            }
+            uint8_t c = data[i++];
+            if ('\n' != c)
+            {
+                if ('\r' != c && _line_len < HTTP_STREAM_LINE - 1)
+                    _line[_line_len++] = c;
+                continue;
+            }
+            _line[_line_len] = 0;
+            if (line() < 0)
+                return -1;
+            _line_len = 0;
+        }
+        return (int)i;
+    }
+
+    /* the connection was closed, true if the response is complete */
+    bool finish()
+    {
+        if (BODY_CLOSE == state)
+            state = DONE;
+        return DONE == state;
+    }
+
+private:
+    http_body_cb _cb;
+    void *_user;
+    char *_header;
+    size_t _header_size;
+    size_t _header_len;
+    bool _no_body;
+    bool _chunked;
+    long long _left;
+    char _line[HTTP_STREAM_LINE];
+    size_t _line_len;
+
+    int fail()
+    {
+        state = FAILED;
+        return -1;
+    }
+
+    static bool is(const char *line, const char *name)
+    {
+        size_t n = strlen(name);
+        return 0 == strncasecmp(line, name, n) && ':' == line[n];
+    }
+
+    static const char *value(const char *line)
+    {
+        line = strchr(line, ':') + 1;
+        while (' ' == *line || '\t' == *line)
+            line++;
+        return line;
+    }
+
+    void keep_header()
+    {
+        if (NULL == _header || _header_len + _line_len + 3 > _header_size)
+            return;
+        memcpy(_header + _header_len, _line, _line_len);
+        _header_len += _line_len;
+        _header[_header_len++] = '\r';
+        _header[_header_len++] = '\n';
+        _header[_header_len] = 0;
+    }
+
+    int body()
+    {
+        if (_no_body || 204 == status || 304 == status)
+            state = DONE;
+        else if (_chunked)
+            state = CHUNK_SIZE;
+        else if (content_length >= 0)
+        {
+            _left = content_length;
+            state = _left ? BODY : DONE;
+        }
+        else
+            state = BODY_CLOSE;
+        return 0;
+    }
+
+    int line()
+    {
+        switch (state)
+        {
+        case STATUS:
+            if (0 == _line_len)
+                return 0; // stray CRLF before the response
+            if (strncmp(_line, "HTTP/1.", 7) || _line_len < 12)
+                return fail();
+            status = atoi(_line + 9);
+            state = HEADER;
+            return 0;
+        case HEADER:
+            if (_line_len)
+            {
+                keep_header();
+                if (is(_line, "Content-Length"))
+                    content_length = strtoll(value(_line), NULL, 10);
+                else if (is(_line, "Transfer-Encoding"))
+                    _chunked = NULL != strstr(value(_line), "chunked");
+                return 0;
+            }
+            if (status >= 100 && status < 200) // 100 Continue, the real response follows
+            {
+                state = STATUS;
+                content_length = -1;
+                _chunked = false;
+                return 0;
+            }
+            return body();
+        case CHUNK_SIZE:
+        {
+            char *end;
+            _left = strtoll(_line, &end, 16);
+            if (end == _line || _left < 0)
+                return fail();
+            state = _left ? CHUNK_DATA : TRAILER;
+            return 0;
+        }
+        case CHUNK_END:
+            if (_line_len)
+                return fail();
+            state = CHUNK_SIZE;
+            return 0;
+        case TRAILER:
+            if (0 == _line_len)
+                state = DONE;
+            return 0;
+        }
+        return fail();
+    }
+};
+
+/* "http[s]://host[:port][/path]", host is copied, path points into url */
+static inline bool http_parse_url(const char *url, bool *https, char *host, size_t host_size, int *port, const char **path)
+{
+    const char *p, *end;
+    size_t n;
+    if (0 == strncmp(url, "https://", 8))
+    {
+        *https = true;
+        url += 8;
+    }
+    else if (0 == strncmp(url, "http://", 7))
+    {
+        *https = false;
+        url += 7;
+    }
+    else
+        return false;
+    end = url + strcspn(url, "/?");
+    p = (const char *)memchr(url, ':', end - url);
+    n = (p ? p : end) - url;
+    if (0 == n || n >= host_size)
+        return false;
+    memcpy(host, url, n);
+    host[n] = 0;
+    *port = p ? atoi(p + 1) : (*https ? 443 : 80);
+    *path = *end ? end : "/";
+    return *port > 0;
+}
+
+#endif
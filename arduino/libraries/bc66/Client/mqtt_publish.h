@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2020 Georgi Angelov
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#ifndef MQTT_PUBLISH_H_
+#define MQTT_PUBLISH_H_
+
+/*
+    MQTT 3.1.1 PUBLISH head (fixed header, topic, packet id) for a payload
+    that is written separately, straight from the caller's buffers.
+    No Arduino dependencies.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define MQTT_MAX_REMAINING_LENGTH 268435455
+
+/* scratch for the head and the leading payload bytes, topics up to ~240 bytes */
+#ifndef LMQTT_PUBLISH_SCRATCH
+#define LMQTT_PUBLISH_SCRATCH 256
+#endif
+
+/* upper bound of the receive buffer, the largest packet the client accepts */
+#ifndef LMQTT_RX_MAX
+#define LMQTT_RX_MAX 16384
+#endif
+
+typedef struct
+{
+    const void *data;
+    size_t size;
+} mqtt_buffer_t;
+
+/*
+    packet is a PUBLISH serialized with an empty payload (fixed header, topic,
+    packet id), buf gets the head of the same PUBLISH carrying payload_size
+    bytes. Returns the head length or -1 if it does not fit size, the packet
+    is not such a PUBLISH or gets too big.
+*/
+static inline int mqtt_publish_head(uint8_t *buf, size_t size, const uint8_t *packet, size_t packet_len, size_t payload_size)
+{
+    size_t rem = 0, head, len = 1;
+    unsigned shift = 0;
+    if (packet_len < 2 || 0x30 != (packet[0] & 0xF0))
+        return -1;
+    do
+    {
+        if (len >= packet_len || shift > 21)
+            return -1;
+        rem |= (size_t)(packet[len] & 0x7F) << shift;
+        shift += 7;
+    } while (packet[len++] & 0x80);
+    if (rem != packet_len - len)
+        return -1;
+    head = rem; /* topic and packet id */
+    rem += payload_size;
+    if (rem > MQTT_MAX_REMAINING_LENGTH || rem < payload_size || size < 1 + 4 + head)
+        return -1;
+    buf[0] = packet[0];
+    len = 1;
+    do
+    {
+        uint8_t b = rem & 0x7F;
+        rem >>= 7;
+        buf[len++] = rem ? b | 0x80 : b;
+    } while (rem);
+    memcpy(buf + len, packet + packet_len - head, head);
+    return (int)(len + head);
+}
+
+#endif
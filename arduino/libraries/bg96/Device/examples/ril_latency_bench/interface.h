@@ -0,0 +1,78 @@
+/*
+ * interface.h
+ *
+ * Host stand-in for the BG96 core interface.h, ThreadX and qapi on
+ * pthreads. Only what ril.cpp uses, for ril_latency_bench.
+ */
+
+#ifndef INTERFACE_H_
+#define INTERFACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define PRIO (180)
+#define TICKS_PER_MSEC (10)
+
+typedef unsigned char UCHAR;
+typedef unsigned long ULONG;
+typedef unsigned int UINT;
+typedef uint64_t qurt_time_t;
+
+#define TX_AND (2)
+#define TX_OR (0)
+#define TX_OR_CLEAR (1)
+#define TX_INHERIT (1)
+#define TX_NO_TIME_SLICE (0)
+#define TX_AUTO_START (1)
+#define TX_WAIT_FOREVER (0xFFFFFFFFUL)
+#define QAPI_TIMER_UNIT_TICK (0)
+
+typedef struct
+{
+	pthread_t thread;
+} TX_THREAD;
+
+typedef struct
+{
+	pthread_mutex_t mutex;
+} TX_MUTEX;
+
+typedef struct
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	ULONG flags;
+} TX_EVENT_FLAGS_GROUP;
+
+template <class T>
+int txm_module_object_allocate(T **object, size_t size)
+{
+	*object = (T *)calloc(1, size);
+	return *object ? 0 : 1;
+}
+
+UINT tx_mutex_create(TX_MUTEX *mutex, const char *name, UINT inherit);
+UINT tx_mutex_get(TX_MUTEX *mutex, ULONG wait);
+UINT tx_mutex_put(TX_MUTEX *mutex);
+UINT tx_mutex_delete(TX_MUTEX *mutex);
+UINT tx_event_flags_create(TX_EVENT_FLAGS_GROUP *group, const char *name);
+UINT tx_event_flags_set(TX_EVENT_FLAGS_GROUP *group, ULONG flags, UINT option);
+UINT tx_event_flags_get(TX_EVENT_FLAGS_GROUP *group, ULONG requested, UINT option, ULONG *actual, ULONG wait);
+UINT tx_event_flags_delete(TX_EVENT_FLAGS_GROUP *group);
+UINT tx_thread_create(TX_THREAD *thread, const char *name, void (*entry)(void *), void *arg,
+					  void *stack, ULONG stack_size, UINT prio, UINT threshold, ULONG slice, UINT start);
+int qapi_Timer_Sleep(uint32_t time, int unit, int blocking);
+qurt_time_t qurt_timer_get_ticks(void);
+
+void critical_enter(void);
+void critical_exit(void);
+#define ENTER_CRITICAL() critical_enter()
+#define EXIT_CRITICAL() critical_exit()
+
+int strStartsWith(const char *line, const char *prefix);
+
+#endif /* INTERFACE_H_ */
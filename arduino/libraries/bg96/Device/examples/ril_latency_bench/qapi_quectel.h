@@ -0,0 +1,37 @@
+/*
+ * qapi_quectel.h
+ *
+ * Host stand-in, the AT pipe part of the SDK header only.
+ */
+
+#ifndef __QAPI_QUECTEL_H__
+#define __QAPI_QUECTEL_H__
+
+#define QAPI_QT_ERR_OK (0)
+
+typedef enum qpi_at_port_e
+{
+	QAPI_AT_PORT_0 = 0,
+	QAPI_AT_PORT_1,
+	QAPI_AT_PORT_2,
+	QAPI_AT_PORT_3,
+
+	QAPI_AT_PORT_MAX
+} qapi_at_port_t;
+
+typedef struct qapi_atc_pipe_data_s
+{
+	char data[2048];
+	int len;
+} qapi_at_pipe_data_t;
+
+typedef signed short int2;
+
+typedef int2 qapi_at_stream_id_t;
+typedef void (*qapi_at_resp_func_cb_t)(qapi_at_pipe_data_t *data);
+
+int qapi_QT_Apps_AT_Port_Open(qapi_at_port_t port, qapi_at_stream_id_t *stream, qapi_at_resp_func_cb_t cb, qapi_at_pipe_data_t *pipe);
+int qapi_QT_Apps_AT_Port_Close(qapi_at_port_t port);
+int qapi_QT_Apps_Send_AT(qapi_at_stream_id_t stream, const char *command);
+
+#endif
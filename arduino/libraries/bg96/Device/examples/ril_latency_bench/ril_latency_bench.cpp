@@ -0,0 +1,259 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   ril_latency_bench.cpp
+ *
+ * Description:
+ * ------------
+ *   AT round trip latency of the BG96 core Ril: from send_*() to the
+ *   final response, for a bare AT, AT+GSN and a 100 line AT+QENG answer.
+ *   The modem is a thread that answers through the AT port callback,
+ *   a line per call, so what is measured above its own delay is the Ril:
+ *   its sleeps, wakeups and copies. ThreadX and qapi run on pthreads (interface.h and
+ *   qapi_quectel.h here), a tick is TICKS_PER_MSEC ms as in the core:
+ *
+ *   g++ -O2 -I. -I../../../../../cores/bg96 ril_latency_bench.cpp \
+ *       -lpthread -o ril_latency_bench
+ *   ./ril_latency_bench [rounds] [modem_ms]
+ *
+ *   modem_ms delays each answer like a real modem does. Add
+ *   -DRIL_WRITE_GUARD_TICKS=0 to build without the sleep after
+ *   qapi_QT_Apps_Send_AT. For the numbers before the receive ring, point
+ *   the second -I at a checkout of the older cores/bg96 and give a
+ *   modem_ms above one tick: that Ril arms the response only after
+ *   write() and its sleep, an earlier answer is taken as unsolicited.
+ ****************************************************************************/
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include "interface.h"
+#include "qapi_quectel.h"
+#include "ril.cpp"
+
+#define TICK_US (TICKS_PER_MSEC * 1000)
+#define QENG_LINES 100
+
+/* ThreadX and qapi on pthreads */
+static pthread_mutex_t critical = PTHREAD_MUTEX_INITIALIZER;
+void critical_enter(void) { pthread_mutex_lock(&critical); }
+void critical_exit(void) { pthread_mutex_unlock(&critical); }
+
+UINT tx_mutex_create(TX_MUTEX *mutex, const char *name, UINT inherit)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	return pthread_mutex_init(&mutex->mutex, &attr);
+}
+UINT tx_mutex_get(TX_MUTEX *mutex, ULONG wait) { return pthread_mutex_lock(&mutex->mutex); }
+UINT tx_mutex_put(TX_MUTEX *mutex) { return pthread_mutex_unlock(&mutex->mutex); }
+UINT tx_mutex_delete(TX_MUTEX *mutex) { return pthread_mutex_destroy(&mutex->mutex); }
+
+UINT tx_event_flags_create(TX_EVENT_FLAGS_GROUP *group, const char *name)
+{
+	pthread_mutex_init(&group->mutex, NULL);
+	pthread_cond_init(&group->cond, NULL);
+	group->flags = 0;
+	return 0;
+}
+
+UINT tx_event_flags_set(TX_EVENT_FLAGS_GROUP *group, ULONG flags, UINT option)
+{
+	pthread_mutex_lock(&group->mutex);
+	if (TX_AND == option)
+		group->flags &= flags;
+	else
+		group->flags |= flags;
+	pthread_cond_broadcast(&group->cond);
+	pthread_mutex_unlock(&group->mutex);
+	return 0;
+}
+
+UINT tx_event_flags_get(TX_EVENT_FLAGS_GROUP *group, ULONG requested, UINT option, ULONG *actual, ULONG wait)
+{
+	struct timespec until;
+	int r = 0;
+	clock_gettime(CLOCK_REALTIME, &until);
+	if (TX_WAIT_FOREVER != wait)
+	{
+		uint64_t ns = until.tv_nsec + (uint64_t)wait * TICK_US * 1000;
+		until.tv_sec += ns / 1000000000;
+		until.tv_nsec = ns % 1000000000;
+	}
+	pthread_mutex_lock(&group->mutex);
+	while (0 == (group->flags & requested) && ETIMEDOUT != r)
+		r = TX_WAIT_FOREVER == wait ? pthread_cond_wait(&group->cond, &group->mutex)
+									: pthread_cond_timedwait(&group->cond, &group->mutex, &until);
+	*actual = group->flags;
+	if (TX_OR_CLEAR == option)
+		group->flags &= ~requested;
+	pthread_mutex_unlock(&group->mutex);
+	return (*actual & requested) ? 0 : 7; /* TX_NO_EVENTS */
+}
+
+UINT tx_event_flags_delete(TX_EVENT_FLAGS_GROUP *group) { return 0; }
+
+UINT tx_thread_create(TX_THREAD *thread, const char *name, void (*entry)(void *), void *arg,
+					  void *stack, ULONG stack_size, UINT prio, UINT threshold, ULONG slice, UINT start)
+{
+	return pthread_create(&thread->thread, NULL, (void *(*)(void *))entry, arg);
+}
+
+int qapi_Timer_Sleep(uint32_t time, int unit, int blocking)
+{
+	struct timespec ts = {0, 0};
+	uint64_t ns = (uint64_t)time * TICK_US * 1000;
+	ts.tv_sec = ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	nanosleep(&ts, NULL);
+	return 0;
+}
+
+/* 19.2 MHz like the qurt timetick */
+qurt_time_t qurt_timer_get_ticks(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((qurt_time_t)ts.tv_sec * 1000000000 + ts.tv_nsec) * 192 / 10000;
+}
+
+int strStartsWith(const char *line, const char *prefix)
+{
+	for (; *line != '\0' && *prefix != '\0'; line++, prefix++)
+		if (*line != *prefix)
+			return 0;
+	return *prefix == '\0';
+}
+
+/* the modem: answers every command from its own thread */
+static qapi_at_resp_func_cb_t at_callback;
+static pthread_mutex_t modem_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t modem_cond = PTHREAD_COND_INITIALIZER;
+static char modem_command[64];
+static int modem_ms; /* the modem's own time to answer */
+static char answer[QENG_LINES * 96];
+
+int qapi_QT_Apps_AT_Port_Open(qapi_at_port_t port, qapi_at_stream_id_t *stream, qapi_at_resp_func_cb_t cb, qapi_at_pipe_data_t *pipe)
+{
+	at_callback = cb;
+	*stream = 0;
+	return QAPI_QT_ERR_OK;
+}
+
+int qapi_QT_Apps_AT_Port_Close(qapi_at_port_t port) { return QAPI_QT_ERR_OK; }
+
+int qapi_QT_Apps_Send_AT(qapi_at_stream_id_t stream, const char *command)
+{
+	pthread_mutex_lock(&modem_mutex);
+	snprintf(modem_command, sizeof(modem_command), "%s", command);
+	pthread_cond_signal(&modem_cond);
+	pthread_mutex_unlock(&modem_mutex);
+	return QAPI_QT_ERR_OK;
+}
+
+static Ril *ril;
+
+static void *modem(void *arg)
+{
+	static qapi_at_pipe_data_t pipe;
+	char command[64];
+	int len, off, i;
+	for (;;)
+	{
+		pthread_mutex_lock(&modem_mutex);
+		while (0 == modem_command[0])
+			pthread_cond_wait(&modem_cond, &modem_mutex);
+		strcpy(command, modem_command);
+		modem_command[0] = 0;
+		pthread_mutex_unlock(&modem_mutex);
+		usleep(modem_ms * 1000);
+		len = 0;
+		if (0 == strcmp(command, "AT+GSN\r\n"))
+			len = sprintf(answer, "\r\n866425030000001\r\n");
+		else if (0 == strcmp(command, "AT+QENG=\"neighbourcell\"\r\n"))
+			for (i = 0; i < QENG_LINES; i++)
+				len += sprintf(answer + len, "+QENG: \"neighbourcell intra\",\"LTE\",%d,%d,-12,-95,-65,0,37,7,16,6,44\r\n", 6300 + i, 100 + i);
+		len += sprintf(answer + len, "\r\nOK\r\n");
+		for (off = 0; off < len; off += pipe.len) /* a line per callback */
+		{
+			const char *eol = (const char *)memchr(answer + off, '\n', len - off);
+			pipe.len = eol ? eol - (answer + off) + 1 : len - off;
+			memcpy(pipe.data, answer + off, pipe.len);
+			while (ril->available() + pipe.len >= INTERNAL_RECEIVE_SIZE)
+				sched_yield(); /* the pipe holds the rest back */
+			at_callback(&pipe);
+		}
+	}
+	return NULL;
+}
+
+static void on_receive(qapi_at_pipe_data_t *data)
+{
+	ril->save(data->data, data->len);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int count_lines(ATResponse *p_response)
+{
+	int n = 0;
+	for (ATLine *p = p_response ? p_response->p_intermediates : NULL; p; p = p->p_next)
+		n++;
+	return n;
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = argc > 1 ? atoi(argv[1]) : 20;
+	modem_ms = argc > 2 ? atoi(argv[2]) : 0;
+	double t[3] = {0, 0, 0};
+	int failed = 0;
+	pthread_t modem_thread;
+
+	pthread_create(&modem_thread, NULL, modem, NULL);
+	ril = new Ril(QAPI_AT_PORT_0);
+	ril->begin(on_receive);
+	for (int r = 0; r < rounds; r++)
+	{
+		ATResponse *p_response = NULL;
+		double t0 = now();
+		failed += AT_NO_ERROR != ril->send("AT\r\n", NULL);
+		t[0] += now() - t0;
+
+		t0 = now();
+		failed += AT_NO_ERROR != ril->send_numeric("AT+GSN\r\n", &p_response) ||
+				  strncmp(p_response->p_intermediates->line, "866425030000001", 15);
+		t[1] += now() - t0;
+		ril->response_free(p_response);
+
+		p_response = NULL;
+		t0 = now();
+		failed += AT_NO_ERROR != ril->send_multiline("AT+QENG=\"neighbourcell\"\r\n", "+QENG:", &p_response) ||
+				  QENG_LINES != count_lines(p_response);
+		t[2] += now() - t0;
+		ril->response_free(p_response);
+	}
+	if (failed)
+	{
+		printf("%d commands failed\n", failed);
+		return 1;
+	}
+#ifdef RIL_ARENA_SIZE
+	printf("receive ring, RIL_WRITE_GUARD_TICKS %d, tick %d ms, modem %d ms, %d rounds\n",
+		   RIL_WRITE_GUARD_TICKS, TICKS_PER_MSEC, modem_ms, rounds);
+#else
+	printf("per byte ring, tick %d ms, modem %d ms, %d rounds\n", TICKS_PER_MSEC, modem_ms, rounds);
+#endif
+	printf("AT                 %9.3f ms\n", t[0] * 1e3 / rounds);
+	printf("AT+GSN             %9.3f ms\n", t[1] * 1e3 / rounds);
+	printf("AT+QENG, %d lines %9.3f ms\n", QENG_LINES, t[2] * 1e3 / rounds);
+	return 0;
+}
@@ -133,6 +133,37 @@ int txClient::read(uint8_t *buf, size_t size)
     return r > 0 ? r : -1;
 }
 
+size_t txClient::readAvailable(char *buf, size_t size)
+{
+    if (-1 == m_socket || NULL == buf || 0 == size)
+        return 0;
+    int r = qapi_recv(m_socket, buf, size, MSG_DONTWAIT);
+    return r > 0 ? r : 0;
+}
+
+/* the socket queue is the buffer: peekSpan() copies a chunk with MSG_PEEK, consume() drops it */
+size_t txClient::peekSpan(const char **data)
+{
+    if (-1 == m_socket)
+        return 0;
+    int r = qapi_recv(m_socket, m_peek, sizeof(m_peek), MSG_PEEK | MSG_DONTWAIT);
+    if (r <= 0)
+        return 0;
+    *data = m_peek;
+    return r;
+}
+
+void txClient::consume(size_t length)
+{
+    while (length && -1 != m_socket)
+    {
+        int r = qapi_recv(m_socket, m_peek, length < sizeof(m_peek) ? length : sizeof(m_peek), MSG_DONTWAIT);
+        if (r <= 0)
+            break;
+        length -= r;
+    }
+}
+
 int txClient::peek()
 {
     if (m_socket == -1)
@@ -24,6 +24,10 @@
 #include "Client.h"
 #include "IPAddress.h"
 
+#ifndef TX_CLIENT_PEEK_SIZE
+#define TX_CLIENT_PEEK_SIZE 256
+#endif
+
 class txClient : public Client
 {
 #define htons(s) ((((s) >> 8) & 0xff) | (((s) << 8) & 0xff00))
@@ -40,6 +44,9 @@ public:
   virtual int read();
   virtual int read(uint8_t *buf, size_t size);
   virtual int peek();
+  virtual size_t readAvailable(char *buf, size_t size);
+  virtual size_t peekSpan(const char **data);
+  virtual void consume(size_t length);
   virtual void flush() {}
   virtual void stop();
   virtual uint8_t connected();
@@ -56,6 +63,7 @@ private:
   int m_socket;
   bool m_externalSocket;
   int32_t m_timeout;
+  char m_peek[TX_CLIENT_PEEK_SIZE]; // MSG_PEEK copy behind peekSpan()
 
   uint32_t errno()
   {
@@ -0,0 +1,110 @@
+/***
+    spi_page_read_bench example.
+
+    Reads 4 KB pages from a SPI NOR flash (command 0x03, 24 bit address)
+    three ways and prints the throughput:
+        byte    - one transfer() call per byte
+        buffer  - one transfer(tx, rx) call per page
+        queued  - cmd/addr + data descriptors in one call, the next page
+                  is queued while the previous one is checked
+
+    Any 0x03-compatible flash on the hardware SPI port works,
+    the data is only read. The byte variant only shows the per call
+    cost, the controller may release CS between the calls.
+***/
+
+#include <SPI.h>
+
+#define PAGE_SIZE 4096
+#define PAGES 32
+#define CLOCK 10000000
+
+static uint8_t page[2][4 + PAGE_SIZE];
+static uint8_t dummy[4 + PAGE_SIZE];
+static uint32_t sum;
+
+static void cmd(uint8_t *p, uint32_t addr)
+{
+  p[0] = 0x03;
+  p[1] = addr >> 16;
+  p[2] = addr >> 8;
+  p[3] = addr;
+}
+
+static void check(const uint8_t *p)
+{
+  for (int i = 0; i < PAGE_SIZE; i++)
+    sum += p[i];
+}
+
+static void report(const char *name, uint32_t ms)
+{
+  Serial.printf("%-6s %4u ms  %5u KB/s  sum %08X\n", name, ms, ms ? (PAGES * PAGE_SIZE / 1024) * 1000 / ms : 0, sum);
+}
+
+static void bench_byte()
+{
+  sum = 0;
+  uint32_t start = millis();
+  for (int n = 0; n < PAGES; n++)
+  {
+    cmd(page[0], n * PAGE_SIZE);
+    for (int i = 0; i < 4 + PAGE_SIZE; i++)
+      page[0][i] = SPI.transfer(i < 4 ? page[0][i] : 0);
+    check(page[0] + 4);
+  }
+  report("byte", millis() - start);
+}
+
+static void bench_buffer()
+{
+  sum = 0;
+  uint32_t start = millis();
+  for (int n = 0; n < PAGES; n++)
+  {
+    cmd(dummy, n * PAGE_SIZE);
+    SPI.transfer(dummy, 4 + PAGE_SIZE, page[0], 4 + PAGE_SIZE);
+    check(page[0] + 4);
+  }
+  report("buffer", millis() - start);
+}
+
+static void bench_queued()
+{
+  static qapi_SPIM_Descriptor_t desc[2][2];
+  sum = 0;
+  uint32_t start = millis();
+  for (int n = 0; n < PAGES; n++)
+  {
+    int b = n & 1;
+    cmd(page[b], n * PAGE_SIZE);
+    desc[b][0].tx_buf = page[b];
+    desc[b][0].rx_buf = NULL;
+    desc[b][0].len = 4;
+    desc[b][1].tx_buf = NULL;
+    desc[b][1].rx_buf = page[b] + 4;
+    desc[b][1].len = PAGE_SIZE;
+    SPI.queue(desc[b], 2); // waits for the previous page
+    if (n)
+      check(page[b ^ 1] + 4); // while this one is on the bus
+  }
+  SPI.wait();
+  check(page[(PAGES - 1) & 1] + 4);
+  report("queued", millis() - start);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  SPI.begin();
+  SPI.beginTransaction(SPISettings(CLOCK, MSBFIRST, SPI_MODE0));
+  memset(dummy, 0, sizeof(dummy));
+  bench_byte();
+  bench_buffer();
+  bench_queued();
+  SPI.endTransaction();
+}
+
+void loop()
+{
+}
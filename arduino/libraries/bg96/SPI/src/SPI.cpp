@@ -28,6 +28,11 @@ SPISettings::SPISettings()
 void SPIClass::ctor()
 {
     handle = NULL;
+    event = NULL;
+    pending = false;
+    status = QAPI_SPI_COMPLETE;
+    done = NULL;
+    user = NULL;
     config.SPIM_Mode = QAPI_SPIM_MODE_0_E;               // set the spi mode, determined by slave device
     config.SPIM_CS_Polarity = QAPI_SPIM_CS_ACTIVE_LOW_E; // set CS low as active, determined by slave device
     config.SPIM_endianness = SPI_LITTLE_ENDIAN;
@@ -83,7 +88,21 @@ void SPIClass::begin()
 {
     if (handle)
         return; // already
-    int r = qapi_SPIM_Open(port, &handle);
+    int r;
+    if (NULL == event)
+    {
+        if ((r = txm_module_object_allocate(&event, sizeof(TX_EVENT_FLAGS_GROUP))))
+        {
+            DEBUG_SPI("[ERROR] SPI[%d] EVENT txm_module_object_allocate: %d\n", port, r);
+            abort();
+        }
+        if ((r = tx_event_flags_create(event, "spi-event")))
+        {
+            DEBUG_SPI("[ERROR] SPI[%d] tx_event_flags_create: %d\n", port, r);
+            abort();
+        }
+    }
+    r = qapi_SPIM_Open(port, &handle);
     if (r)
     {
         DEBUG_SPI("[ERROR] SPI[%d] Open: %d\n", port, r);
@@ -102,6 +121,7 @@ void SPIClass::end()
 {
     if (handle)
     {
+        wait();
         qapi_SPIM_Power_Off(handle);
         qapi_SPIM_Close(handle);
     }
@@ -111,40 +131,111 @@ void SPIClass::end()
 /* Stop using the SPI bus. Normally this is called after de-asserting the chip select, to allow other libraries to use the SPI bus */
 void SPIClass::endTransaction(void)
 {
-    end();
+    // the bus stays open and powered until end(), open + power on costs more than most transfers
 }
 
 /* Initializes the SPI bus using the defined SPISettings */
 void SPIClass::beginTransaction(SPISettings settings)
 {
+    // the config goes with every qapi_SPIM_Full_Duplex, nothing to apply to the hardware here
     setFrequency(settings.clock);
     setDataMode(settings.mode);
     setBitOrder(settings.order);
     begin();
 }
 
+void SPIClass::callback(uint32_t status, void *cb_para)
+{
+    SPIClass *THIS = (SPIClass *)cb_para;
+    spi_done_cb cb = THIS->done;
+    void *user = THIS->user;
+    THIS->status = status;
+    THIS->pending = false;
+    tx_event_flags_set(THIS->event, SPI_EVENT_DONE, TX_OR);
+    if (cb)
+        cb(status, user);
+}
+
+/* LSB first: mirror the bits of every byte, four bytes per rbit + rev */
+void SPIClass::reverse(uint8_t *buf, uint32_t size)
+{
+    uint32_t w;
+    for (; size && ((uint32_t)buf & 3); size--, buf++)
+        *buf = __REV(__RBIT(*buf));
+    for (; size >= 4; size -= 4, buf += 4)
+    {
+        w = *(uint32_t *)buf;
+        *(uint32_t *)buf = __REV(__RBIT(w));
+    }
+    for (; size; size--, buf++)
+        *buf = __REV(__RBIT(*buf));
+}
+
+int SPIClass::queue(qapi_SPIM_Descriptor_t *desc, uint32_t count, spi_done_cb cb, void *user)
+{
+    if (NULL == handle || NULL == desc || 0 == count)
+        return -1;
+    wait(); // one transfer in flight
+    ULONG sig;
+    tx_event_flags_get(event, SPI_EVENT_DONE, TX_OR_CLEAR, &sig, TX_NO_WAIT);
+    this->done = cb;
+    this->user = user;
+    pending = true;
+    int r = qapi_SPIM_Full_Duplex(handle, &config, desc, count, SPIClass::callback, this, false);
+    if (r)
+    {
+        pending = false;
+        status = QAPI_SPI_FAILURE;
+        DEBUG_SPI("[ERROR] SPI[%d] Full_Duplex: %d\n", port, r);
+        return -1;
+    }
+    return 0;
+}
+
+int SPIClass::wait(void)
+{
+    ULONG sig;
+    if (pending)
+        tx_event_flags_get(event, SPI_EVENT_DONE, TX_OR_CLEAR, &sig, TX_WAIT_FOREVER);
+    return status;
+}
+
+int SPIClass::transfer(qapi_SPIM_Descriptor_t *desc, uint32_t count)
+{
+    if (queue(desc, count))
+        return -1;
+    if (QAPI_SPI_FAILURE == wait())
+        return -1;
+    int size = 0;
+    for (uint32_t i = 0; i < count; i++)
+        size += desc[i].len;
+    return size;
+}
+
 int SPIClass::rewrite(uint8_t *tx, uint8_t *rx, size_t size)
 {
     qapi_SPIM_Descriptor_t desc;
     desc.rx_buf = rx;
     desc.tx_buf = tx;
     desc.len = size;
-    int r = qapi_SPIM_Full_Duplex(handle, &config, &desc, 1, callback, NULL, false);
-    if (r)
+    int r = transfer(&desc, 1);
+    if (r < 0)
     {
-        DEBUG_SPI("[ERROR] SPI[%d] WriteRead: %d\n", port, r);
-        return 0; 
+        DEBUG_SPI("[ERROR] SPI[%d] WriteRead: %d\n", port, status);
+        return 0;
     }
     return size;
 }
 
 uint8_t SPIClass::transfer(uint8_t tx)
 {
-    uint8_t rx;
-    int r = 0;
+    uint8_t rx = 0;
     if (order == LSBFIRST)
         tx = __REV(__RBIT(tx));
-    return rewrite(&tx, &rx, 1);
+    rewrite(&tx, &rx, 1);
+    if (order == LSBFIRST)
+        rx = __REV(__RBIT(rx));
+    return rx;
 }
 
 uint16_t SPIClass::transfer16(uint16_t _data)
@@ -158,33 +249,36 @@ uint16_t SPIClass::transfer16(uint16_t _data)
         };
     } t;
     t.val = _data;
+    uint8_t buf[2];
     if (order == LSBFIRST)
     {
-        t.lsb = transfer(t.lsb);
-        t.msb = transfer(t.msb);
+        buf[0] = t.lsb;
+        buf[1] = t.msb;
+        transfer(buf, 2);
+        t.lsb = buf[0];
+        t.msb = buf[1];
     }
     else
     {
-        t.msb = transfer(t.msb);
-        t.lsb = transfer(t.lsb);
+        buf[0] = t.msb;
+        buf[1] = t.lsb;
+        transfer(buf, 2);
+        t.msb = buf[0];
+        t.lsb = buf[1];
     }
     return t.val;
 }
 
 int SPIClass::transfer(uint8_t *tx, uint32_t wLen)
 {
-
     if (tx && wLen)
     {
-        if (order == MSBFIRST)
-        {
-            return rewrite(tx, tx, wLen);
-        }
-        else
-        {
-            for (int i = wLen; i; i--)
-                tx[i - 1] = transfer(tx[i - 1]);
-        }
+        if (order == LSBFIRST)
+            reverse(tx, wLen);
+        int r = rewrite(tx, tx, wLen);
+        if (order == LSBFIRST)
+            reverse(tx, wLen); // now rx
+        return r ? r : -1;
     }
     return -1;
 }
@@ -193,15 +287,15 @@ int SPIClass::transfer(uint8_t *tx, uint32_t wLen, uint8_t *rx, uint32_t rLen)
 {
     if (tx && rx && wLen && rLen)
     {
-        if (order == MSBFIRST)
-        {
-            return rewrite(tx, rx, wLen); // MAX
-        }
-        else
+        if (order == LSBFIRST)
+            reverse(tx, wLen);
+        int r = rewrite(tx, rx, wLen); // MAX
+        if (order == LSBFIRST)
         {
-            for (int i = wLen; i; i--)
-                rx[i - 1] = transfer(tx[i - 1]);
+            reverse(tx, wLen); // restore the caller tx buffer
+            reverse(rx, wLen);
         }
+        return r ? r : -1;
     }
     return -1;
 }
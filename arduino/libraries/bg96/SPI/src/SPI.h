@@ -29,6 +29,10 @@ private:
   friend class SPIClass;
 };
 
+#define SPI_EVENT_DONE 1
+
+typedef void (*spi_done_cb)(uint32_t status, void *user); // status QAPI_SPI_COMPLETE or QAPI_SPI_FAILURE
+
 class SPIClass
 {
 public:
@@ -50,6 +54,13 @@ public:
   int transfer(uint8_t *tx, uint32_t wLen, uint8_t *rx, uint32_t rLen);
   void cs(int level);
 
+  // Queued transfers: the descriptors (cmd, addr, data ...) go to the controller in one call.
+  // The descriptors and their buffers must stay valid until the callback or wait(); bytes are sent as they are (MSB first).
+  int queue(qapi_SPIM_Descriptor_t *desc, uint32_t count, spi_done_cb cb = NULL, void *user = NULL);
+  int wait(void); // status of the last queued transfer, QAPI_SPI_COMPLETE if none
+  bool busy(void) { return pending; }
+  int transfer(qapi_SPIM_Descriptor_t *desc, uint32_t count); // queue + wait, bytes or -1
+
   void setClockDivider(uint8_t){};
   void setClockDivider(uint8_t, uint8_t) {}
   void attachInterrupt(){};
@@ -60,7 +71,13 @@ private:
   qapi_SPIM_Instance_t port;
   qapi_SPIM_Config_t config;
   void *handle = NULL;
-  static void callback(uint32 status, void *cb_para) {}
+  TX_EVENT_FLAGS_GROUP *event;
+  volatile bool pending;
+  volatile uint32_t status;
+  spi_done_cb done;
+  void *user;
+  static void callback(uint32_t status, void *cb_para);
+  static void reverse(uint8_t *buf, uint32_t size);
   void ctor();
   int rewrite(uint8_t *tx, uint8_t *rx, size_t size);
 };
@@ -0,0 +1,50 @@
+/*
+    Host stand-in for the parts of Arduino.h the Azure library uses,
+    for azure_sas_rfc4231.cpp only
+*/
+#ifndef ARDUINO_HOST_H_
+#define ARDUINO_HOST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "Print.h"
+
+class String
+{
+public:
+    String() {}
+    String(const char *s) : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    String(uint32_t value) : _s(std::to_string(value)) {}
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.size(); }
+    String &operator=(const char *s)
+    {
+        _s = s;
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        _s += c;
+        return *this;
+    }
+    friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+    friend String operator+(const String &a, const char *b) { return String(a._s + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b._s); }
+
+private:
+    std::string _s;
+};
+
+inline size_t Print::print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+
+struct SerialStub
+{
+    int printf(const char *, ...) { return 0; }
+};
+static SerialStub Serial;
+
+#endif
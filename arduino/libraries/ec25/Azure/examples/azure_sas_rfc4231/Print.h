@@ -0,0 +1,30 @@
+/*
+    Host stand-in for the Print.h of the core, for azure_sas_rfc4231.cpp only
+*/
+#ifndef PRINT_HOST_H_
+#define PRINT_HOST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define memcpy_P memcpy
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+
+class String;
+
+class Print
+{
+public:
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--)
+            n += write(*buffer++);
+        return n;
+    }
+    size_t print(const String &s);
+};
+
+#endif
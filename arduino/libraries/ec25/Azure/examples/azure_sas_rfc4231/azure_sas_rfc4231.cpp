@@ -0,0 +1,167 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   azure_sas_rfc4231.cpp
+ *
+ * Description:
+ * ------------
+ *   Runs the HMAC-SHA-256 test cases 1-7 of RFC 4231 through Sha256Class
+ *   three ways: initHmac(secret) as before, initHmac() with a stored
+ *   Sha256HmacKey and the same key schedule reused for a second message.
+ *   Case 5 compares the first 128 bits, cases 6 and 7 use a 131 byte key,
+ *   longer than a block. Then AzureSAS::sign() must give the token of
+ *   create(), get() must reuse it until the refresh margin, and the time
+ *   per token of both is reported. Arduino.h and Print.h in this folder
+ *   are host stand-ins:
+ *
+ *   S=../../src
+ *   g++ -O2 -I. -I$S azure_sas_rfc4231.cpp $S/sha256.cpp $S/Base64.cpp \
+ *       -o azure_sas_rfc4231
+ *   ./azure_sas_rfc4231
+ ****************************************************************************/
+#include <stdio.h>
+#include <time.h>
+#include "Arduino.h"
+#include "AzureSAS.h"
+
+typedef struct
+{
+    const char *key; /* NULL: 131 bytes of 0xaa */
+    const char *data;
+    const char *mac;
+} ST_Rfc4231;
+
+static const ST_Rfc4231 rfc4231[] = {
+    {"0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+     "4869205468657265",
+     "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7"},
+    {"4a656665",
+     "7768617420646f2079612077616e7420666f72206e6f7468696e673f",
+     "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"},
+    {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+     "dddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddd",
+     "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe"},
+    {"0102030405060708090a0b0c0d0e0f10111213141516171819",
+     "cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd",
+     "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b"},
+    {"0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c",
+     "546573742057697468205472756e636174696f6e",
+     "a3b6167473100ee06e0c796c2955552b"},
+    {NULL,
+     "54657374205573696e67204c6172676572205468616e20426c6f636b2d53697a65204b6579202d2048617368204b6579204669727374",
+     "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"},
+    {NULL,
+     "5468697320697320612074657374207573696e672061206c6172676572207468616e20626c6f636b2d73697a65206b6579"
+     "20616e642061206c6172676572207468616e20626c6f636b2d73697a6520646174612e20546865206b6579206e6565"
+     "647320746f20626520686173686564206265666f7265206265696e6720757365642062792074686520484d414320616c"
+     "676f726974686d2e",
+     "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2"},
+};
+
+#define CASES (sizeof(rfc4231) / sizeof(rfc4231[0]))
+
+static int unhex(const char *hex, uint8_t *out)
+{
+    int n = 0;
+    unsigned v;
+    for (; hex[0] && hex[1]; hex += 2)
+    {
+        sscanf(hex, "%2x", &v);
+        out[n++] = v;
+    }
+    return n;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int check_rfc4231(void)
+{
+    int fails = 0;
+    for (size_t i = 0; i < CASES; i++)
+    {
+        uint8_t key[131], data[200], mac[32];
+        int key_len, data_len, mac_len = unhex(rfc4231[i].mac, mac);
+        Sha256HmacKey schedule;
+        Sha256Class a, b, c;
+        bool plain, stored, reused;
+        if (rfc4231[i].key)
+            key_len = unhex(rfc4231[i].key, key);
+        else
+            memset(key, 0xaa, key_len = sizeof(key));
+        data_len = unhex(rfc4231[i].data, data);
+
+        a.initHmac(key, key_len);
+        a.write(data, data_len);
+        plain = !memcmp(a.resultHmac(), mac, mac_len);
+        b.initHmac(key, key_len, &schedule);
+        b.write(data, data_len);
+        stored = !memcmp(b.resultHmac(&schedule), mac, mac_len);
+        c.initHmac(&schedule);
+        c.write(data, data_len);
+        reused = !memcmp(c.resultHmac(&schedule), mac, mac_len);
+
+        printf("RFC 4231 case %d: initHmac(secret) %s, stored schedule %s, reused %s\n", (int)i + 1,
+               plain ? "ok" : "FAILED", stored ? "ok" : "FAILED", reused ? "ok" : "FAILED");
+        fails += !plain + !stored + !reused;
+    }
+    return fails;
+}
+
+static int check_sas(void)
+{
+    char key[] = "7gtWsRQX4hTzG9D/hqYXtm4JeQJGFUjP0V/3hP5Dr5M=";
+    const char *url = "myhub.azure-devices.net%2Fdevices%2Fdev-01";
+    char prev[AZURE_SAS_MAX_LENGTH] = "", big[400];
+    AzureSAS legacy, sas, nokey;
+    int fails = 0, signs = 0, n = 20000;
+    double t;
+
+    sas.begin(key);
+    String token = legacy.create(key, url, 1700000000);
+    if (strcmp(token.c_str(), sas.sign(url, 1700000000)))
+    {
+        printf("sign() != create():\n%s\n%s\n", token.c_str(), sas.sign(url, 1700000000));
+        fails++;
+    }
+    for (uint32_t t = 1700000000; t < 1700000000 + 86400; t += 30)
+    {
+        const char *x = sas.get(url, t, 3600);
+        if (strcmp(prev, x))
+        {
+            signs++;
+            strcpy(prev, x);
+        }
+    }
+    /* a token per 3600 - 300 s of the 24 h */
+    fails += 24 * 3600 / (3600 - AZURE_SAS_REFRESH_SECS) + 1 != signs;
+    fails += NULL == strstr(sas.get("other.azure-devices.net%2Fdevices%2Fx", 1700000000, 3600), "other");
+    memset(big, 'u', sizeof(big) - 1);
+    big[sizeof(big) - 1] = 0;
+    fails += NULL != sas.sign(big, 1);
+    fails += NULL != nokey.sign(url, 1);
+    printf("sign() == create(), get() signed %d times in 24 h, too long and no key rejected: %s\n", signs, fails ? "FAILED" : "ok");
+
+    t = now();
+    for (int i = 0; i < n; i++)
+        legacy.create(key, url, 1700000000 + i);
+    printf("create() %.2f us per token\n", (now() - t) / n * 1e6);
+    t = now();
+    for (int i = 0; i < n; i++)
+        sas.sign(url, 1700000000 + i);
+    printf("sign()   %.2f us per token\n", (now() - t) / n * 1e6);
+    return fails;
+}
+
+int main(void)
+{
+    int fails = check_rfc4231() + check_sas();
+    if (fails)
+        printf("%d checks failed\n", fails);
+    return fails != 0;
+}
@@ -15,36 +15,60 @@
 #   include <sha256.h>
 #endif
 
+#ifndef AZURE_SAS_MAX_LENGTH
+#define AZURE_SAS_MAX_LENGTH 384 // fits a resource url of up to ~200 chars
+#endif
+
+#ifndef AZURE_SAS_REFRESH_SECS
+#define AZURE_SAS_REFRESH_SECS 300 // a cached token is renewed this long before expiry
+#endif
+
+#define AZURE_SAS_PREFIX "SharedAccessSignature sr="
+
 class AzureSAS
 {
 public:
     String SAS;
 
-    AzureSAS() { SAS = ""; }
+    AzureSAS()
+    {
+        SAS = "";
+        reset();
+    }
     AzureSAS(char *key, String url, uint32_t expire)
     {
+        reset();
         SAS = create(key, url, expire);
     }
 
-    static String urlEncode(const char *msg)
+    /* out must hold 3 * strlen(msg) + 1, returns the encoded length */
+    static size_t urlEncode(char *out, const char *msg)
     {
         const char *hex = "0123456789abcdef";
-        String encodedMsg = "";
-        while (*msg != '\0')
+        char *p = out;
+        for (; *msg; msg++)
         {
-            if (('a' <= *msg && *msg <= 'z') || ('A' <= *msg && *msg <= 'Z') || ('0' <= *msg && *msg <= '9'))
+            unsigned char c = *msg;
+            if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9'))
             {
-                encodedMsg += *msg;
+                *p++ = c;
             }
             else
             {
-                encodedMsg += '%';
-                encodedMsg += hex[*msg >> 4];
-                encodedMsg += hex[*msg & 15];
+                *p++ = '%';
+                *p++ = hex[c >> 4];
+                *p++ = hex[c & 15];
             }
-            msg++;
         }
-        return encodedMsg;
+        *p = 0;
+        return p - out;
+    }
+
+    static String urlEncode(const char *msg)
+    {
+        char encodedMsg[strlen(msg) * 3 + 1];
+        urlEncode(encodedMsg, msg);
+        return String(encodedMsg);
     }
 
     String get()
@@ -65,7 +89,7 @@ public:
 
         int keyLength = strlen(key);
         int decodedKeyLength = base64_dec_len(key, keyLength);
-        char decodedKey[decodedKeyLength];         //allocate char array big enough for the base64 decoded key
+        char decodedKey[decodedKeyLength + 1];     //allocate char array big enough for the base64 decoded key and its '\0'
         base64_decode(decodedKey, key, keyLength); //decode key
 
         // openSSL version
@@ -81,7 +105,7 @@ public:
 
         // Get base64 of signature
         int encodedSignLen = base64_enc_len(32); // HASH_LENGTH
-        char encodedSign[encodedSignLen];
+        char encodedSign[encodedSignLen + 1];
         base64_encode(encodedSign, (char *)sign, 32); // HASH_LENGTH
 
         //DBG_SAS("url: %s\n", URL.c_str());
@@ -97,6 +121,91 @@ public:
         return SAS;
     }
 
+#ifndef openSSL
+    /*
+        Token context: the device key is decoded once and only the HMAC
+        inner/outer states are kept, a token costs the hash of the
+        string to sign. The token is built in a fixed buffer.
+    */
+
+    /* base64 device key */
+    bool begin(const char *key)
+    {
+        int keyLength = strlen(key);
+        if (keyLength < 4)
+            return false;
+        int decodedKeyLength = base64_dec_len((char *)key, keyLength);
+        char decodedKey[decodedKeyLength + 1]; // base64_decode() appends a '\0'
+        base64_decode(decodedKey, (char *)key, keyLength);
+        Sha256Class sha;
+        sha.initHmac((const uint8_t *)decodedKey, decodedKeyLength, &hmac);
+        memset(decodedKey, 0, decodedKeyLength);
+        keyed = true;
+        expiry = 0;
+        return true;
+    }
+
+    void setRefreshMargin(uint32_t secs) { margin = secs; }
+
+    /* new token for url, NULL without a key or if it does not fit AZURE_SAS_MAX_LENGTH */
+    const char *sign(const char *url, uint32_t expire)
+    {
+        char se[12], encodedSign[base64_enc_len(HASH_LENGTH) + 1];
+        size_t urlLength = strlen(url), len;
+        int seLength = snprintf(se, sizeof(se), "%lu", (unsigned long)expire);
+        expiry = 0;
+        if (!keyed || sizeof(AZURE_SAS_PREFIX) + urlLength + 5 + 3 * base64_enc_len(HASH_LENGTH) + 4 + seLength > sizeof(token))
+            return NULL;
+
+        Sha256Class sha;
+        sha.initHmac(&hmac);
+        sha.write((const uint8_t *)url, urlLength);
+        sha.write('\n');
+        sha.write((const uint8_t *)se, seLength);
+        base64_encode(encodedSign, (char *)sha.resultHmac(&hmac), HASH_LENGTH);
+
+        len = sizeof(AZURE_SAS_PREFIX) - 1;
+        memcpy(token, AZURE_SAS_PREFIX, len);
+        memcpy(token + len, url, urlLength);
+        len += urlLength;
+        memcpy(token + len, "&sig=", 5);
+        len += 5;
+        len += urlEncode(token + len, encodedSign);
+        memcpy(token + len, "&se=", 4);
+        len += 4;
+        memcpy(token + len, se, seLength + 1);
+        expiry = expire;
+        return token;
+    }
+
+    /* the cached token if url matches and now is before the refresh margin, else a new one valid for ttl */
+    const char *get(const char *url, uint32_t now, uint32_t ttl)
+    {
+        size_t n = strlen(url);
+        const char *sr = token + sizeof(AZURE_SAS_PREFIX) - 1;
+        if (expiry && now + margin < expiry && 0 == strncmp(sr, url, n) && '&' == sr[n])
+            return token;
+        return sign(url, now + ttl);
+    }
+
+private:
+    Sha256HmacKey hmac;
+    bool keyed;
+    uint32_t expiry;
+    uint32_t margin;
+    char token[AZURE_SAS_MAX_LENGTH];
+
+    void reset()
+    {
+        keyed = false;
+        expiry = 0;
+        margin = AZURE_SAS_REFRESH_SECS;
+        token[0] = 0;
+    }
+#else
+    void reset() {}
+#endif
+
 #ifdef openSSL
     static int hmac_sha25_digest(unsigned char *msg, int mlen, unsigned char *key, int key_len, unsigned char **res, unsigned int *rlen)
     {
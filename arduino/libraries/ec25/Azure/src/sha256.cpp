@@ -102,6 +102,7 @@ size_t Sha256Class::write(uint8_t data)
 {
   ++byteCount;
   addUncounted(data);
+  return 1;
 }
 
 void Sha256Class::pad()
@@ -189,4 +190,36 @@ uint8_t *Sha256Class::resultHmac(void)
     write(innerHash[i]);
   return result();
 }
+
+void Sha256Class::initHmac(const uint8_t *key, int keyLength, Sha256HmacKey *hmac)
+{
+  uint8_t i;
+  initHmac(key, keyLength);
+  // both pads are exactly one block, the state is all there is to keep
+  hmac->inner = state;
+  init();
+  for (i = 0; i < BLOCK_LENGTH; i++)
+    write(keyBuffer[i] ^ HMAC_OPAD);
+  hmac->outer = state;
+  initHmac(hmac);
+}
+
+void Sha256Class::initHmac(const Sha256HmacKey *hmac)
+{
+  state = hmac->inner;
+  byteCount = BLOCK_LENGTH;
+  bufferOffset = 0;
+}
+
+uint8_t *Sha256Class::resultHmac(const Sha256HmacKey *hmac)
+{
+  uint8_t i;
+  memcpy(innerHash, result(), HASH_LENGTH);
+  state = hmac->outer;
+  byteCount = BLOCK_LENGTH;
+  bufferOffset = 0;
+  for (i = 0; i < HASH_LENGTH; i++)
+    write(innerHash[i]);
+  return result();
+}
 Sha256Class Sha256;
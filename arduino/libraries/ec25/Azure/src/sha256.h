@@ -17,6 +17,12 @@ union _state {
   uint32_t w[HASH_LENGTH/4];
 };
 
+// HMAC key schedule: the hash states after the ipad and the opad block
+typedef struct {
+  _state inner;
+  _state outer;
+} Sha256HmacKey;
+
 class Sha256Class : public Print
 {
   public:
@@ -24,6 +30,11 @@ class Sha256Class : public Print
     void initHmac(const uint8_t* secret, int secretLength);
     uint8_t* result(void);
     uint8_t* resultHmac(void);
+    // once per key: fills the schedule and starts the inner hash
+    void initHmac(const uint8_t* secret, int secretLength, Sha256HmacKey* key);
+    // per message: no key block is hashed again
+    void initHmac(const Sha256HmacKey* key);
+    uint8_t* resultHmac(const Sha256HmacKey* key);
     virtual size_t write(uint8_t);
     using Print::write;
   private:
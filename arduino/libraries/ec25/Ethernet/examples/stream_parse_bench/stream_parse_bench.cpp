@@ -0,0 +1,191 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   stream_parse_bench.cpp
+ *
+ * Description:
+ * ------------
+ *   A 64 KB HTTP body parsed line by line with Stream::readStringUntil('\n'),
+ *   four ways: from memory through a stream with and without peekSpan(),
+ *   and from a socket through EthernetClient with its MSG_PEEK span and with
+ *   the span turned off, which is the byte path: one virtual read() and a
+ *   recv() per byte. Every way must give the same lines. Prints the time
+ *   per body, the rate and the recv() calls per body, counted with
+ *   -Wl,--wrap=recv. Stream, String and EthernetClient are the real
+ *   sources, the ec25 core headers build on Linux as they are:
+ *
+ *   A=../../../../..
+ *   gcc -c $A/arduino/dtostrf.c $A/cores/ec25/no_std.c
+ *   g++ -O2 -I$A/arduino -I$A/cores/ec25 -I$A/variants/ec25 \
+ *       -I$A/../openlinux/ec25/interface -I../../src stream_parse_bench.cpp \
+ *       ../../src/EthernetClient.cpp $A/arduino/Stream.cpp $A/arduino/Print.cpp \
+ *       $A/arduino/WString.cpp $A/arduino/IPAddress.cpp dtostrf.o no_std.o \
+ *       -Wl,--wrap=recv -lpthread -o stream_parse_bench
+ *   ./stream_parse_bench [rounds]
+ *
+ *   For the numbers before the span API, build against the older
+ *   arduino/Stream.cpp and Stream.h.
+ ****************************************************************************/
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "Arduino.h"
+#include "EthernetClient.h"
+
+#define BODY_SIZE (64 * 1024)
+
+static char body[BODY_SIZE];
+static size_t body_lines;
+static unsigned long recv_calls;
+
+extern "C" ssize_t __real_recv(int fd, void *buf, size_t len, int flags);
+extern "C" ssize_t __wrap_recv(int fd, void *buf, size_t len, int flags)
+{
+    recv_calls++;
+    return __real_recv(fd, buf, len, flags);
+}
+
+unsigned int millis(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the body in memory, spans of at most 1460 bytes like TCP segments */
+class MemStream : public Stream
+{
+public:
+    MemStream(bool spans) : pos(0), spans(spans) {}
+    size_t pos;
+    bool spans;
+    int available() { return BODY_SIZE - pos; }
+    int read() { return pos < BODY_SIZE ? (unsigned char)body[pos++] : -1; }
+    int peek() { return pos < BODY_SIZE ? (unsigned char)body[pos] : -1; }
+    size_t write(uint8_t) { return 0; }
+    size_t peekSpan(const char **data)
+    {
+        size_t n = BODY_SIZE - pos;
+        if (!spans || 0 == n)
+            return 0;
+        *data = body + pos;
+        return n < 1460 ? n : 1460;
+    }
+    void consume(size_t length) { pos += length; }
+};
+
+/* EthernetClient on the byte path */
+class ByteClient : public EthernetClient
+{
+public:
+    ByteClient(int sock) : EthernetClient(sock) {}
+    size_t peekSpan(const char **data) { return 0; }
+    size_t readAvailable(char *buf, size_t size) { return 0; }
+};
+
+static void *writer(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    for (size_t off = 0; off < BODY_SIZE;)
+    {
+        ssize_t w = write(fd, body + off, BODY_SIZE - off);
+        if (w <= 0)
+            break;
+        off += w;
+    }
+    close(fd);
+    return NULL;
+}
+
+/* parses one body, returns false when a line differs */
+static bool parse(Stream &s)
+{
+    size_t off = 0, lines = 0;
+    while (off < BODY_SIZE)
+    {
+        String line = s.readStringUntil('\n');
+        if (0 != memcmp(line.c_str(), body + off, line.length()) || '\n' != body[off + line.length()])
+            return false;
+        off += line.length() + 1;
+        lines++;
+    }
+    return lines == body_lines;
+}
+
+static int run(const char *name, int rounds, int kind)
+{
+    int failed = 0;
+    double t = 0;
+    unsigned long calls = 0;
+    for (int r = 0; r < rounds; r++)
+    {
+        if (kind < 2)
+        {
+            MemStream m(kind == 1);
+            double t0 = now();
+            failed += !parse(m);
+            t += now() - t0;
+            continue;
+        }
+        int sv[2];
+        pthread_t tid;
+        socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+        pthread_create(&tid, NULL, writer, (void *)(intptr_t)sv[1]);
+        EthernetClient *c = kind == 3 ? new EthernetClient(sv[0]) : new ByteClient(sv[0]);
+        recv_calls = 0;
+        double t0 = now();
+        failed += !parse(*c);
+        t += now() - t0;
+        calls += recv_calls;
+        pthread_join(tid, NULL);
+        c->stop();
+        delete c;
+    }
+    printf("%-28s %8.3f ms/body %8.1f MB/s", name, t * 1e3 / rounds, BODY_SIZE * rounds / t / 1e6);
+    if (kind >= 2)
+        printf(" %7lu recv/body", calls / rounds);
+    printf("%s\n", failed ? "  FAILED" : "");
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 20;
+    int failed = 0;
+
+    /* headers-like short lines, then longer body lines, all '\n' terminated */
+    srand(1);
+    for (size_t off = 0; off < BODY_SIZE;)
+    {
+        size_t n = (off < 1024 ? 10 : 20) + rand() % 100;
+        if (off + n + 1 > BODY_SIZE)
+            n = BODY_SIZE - off - 1;
+        for (size_t i = 0; i < n; i++)
+            body[off + i] = 'a' + (off + i) % 26;
+        body[off + n] = '\n';
+        off += n + 1;
+        body_lines++;
+    }
+    printf("%u bytes, %u lines, %d rounds\n", BODY_SIZE, (unsigned)body_lines, rounds);
+
+    failed += run("memory, byte path", rounds, 0);
+    failed += run("memory, peekSpan", rounds, 1);
+    failed += run("EthernetClient, byte path", rounds, 2);
+    failed += run("EthernetClient, peekSpan", rounds, 3);
+    if (failed)
+    {
+        printf("%d bodies failed\n", failed);
+        return 1;
+    }
+    printf("all lines match\n");
+    return 0;
+}
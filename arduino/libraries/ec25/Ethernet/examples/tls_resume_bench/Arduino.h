@@ -0,0 +1,39 @@
+/*
+    Host stand-in for the parts of Arduino.h ClientSecure uses,
+    for tls_resume_bench.cpp only
+*/
+#ifndef ARDUINO_HOST_H_
+#define ARDUINO_HOST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <string>
+
+static inline uint32_t millis()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+class String
+{
+public:
+    String(const char *s) : _s(s ? s : "") {}
+    const char *c_str() const { return _s.c_str(); }
+
+private:
+    std::string _s;
+};
+
+#endif
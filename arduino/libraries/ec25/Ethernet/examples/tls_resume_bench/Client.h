@@ -0,0 +1,23 @@
+/*
+    Host stand-in, for tls_resume_bench.cpp only
+*/
+#ifndef CLIENT_HOST_H_
+#define CLIENT_HOST_H_
+
+#include "Print.h"
+
+class Client : public Stream
+{
+public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t *buf, size_t size) = 0;
+    virtual int peek() = 0;
+    virtual void flush() = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+};
+
+#endif
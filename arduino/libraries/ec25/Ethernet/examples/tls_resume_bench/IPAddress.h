@@ -0,0 +1,12 @@
+/*
+    Host stand-in, for tls_resume_bench.cpp only
+*/
+#ifndef IPADDRESS_HOST_H_
+#define IPADDRESS_HOST_H_
+
+struct IPAddress
+{
+    String toString() const { return String("127.0.0.1"); }
+};
+
+#endif
@@ -0,0 +1,26 @@
+/*
+    Host stand-in for Print and Stream, for tls_resume_bench.cpp only
+*/
+#ifndef PRINT_HOST_H_
+#define PRINT_HOST_H_
+
+class Print
+{
+public:
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--)
+            n += write(*buffer++);
+        return n;
+    }
+};
+
+class Stream : public Print
+{
+public:
+    size_t readBytes(char *buffer, size_t length) { return 0; }
+};
+
+#endif
@@ -0,0 +1,15 @@
+#!/bin/sh
+#
+# Test PKI for tls_resume_bench: a CA, a server and a client certificate
+# signed by it, and an unrelated CA for the verification failure case.
+#
+#   sh certs.sh
+#
+set -e
+openssl req -x509 -newkey rsa:2048 -nodes -days 30 -subj /CN=bench-ca -keyout ca.key -out ca.pem
+openssl req -x509 -newkey rsa:2048 -nodes -days 30 -subj /CN=other-ca -keyout other.key -out other.pem
+for name in server client; do
+    openssl req -newkey rsa:2048 -nodes -subj /CN=127.0.0.1 -keyout $name.key -out $name.csr
+    openssl x509 -req -days 30 -in $name.csr -CA ca.pem -CAkey ca.key -CAcreateserial -out $name.pem
+    rm $name.csr
+done
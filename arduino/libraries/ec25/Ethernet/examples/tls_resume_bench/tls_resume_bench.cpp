@@ -0,0 +1,183 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   tls_resume_bench.cpp
+ *
+ * Description:
+ * ------------
+ *   Connects ClientSecure to three openssl s_server instances: one with
+ *   session tickets, one with session ids only (-no_ticket) and one that
+ *   requires a client certificate. Every connect sends a request and must
+ *   get an answer. Reported per server: ms per connect and handshake bytes
+ *   per connect, with resumption and without. Checked from getStats():
+ *   all but the first handshake resume, a wrong CA fails verification and
+ *   is counted, flushCache() forces a full handshake, and a client whose
+ *   credentials don't fit the SSL_CTX cache gets a private ctx and never
+ *   resumes. Then several threads connect at once through the shared
+ *   caches. Arduino.h, Client.h, IPAddress.h and Print.h here are host
+ *   stand-ins, the host's OpenSSL is used:
+ *
+ *   sh certs.sh
+ *   S="-tls1_2 -www -cert server.pem -key server.key -quiet"
+ *   openssl s_server $S -accept 44331 &
+ *   openssl s_server $S -accept 44332 -no_ticket &
+ *   openssl s_server $S -accept 44333 -Verify 1 -CAfile ca.pem &
+ *   g++ -O2 -I. -I../../src tls_resume_bench.cpp ../../src/ClientSecure.cpp \
+ *       -lssl -lcrypto -lpthread -o tls_resume_bench
+ *   ./tls_resume_bench [connects] [threads]
+ ****************************************************************************/
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <openssl/bio.h>
+#include "ClientSecure.h"
+
+#define TICKETS 44331
+#define SESSION_IDS 44332
+#define MUTUAL 44333
+
+class BenchClient : public ClientSecure
+{
+public:
+    /* bytes on the wire so far, before the request that is the handshake */
+    unsigned long wire() { return BIO_number_read(SSL_get_rbio(client.ssl)) + BIO_number_written(SSL_get_wbio(client.ssl)); }
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* connects n times, returns the connects that got an answer */
+static int run(const char *name, uint16_t port, const char *ca, const char *cert, const char *key, int n, bool resume, bool quiet = false)
+{
+    unsigned long handshake = 0;
+    int ok = 0;
+    double t = now();
+    for (int i = 0; i < n; i++)
+    {
+        BenchClient c;
+        c.setCACert(ca);
+        c.setCertificate(cert);
+        c.setPrivateKey(key);
+        c.setVerify(SSL_VERIFY_PEER);
+        c.setSessionResumption(resume);
+        if (!c.connect("127.0.0.1", port))
+            continue;
+        handshake += c.wire();
+        static const char request[] = "GET / HTTP/1.0\r\n\r\n";
+        c.write((const uint8_t *)request, sizeof(request) - 1);
+        uint8_t buf[512];
+        int got = 0;
+        for (int k = 0; k < 200 && got <= 0; k++)
+            got = c.read(buf, sizeof(buf));
+        ok += got > 0;
+        c.stop();
+    }
+    t = now() - t;
+    if (!quiet)
+        printf("%-28s %3d/%-3d ok, %6.2f ms/connect, %5lu handshake bytes/connect\n", name, ok, n, t * 1000 / n, n ? handshake / n : 0);
+    return ok;
+}
+
+static int expect(bool ok, const char *what)
+{
+    if (!ok)
+        printf("FAILED: %s\n", what);
+    return !ok;
+}
+
+static int connects;
+
+static void *worker(void *arg)
+{
+    *(int *)arg = run("thread", (uintptr_t)arg & 1 ? TICKETS : SESSION_IDS, "ca.pem", NULL, NULL, connects, true, true);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 50;
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+    int failed = 0;
+    ssl_stats_t s;
+
+    failed += expect(n == run("tickets", TICKETS, "ca.pem", NULL, NULL, n, true), "tickets");
+    failed += expect(n == run("session ids (-no_ticket)", SESSION_IDS, "ca.pem", NULL, NULL, n, true), "session ids");
+    failed += expect(n == run("mutual TLS", MUTUAL, "ca.pem", "client.pem", "client.key", n, true), "mutual TLS");
+    ClientSecure::getStats(&s);
+    printf("resumed %u of %u handshakes, full %.1f ms, resumed %.1f ms, ctx hits %u misses %u\n",
+           s.resumed, s.handshakes, (double)s.full_ms / (s.handshakes - s.resumed),
+           s.resumed ? (double)s.resumed_ms / s.resumed : 0, s.ctx_hits, s.ctx_misses);
+    failed += expect(s.handshakes == 3u * n && s.resumed == 3u * (n - 1) && s.failed == 0, "all but the first resume");
+
+    ClientSecure::resetStats();
+    failed += expect(n == run("tickets, resumption off", TICKETS, "ca.pem", NULL, NULL, n, false), "resumption off");
+    failed += expect(n == run("session ids, resumption off", SESSION_IDS, "ca.pem", NULL, NULL, n, false), "resumption off");
+    failed += expect(n == run("mutual TLS, resumption off", MUTUAL, "ca.pem", "client.pem", "client.key", n, false), "resumption off");
+    ClientSecure::getStats(&s);
+    failed += expect(s.resumed == 0, "nothing resumed with resumption off");
+
+    ClientSecure::resetStats();
+    failed += expect(0 == run("wrong CA", TICKETS, "other.pem", NULL, NULL, 3, true), "wrong CA connects");
+    ClientSecure::getStats(&s);
+    failed += expect(s.failed == 3, "wrong CA counted as failed");
+
+    ClientSecure::flushCache();
+    ClientSecure::resetStats();
+    run("after flushCache", TICKETS, "ca.pem", NULL, NULL, 3, true);
+    ClientSecure::getStats(&s);
+    failed += expect(s.resumed == 2 && s.ctx_misses == 1, "full handshake after flushCache");
+
+    /* fill the ctx cache, the credentials past it get a private ctx */
+    ClientSecure::flushCache();
+    ClientSecure::resetStats();
+    static char paths[SSL_CTX_CACHE_SIZE + 1][64];
+    for (int i = 0; i <= SSL_CTX_CACHE_SIZE; i++)
+    {
+        snprintf(paths[i], sizeof(paths[i]), "%.*sca.pem", 2 * i, "././././././././././././././././");
+        run(paths[i], TICKETS, paths[i], NULL, NULL, 1, true, true);
+    }
+    ClientSecure::resetStats();
+    run("private SSL_CTX", TICKETS, paths[SSL_CTX_CACHE_SIZE], NULL, NULL, 4, true);
+    ClientSecure::getStats(&s);
+    failed += expect(s.handshakes == 4 && s.resumed == 0, "no resumption on a private ctx");
+
+    /* the caches from several threads at once */
+    ClientSecure::flushCache();
+    ClientSecure::resetStats();
+    pthread_t tid[64];
+    int ok[64];
+    connects = n;
+    if (threads > 64)
+        threads = 64;
+    double t = now();
+    for (int i = 0; i < threads; i++)
+    {
+        ok[i] = i;
+        pthread_create(&tid[i], NULL, worker, &ok[i]);
+    }
+    int total = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(tid[i], NULL);
+        total += ok[i];
+    }
+    t = now() - t;
+    ClientSecure::getStats(&s);
+    printf("%d threads x %d connects: %d ok, %.2f ms/connect, resumed %u of %u\n",
+           threads, n, total, t * 1000 / (threads * n), s.resumed, s.handshakes);
+    failed += expect(total == threads * n && s.failed == 0, "threads");
+    ClientSecure::flushCache();
+
+    if (failed)
+    {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
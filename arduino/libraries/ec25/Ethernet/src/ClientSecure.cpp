@@ -29,6 +29,244 @@
 #define SSL_DEFAULT_TIMEOUT 10000
 #define SSL_ERROR_STRING ERR_error_string(ERR_get_error(), NULL)
 
+/*
+    Process-wide caches, shared by all ClientSecure objects:
+    - one SSL_CTX per credential set, the CA, certificate and key files
+      are loaded once instead of on every connect
+    - the last TLS session per host:port and SSL_CTX, offered with
+      SSL_set_session() so a reconnect is an abbreviated handshake
+      (session ticket or session id, whichever the server gave)
+      only for a cached SSL_CTX, one that is not cached dies with its
+      client and could leave an entry behind for an unrelated ctx
+    An SSL holds its own reference to the SSL_CTX, flushCache() is safe
+    while clients are connected.
+*/
+
+#include <pthread.h>
+
+static pthread_mutex_t ssl_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct
+{
+    SSL_CTX *ctx;
+    char *ca_cert;
+    char *certificate;
+    char *private_key;
+} ssl_ctx_cache[SSL_CTX_CACHE_SIZE];
+
+static struct
+{
+    SSL_CTX *ctx;
+    SSL_SESSION *session;
+    uint16_t port;
+    char host[SSL_SESSION_HOST_MAX];
+} ssl_session_cache[SSL_SESSION_CACHE_SIZE];
+
+static unsigned ssl_session_next; // round robin victim when full
+
+static ssl_stats_t ssl_stats;
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+/*
+    OpenSSL 1.0.x locks nothing by itself, the shared SSL_CTX, its
+    certificate store and the cached sessions are used by every thread
+    that connects. One mutex per CRYPTO lock and the thread id, unless
+    the application has installed its own callbacks.
+*/
+static pthread_mutex_t *ssl_locks;
+
+static void ssl_locking_callback(int mode, int n, const char *file, int line)
+{
+    if (mode & CRYPTO_LOCK)
+        pthread_mutex_lock(&ssl_locks[n]);
+    else
+        pthread_mutex_unlock(&ssl_locks[n]);
+}
+
+static unsigned long ssl_id_callback(void)
+{
+    return (unsigned long)pthread_self();
+}
+
+static void ssl_thread_setup()
+{
+    if (CRYPTO_get_locking_callback())
+        return;
+    ssl_locks = (pthread_mutex_t *)malloc(CRYPTO_num_locks() * sizeof(pthread_mutex_t));
+    if (NULL == ssl_locks)
+        abort();
+    for (int i = 0; i < CRYPTO_num_locks(); i++)
+        pthread_mutex_init(&ssl_locks[i], NULL);
+    CRYPTO_set_id_callback(ssl_id_callback);
+    CRYPTO_set_locking_callback(ssl_locking_callback);
+}
+#endif
+
+static pthread_once_t ssl_setup_once = PTHREAD_ONCE_INIT;
+
+static void ssl_setup_run()
+{
+    SSL_library_init();
+    SSL_load_error_strings();
+    OpenSSL_add_all_algorithms();
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    ssl_thread_setup();
+#endif
+}
+
+void ClientSecure::ssl_setup()
+{
+    pthread_once(&ssl_setup_once, ssl_setup_run);
+}
+
+static bool ssl_same(const char *a, const char *b)
+{
+    return a == b || (a && b && 0 == strcmp(a, b));
+}
+
+static char *ssl_dup(const char *s)
+{
+    return s ? strdup(s) : NULL;
+}
+
+static SSL_CTX *ssl_ctx_find(secure_contex *client)
+{
+    SSL_CTX *ctx = NULL;
+    pthread_mutex_lock(&ssl_cache_lock);
+    for (int i = 0; i < SSL_CTX_CACHE_SIZE; i++)
+    {
+        if (ssl_ctx_cache[i].ctx &&
+            ssl_same(ssl_ctx_cache[i].ca_cert, client->ca_cert) &&
+            ssl_same(ssl_ctx_cache[i].certificate, client->certificate) &&
+            ssl_same(ssl_ctx_cache[i].private_key, client->private_key))
+        {
+            ctx = ssl_ctx_cache[i].ctx;
+            break;
+        }
+    }
+    if (ctx)
+        ssl_stats.ctx_hits++;
+    else
+        ssl_stats.ctx_misses++;
+    pthread_mutex_unlock(&ssl_cache_lock);
+    return ctx;
+}
+
+/* the cache takes ctx if a slot is free, returns 1 then */
+static int ssl_ctx_store(secure_contex *client)
+{
+    int rc = 0;
+    pthread_mutex_lock(&ssl_cache_lock);
+    for (int i = 0; i < SSL_CTX_CACHE_SIZE; i++)
+    {
+        if (NULL == ssl_ctx_cache[i].ctx)
+        {
+            ssl_ctx_cache[i].ctx = client->ctx;
+            ssl_ctx_cache[i].ca_cert = ssl_dup(client->ca_cert);
+            ssl_ctx_cache[i].certificate = ssl_dup(client->certificate);
+            ssl_ctx_cache[i].private_key = ssl_dup(client->private_key);
+            rc = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ssl_cache_lock);
+    return rc;
+}
+
+static int ssl_session_find(SSL_CTX *ctx, const char *host, uint16_t port)
+{
+    for (int i = 0; i < SSL_SESSION_CACHE_SIZE; i++)
+        if (ssl_session_cache[i].session && ssl_session_cache[i].ctx == ctx &&
+            ssl_session_cache[i].port == port && 0 == strcmp(ssl_session_cache[i].host, host))
+            return i;
+    return -1;
+}
+
+/* offer the cached session, returns 1 if there was one */
+static int ssl_session_apply(SSL *ssl, SSL_CTX *ctx, const char *host, uint16_t port)
+{
+    int i, rc = 0;
+    pthread_mutex_lock(&ssl_cache_lock);
+    if ((i = ssl_session_find(ctx, host, port)) >= 0)
+    {
+        SSL_SESSION *session = ssl_session_cache[i].session;
+        if ((long)time(NULL) < SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session))
+            rc = SSL_set_session(ssl, session); // takes its own reference
+        else
+        {
+            SSL_SESSION_free(session);
+            ssl_session_cache[i].session = NULL;
+        }
+    }
+    pthread_mutex_unlock(&ssl_cache_lock);
+    return rc;
+}
+
+/* keep session (a reference from SSL_get1_session) for host:port, NULL drops the entry */
+static void ssl_session_store(SSL_CTX *ctx, const char *host, uint16_t port, SSL_SESSION *session)
+{
+    int i;
+    if (strlen(host) >= SSL_SESSION_HOST_MAX)
+    {
+        if (session)
+            SSL_SESSION_free(session);
+        return;
+    }
+    pthread_mutex_lock(&ssl_cache_lock);
+    if ((i = ssl_session_find(ctx, host, port)) < 0 && session)
+    {
+        for (i = 0; i < SSL_SESSION_CACHE_SIZE && ssl_session_cache[i].session; i++)
+            ;
+        if (i == SSL_SESSION_CACHE_SIZE)
+            i = ssl_session_next++ % SSL_SESSION_CACHE_SIZE;
+    }
+    if (i >= 0)
+    {
+        if (ssl_session_cache[i].session)
+            SSL_SESSION_free(ssl_session_cache[i].session);
+        ssl_session_cache[i].session = session;
+        ssl_session_cache[i].ctx = ctx;
+        ssl_session_cache[i].port = port;
+        strcpy(ssl_session_cache[i].host, host);
+    }
+    pthread_mutex_unlock(&ssl_cache_lock);
+}
+
+void ClientSecure::getStats(ssl_stats_t *stats)
+{
+    pthread_mutex_lock(&ssl_cache_lock);
+    *stats = ssl_stats;
+    pthread_mutex_unlock(&ssl_cache_lock);
+}
+
+void ClientSecure::resetStats()
+{
+    pthread_mutex_lock(&ssl_cache_lock);
+    memset(&ssl_stats, 0, sizeof(ssl_stats));
+    pthread_mutex_unlock(&ssl_cache_lock);
+}
+
+void ClientSecure::flushCache()
+{
+    pthread_mutex_lock(&ssl_cache_lock);
+    for (int i = 0; i < SSL_SESSION_CACHE_SIZE; i++)
+    {
+        if (ssl_session_cache[i].session)
+            SSL_SESSION_free(ssl_session_cache[i].session);
+        ssl_session_cache[i].session = NULL;
+    }
+    for (int i = 0; i < SSL_CTX_CACHE_SIZE; i++)
+    {
+        if (ssl_ctx_cache[i].ctx)
+            SSL_CTX_free(ssl_ctx_cache[i].ctx);
+        free(ssl_ctx_cache[i].ca_cert);
+        free(ssl_ctx_cache[i].certificate);
+        free(ssl_ctx_cache[i].private_key);
+        memset(&ssl_ctx_cache[i], 0, sizeof(ssl_ctx_cache[i]));
+    }
+    pthread_mutex_unlock(&ssl_cache_lock);
+}
+
 static int ssl_connect(secure_contex *client, const char *host, uint32_t port)
 {
     if (NULL == client)
@@ -47,7 +285,10 @@ static int ssl_connect(secure_contex *client, const char *host, uint32_t port)
     DEBUG_SSL("[SSL] GetHostByName: %s\n", host);
     struct sockaddr_in sa;
     memset(&sa, 0, sizeof(sa));
-    struct hostent *hp = gethostbyname(host);
+    struct hostent he, *hp = NULL;
+    char hbuf[512];
+    int herr;
+    gethostbyname_r(host, &he, hbuf, sizeof(hbuf), &hp, &herr); // gethostbyname() is one static buffer for all threads
     if (hp == NULL)
     {
         DEBUG_SSL("[ERROR] gethostbyname()\n", host);
@@ -140,12 +381,18 @@ int ClientSecure::ssl_begin(const char *host, uint32_t port, int vrf)
     if (ssl_connect(&client, host, port) < 0)
         return -1;
 
-    client.ctx = SSL_CTX_new(SSLv23_method()); // 23 can work with TLSv1_2_method
-    //SSL_CTX_set_options(client.ctx, SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_1 | SSL_OP_NO_TLSv1_3);
-    //SSL_CTX_set_options(client.ctx, SSL_OP_NO_COMPRESSION);
+    client.ctx = ssl_ctx_find(&client);
+    client.ctx_shared = NULL != client.ctx;
+    if (NULL == client.ctx)
+    {
+        client.ctx = SSL_CTX_new(SSLv23_method()); // 23 can work with TLSv1_2_method
+        //SSL_CTX_set_options(client.ctx, SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_1 | SSL_OP_NO_TLSv1_3);
+        //SSL_CTX_set_options(client.ctx, SSL_OP_NO_COMPRESSION);
 
-    if (ssl_try_load_files() || ssl_try_load_array())
-        return -1;
+        if (ssl_try_load_files() || ssl_try_load_array())
+            return -1;
+        client.ctx_shared = ssl_ctx_store(&client); // else freed by stop()
+    }
 
     //CREATE SSL, must be here, after CTX initialization
     client.ssl = SSL_new(client.ctx);
@@ -168,22 +415,57 @@ int ClientSecure::ssl_begin(const char *host, uint32_t port, int vrf)
         return -1;
     }
 
+    //RESUME, only with a cached SSL_CTX: a private one is freed by stop() and
+    //its address, the key of the session cache, may be reused by another ctx
+    int resume = client.resume && client.ctx_shared;
+    if (resume)
+        ssl_session_apply(client.ssl, client.ctx, host, port);
+
     //HANDSHAKE
+    uint32_t start = millis();
     rc = SSL_connect(client.ssl);
+    uint32_t elapsed = millis() - start;
     if (rc <= 0)
     {
         DEBUG_SSL("[ERROR] SSL_connect() %s\n", SSL_ERROR_STRING);
         //ERR_print_errors_fp(stderr);
+        if (resume)
+            ssl_session_store(client.ctx, host, port, NULL); // do not offer it again
+        pthread_mutex_lock(&ssl_cache_lock);
+        ssl_stats.failed++;
+        pthread_mutex_unlock(&ssl_cache_lock);
         return -1;
     }
 
+    int reused = SSL_session_reused(client.ssl);
+    pthread_mutex_lock(&ssl_cache_lock);
+    ssl_stats.handshakes++;
+    if (reused)
+    {
+        ssl_stats.resumed++;
+        ssl_stats.resumed_ms += elapsed;
+    }
+    else
+        ssl_stats.full_ms += elapsed;
+    pthread_mutex_unlock(&ssl_cache_lock);
+    DEBUG_SSL("[SSL] Handshake %s %u ms\n", reused ? "resumed" : "full", elapsed);
+
     if (vrf && SSL_get_verify_result(client.ssl) != X509_V_OK)
     {
         DEBUG_SSL("[ERROR] Certificate doesn't verify\n%s\n", SSL_ERROR_STRING);
         //ERR_print_errors_fp(stderr);
+        if (resume)
+            ssl_session_store(client.ctx, host, port, NULL);
+        pthread_mutex_lock(&ssl_cache_lock);
+        ssl_stats.failed++;
+        pthread_mutex_unlock(&ssl_cache_lock);
         return -1;
     }
 
+    //only a verified session is kept, a resumed one may come with a renewed ticket
+    if (resume)
+        ssl_session_store(client.ctx, host, port, SSL_get1_session(client.ssl));
+
     struct timeval interval = {0, 10 * 1000}; // 10ms timeout for reading and peek
     setsockopt(client.sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&interval, sizeof(struct timeval));
     return 0;
@@ -241,12 +523,17 @@ void ClientSecure::stop()
     client.sock = -1;
 
     if (client.ssl)
+    {
+        if (client.resume)
+            SSL_set_shutdown(client.ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN); // freed unshut, the session is not resumable
         SSL_free(client.ssl);
+    }
     client.ssl = NULL;
 
-    if (client.ctx)
+    if (client.ctx && !client.ctx_shared)
         SSL_CTX_free(client.ctx);
     client.ctx = NULL;
+    client.ctx_shared = 0;
 
     DEBUG_SSL("[SSL] stop()\n");
 }
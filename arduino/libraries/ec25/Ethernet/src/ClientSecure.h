@@ -33,6 +33,27 @@
 #define CIPHERS_ALL     "ALL:!EXPORT:!LOW:!aNULL:!eNULL:!SSLv2"
 #define CIPHERS_HIGH    "HIGH:!aNULL:!kRSA:!PSK:!SRP:!MD5:!RC4"
 
+#ifndef SSL_CTX_CACHE_SIZE
+#define SSL_CTX_CACHE_SIZE      4   // credential sets (CA, certificate, key) kept per process
+#endif
+
+#ifndef SSL_SESSION_CACHE_SIZE
+#define SSL_SESSION_CACHE_SIZE  8   // host:port entries with a session to resume
+#endif
+
+#define SSL_SESSION_HOST_MAX    64
+
+typedef struct
+{
+    uint32_t handshakes;    // completed
+    uint32_t resumed;       // of them, abbreviated with a cached session
+    uint32_t failed;        // handshake or certificate verification
+    uint32_t full_ms;       // time spent in full handshakes
+    uint32_t resumed_ms;    // time spent in resumed handshakes
+    uint32_t ctx_hits;      // connects served by a cached SSL_CTX
+    uint32_t ctx_misses;
+} ssl_stats_t;
+
 typedef struct
 {
     SSL_CTX *ctx;
@@ -49,6 +70,9 @@ typedef struct
     const char *ciphers;
     const char *sni_host_name;
     int verify;
+
+    int ctx_shared; // ctx belongs to the process-wide cache
+    int resume;     // offer and keep TLS sessions
 } secure_contex;
 
 class ClientSecure : public Client
@@ -60,12 +84,12 @@ protected:
     int ssl_begin(const char *host, uint32_t port, int vrf);
     int ssl_try_load_files();
     int ssl_try_load_array();
+    static void ssl_setup(); // library init and thread locks, once per process
     void ssl_init()
     {
-        SSL_library_init();
-        SSL_load_error_strings();
-        OpenSSL_add_all_algorithms();
+        ssl_setup();
         memset(&client, 0, sizeof(client));
+        client.resume = 1;
     }
 
 public:
@@ -104,6 +128,11 @@ public:
     void setCiphers(const char *ciphers) { client.ciphers = ciphers; } // https://testssl.sh/openssl-iana.mapping.html
     void setSNI(const char *sni) { client.sni_host_name = sni; }
     void setVerify(int vrf) { client.verify = vrf; }
+    void setSessionResumption(bool on) { client.resume = on; }
+
+    static void getStats(ssl_stats_t *stats);
+    static void resetStats();
+    static void flushCache(); // after the credential files changed
 
     operator bool() { return connected(); }
 
@@ -158,6 +158,37 @@ int EthernetClient::read(uint8_t *buf, size_t size)
 	return -1;
 }
 
+size_t EthernetClient::readAvailable(char *buf, size_t size)
+{
+	if (_sock < 0 || NULL == buf || 0 == size)
+		return 0;
+	int rc = recv(_sock, buf, size, MSG_DONTWAIT);
+	return rc > 0 ? rc : 0;
+}
+
+// the socket queue is the buffer: peekSpan() copies a chunk with MSG_PEEK, consume() drops it
+size_t EthernetClient::peekSpan(const char **data)
+{
+	if (_sock < 0)
+		return 0;
+	int rc = recv(_sock, _peek, sizeof(_peek), MSG_PEEK | MSG_DONTWAIT);
+	if (rc <= 0)
+		return 0;
+	*data = _peek;
+	return rc;
+}
+
+void EthernetClient::consume(size_t length)
+{
+	while (length && _sock >= 0)
+	{
+		int rc = recv(_sock, _peek, length < sizeof(_peek) ? length : sizeof(_peek), MSG_DONTWAIT);
+		if (rc <= 0)
+			break;
+		length -= rc;
+	}
+}
+
 int EthernetClient::available()
 {
 	if (_sock < 0)
@@ -24,11 +24,16 @@
 #include "Client.h"
 #include "IPAddress.h"
 
+#ifndef ETHERNET_CLIENT_PEEK_SIZE
+#define ETHERNET_CLIENT_PEEK_SIZE 256
+#endif
+
 class EthernetClient : public Client
 {
 private:
 	int _sock;
 	bool connect_true;
+	char _peek[ETHERNET_CLIENT_PEEK_SIZE]; // MSG_PEEK copy behind peekSpan()
 
 public:
 	EthernetClient();
@@ -43,6 +48,9 @@ public:
 	int read();
 	int read(uint8_t *buf, size_t size);
 	int peek();
+	size_t readAvailable(char *buf, size_t size);
+	size_t peekSpan(const char **data);
+	void consume(size_t length);
 	void flush();
 	void stop();
 	uint8_t connected();
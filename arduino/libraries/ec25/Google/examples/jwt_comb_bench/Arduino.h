@@ -0,0 +1,47 @@
+/*
+    Host stand-in for the parts of Arduino.h the Google library uses,
+    for jwt_comb_bench.cpp only
+*/
+#ifndef ARDUINO_HOST_H_
+#define ARDUINO_HOST_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+static inline long random(long min, long max) { return min + rand() % (max - min); }
+
+class String
+{
+public:
+    String() {}
+    String(const char *s) : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.size(); }
+    char operator[](unsigned int i) const { return _s[i]; }
+    String &operator=(const char *s)
+    {
+        _s = s;
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        _s += c;
+        return *this;
+    }
+    String &operator+=(const String &s)
+    {
+        _s += s._s;
+        return *this;
+    }
+    friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+    friend String operator+(const String &a, const char *b) { return String(a._s + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b._s); }
+
+private:
+    std::string _s;
+};
+
+#endif
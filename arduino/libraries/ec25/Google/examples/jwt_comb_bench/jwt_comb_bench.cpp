@@ -0,0 +1,316 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   jwt_comb_bench.cpp
+ *
+ * Description:
+ * ------------
+ *   Checks the fixed-base comb of crypto/ecc against the sliding window it
+ *   replaced for JWT signing and measures signatures per second:
+ *
+ *   - k*G from ecc_comb_mul() equals ecc_win_mul_base() for edge scalars
+ *     and 2000 random ones
+ *   - with the same nonce ecdsa_sign_comb() gives the signature of
+ *     ecdsa_sign(), tokens from JwtSigner pass ecdsa_verify()
+ *   - JwtSigner::get returns the cached token for the same project id,
+ *     compared by content, and lifetime, and a new one JWT_RENEW_SECS
+ *     before exp, for another id or lifetime and after clear()
+ *   - signatures/sec of the old CreateJwt (ecc_init, public key and window
+ *     tables for every token), of CreateJwt now and of JwtSigner::sign
+ *
+ *   Build it once per comb width, Arduino.h in this folder is a host
+ *   stand-in:
+ *
+ *   S=../../src
+ *   for b in 2 4 6; do
+ *       g++ -O2 -DCONF_COMB_BITS=$b -I. -I$S jwt_comb_bench.cpp $S/jwt.cpp \
+ *           $S/crypto/ecc.cpp $S/crypto/ecdsa.cpp $S/crypto/nn.cpp \
+ *           $S/crypto/prng.cpp $S/crypto/secp256r1.cpp $S/crypto/sha256.cpp \
+ *           -o jwt_comb_bench_$b
+ *       ./jwt_comb_bench_$b [signatures]
+ *   done
+ ****************************************************************************/
+#include <stdio.h>
+#include <time.h>
+#include "jwt.h"
+#include "crypto/ecdsa.h"
+#include "crypto/sha256.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* a test key, big endian as in CloudIoTCoreDevice::fillPrivateKey */
+static const uint8_t key_bytes[32] = {
+    0x04, 0xdb, 0x32, 0x4f, 0x6b, 0x1f, 0x31, 0x53, 0xa4, 0xe5, 0x58, 0x8b, 0xd0, 0xa8, 0x0f, 0x85,
+    0x56, 0x23, 0xb4, 0xb1, 0xe6, 0x24, 0x75, 0x70, 0xca, 0xdb, 0xe8, 0xfc, 0xc2, 0x11, 0xe7, 0xe6};
+
+static NN_DIGIT key[NUMWORDS];
+static point_t comb[COMB_POINTS];
+
+/* the CreateJwt before the comb, base64 one String character at a time */
+static String old_base64(const unsigned char *in, unsigned int len)
+{
+    static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    String ret;
+    unsigned int i;
+    for (i = 0; i + 2 < len; i += 3)
+    {
+        ret += chars[in[i] >> 2];
+        ret += chars[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+        ret += chars[((in[i + 1] & 0x0f) << 2) | (in[i + 2] >> 6)];
+        ret += chars[in[i + 2] & 0x3f];
+    }
+    if (i < len)
+    {
+        ret += chars[in[i] >> 2];
+        ret += chars[((in[i] & 0x03) << 4) | (i + 1 < len ? in[i + 1] >> 4 : 0)];
+        ret += i + 1 < len ? chars[(in[i + 1] & 0x0f) << 2] : '=';
+        ret += '=';
+    }
+    return ret;
+}
+
+static String old_create_jwt(const char *project_id, long long int time, NN_DIGIT *priv_key, int exp_secs)
+{
+    char payload[160];
+    unsigned char sha256[SHA256_DIGEST_LENGTH], signature[64];
+    NN_DIGIT r[NUMWORDS], s[NUMWORDS];
+    point_t pub_key;
+    Sha256 sha;
+    const char *header = "{\"alg\":\"ES256\",\"typ\":\"JWT\"}";
+    ecc_init();
+    snprintf(payload, sizeof(payload), "{\"iat\":%d,\"exp\":%d,\"aud\":\"%s\"}", (int)time, (int)(time + exp_secs), project_id);
+    String hp = old_base64((const unsigned char *)header, strlen(header)) + "." + old_base64((const unsigned char *)payload, strlen(payload));
+    sha.update((const unsigned char *)hp.c_str(), hp.length());
+    sha.final(sha256); /* into bytes, the old String digest stopped at a zero byte */
+    ecc_gen_pub_key(priv_key, &pub_key);
+    ecdsa_init(&pub_key);
+    ecdsa_sign(sha256, r, s, priv_key);
+    NN_Encode(signature, 32, r, NUMWORDS - 1);
+    NN_Encode(signature + 32, 32, s, NUMWORDS - 1);
+    return hp + "." + old_base64(signature, 64);
+}
+
+static int random_scalar(NN_DIGIT *k)
+{
+    uint8_t b[32];
+    for (int i = 0; i < 32; i++)
+        b[i] = rand();
+    NN_AssignZero(k, NUMWORDS);
+    NN_Decode(k, NUMWORDS - 1, b, 32);
+    return 0;
+}
+
+static bool same_point(point_t *a, point_t *b)
+{
+    return 0 == NN_Cmp(a->x, b->x, NUMWORDS) && 0 == NN_Cmp(a->y, b->y, NUMWORDS);
+}
+
+static int check_comb(void)
+{
+    NN_DIGIT k[NUMWORDS], order[NUMWORDS];
+    point_t a, b;
+    int i, n = 0;
+    ecc_get_order(order);
+    for (i = -4; i < 2000; i++, n++)
+    {
+        if (i < 0)
+        {
+            /* 1, 2, order - 1 and the top bit of every comb column */
+            NN_AssignZero(k, NUMWORDS);
+            if (-4 == i)
+                k[0] = 1;
+            else if (-3 == i)
+                k[0] = 2;
+            else if (-2 == i)
+            {
+                NN_AssignDigit(k, 1, NUMWORDS);
+                NN_Sub(k, order, k, NUMWORDS);
+            }
+            else
+                for (int j = 0; j < COMB_BITS; j++)
+                {
+                    int bit = j * COMB_COLS + COMB_COLS - 1;
+                    if (bit < KEY_BIT_LEN)
+                        k[bit / NN_DIGIT_BITS] |= (NN_DIGIT)1 << (bit % NN_DIGIT_BITS);
+                }
+        }
+        else
+            random_scalar(k);
+        ecc_comb_mul(&a, k, comb);
+        ecc_win_mul_base(&b, k);
+        if (!same_point(&a, &b))
+        {
+            printf("COMB_BITS %d: k*G differs from the sliding window at scalar %d\n", COMB_BITS, i);
+            return -1;
+        }
+    }
+    printf("COMB_BITS %d: %d points in the table, k*G equal to the sliding window for %d scalars\n", COMB_BITS, COMB_POINTS, n);
+    return 0;
+}
+
+static int base64url_decode(uint8_t *out, const char *in)
+{
+    int n = 0, bits = 0;
+    uint32_t acc = 0;
+    for (; *in; in++)
+    {
+        const char *c = strchr("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_", *in);
+        if (NULL == c)
+            return -1;
+        acc = acc << 6 | (c - "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_");
+        if ((bits += 6) >= 8)
+            out[n++] = acc >> (bits -= 8);
+    }
+    return n;
+}
+
+static int check_signatures(void)
+{
+    NN_DIGIT r1[NUMWORDS], s1[NUMWORDS], r2[NUMWORDS], s2[NUMWORDS];
+    uint8_t hash[SHA256_DIGEST_LENGTH], sig[64];
+    point_t pub_key;
+    JwtSigner signer;
+    int i;
+
+    ecc_gen_pub_key(key, &pub_key);
+    ecdsa_init(&pub_key);
+    for (i = 0; i < 20; i++)
+    {
+        for (int j = 0; j < SHA256_DIGEST_LENGTH; j++)
+            hash[j] = rand();
+        srand(100 + i);
+        ecdsa_sign(hash, r1, s1, key);
+        srand(100 + i);
+        ecdsa_sign_comb(hash, r2, s2, key, comb);
+        if (NN_Cmp(r1, r2, NUMWORDS) || NN_Cmp(s1, s2, NUMWORDS))
+        {
+            printf("same nonce, different signature\n");
+            return -1;
+        }
+    }
+    signer.setPrivateKey(key);
+    for (i = 0; i < 50; i++)
+    {
+        const char *token = signer.sign(i & 1 ? "a-much-longer-project-name-0123456789" : "p", 1600000000LL + i * 7919, 60 + i);
+        const char *dot = strrchr(token, '.');
+        Sha256 sha;
+        sha.update((const unsigned char *)token, dot - token);
+        sha.final(hash);
+        NN_AssignZero(r1, NUMWORDS);
+        NN_AssignZero(s1, NUMWORDS);
+        if (64 != base64url_decode(sig, dot + 1))
+            return -1;
+        NN_Decode(r1, NUMWORDS - 1, sig, 32);
+        NN_Decode(s1, NUMWORDS - 1, sig + 32, 32);
+        if (1 != ecdsa_verify(hash, r1, s1, &pub_key))
+        {
+            printf("token %d does not verify: %s\n", i, token);
+            return -1;
+        }
+    }
+    printf("same nonce same signature, 50 JwtSigner tokens verify\n");
+    return 0;
+}
+
+/* iat and aud from the payload of a token */
+static bool claims(const char *token, long long *iat, char *aud, size_t size)
+{
+    char part[JWT_MAX_LENGTH], payload[JWT_MAX_LENGTH];
+    const char *p = strchr(token, '.') + 1, *q = strchr(p, '.');
+    memcpy(part, p, q - p);
+    part[q - p] = 0;
+    int n = base64url_decode((uint8_t *)payload, part);
+    if (n < 0)
+        return false;
+    payload[n] = 0;
+    const char *a = strstr(payload, "\"aud\":\"");
+    if (1 != sscanf(payload, "{\"iat\":%lld", iat) || NULL == a)
+        return false;
+    snprintf(aud, size, "%.*s", (int)(strchr(a + 7, '"') - a - 7), a + 7);
+    return true;
+}
+
+/* what a token from get() must be: renewed or the cached one, and its claims */
+static int expect_token(JwtSigner &signer, const char *project_id, long long time, int exp_secs,
+                        long long want_iat, const char *want_aud, const char *what)
+{
+    long long iat;
+    char aud[JWT_MAX_LENGTH];
+    const char *token = signer.get(project_id, time, exp_secs);
+    if (NULL == token || !claims(token, &iat, aud, sizeof(aud)) || iat != want_iat || strcmp(aud, want_aud))
+    {
+        printf("JwtSigner::get, %s: iat %lld aud %s\n", what, token ? iat : 0, token ? aud : "-");
+        return -1;
+    }
+    return 0;
+}
+
+static int check_cache(void)
+{
+    const long long t = 1600000000LL;
+    const int life = 3600;
+    char project[32];
+    JwtSigner signer;
+    int failed = 0;
+
+    signer.setPrivateKey(key);
+    strcpy(project, "first-project");
+    failed += expect_token(signer, project, t, life, t, "first-project", "first token");
+    failed += expect_token(signer, project, t + 100, life, t, "first-project", "cached");
+    failed += expect_token(signer, "first-project", t + 100, life, t, "first-project", "same id in another buffer");
+    failed += expect_token(signer, project, t + life - JWT_RENEW_SECS - 1, life, t, "first-project", "cached up to the renew margin");
+    failed += expect_token(signer, project, t + life - JWT_RENEW_SECS, life, t + life - JWT_RENEW_SECS, "first-project", "renewed at the margin");
+    const long long t2 = t + life - JWT_RENEW_SECS;
+    failed += expect_token(signer, project, t2 - 1, life, t2 - 1, "first-project", "renewed for a time before iat");
+    failed += expect_token(signer, project, t2, 600, t2, "first-project", "renewed for another lifetime");
+    /* the caller reuses its buffer for another project */
+    strcpy(project, "second-project");
+    failed += expect_token(signer, project, t2 + 1, 600, t2 + 1, "second-project", "renewed for another id in the same buffer");
+    failed += expect_token(signer, project, t2 + 2, 600, t2 + 1, "second-project", "cached for the new id");
+    signer.clear();
+    failed += expect_token(signer, project, t2 + 3, 600, t2 + 3, "second-project", "renewed after clear");
+    if (0 == failed)
+        printf("JwtSigner::get caches per project id and lifetime, renews %d s before exp\n", JWT_RENEW_SECS);
+    return failed;
+}
+
+static void bench(int n)
+{
+    JwtSigner signer;
+    double t;
+    int i;
+
+    t = now();
+    for (i = 0; i < n; i++)
+        old_create_jwt("my-project", 1600000000 + i, key, 3600);
+    printf("old CreateJwt     %7.1f signatures/s\n", n / (now() - t));
+    t = now();
+    for (i = 0; i < n; i++)
+        CreateJwt("my-project", 1600000000 + i, key);
+    printf("CreateJwt         %7.1f signatures/s\n", n / (now() - t));
+    signer.setPrivateKey(key);
+    t = now();
+    for (i = 0; i < n; i++)
+        signer.sign("my-project", 1600000000 + i, 3600);
+    printf("JwtSigner::sign   %7.1f signatures/s\n", n / (now() - t));
+}
+
+int main(int argc, char **argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 500;
+    NN_AssignZero(key, NUMWORDS);
+    NN_Decode(key, NUMWORDS - 1, (unsigned char *)key_bytes, 32);
+    srand(1);
+    ecc_init();
+    ecc_comb_precompute(ecc_get_base_p(), comb);
+    if (check_comb() || check_signatures() || check_cache())
+        return 1;
+    bench(n);
+    return 0;
+}
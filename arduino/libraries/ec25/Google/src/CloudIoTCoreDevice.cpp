@@ -44,13 +44,14 @@ CloudIoTCoreDevice::CloudIoTCoreDevice(const char *project_id,
 
 String CloudIoTCoreDevice::createJWT(long long int current_time)
 {
-  jwt = CreateJwt(project_id, current_time, priv_key, this->jwt_exp_secs);
-  return jwt;
+  return createJWT(current_time, this->jwt_exp_secs);
 }
 
+// The signed token is reused until JWT_RENEW_SECS before it expires
 String CloudIoTCoreDevice::createJWT(long long int current_time, int exp_in_secs)
 {
-  jwt = CreateJwt(project_id, current_time, priv_key, exp_in_secs);
+  const char *token = signer.get(project_id, current_time, exp_in_secs);
+  jwt = token ? token : "";
   return jwt;
 }
 
@@ -169,5 +170,6 @@ CloudIoTCoreDevice &CloudIoTCoreDevice::setPrivateKey(const char *private_key)
     //Serial.println("Warning: expected private key to be 95, was: " + String(strlen(private_key)));
   }
   fillPrivateKey();
+  signer.setPrivateKey(priv_key);
   return *this;
 }
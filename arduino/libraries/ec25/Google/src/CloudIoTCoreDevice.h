@@ -29,6 +29,7 @@ private:
   const char *private_key;
 
   NN_DIGIT priv_key[9];
+  JwtSigner signer;
   String jwt;
   unsigned long iss = 0;
   int jwt_exp_secs = 3600;
@@ -659,6 +659,83 @@ ecc_win_mul_base(point_t * P0, NN_DIGIT * n)
   ecc_win_mul(P0, n, pBaseArray);
 }
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief             Convert (P0,Z0) back to affine coordinate
+ */
+static void
+p_affine(point_t * P0, NN_DIGIT * Z0)
+{
+  NN_DIGIT Z1[NUMWORDS];
+
+  if(!Z_is_one(Z0)) {
+    NN_ModInv(Z1, Z0, param.p, NUMWORDS);
+    NN_ModMultOpt(Z0, Z1, Z1, param.p, param.omega, NUMWORDS);
+    NN_ModMultOpt(P0->x, P0->x, Z0, param.p, param.omega, NUMWORDS);
+    NN_ModMultOpt(Z0, Z0, Z1, param.p, param.omega, NUMWORDS);
+    NN_ModMultOpt(P0->y, P0->y, Z0, param.p, param.omega, NUMWORDS);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+ecc_comb_precompute(point_t * baseP, point_t * comb)
+{
+  uint16_t i, j;
+  NN_DIGIT Z0[NUMWORDS];
+
+  /* comb[2^i - 1] = 2^(i*COMB_COLS) * baseP */
+  p_copy(&(comb[0]), baseP);
+  for(i = 1; i < COMB_BITS; i++) {
+    p_copy(&(comb[(1 << i) - 1]), &(comb[(1 << (i-1)) - 1]));
+    NN_AssignDigit(Z0, 1, NUMWORDS);
+    for(j = 0; j < COMB_COLS; j++) {
+      ecc_dbl_proj(&(comb[(1 << i) - 1]), Z0, &(comb[(1 << i) - 1]), Z0);
+    }
+    p_affine(&(comb[(1 << i) - 1]), Z0);
+  }
+
+  /* comb[j-1] = comb[(j without its top bit)-1] + comb[(top bit)-1] */
+  for(i = 1; i < COMB_BITS; i++) {
+    for(j = (1 << i) + 1; j < (1 << (i+1)); j++) {
+      ecc_add(&(comb[j-1]), &(comb[j - (1 << i) - 1]), &(comb[(1 << i) - 1]));
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * scalar point multiplication with the fixed-base comb:
+ * COMB_COLS doublings and at most COMB_COLS mixed additions,
+ * against KEY_BIT_LEN doublings for the sliding window method
+ */
+void
+ecc_comb_mul(point_t * P0, NN_DIGIT * n, point_t * comb)
+{
+  int16_t i;
+  uint16_t j, bit;
+  NN_DIGIT windex;
+  NN_DIGIT Z0[NUMWORDS];
+
+  p_clear(P0);
+  NN_AssignZero(Z0, NUMWORDS);
+
+  for(i = COMB_COLS - 1; i >= 0; i--) {
+    ecc_dbl_proj(P0, Z0, P0, Z0);
+
+    windex = 0;
+    for(j = 0; j < COMB_BITS; j++) {
+      bit = j * COMB_COLS + i;
+      if(bit < KEY_BIT_LEN && b_testbit(n, bit)) {
+        windex |= (NN_DIGIT)1 << j;
+      }
+    }
+
+    if(windex) {
+      c_add_mix(P0, Z0, P0, Z0, &(comb[windex-1]));
+    }
+  }
+
+  p_affine(P0, Z0);
+}
+/*---------------------------------------------------------------------------*/
 point_t *
 ecc_get_base_p()
 {
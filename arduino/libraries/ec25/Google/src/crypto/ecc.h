@@ -49,6 +49,26 @@
  */
 #define NUM_POINTS ((1 << W_BITS) - 1)
 
+/**
+ * Number of teeth of the fixed-base comb, the comb table holds
+ * 2^COMB_BITS - 1 points (change this to trade memory for speed)
+ */
+#ifdef CONF_COMB_BITS
+#define COMB_BITS CONF_COMB_BITS
+#else
+#define COMB_BITS 4
+#endif
+
+/**
+ * Number of points in the comb table, COMB_POINTS = 2^COMB_BITS - 1
+ */
+#define COMB_POINTS ((1 << COMB_BITS) - 1)
+
+/**
+ * Number of comb columns (doublings per multiplication)
+ */
+#define COMB_COLS ((KEY_BIT_LEN + COMB_BITS - 1) / COMB_BITS)
+
 /**
  * The data structure define the elliptic curve.
  */
@@ -160,6 +180,20 @@ void ecc_m_dbl_projective(point_t * P0, NN_DIGIT *Z0, uint8_t m);
  */
 void ecc_win_mul_base(point_t * P0, NN_DIGIT * n);
 
+/**
+ * \brief             Precompute the fixed-base comb table of baseP,
+ *                    comb[j-1] = sum of 2^(i*COMB_COLS)*baseP for each bit i of j.
+ *                    Done once per base point, ecc_init() must be called first.
+ */
+void ecc_comb_precompute(point_t * baseP, point_t * comb);
+
+/**
+ * \brief             Scalar point multiplication using the fixed-base comb,
+ *                    P0 = n * baseP, n < 2^KEY_BIT_LEN.
+ *                    comb is constructed by ecc_comb_precompute(baseP, comb)
+ */
+void ecc_comb_mul(point_t * P0, NN_DIGIT * n, point_t * comb);
+
 /**
  * \brief             Get base point
  */
@@ -196,8 +196,12 @@ ecdsa_init(point_t * pb_key)
 }
 
 /*---------------------------------------------------------------------------*/
-void
-ecdsa_sign(uint8_t sha256sum[SHA256_DIGEST_LENGTH], NN_DIGIT *r, NN_DIGIT *s, NN_DIGIT *d)
+/**
+ * \brief             Sign with k*G from the sliding window (comb == NULL)
+ *                    or from the fixed-base comb table.
+ */
+static void
+sign(uint8_t sha256sum[SHA256_DIGEST_LENGTH], NN_DIGIT *r, NN_DIGIT *s, NN_DIGIT *d, point_t *comb)
 {
 
   char done = FALSE;
@@ -217,7 +221,11 @@ ecdsa_sign(uint8_t sha256sum[SHA256_DIGEST_LENGTH], NN_DIGIT *r, NN_DIGIT *s, NN
       continue;
     }
 
-    ecc_win_mul_base(&P, k);
+    if(comb) {
+      ecc_comb_mul(&P, k, comb);
+    } else {
+      ecc_win_mul_base(&P, k);
+    }
 
     NN_Mod(r, P.x, NUMWORDS, order, NUMWORDS);
 
@@ -253,6 +261,20 @@ ecdsa_sign(uint8_t sha256sum[SHA256_DIGEST_LENGTH], NN_DIGIT *r, NN_DIGIT *s, NN
 
 }
 /*---------------------------------------------------------------------------*/
+void
+ecdsa_sign(uint8_t sha256sum[SHA256_DIGEST_LENGTH], NN_DIGIT *r, NN_DIGIT *s, NN_DIGIT *d)
+{
+  sign(sha256sum, r, s, d, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+ecdsa_sign_comb(uint8_t sha256sum[SHA256_DIGEST_LENGTH], NN_DIGIT *r, NN_DIGIT *s, NN_DIGIT *d, point_t *comb)
+{
+  /* no ecdsa_init() here, the public key table is for verification only */
+  ecc_get_order(order);
+  sign(sha256sum, r, s, d, comb);
+}
+/*---------------------------------------------------------------------------*/
 uint8_t
 ecdsa_verify(uint8_t sha256sum[SHA256_DIGEST_LENGTH], NN_DIGIT *r, NN_DIGIT *s, point_t *Q)
 {
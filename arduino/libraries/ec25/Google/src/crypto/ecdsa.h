@@ -40,6 +40,16 @@ void ecdsa_init(point_t * pb_key);
  */
 void ecdsa_sign(uint8_t sha256sum[SHA256_DIGEST_LENGTH], NN_DIGIT *r, NN_DIGIT *s, NN_DIGIT * pr_key);
 
+/**
+ * \brief             Sign a message using the private key, k*G is taken
+ *                    from the fixed-base comb table of the base point.
+ *                    ecdsa_init() is not needed.
+ *
+ * \param comb        Built once by ecc_comb_precompute(ecc_get_base_p(), comb).
+ * \sa  ecdsa_sign
+ */
+void ecdsa_sign_comb(uint8_t sha256sum[SHA256_DIGEST_LENGTH], NN_DIGIT *r, NN_DIGIT *s, NN_DIGIT * pr_key, point_t * comb);
+
 /**
  * \brief             Verify a message using public key.
  * \param sha256sum   Hash of the message to sign.
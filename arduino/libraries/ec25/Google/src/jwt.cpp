@@ -20,134 +20,119 @@
 #include "crypto/sha256.h"
 #include "jwt.h"
 
-// base64_encode copied from https://github.com/ReneNyffenegger/cpp-base64
-static const String base64_chars =
+// {"alg":"ES256","typ":"JWT"}
+static const char jwt_header[] = "eyJhbGciOiJFUzI1NiIsInR5cCI6IkpXVCJ9";
+
+static const char base64url_chars[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz"
-    "0123456789+/";
+    "0123456789-_";
 
-String base64_encode(const unsigned char *bytes_to_encode,
-                     unsigned int in_len)
+// base64url without padding (RFC 7515), returns the encoded length
+static size_t base64url_encode(char *out, const unsigned char *in, size_t in_len)
 {
-  String ret;
-  int i = 0;
-  int j = 0;
-  unsigned char char_array_3[3];
-  unsigned char char_array_4[4];
-
-  while (in_len--)
+  char *p = out;
+  for (; in_len >= 3; in += 3, in_len -= 3)
   {
-    char_array_3[i++] = *(bytes_to_encode++);
-    if (i == 3)
-    {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] =
-          ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] =
-          ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
-
-      for (i = 0; (i < 4); i++)
-      {
-        ret += base64_chars[char_array_4[i]];
-      }
-      i = 0;
-    }
+    *p++ = base64url_chars[in[0] >> 2];
+    *p++ = base64url_chars[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+    *p++ = base64url_chars[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+    *p++ = base64url_chars[in[2] & 0x3f];
   }
-
-  if (i)
+  if (in_len)
   {
-    for (j = i; j < 3; j++)
-    {
-      char_array_3[j] = '\0';
-    }
-
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] =
-        ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] =
-        ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-    char_array_4[3] = char_array_3[2] & 0x3f;
-
-    for (j = 0; (j < i + 1); j++)
-    {
-      ret += base64_chars[char_array_4[j]];
-    }
-
-    while ((i++ < 3))
+    *p++ = base64url_chars[in[0] >> 2];
+    if (1 == in_len)
+      *p++ = base64url_chars[(in[0] & 0x03) << 4];
+    else
     {
-      ret += '=';
+      *p++ = base64url_chars[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+      *p++ = base64url_chars[(in[1] & 0x0f) << 2];
     }
   }
-
-  return ret;
+  return p - out;
 }
 
-String base64_encode(String str)
+#define BASE64URL_LENGTH(n) (((n) * 4 + 2) / 3)
+
+JwtSigner::JwtSigner()
 {
-  return base64_encode((const unsigned char *)str.c_str(), str.length());
+  memset(key, 0, sizeof(key));
+  comb_ready = false;
+  project[0] = 0;
+  lifetime = 0;
+  clear();
 }
 
-// Get's sha256 of str.
-String get_sha(const String &str)
+void JwtSigner::setPrivateKey(NN_DIGIT *priv_key)
 {
-  Sha256 sha256Instance;
-
-  sha256Instance.update((const unsigned char *)str.c_str(), str.length());
+  NN_Assign(key, priv_key, NUMWORDS);
+  clear();
+}
 
-  unsigned char sha256[SHA256_DIGEST_LENGTH];
+const char *JwtSigner::sign(const char *project_id, long long int time, int exp_secs)
+{
+  char payload[JWT_MAX_LENGTH / 2];
+  unsigned char signature[64], sha256[SHA256_DIGEST_LENGTH];
+  NN_DIGIT signature_r[NUMWORDS], signature_s[NUMWORDS];
+  size_t len;
+  int n;
+
+  clear();
+  n = snprintf(payload, sizeof(payload), "{\"iat\":%lld,\"exp\":%lld,\"aud\":\"%s\"}",
+               time, time + exp_secs, project_id);
+  if (n < 0 || n >= (int)sizeof(payload) ||
+      sizeof(jwt_header) + BASE64URL_LENGTH(n) + 1 + BASE64URL_LENGTH(64) + 1 > sizeof(token))
+    return NULL;
+
+  // header.payload straight into the token
+  len = sizeof(jwt_header) - 1;
+  memcpy(token, jwt_header, len);
+  token[len++] = '.';
+  len += base64url_encode(token + len, (const unsigned char *)payload, n);
 
+  Sha256 sha256Instance;
+  sha256Instance.update((const unsigned char *)token, len);
   sha256Instance.final(sha256);
 
-  return String((const char *)sha256);
-}
+  if (!comb_ready)
+  {
+    ecc_init();
+    ecc_comb_precompute(ecc_get_base_p(), comb);
+    comb_ready = true;
+  }
+  ecdsa_sign_comb(sha256, signature_r, signature_s, key, comb);
 
-// Get base64 signature string from the signature_r and signature_s ecdsa
-// signature.
-String MakeBase64Signature(NN_DIGIT *signature_r, NN_DIGIT *signature_s)
-{
-  unsigned char signature[64];
   NN_Encode(signature, (NUMWORDS - 1) * NN_DIGIT_LEN, signature_r,
             (NN_UINT)(NUMWORDS - 1));
   NN_Encode(signature + (NUMWORDS - 1) * NN_DIGIT_LEN,
             (NUMWORDS - 1) * NN_DIGIT_LEN, signature_s,
             (NN_UINT)(NUMWORDS - 1));
-
-  return base64_encode(signature, 64);
+  token[len++] = '.';
+  len += base64url_encode(token + len, signature, 64);
+  token[len] = 0;
+
+  strcpy(project, project_id); // shorter than the payload it went into
+  lifetime = exp_secs;
+  iat = time;
+  exp = time + exp_secs;
+  return token;
 }
 
-// Convert an integer to a string.
-String int_to_string(long long int x)
+const char *JwtSigner::get(const char *project_id, long long int time, int exp_secs)
 {
-  char buf[20];
-  snprintf(buf, 20, "%d", (int)x);
-  return String(buf);
+  if (exp && 0 == strcmp(project, project_id) && lifetime == exp_secs &&
+      time >= iat && time + JWT_RENEW_SECS < exp)
+    return token;
+  return sign(project_id, time, exp_secs);
 }
 
 String CreateJwt(String project_id, long long int time, NN_DIGIT *priv_key, int lib_jwt_exp_secs)
 {
-  ecc_init();
-  // Making jwt token json
-  String header = "{\"alg\":\"ES256\",\"typ\":\"JWT\"}";
-  String payload = "{\"iat\":" + int_to_string(time) +
-                   ",\"exp\":" + int_to_string(time + lib_jwt_exp_secs) + ",\"aud\":\"" +
-                   project_id + "\"}";
-  String header_payload_base64 =
-      base64_encode(header) + "." + base64_encode(payload);
-
-  String sha256 = get_sha(header_payload_base64);
-
-  // Signing sha with ec key. Bellow is the ec private key.
-  point_t pub_key;
-  ecc_gen_pub_key(priv_key, &pub_key);
-
-  ecdsa_init(&pub_key);
-
-  NN_DIGIT signature_r[NUMWORDS], signature_s[NUMWORDS];
-  ecdsa_sign((uint8_t *)sha256.c_str(), signature_r, signature_s, priv_key);
-
-  return header_payload_base64 + "." +
-         MakeBase64Signature(signature_r, signature_s);
+  JwtSigner signer;
+  signer.setPrivateKey(priv_key);
+  const char *jwt = signer.sign(project_id.c_str(), time, lib_jwt_exp_secs);
+  return jwt ? String(jwt) : String();
 }
 
 String CreateJwt(String project_id, long long int time, NN_DIGIT *priv_key)
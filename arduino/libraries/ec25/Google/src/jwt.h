@@ -18,6 +18,40 @@
 
 #include <Arduino.h>
 #include "crypto/nn.h"
+#include "crypto/ecc.h"
+
+#ifndef JWT_MAX_LENGTH
+#define JWT_MAX_LENGTH 320 // fits a project id of up to 64 chars
+#endif
+
+#ifndef JWT_RENEW_SECS
+#define JWT_RENEW_SECS 60 // a cached token is renewed this long before exp
+#endif
+
+// ES256 signer bound to one private key. The comb table of the base point
+// is built on the first signature and reused, the token is kept until
+// JWT_RENEW_SECS before it expires.
+class JwtSigner
+{
+public:
+  JwtSigner();
+  void setPrivateKey(NN_DIGIT *priv_key);
+
+  // New token with iat = time, NULL if it does not fit JWT_MAX_LENGTH
+  const char *sign(const char *project_id, long long int time, int exp_secs);
+  // The cached token if it is still good at time, else a new one
+  const char *get(const char *project_id, long long int time, int exp_secs);
+  void clear() { iat = exp = 0; }
+
+private:
+  NN_DIGIT key[NUMWORDS];
+  point_t comb[COMB_POINTS];
+  bool comb_ready;
+  char token[JWT_MAX_LENGTH];
+  char project[JWT_MAX_LENGTH / 2]; // aud of the cached token, compared by content
+  int lifetime;
+  long long int iat, exp;
+};
 
 String CreateJwt(String project_id, long long int time, NN_DIGIT* priv_key);
 String CreateJwt(String project_id, long long int time, NN_DIGIT* priv_key, int JWT_EXP_SECS);
@@ -9,75 +9,193 @@
 
 EEPROMClass EEPROM;
 
+// RAM copy of the secure data cells, the address is the shadow index
+static struct
+{
+    uint16_t loaded; // bit (cell - 1)
+    uint16_t dirty;  // bit (cell - 1)
+    uint32_t idle_ms;
+    bool timer;      // idle timer registered
+    uint8_t batch;   // put() nesting, the timer restart is deferred to its end
+    bool touched;    // a byte changed during the batch
+    int error;       // last failed Ql_SecureData_Read / Store, QL_RET_OK if none
+    EEPROMCellStats stats[_EEPROM_CELLS];
+    uint8_t data[_EEPROM_SHADOW_SIZE];
+} eep = {0, 0, EEPROM_AUTOCOMMIT_MS, false, 0, false, QL_RET_OK};
+
+static void ql_eeprom_get_cell(u8 cell, u32 *size, u32 *offset)
+{
+    if (cell < 9)
+    {
+        *size = 50;
+        *offset = (cell - 1) * 50;
+    }
+    else if (cell < 13)
+    {
+        *size = 100;
+        *offset = 400 + (cell - 9) * 100;
+    }
+    else
+    {
+        *size = 500;
+        *offset = 800;
+    }
+}
+
 // cell from 1 to 13
 static void ql_eeprom_get_index(u32 address, u8 *cell, u32 *size, u32 *offset)
 {
     if (address < 400)
     {
         *cell = 1 + (address / 50);
-        *size = 50;
-        *offset = 0;
-        return;
     }
     else if (address < 800)
     {
-        address -= 400;
-        *cell = 9 + (address / 100);
-        *size = 100;
-        *offset = 400;
-        return;
+        *cell = 9 + ((address - 400) / 100);
     }
     else
     {
         *cell = 13;
-        *size = 500;
-        *offset = 800;
     }
+    ql_eeprom_get_cell(*cell, size, offset);
 }
 
-uint8_t EERef::operator*() const
+// NULL if the cell can not be read, it stays unloaded and is tried again on the next access
+static uint8_t *ql_eeprom_cell(int index)
 {
-    if (index < _EEPROM_SIZE)
+    u8 cell;
+    u32 size, offset;
+    ql_eeprom_get_index(index, &cell, &size, &offset);
+    if (0 == (eep.loaded & (1 << (cell - 1))))
     {
-        u8 cell;
-        u32 size, offset;
-        ql_eeprom_get_index(index, &cell, &size, &offset);
-        uint8_t data[size];
-        int res = Ql_SecureData_Read(cell, (u8 *)data, size); // RIL
-        DEBUG_EEP("Read cell = %d, size = %d, res = %d", cell, size, res);
-        if (size == res)
+        int res = Ql_SecureData_Read(cell, eep.data + offset, size); // RIL
+        DEBUG_EEP("Load cell = %d, size = %d, res = %d", cell, size, res);
+        if (size != res)
         {
-            return data[index - offset];
-        }
-        else
-        {
-            DEBUG_EEP("Read failed. Return 0 as value");
+            DEBUG_EEP("Load failed ( %d )", res);
+            eep.stats[cell - 1].load_errors++;
+            eep.error = res < 0 ? res : Ql_RET_ERR_UNKOWN; // short read
+            return NULL;
         }
+        eep.stats[cell - 1].loads++;
+        eep.loaded |= 1 << (cell - 1);
     }
-    return 0;
+    return eep.data + index;
+}
+
+static void ql_eeprom_idle(u32 timerId, void *param)
+{
+    EEPROM.commit();
+}
+
+static void ql_eeprom_touch(void)
+{
+    if (0 == eep.idle_ms)
+        return;
+    if (eep.batch)
+    {
+        eep.touched = true;
+        return;
+    }
+    if (false == eep.timer)
+        eep.timer = QL_RET_OK == Ql_Timer_Register(EEPROM_TIMER_ID, ql_eeprom_idle, NULL);
+    if (eep.timer)
+    {
+        Ql_Timer_Stop(EEPROM_TIMER_ID); // restart, the cells go out once the writes are over
+        Ql_Timer_Start(EEPROM_TIMER_ID, eep.idle_ms, false);
+    }
+}
+
+uint8_t EERef::operator*() const
+{
+    uint8_t *p = index < _EEPROM_SIZE ? ql_eeprom_cell(index) : NULL;
+    return p ? *p : 0; // 0 as value when the cell can not be read
 }
 
 EERef &EERef::operator=(uint8_t in)
 {
     if (index < _EEPROM_SIZE)
     {
-        u8 cell;
+        uint8_t *p = ql_eeprom_cell(index);
+        if (p && *p != in) // not read, not written: a commit would store a guess over the cell
+        {
+            u8 cell;
+            u32 size, offset;
+            ql_eeprom_get_index(index, &cell, &size, &offset);
+            *p = in;
+            eep.dirty |= 1 << (cell - 1);
+            ql_eeprom_touch();
+        }
+    }
+    return *this;
+}
+
+bool EEPROMClass::commit()
+{
+    bool ok = true;
+    for (u8 cell = 1; eep.dirty && cell <= _EEPROM_CELLS; cell++)
+    {
+        if (0 == (eep.dirty & (1 << (cell - 1))))
+            continue;
         u32 size, offset;
-        ql_eeprom_get_index(index, &cell, &size, &offset);
-        uint8_t data[size];
-        int res = Ql_SecureData_Read(cell, (u8 *)data, size); // RIL
-        DEBUG_EEP("Write cell = %d, size = %d, res = %d", cell, size, res);
-        if (size == res)
+        ql_eeprom_get_cell(cell, &size, &offset);
+        EEPROMCellStats *st = &eep.stats[cell - 1];
+        uint32_t start = millis();
+        int res = Ql_SecureData_Store(cell, eep.data + offset, size); // RIL
+        st->last_ms = millis() - start;
+        if (st->last_ms > st->max_ms)
+            st->max_ms = st->last_ms;
+        DEBUG_EEP("Store cell = %d, size = %d, res = %d, %d ms", cell, size, res, st->last_ms);
+        if (QL_RET_OK == res)
         {
-            data[index - offset] = in;
-            Ql_SecureData_Store(cell, (u8 *)data, size); // RIL
+            st->stores++;
+            eep.dirty &= ~(1 << (cell - 1));
         }
         else
         {
-            DEBUG_EEP("Write failed ( %d )", res);
+            st->errors++;
+            eep.error = res;
+            ok = false; // stays dirty for the next commit
         }
     }
-    return *this;
+    return ok;
+}
+
+void EEPROMClass::batchBegin()
+{
+    eep.batch++;
+}
+
+void EEPROMClass::batchEnd()
+{
+    if (--eep.batch || false == eep.touched)
+        return;
+    eep.touched = false;
+    ql_eeprom_touch();
+}
+
+void EEPROMClass::setAutoCommit(uint32_t idle_ms)
+{
+    eep.idle_ms = idle_ms;
+    if (0 == idle_ms && eep.timer)
+        Ql_Timer_Stop(EEPROM_TIMER_ID);
+    else if (eep.dirty)
+        ql_eeprom_touch();
+}
+
+int EEPROMClass::lastError()
+{
+    int error = eep.error;
+    eep.error = QL_RET_OK;
+    return error;
+}
+
+bool EEPROMClass::getCellStats(int cell, EEPROMCellStats &stats)
+{
+    if (cell < 1 || cell > _EEPROM_CELLS)
+        return false;
+    stats = eep.stats[cell - 1];
+    return true;
 }
 
 #endif
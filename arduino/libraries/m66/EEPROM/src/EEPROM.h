@@ -30,6 +30,27 @@
 //DBG("[EEP] " F "\n", ##__VA_ARGS__)
 
 #define _EEPROM_SIZE (900)
+#define _EEPROM_CELLS (13)
+#define _EEPROM_SHADOW_SIZE (8 * 50 + 4 * 100 + 500) // whole cells, the last one is only partly exposed
+
+#ifndef EEPROM_AUTOCOMMIT_MS
+#define EEPROM_AUTOCOMMIT_MS (500) // store dirty cells after this idle time, 0 = only by commit()
+#endif
+// Reserved for the idle commit, do not register an application timer with this id.
+// Define another id (build flag) when it clashes; GPTimer uses TIMER_ID_USER_START + 1..10
+#ifndef EEPROM_TIMER_ID
+#define EEPROM_TIMER_ID (TIMER_ID_USER_START + 0xEE)
+#endif
+
+typedef struct
+{
+    uint32_t loads;       // Ql_SecureData_Read of the whole cell
+    uint32_t stores;      // Ql_SecureData_Store of the whole cell, flash wear since boot
+    uint32_t errors;      // failed stores
+    uint32_t load_errors; // failed reads, the access was refused
+    uint32_t last_ms;     // duration of the last store
+    uint32_t max_ms;      // longest store
+} EEPROMCellStats;
 
 /***
     EERef class.
@@ -131,6 +152,14 @@ class EEPROMClass
 {
   public:
     EEPROMClass(){}
+
+    //Writes only change the RAM shadow; dirty cells go to flash on commit() or after the idle time
+    bool commit();
+    void setAutoCommit(uint32_t idle_ms);
+    bool getCellStats(int cell, EEPROMCellStats &stats); // cell from 1 to 13
+    //QL_RET_OK, else the last failed load or store since the previous call. A failed load reads 0 and drops the write
+    int lastError();
+
     //Basic user access methods.
     EERef operator[](const int idx) { return idx; }
     uint8_t read(int idx) { return EERef(idx); }
@@ -158,12 +187,17 @@ class EEPROMClass
     {
         EEPtr e = idx;
         const uint8_t *ptr = (const uint8_t *)&t;
+        batchBegin();
         for (int count = sizeof(T); count; --count, ++e)
             (*e).update(*ptr++);
+        batchEnd();
         return t;
     }
 
   private:
+    //The idle timer is restarted once per batch instead of for every changed byte
+    void batchBegin();
+    void batchEnd();
     const uint16_t _length = _EEPROM_SIZE;
 };
 
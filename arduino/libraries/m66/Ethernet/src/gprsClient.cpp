@@ -7,11 +7,20 @@
 
 #include "gprsClient.h"
 
+void gprsClient::init()
+{
+    rx_buffer = NULL;
+    rx_size = GPRS_CLIENT_RX_BUFFER_SIZE;
+    rx_pos = 0;
+    rx_len = 0;
+    rx_error = 0;
+    resetStats();
+}
+
 gprsClient::gprsClient()
 {
     id = 0;
-    peeked = 0;
-    Peek = 0;
+    init();
     m_externalSocket = true;
     m_socket = -1;
 }
@@ -20,8 +29,7 @@ gprsClient::gprsClient(int contextID)
 
 {
     id = contextID;
-    peeked = 0;
-    Peek = 0;
+    init();
     m_externalSocket = 0;
     m_socket = -1;
 }
@@ -29,8 +37,7 @@ gprsClient::gprsClient(int contextID)
 gprsClient::gprsClient(int socket, int contextID)
 {
     id = contextID;
-    peeked = 0;
-    Peek = 0;
+    init();
     m_externalSocket = 1;
     m_socket = socket;
 }
@@ -39,6 +46,48 @@ gprsClient::~gprsClient()
 {
     if (!m_externalSocket)
         stop();
+    delete[] rx_buffer;
+}
+
+void gprsClient::setRxBufferSize(size_t size)
+{
+    if (rx_buffer && rx_len == rx_pos)
+    {
+        delete[] rx_buffer;
+        rx_buffer = NULL;
+    }
+    if (NULL == rx_buffer)
+        rx_size = size ? size : 1;
+}
+
+int gprsClient::recv(unsigned char *buf, size_t size)
+{
+    int r = Ql_SOC_Recv(m_socket, buf, size); // no wait
+    stats.recv_calls++;
+    if (r > 0)
+        stats.recv_bytes += r;
+    else if (r < 0 && r != SOC_WOULDBLOCK)
+        rx_error = r;
+    DEBUG_TCP("Ql_SOC_Recv( %d ) r = %d", size, r);
+    return r;
+}
+
+/* refill the empty rx buffer with one bulk receive, returns buffered bytes or Ql_SOC_Recv() result */
+int gprsClient::fill()
+{
+    if (rx_pos < rx_len)
+        return rx_len - rx_pos;
+    rx_pos = rx_len = 0;
+    if (NULL == rx_buffer)
+    {
+        rx_buffer = new unsigned char[rx_size];
+        if (NULL == rx_buffer)
+            return 0;
+    }
+    int r = recv(rx_buffer, rx_size);
+    if (r > 0)
+        rx_len = r;
+    return r;
 }
 
 int gprsClient::connect(unsigned int ip, unsigned short port)
@@ -95,59 +144,85 @@ int gprsClient::read()
 {
     if (m_socket == -1)
         return -1;
-    if (peeked)
-    {
-        peeked = false;
-        return Peek;
-    }
-    unsigned char b;
-    return (1 == Ql_SOC_Recv(m_socket, &b, 1)) ? b : -1; // no wait
+    stats.user_reads++;
+    if (fill() > 0)
+        return rx_buffer[rx_pos++];
+    return -1;
 }
 
 int gprsClient::read(unsigned char *buffer, size_t size)
 {
     if (m_socket == -1 || NULL == buffer || size == 0)
         return 0;
-    unsigned char *p = buffer;
-    if (peeked)
+    stats.user_reads++;
+    size_t n = rx_len - rx_pos;
+    if (n)
     {
-        peeked = false;
-        *p++ = Peek;
-        size -= 1;
-        if (0 == size)
-            return 1;
+        if (n > size)
+            n = size;
+        memcpy(buffer, rx_buffer + rx_pos, n);
+        rx_pos += n;
+        if (n == size)
+            return n;
     }
-    int r = Ql_SOC_Recv(m_socket, p, size); // no wait
-    DEBUG_TCP("Ql_SOC_Recv( %d ) r = %d", size, r);
-    return r > -1 ? r : -1;
+    // rx buffer is empty now
+    if (size - n >= rx_size)
+    {
+        int r = recv(buffer + n, size - n); // large reads go straight to the caller
+        if (r < 0)
+            return n ? (int)n : -1;
+        return n + r;
+    }
+    int r = fill();
+    if (r <= 0)
+        return n ? (int)n : (r < 0 ? -1 : 0);
+    size_t m = (size_t)r < size - n ? (size_t)r : size - n;
+    memcpy(buffer + n, rx_buffer + rx_pos, m);
+    rx_pos += m;
+    return n + m;
 }
 
 int gprsClient::available()
 {
-    //return m_socket > -1 && peek() > -1;// without soc_getsockopt
-    short val;
-    return (0 == api_soc_getsockopt(m_socket, SOC_NREAD, &val, 2)) ? val : -1;
+    if (m_socket == -1)
+        return 0;
+    int r = fill(); // buffered bytes, refilled in bulk when empty
+    return r > 0 ? r : 0; // a socket error shows in connected()
 }
 
 int gprsClient::peek()
 {
-    if (m_socket > -1)
+    if (m_socket == -1)
+        return -1;
+    stats.user_reads++;
+    if (fill() > 0)
     {
-        if (peeked)
-        {
-            DEBUG_TCP("peeked( %02X )", (int)Peek & 0xFF);
-            return Peek;
-        }
-        peeked = 1 == Ql_SOC_Recv(m_socket, &Peek, 1); // no wait
-        if (peeked)
-        {
-            DEBUG_TCP("peek( %02X )", (int)Peek & 0xFF);
-            return Peek;
-        }
+        DEBUG_TCP("peek( %02X )", (int)rx_buffer[rx_pos]);
+        return rx_buffer[rx_pos];
     }
     return -1;
 }
 
+size_t gprsClient::readAvailable(char *buf, size_t size)
+{
+    int r = read((unsigned char *)buf, size);
+    return r > 0 ? r : 0;
+}
+
+size_t gprsClient::peekSpan(const char **data)
+{
+    if (m_socket == -1 || fill() <= 0)
+        return 0;
+    *data = (const char *)rx_buffer + rx_pos;
+    return rx_len - rx_pos;
+}
+
+void gprsClient::consume(size_t length)
+{
+    size_t n = rx_len - rx_pos;
+    rx_pos += length < n ? length : n;
+}
+
 void gprsClient::stop()
 {
     if (m_socket > -1)
@@ -156,11 +231,14 @@ void gprsClient::stop()
         DEBUG_TCP("Ql_SOC_Close()");
         m_socket = -1;
     }
+    rx_pos = rx_len = 0;
+    rx_error = 0;
 }
 
 unsigned char gprsClient::connected()
 {
-    return m_socket > -1;
+    // a receive error ends the connection once the buffered bytes are read
+    return m_socket > -1 && (0 == rx_error || rx_pos < rx_len);
 }
 
 gprsClient::operator bool()
@@ -13,13 +13,34 @@
 #define DEBUG_TCP(F, ...)
 //DBG("[TCP] " F "\n", ##__VA_ARGS__)
 
+#ifndef GPRS_CLIENT_RX_BUFFER_SIZE
+#define GPRS_CLIENT_RX_BUFFER_SIZE 1024
+#endif
+
+typedef struct
+{
+  uint32_t recv_calls; // Ql_SOC_Recv() calls
+  uint32_t recv_bytes; // bytes returned by them
+  uint32_t user_reads; // read() / read(buf) / peek() calls
+} gprs_client_stats_t;
+
 class gprsClient : public Client
 {
 
 private:
   char id;
-  unsigned char Peek;
-  bool peeked;
+  unsigned char *rx_buffer;
+  size_t rx_size;
+  size_t rx_pos;
+  size_t rx_len;
+  int rx_error; // last Ql_SOC_Recv() failure other than SOC_WOULDBLOCK, 0 none
+  gprs_client_stats_t stats;
+
+  void init();
+  int fill();
+  int recv(unsigned char *buf, size_t size);
+  gprsClient(const gprsClient &);
+  gprsClient &operator=(const gprsClient &);
 
 public:
   gprsClient();
@@ -36,11 +57,19 @@ public:
   virtual int read();
   virtual int read(unsigned char *buf, size_t size);
   virtual int peek();
+  virtual size_t readAvailable(char *buf, size_t size);
+  virtual size_t peekSpan(const char **data);
+  virtual void consume(size_t length);
   virtual void flush() {}
   virtual void stop();
   virtual unsigned char connected();
   virtual operator bool();
 
+  // rx buffer size, applied while the buffer is empty
+  void setRxBufferSize(size_t size);
+  const gprs_client_stats_t &getStats() const { return stats; }
+  void resetStats() { memset(&stats, 0, sizeof(stats)); }
+
   friend class WiFiServer;
   using Print::write;
 
@@ -0,0 +1,348 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   ril_replay_bench.cpp
+ *
+ * Description:
+ * ------------
+ *   Replays a recorded AT transcript through RilClass::poll() of the m66
+ *   core and through the old String buffer parser, checks that both give
+ *   the same response data and reports bytes/sec and allocations per
+ *   response. The uart and String are small stubs, so it runs on any
+ *   Linux box:
+ *
+ *   g++ -O2 -I../../../../../cores/m66 ril_replay_bench.cpp -o ril_replay_bench
+ *   ./ril_replay_bench [rounds]
+ *
+ *   The String stub grows like WString (realloc to the exact size) and
+ *   counts every malloc/realloc, a fresh String is used per response.
+ *   The old parser keeps its grown _buffer, so it allocates once for the
+ *   copy into the response, the line buffer once per stored line.
+ *   The last response is longer than RIL_LINE_SIZE and is checked to
+ *   arrive complete, in storage and through the line handler.
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <time.h>
+
+/* keep the real headers out, the core pulls in the whole OpenCPU SDK */
+#define INTERFACE_H_
+#define HardwareSerial_h
+#define TRACE(...)
+
+static unsigned long allocs;
+
+class String
+{
+public:
+    String() : buf(NULL), len(0), cap(0) {}
+    String(const String &s) : buf(NULL), len(0), cap(0) { copy(s.buf, s.len); }
+    ~String() { free(buf); }
+    String &operator=(const String &s) { return copy(s.buf, s.len); }
+    String &operator=(const char *s) { return copy(s, strlen(s)); }
+    String &operator+=(char c) { return concat(&c, 1); }
+    String &concat(const char *s) { return concat(s, strlen(s)); }
+    String &concat(const char *s, unsigned int n)
+    {
+        reserve(len + n);
+        memcpy(buf + len, s, n);
+        len += n;
+        buf[len] = 0;
+        return *this;
+    }
+    unsigned int length() const { return len; }
+    const char *c_str() const { return buf ? buf : ""; }
+    bool startsWith(const char *s) const { return len >= strlen(s) && 0 == memcmp(buf, s, strlen(s)); }
+    bool endsWith(const char *s) const
+    {
+        size_t n = strlen(s);
+        return len >= n && 0 == memcmp(buf + len - n, s, n);
+    }
+    int lastIndexOf(const char *s) const
+    {
+        size_t n = strlen(s);
+        for (int i = (int)len - (int)n; i >= 0; i--)
+            if (0 == memcmp(buf + i, s, n))
+                return i;
+        return -1;
+    }
+    void remove(unsigned int index)
+    {
+        if (index < len)
+            buf[len = index] = 0;
+    }
+    void trim()
+    {
+        unsigned int b = 0;
+        while (b < len && isspace((unsigned char)buf[b]))
+            b++;
+        while (len > b && isspace((unsigned char)buf[len - 1]))
+            len--;
+        len -= b;
+        if (buf)
+        {
+            memmove(buf, buf + b, len);
+            buf[len] = 0;
+        }
+    }
+
+    void reserve(unsigned int size)
+    {
+        if (buf && cap >= size)
+            return;
+        buf = (char *)realloc(buf, size + 1);
+        if (0 == len)
+            buf[0] = 0;
+        cap = size;
+        allocs++;
+    }
+
+private:
+    char *buf;
+    unsigned int len, cap;
+    String &copy(const char *s, unsigned int n)
+    {
+        reserve(n);
+        memcpy(buf, s, n);
+        buf[len = n] = 0;
+        return *this;
+    }
+};
+
+/* uart fed from the transcript */
+class HardwareSerial
+{
+public:
+    const char *data;
+    size_t size;
+    void begin(unsigned long) {}
+    void end() {}
+    void clear() {}
+    void println(const char *) {}
+    size_t write(uint8_t) { return 1; }
+    size_t write(const uint8_t *, size_t n) { return n; }
+    int available() { return size != 0; }
+    int read()
+    {
+        size--;
+        return (uint8_t)*data++;
+    }
+};
+
+HardwareSerial Virtual1;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long millis(void) { return (unsigned long)(now() * 1000); }
+static void arduinoProcessMessages(unsigned int) {}
+
+#include "RilCLass.cpp"
+
+/* the parser before the line buffer, reduced to what a response needs */
+class OldRil
+{
+public:
+    OldRil(HardwareSerial &uart) : _uart(&uart), _atCommandState(AT_COMMAND_IDLE), _ready(1), _responseDataStorage(NULL) {}
+    void send(const char *)
+    {
+        _atCommandState = AT_COMMAND_IDLE;
+        _ready = 0;
+    }
+    int waitForResponse(unsigned long timeout, String *responseDataStorage)
+    {
+        _responseDataStorage = responseDataStorage;
+        for (unsigned long start = millis(); (millis() - start) < timeout;)
+        {
+            poll();
+            if (_ready != 0)
+            {
+                _responseDataStorage = NULL;
+                return _ready;
+            }
+        }
+        _responseDataStorage = NULL;
+        _buffer = "";
+        return -1;
+    }
+
+private:
+    HardwareSerial *_uart;
+    enum
+    {
+        AT_COMMAND_IDLE,
+        AT_RECEIVING_RESPONSE
+    } _atCommandState;
+    int _ready;
+    String _buffer;
+    String *_responseDataStorage;
+
+    void poll()
+    {
+        while (_uart->available())
+        {
+            char c = _uart->read();
+            _buffer += c;
+            if (_atCommandState == AT_COMMAND_IDLE)
+            {
+                if (_buffer.startsWith("AT") && _buffer.endsWith("\r\n"))
+                {
+                    _atCommandState = AT_RECEIVING_RESPONSE;
+                    _buffer = "";
+                }
+                else if (_buffer.endsWith("\r\n"))
+                    _buffer = "";
+                continue;
+            }
+            if (c != '\n')
+                continue;
+            int index = _buffer.lastIndexOf("OK\r\n");
+            if (index != -1)
+                _ready = 1;
+            else if ((index = _buffer.lastIndexOf("ERROR\r\n")) != -1)
+                _ready = 2;
+            else if ((index = _buffer.lastIndexOf("NO CARRIER\r\n")) != -1)
+                _ready = 3;
+            if (_ready != 0)
+            {
+                if (_responseDataStorage != NULL)
+                {
+                    _buffer.remove(index);
+                    _buffer.trim();
+                    *_responseDataStorage = _buffer;
+                    _responseDataStorage = NULL;
+                }
+                _atCommandState = AT_COMMAND_IDLE;
+                _buffer = "";
+                return;
+            }
+        }
+    }
+};
+
+typedef struct
+{
+    const char *command;
+    const char *reply;
+    int result;
+} ST_Exchange;
+
+static char long_reply[2048];
+static char long_data[1200];
+
+static ST_Exchange transcript[] = {
+    {"AT", "AT\r\r\nOK\r\n", 1},
+    {"AT+CSQ", "AT+CSQ\r\r\n+CSQ: 23,0\r\n\r\nOK\r\n", 1},
+    {"AT+CREG?", "\r\n+CREG: 1\r\nAT+CREG?\r\r\n+CREG: 0,1\r\n\r\nOK\r\n", 1},
+    {"AT+COPS?", "AT+COPS?\r\r\n+COPS: 0,0,\"CHINA MOBILE\"\r\n\r\nOK\r\n", 1},
+    {"AT+GSN", "AT+GSN\r\r\n861234567890123\r\n\r\nOK\r\n", 1},
+    {"AT+QISTATE", "AT+QISTATE\r\r\n+QISTATE: 0,\"TCP\",\"10.0.0.1\",80,\"CONNECTED\"\r\n"
+                   "+QISTATE: 1,\"UDP\",\"10.0.0.2\",53,\"INITIAL\"\r\n\r\nOK\r\n", 1},
+    {"AT+QIDEACT", "AT+QIDEACT\r\r\nERROR\r\n", 2},
+    {"AT+QHTTPREAD", long_reply, 1},
+};
+
+#define EXCHANGES (sizeof(transcript) / sizeof(transcript[0]))
+
+typedef struct
+{
+    String line;
+    int partials;
+    int done;
+} ST_Collect;
+
+static void on_line(ril_line_type_t type, const char *line, size_t len, void *user)
+{
+    ST_Collect *c = (ST_Collect *)user;
+    if (type == RIL_LINE_PARTIAL)
+        c->partials++;
+    else if (type != RIL_LINE_INTERMEDIATE)
+        return;
+    c->line.concat(line, len);
+    if (type == RIL_LINE_INTERMEDIATE)
+        c->done++;
+}
+
+static size_t transcript_bytes(void)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < EXCHANGES; i++)
+        n += strlen(transcript[i].reply);
+    return n;
+}
+
+static void check(void)
+{
+    ST_Collect collect;
+    collect.partials = collect.done = 0;
+    Ril.setLineHandler(on_line, &collect);
+    for (size_t i = 0; i < EXCHANGES; i++)
+    {
+        String a, b;
+        OldRil old(Virtual1);
+        old.send(transcript[i].command);
+        Virtual1.data = transcript[i].reply;
+        Virtual1.size = strlen(transcript[i].reply);
+        int ra = old.waitForResponse(500, &a);
+        Ril.send(transcript[i].command);
+        Virtual1.data = transcript[i].reply;
+        Virtual1.size = strlen(transcript[i].reply);
+        int rb = Ril.waitForResponse(500, &b);
+        if (ra != transcript[i].result || rb != ra || a.length() != b.length() || strcmp(a.c_str(), b.c_str()))
+        {
+            printf("%s: old %d \"%s\", new %d \"%s\"\n", transcript[i].command, ra, a.c_str(), rb, b.c_str());
+            exit(1);
+        }
+    }
+    Ril.setLineHandler(NULL);
+    if (strcmp(collect.line.c_str() + collect.line.length() - strlen(long_data), long_data) || collect.partials < 4)
+    {
+        printf("long line: %d partial segments, handler got %u bytes\n", collect.partials, collect.line.length());
+        exit(1);
+    }
+    printf("responses match, %u byte line in %d partial segments\n", (unsigned)strlen(long_data), collect.partials);
+}
+
+template <class T>
+static void bench(const char *name, T &ril, unsigned rounds)
+{
+    size_t bytes = transcript_bytes() * rounds;
+    unsigned long a = allocs;
+    double t = now();
+    for (unsigned r = 0; r < rounds; r++)
+        for (size_t i = 0; i < EXCHANGES; i++)
+        {
+            String response;
+            ril.send(transcript[i].command);
+            Virtual1.data = transcript[i].reply;
+            Virtual1.size = strlen(transcript[i].reply);
+            ril.waitForResponse(500, &response);
+        }
+    t = now() - t;
+    printf("%-12s %9.1f KB/s  %6.2f allocs/response\n", name, bytes / t / 1024,
+           (double)(allocs - a) / (rounds * EXCHANGES));
+}
+
+int main(int argc, char **argv)
+{
+    unsigned rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    for (size_t i = 0; i < sizeof(long_data) - 1; i++)
+        long_data[i] = "0123456789abcdef"[i % 16];
+    snprintf(long_reply, sizeof(long_reply), "AT+QHTTPREAD\r\r\nCONNECT\r\n%s\r\nOK\r\n", long_data);
+
+    check();
+    OldRil old(Virtual1);
+    printf("%u rounds of %u responses, %u bytes each round\n", rounds, (unsigned)EXCHANGES, (unsigned)transcript_bytes());
+    bench("old String", old, rounds);
+    bench("line buffer", Ril, rounds);
+    return 0;
+}
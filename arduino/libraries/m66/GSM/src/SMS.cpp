@@ -241,6 +241,28 @@ int SMS::peek()
   return -1;
 }
 
+size_t SMS::peekSpan(const char **data)
+{
+  int end = _incomingBuffer.length();
+  if (end > _smsDataEndIndex + 1)
+  {
+    end = _smsDataEndIndex + 1;
+  }
+  if (_smsDataIndex >= end)
+  {
+    return 0;
+  }
+  *data = _incomingBuffer.c_str() + _smsDataIndex;
+  return end - _smsDataIndex;
+}
+
+void SMS::consume(size_t length)
+{
+  const char *data;
+  size_t n = peekSpan(&data);
+  _smsDataIndex += length < n ? length : n;
+}
+
 void SMS::flush()
 {
   int smsIndexStart = _incomingBuffer.indexOf(' ');
@@ -79,6 +79,13 @@ public:
    */
   int peek();
 
+  /** Received message text after the read position as one block, not consumed
+      @return number of bytes
+   */
+  size_t peekSpan(const char **data);
+  void consume(size_t length);
+  size_t readAvailable(char *buffer, size_t length) { return readSpans(buffer, length); }
+
   /** Delete the SMS from Modem memory and proccess answer
    */
   void flush();
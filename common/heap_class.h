@@ -0,0 +1,232 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2020 Georgi Angelov
+//      Size class heap shared by the malloc shims
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#ifndef HEAP_CLASS_H_
+#define HEAP_CLASS_H_
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HEAP_CLASSES 8
+    typedef struct
+    {
+        uint32_t live;                     /* bytes requested and not freed */
+        uint32_t peak;                     /* highest live */
+        uint32_t held;                     /* bytes taken from the OS heap */
+        uint32_t fragmentation;            /* percent of held that is not live */
+        uint32_t slabs;                    /* slabs carved for the size classes */
+        uint32_t large;                    /* live blocks above the largest class */
+        uint32_t in_place;                 /* reallocs served without a copy */
+        uint32_t count[HEAP_CLASSES];      /* live blocks per size class */
+        uint32_t class_size[HEAP_CLASSES]; /* usable bytes of each class */
+    } heap_stats_t;
+    void heap_stats(heap_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* HEAP_CLASS_H_ */
+
+/*
+    The malloc shim of each platform (BC66 os_syscall.c, BG96 std.c) defines
+    HEAP_CLASS_IMPLEMENTATION and the hooks below, then includes this file
+    once more to get heap_alloc(), heap_release(), heap_resize() and
+    heap_stats(). The lock is per platform, BC66 masks interrupts so free()
+    stays safe from an ISR, BG96 takes a TX_MUTEX:
+
+    HEAP_OS_ALLOC(S)  memory from the OS heap, NULL when out
+    HEAP_OS_FREE(P)   gives it back
+    HEAP_LOCK()       enters a short section around the lists and counters
+    HEAP_UNLOCK()     leaves it
+*/
+#if defined(HEAP_CLASS_IMPLEMENTATION) && !defined(HEAP_CLASS_IMPLEMENTED)
+#define HEAP_CLASS_IMPLEMENTED
+
+#if !defined(HEAP_OS_ALLOC) || !defined(HEAP_OS_FREE) || !defined(HEAP_LOCK) || !defined(HEAP_UNLOCK)
+#error "heap_class.h: define HEAP_OS_ALLOC, HEAP_OS_FREE, HEAP_LOCK and HEAP_UNLOCK first"
+#endif
+
+/*
+    Size classes in front of the OS heap. Requests up to the largest class
+    are carved from slabs and recycled through per class free lists, so
+    String/RIL/MQTT churn does not fragment the OS pool. Larger requests go
+    to the OS rounded up to HEAP_LARGE_ALIGN, that slack lets realloc grow
+    in place. Slabs are kept once taken.
+*/
+
+#define HEAP_SLAB_SIZE 2048
+#define HEAP_LARGE_ALIGN 32
+#define HEAP_HEADER sizeof(heap_block_t)
+
+static const uint16_t heap_class_size[HEAP_CLASSES] = {16, 32, 48, 64, 96, 128, 192, 256};
+/* (size + 15) / 16 -> class */
+static const uint8_t heap_class_index[17] = {0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7};
+
+typedef struct
+{
+    uint32_t size; /* requested */
+    uint32_t kind; /* < HEAP_CLASSES: class, else capacity of a large block */
+} heap_block_t;
+
+static void *heap_free_list[HEAP_CLASSES];
+static heap_stats_t heap_stat;
+
+static inline heap_block_t *heap_block(void *p) { return (heap_block_t *)p - 1; }
+
+static inline void heap_account(int32_t live, int32_t held)
+{
+    heap_stat.live += live;
+    heap_stat.held += held;
+    if (heap_stat.live > heap_stat.peak)
+        heap_stat.peak = heap_stat.live;
+}
+
+static int heap_refill(unsigned cls)
+{
+    uint32_t stride = HEAP_HEADER + heap_class_size[cls];
+    uint32_t i, n = HEAP_SLAB_SIZE / stride;
+    char *slab = (char *)HEAP_OS_ALLOC(HEAP_SLAB_SIZE);
+    if (NULL == slab)
+        return -1;
+    for (i = 0; i < n; i++)
+        ((heap_block_t *)(slab + i * stride))->kind = cls;
+    HEAP_LOCK();
+    for (i = 0; i < n; i++)
+    {
+        void *p = slab + i * stride + HEAP_HEADER;
+        *(void **)p = heap_free_list[cls];
+        heap_free_list[cls] = p;
+    }
+    heap_account(0, HEAP_SLAB_SIZE);
+    heap_stat.slabs++;
+    HEAP_UNLOCK();
+    return 0;
+}
+
+static void *heap_alloc(size_t size)
+{
+    heap_block_t *b;
+    void *p;
+    if (size <= heap_class_size[HEAP_CLASSES - 1])
+    {
+        unsigned cls = heap_class_index[(size + 15) >> 4];
+        for (;;)
+        {
+            HEAP_LOCK();
+            p = heap_free_list[cls];
+            if (p)
+            {
+                heap_free_list[cls] = *(void **)p;
+                heap_block(p)->size = size;
+                heap_stat.count[cls]++;
+                heap_account(size, 0);
+                HEAP_UNLOCK();
+                return p;
+            }
+            HEAP_UNLOCK();
+            if (heap_refill(cls))
+                return NULL;
+        }
+    }
+    else
+    {
+        uint32_t capacity = (size + HEAP_LARGE_ALIGN - 1) & ~(HEAP_LARGE_ALIGN - 1);
+        if (capacity < size)
+            return NULL;
+        b = (heap_block_t *)HEAP_OS_ALLOC(HEAP_HEADER + capacity);
+        if (NULL == b)
+            return NULL;
+        b->size = size;
+        b->kind = capacity;
+        HEAP_LOCK();
+        heap_stat.large++;
+        heap_account(size, HEAP_HEADER + capacity);
+        HEAP_UNLOCK();
+        return b + 1;
+    }
+}
+
+static void heap_release(void *p)
+{
+    heap_block_t *b = heap_block(p);
+    if (b->kind < HEAP_CLASSES)
+    {
+        HEAP_LOCK();
+        heap_stat.count[b->kind]--;
+        heap_account(-(int32_t)b->size, 0);
+        *(void **)p = heap_free_list[b->kind];
+        heap_free_list[b->kind] = p;
+        HEAP_UNLOCK();
+    }
+    else
+    {
+        HEAP_LOCK();
+        heap_stat.large--;
+        heap_account(-(int32_t)b->size, -(int32_t)(HEAP_HEADER + b->kind));
+        HEAP_UNLOCK();
+        HEAP_OS_FREE(b);
+    }
+}
+
+static void *heap_resize(void *mem, size_t newsize)
+{
+    heap_block_t *b = heap_block(mem);
+    int in_place;
+    void *p;
+    if (b->kind < HEAP_CLASSES) /* same class */
+        in_place = newsize <= heap_class_size[HEAP_CLASSES - 1] && heap_class_index[(newsize + 15) >> 4] == b->kind;
+    else /* fits, and shrinks to no less than half */
+        in_place = newsize <= b->kind && newsize > heap_class_size[HEAP_CLASSES - 1] && newsize >= b->kind / 2;
+    if (in_place)
+    {
+        HEAP_LOCK();
+        heap_account((int32_t)newsize - (int32_t)b->size, 0);
+        heap_stat.in_place++;
+        HEAP_UNLOCK();
+        b->size = newsize;
+        return mem;
+    }
+    p = heap_alloc(newsize);
+    if (p)
+    {
+        memcpy(p, mem, b->size < newsize ? b->size : newsize);
+        heap_release(mem);
+    }
+    return p;
+}
+
+void heap_stats(heap_stats_t *stats)
+{
+    unsigned i;
+    if (NULL == stats)
+        return;
+    HEAP_LOCK();
+    *stats = heap_stat;
+    HEAP_UNLOCK();
+    for (i = 0; i < HEAP_CLASSES; i++)
+        stats->class_size[i] = heap_class_size[i];
+    stats->fragmentation = stats->held ? (uint32_t)(((uint64_t)(stats->held - stats->live) * 100) / stats->held) : 0;
+}
+
+#endif /* HEAP_CLASS_IMPLEMENTATION */
@@ -73,6 +73,7 @@ typedef enum {
 	URC_LWM2M_WRITE_RSQ, 		// Indication for write response from the module.
 	URC_LWM2M_EXECUTE_REQ,      // Indication for execute execute from server.
 	URC_LWM2M_EXECUTE_RSQ,		// Indication for execute execute from server.
+	URC_SOCKET_RECV,            // Indication for data received in push mode, see also SOCKET_RECV_CONNECTID.
     URC_SYS_END = 100, 
     /*****************************************/
     /* System URC definition end             */
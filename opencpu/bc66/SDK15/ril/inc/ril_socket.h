@@ -37,6 +37,13 @@
 
 #define CONNECTID_MAX       (5)
 #define SOCKET_SEND_BUFFER_LENGTH  (512)
+#ifndef SOCKET_RECV_BUFFER_LENGTH
+#define SOCKET_RECV_BUFFER_LENGTH  (1024)   // receive ring per connection, power of 2
+#endif
+
+// param2 of the URC_SOCKET_RECV indication: connection and bytes in its ring
+#define SOCKET_RECV_CONNECTID(param)   ((u8)((u32)(param) & 0xFF))
+#define SOCKET_RECV_LENGTH(param)      ((u32)(param) >> 8)
 
 typedef enum
 {
@@ -75,6 +82,25 @@ typedef struct{
  Enum_Socket_Protocol_Type protocol_type;//     0: IPv4,1: IPv6
 }ST_Socket_Param_t;
 
+typedef struct{
+ const u8* data;  // raw bytes, not hex encoded
+ u32 length;
+}ST_Socket_Buffer_t;
+
+
+/******************************************************************************
+* Function:     RIL_SOC_Initialize
+*  
+* Description:
+*              Creates the lock shared by the socket send functions. Optional, the
+*              first send creates it otherwise.
+*
+* Parameters:    
+*                None.
+* Return:  
+*                None.
+******************************************************************************/
+void RIL_SOC_Initialize(void);
 
 /******************************************************************************
 * Function:     RIL_SOC_QIOPEN
@@ -157,6 +183,44 @@ s32 RIL_SOC_QISEND(u8 connectID, u32 send_length,u8* send_buffer);
 ******************************************************************************/
 s32 RIL_SOC_QISENDEX(u8 connectID, u32 send_length,u8* send_hex_buffer);
 
+/******************************************************************************
+* Function:     RIL_SOC_QISENDV
+*  
+* Description:
+*                 The function sends raw bytes, gathered from several buffers, to a
+*                 connected TCP/UDP socket. The bytes are hex encoded straight into
+*                 the AT+QISENDEX line, the caller does not encode them and no heap
+*                 is used.
+*
+* Parameters:    
+*            connectID:
+*                   [in] 
+*                   socket service index, range is 0-4.
+*            buffers:
+*                   [in]
+*                   the buffers to send, in order.
+*            count:
+*                   [in]
+*                   number of buffers, their total length cannot exceed SOCKET_SEND_BUFFER_LENGTH
+* Return:  
+*                RIL_AT_SUCCESS,send AT successfully.
+*                RIL_AT_FAILED, send AT failed.
+*                RIL_AT_TIMEOUT,send AT timeout.
+*                RIL_AT_BUSY,   sending AT.
+*                RIL_AT_INVALID_PARAM, invalid input parameter.
+*                RIL_AT_UNINITIALIZED, RIL is not ready, need to wait for MSG_ID_RIL_READY
+*                                      and then call Ql_RIL_Initialize to initialize RIL.
+******************************************************************************/
+s32 RIL_SOC_QISENDV(u8 connectID, const ST_Socket_Buffer_t* buffers, u32 count);
+
+/******************************************************************************
+* Function:     RIL_SOC_QISEND_RAW
+*  
+* Description:
+*                 RIL_SOC_QISENDV with a single buffer.
+******************************************************************************/
+s32 RIL_SOC_QISEND_RAW(u8 connectID, u32 send_length, const u8* send_data);
+
 
 /******************************************************************************
 * Function:     RIL_SOC_QICFG_FORMAT
@@ -183,6 +247,46 @@ s32 RIL_SOC_QISENDEX(u8 connectID, u32 send_length,u8* send_hex_buffer);
 ******************************************************************************/
 s32 RIL_SOC_QICFG_FORMAT(bool send_format,bool recv_format);
 
+/******************************************************************************
+* Function:     RIL_SOC_RECV
+*  
+* Description:
+*                 Reads data pushed by +QIURC: "recv" without blocking and without
+*                 an AT command. The URC handler decodes the data (hex or text, as
+*                 set by RIL_SOC_QICFG_FORMAT) into a ring per connection and posts
+*                 MSG_ID_URC_INDICATION / URC_SOCKET_RECV once, param2 carries the
+*                 connection and the byte count (SOCKET_RECV_CONNECTID/_LENGTH).
+*                 Read until 0 is returned, then the next "recv" posts again.
+*
+* Parameters:    
+*            connectID:
+*                   [in] 
+*                   socket service index, range is 0-4.
+*            buffer:
+*                   [out]
+*                   received bytes.
+*            length:
+*                   [in]
+*                   size of buffer.
+* Return:  
+*                number of bytes read, 0 if nothing is pending.
+*                RIL_AT_INVALID_PARAM, invalid input parameter.
+******************************************************************************/
+s32 RIL_SOC_RECV(u8 connectID, u8* buffer, u32 length);
+
+// bytes pending in the ring of connectID
+s32 RIL_SOC_RECV_Available(u8 connectID);
+// bytes lost because the ring of connectID was full
+u32 RIL_SOC_RECV_Dropped(u8 connectID);
+// discards the pending bytes, RIL_SOC_QICLOSE does it too
+void RIL_SOC_RECV_Purge(u8 connectID);
+// for the URC handler: decodes length bytes of "recv" data into the ring of
+// connectID, notify is set when URC_SOCKET_RECV has to be posted. returns the
+// bytes pending or RIL_AT_INVALID_PARAM
+s32  RIL_SOC_RECV_Store(u8 connectID, const char* data, u32 length, bool* notify);
+// TRUE when "recv" data arrives hex encoded (RIL_SOC_QICFG_FORMAT)
+bool RIL_SOC_RECV_IsHex(void);
+
 
 /******************************************************************************
 * Function:     RIL_SOC_QICLOSE
@@ -77,19 +77,22 @@ s32 Default_atRsp_callback(char* line, u32 len, void* userdata)
 {
 	//Ql_Debug_Trace("[Default_atRsp_callback] %s\r\n", (u8*)line);
 
-    if (Ql_RIL_FindLine(line, len, "OK"))// find <CR><LF>OK<CR><LF>,OK<CR><LF>, <CR>OK<CR>��<LF>OK<LF>
+    switch (Ql_RIL_FindFinalResult(line, len))
     {
+    case RIL_FINAL_OK:
         m_iErrCode = RIL_ATRSP_SUCCESS;
         return  RIL_ATRSP_SUCCESS;
-    }
-    else if (Ql_RIL_FindLine(line, len, "ERROR")) // find <CR><LF>ERROR<CR><LF>, <CR>ERROR<CR>��<LF>ERROR<LF>
-    {
+    case RIL_FINAL_ERROR:
         m_iErrCode = RIL_ATRSP_FAILED;
         return  RIL_ATRSP_FAILED;
+    case RIL_FINAL_CME_ERROR:
+    case RIL_FINAL_CMS_ERROR:
+        Ql_sscanf(line, "%*[^:]: %d\r\n", &m_iErrCode);
+        return  RIL_ATRSP_FAILED;
+    default:
+        break;
     }
-    else if (Ql_RIL_FindString(line, len, "+CME ERROR:") || 
-              Ql_RIL_FindString(line, len, "+CMS ERROR:") ||
-              Ql_RIL_FindString(line, len, "+CIS ERROR:"))
+    if (Ql_RIL_FindString(line, len, "+CIS ERROR:"))
     {
         Ql_sscanf(line, "%*[^:]: %d\r\n", &m_iErrCode);
         return  RIL_ATRSP_FAILED;
@@ -35,6 +35,7 @@
 #include "ql_trace.h"
 #include "ql_error.h"
 #include "ql_uart.h"
+#include "ql_freertos.h"
 #include "ril_socket.h"
 
 #ifdef __OCPU_RIL_SUPPORT__
@@ -158,59 +159,286 @@ s32  RIL_SOC_QIOPEN(ST_Socket_Param_t* socket_param_t)
 
 }
 
+/* one AT line for all sends: head, up to 2 hex chars per byte, quote and \\n */
+#define SOCKET_SEND_LINE_LENGTH  (RIL_MAX_AT_HEAD_LEN+SOCKET_SEND_BUFFER_LENGTH*2+4)
+
+static char s_SendLine[SOCKET_SEND_LINE_LENGTH];
+static volatile u32 s_SendMutex = 0;
+static const char s_HexDigits[] = "0123456789ABCDEF";
+
+/* created on first use, two tasks racing here keep one mutex between them */
+static u32 Soc_Send_Mutex(void)
+{
+    u32 mutex = s_SendMutex;
+    if (0 == mutex)
+    {
+        mutex = Ql_OS_CreateMutex();
+        if (0 != mutex && !__sync_bool_compare_and_swap(&s_SendMutex, 0, mutex))
+        {
+            Ql_OS_DeleteMutex(mutex);
+        }
+        mutex = s_SendMutex;
+    }
+    return mutex;
+}
+
+void RIL_SOC_Initialize(void)
+{
+    Soc_Send_Mutex();
+}
+
+static s32 Soc_Send_Lock(void)
+{
+    u32 mutex = Soc_Send_Mutex();
+    if (0 == mutex)
+    {
+        return RIL_AT_FAILED; // out of OS objects
+    }
+    return Ql_OS_TakeMutex(mutex, -1) ? RIL_AT_SUCCESS : RIL_AT_BUSY;
+}
+
+static s32 Soc_Send_Line(u32 len)
+{
+    s32 ret;
+    s_SendLine[len++] = '"';
+    s_SendLine[len++] = '\n';
+    s_SendLine[len] = '\0';
+    ret = Ql_RIL_SendATCmd(s_SendLine,len,ATRsp_Soc_Qisend_Handler,0,30*1000);
+    RIL_SOCKET_DEBUG(DBG_Buffer,"<--Send AT:%s, ret = %d -->\r\n",s_SendLine, ret);
+    Ql_OS_GiveMutex(s_SendMutex);
+    return ret;
+}
+
+static s32 Soc_Send_String(const char* cmd, u8 connectID, u32 send_length, const u8* data)
+{
+    u32 len, data_len;
+    s32 ret;
+
+    data_len = Ql_strlen((const char*)data);
+    if (data_len > SOCKET_SEND_BUFFER_LENGTH*2)
+    {
+        return RIL_AT_INVALID_PARAM;
+    }
+    ret = Soc_Send_Lock();
+    if (RIL_AT_SUCCESS != ret)
+    {
+        return ret;
+    }
+    len = Ql_sprintf(s_SendLine, "AT+%s=%d,%d,\"",cmd,connectID,send_length);
+    Ql_memcpy(s_SendLine + len, data, data_len);
+    return Soc_Send_Line(len + data_len);
+}
+
 s32 RIL_SOC_QISEND(u8 connectID, u32 send_length,u8* send_buffer)
 {
-    s32 ret = RIL_AT_SUCCESS;
-	u8* strAT  = NULL;
     if((send_length > SOCKET_SEND_BUFFER_LENGTH)||(NULL == send_buffer))
     {
 		return RIL_AT_INVALID_PARAM;
 	}
-	
-	strAT = (u8*)Ql_MEM_Alloc(sizeof(u8)*(SOCKET_SEND_BUFFER_LENGTH*2)+RIL_MAX_AT_HEAD_LEN);
-	if(NULL == strAT)
-	{
-       return RIL_AT_INVALID_PARAM;
-	}
-	
-    Ql_memset(strAT, 0, sizeof(u8)*(SOCKET_SEND_BUFFER_LENGTH*2)+RIL_MAX_AT_HEAD_LEN);
-    Ql_sprintf(strAT, "AT+QISEND=%d,%d,\"%s\"\n",connectID,send_length, send_buffer);
-    ret = Ql_RIL_SendATCmd(strAT,Ql_strlen(strAT),ATRsp_Soc_Qisend_Handler,0,30*1000);
-	RIL_SOCKET_DEBUG(DBG_Buffer,"<--Send AT:%s, ret = %d -->\r\n",strAT, ret);
-	if(NULL != strAT)
-	{
-       Ql_MEM_Free(strAT);
-	   strAT  = NULL;
-	}
-    return ret;
+    return Soc_Send_String("QISEND", connectID, send_length, send_buffer);
 }
 
 s32 RIL_SOC_QISENDEX(u8 connectID, u32 send_length,u8* send_hex_buffer)
 {
-    s32 ret = RIL_AT_SUCCESS;
-    u8* strAT  = NULL;
-
     if((send_length > SOCKET_SEND_BUFFER_LENGTH)||(NULL == send_hex_buffer))
     {
 		return RIL_AT_INVALID_PARAM;
 	}
+    return Soc_Send_String("QISENDEX", connectID, send_length, send_hex_buffer);
+}
 
-	strAT = (u8*)Ql_MEM_Alloc(sizeof(u8)*(SOCKET_SEND_BUFFER_LENGTH*2)+RIL_MAX_AT_HEAD_LEN);
-	if(NULL == strAT)
-	{
-       return RIL_AT_INVALID_PARAM;
-	}
-	
-    Ql_memset(strAT, 0,sizeof(u8)*(SOCKET_SEND_BUFFER_LENGTH*2)+RIL_MAX_AT_HEAD_LEN);
-    Ql_sprintf(strAT, "AT+QISENDEX=%d,%d,\"%s\"\n",connectID,send_length, send_hex_buffer);
-    ret = Ql_RIL_SendATCmd(strAT,Ql_strlen(strAT),ATRsp_Soc_Qisend_Handler,0,30*1000);
-	RIL_SOCKET_DEBUG(DBG_Buffer,"<--Send AT:%s, ret = %d -->\r\n",strAT, ret);
-	if(NULL != strAT)
-	{
-       Ql_MEM_Free(strAT);
-	   strAT  = NULL;
-	}
-    return ret;
+s32 RIL_SOC_QISENDV(u8 connectID, const ST_Socket_Buffer_t* buffers, u32 count)
+{
+    u32 i, j, len, send_length = 0;
+    char* out;
+    s32 ret;
+
+    if ((NULL == buffers) || (0 == count))
+    {
+        return RIL_AT_INVALID_PARAM;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if ((NULL == buffers[i].data) && (0 != buffers[i].length))
+        {
+            return RIL_AT_INVALID_PARAM;
+        }
+        send_length += buffers[i].length;
+        if (send_length > SOCKET_SEND_BUFFER_LENGTH)
+        {
+            return RIL_AT_INVALID_PARAM;
+        }
+    }
+    ret = Soc_Send_Lock();
+    if (RIL_AT_SUCCESS != ret)
+    {
+        return ret;
+    }
+
+    len = Ql_sprintf(s_SendLine, "AT+QISENDEX=%d,%d,\"",connectID,send_length);
+    out = s_SendLine + len;
+    for (i = 0; i < count; i++)
+    {
+        const u8* in = buffers[i].data;
+        for (j = 0; j < buffers[i].length; j++)
+        {
+            *out++ = s_HexDigits[in[j] >> 4];
+            *out++ = s_HexDigits[in[j] & 0x0F];
+        }
+    }
+    return Soc_Send_Line(len + send_length*2);
+}
+
+s32 RIL_SOC_QISEND_RAW(u8 connectID, u32 send_length, const u8* send_data)
+{
+    ST_Socket_Buffer_t buffer;
+
+    buffer.data = send_data;
+    buffer.length = send_length;
+    return RIL_SOC_QISENDV(connectID, &buffer, 1);
+}
+
+/****************************************************/
+/* Push mode receive                                */
+/* -------------------------------------------------*/
+/* +QIURC: "recv" data is decoded by the URC       */
+/* handler straight into a ring per connection,     */
+/* the application drains it with RIL_SOC_RECV. One */
+/* producer (URC) and one consumer per connection,  */
+/* so head and tail need no lock.                   */
+/****************************************************/
+typedef struct {
+    u8  buf[SOCKET_RECV_BUFFER_LENGTH];
+    volatile u32 head;      // written by the URC handler
+    volatile u32 tail;      // written by the reader
+    volatile bool notified; // URC_SOCKET_RECV posted, not read empty yet
+    u32 dropped;
+}ST_Socket_Recv_Ring;
+
+static ST_Socket_Recv_Ring s_RecvRing[CONNECTID_MAX];
+static bool s_RecvHex = FALSE;
+
+static s8 Soc_Hex_Value(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+s32 RIL_SOC_RECV_Store(u8 connectID, const char* data, u32 length, bool* notify)
+{
+    ST_Socket_Recv_Ring* ring;
+    u32 head, room, i;
+
+    *notify = FALSE;
+    if (connectID >= CONNECTID_MAX)
+    {
+        return RIL_AT_INVALID_PARAM;
+    }
+    ring = &s_RecvRing[connectID];
+    head = ring->head;
+    room = SOCKET_RECV_BUFFER_LENGTH - (head - ring->tail);
+    if (length > room)
+    {
+        ring->dropped += length - room;
+        length = room;
+    }
+    for (i = 0; i < length; i++)
+    {
+        u8 value;
+        if (s_RecvHex)
+        {
+            s8 hi = Soc_Hex_Value(data[2*i]);
+            s8 lo = Soc_Hex_Value(data[2*i+1]);
+            if (hi < 0 || lo < 0)
+            {
+                break;
+            }
+            value = (u8)((hi << 4) | lo);
+        }else{
+            value = (u8)data[i];
+        }
+        ring->buf[(head + i) & (SOCKET_RECV_BUFFER_LENGTH - 1)] = value;
+    }
+    ring->head = head + i;
+    if (!ring->notified && ring->head != ring->tail)
+    {
+        ring->notified = TRUE;
+        *notify = TRUE;
+    }
+    return ring->head - ring->tail;
+}
+
+bool RIL_SOC_RECV_IsHex(void)
+{
+    return s_RecvHex;
+}
+
+s32 RIL_SOC_RECV(u8 connectID, u8* buffer, u32 length)
+{
+    ST_Socket_Recv_Ring* ring;
+    u32 tail, n, first;
+
+    if ((connectID >= CONNECTID_MAX) || (NULL == buffer && 0 != length))
+    {
+        return RIL_AT_INVALID_PARAM;
+    }
+    ring = &s_RecvRing[connectID];
+    tail = ring->tail;
+    if (ring->head == tail)
+    {
+        // read empty: the next "recv" posts URC_SOCKET_RECV again. Clear
+        // first, then look again, data stored in between is returned here
+        ring->notified = FALSE;
+        if (ring->head == tail)
+        {
+            return 0;
+        }
+    }
+    n = ring->head - tail;
+    if (n > length)
+    {
+        n = length;
+    }
+    first = SOCKET_RECV_BUFFER_LENGTH - (tail & (SOCKET_RECV_BUFFER_LENGTH - 1));
+    if (first > n)
+    {
+        first = n;
+    }
+    Ql_memcpy(buffer, &ring->buf[tail & (SOCKET_RECV_BUFFER_LENGTH - 1)], first);
+    Ql_memcpy(buffer + first, ring->buf, n - first);
+    ring->tail = tail + n;
+    return n;
+}
+
+s32 RIL_SOC_RECV_Available(u8 connectID)
+{
+    if (connectID >= CONNECTID_MAX)
+    {
+        return RIL_AT_INVALID_PARAM;
+    }
+    return s_RecvRing[connectID].head - s_RecvRing[connectID].tail;
+}
+
+u32 RIL_SOC_RECV_Dropped(u8 connectID)
+{
+    return connectID < CONNECTID_MAX ? s_RecvRing[connectID].dropped : 0;
+}
+
+void RIL_SOC_RECV_Purge(u8 connectID)
+{
+    if (connectID < CONNECTID_MAX)
+    {
+        s_RecvRing[connectID].tail = s_RecvRing[connectID].head;
+        s_RecvRing[connectID].notified = FALSE;
+    }
 }
 
 s32 RIL_SOC_QICFG_FORMAT(bool send_format,bool recv_format)
@@ -222,6 +450,10 @@ s32 RIL_SOC_QICFG_FORMAT(bool send_format,bool recv_format)
     Ql_memset(strAT, 0, sizeof(strAT));
     Ql_sprintf(strAT, "AT+QICFG=\"dataformat\",%d,%d\n",send_format,recv_format);
     ret = Ql_RIL_SendATCmd(strAT,Ql_strlen(strAT),ATResponse_Handler,0,0);
+    if (RIL_AT_SUCCESS == ret)
+    {
+        s_RecvHex = recv_format;
+    }
 	
 	RIL_SOCKET_DEBUG(DBG_Buffer,"<--Send AT:%s, ret = %d -->\r\n",strAT, ret);
     return ret;
@@ -235,6 +467,10 @@ s32 RIL_SOC_QICLOSE(u8 connectID)
     Ql_memset(strAT, 0, sizeof(strAT));
     Ql_sprintf(strAT, "AT+QICLOSE=%d\n",connectID);
     ret = Ql_RIL_SendATCmd(strAT,Ql_strlen(strAT),ATRsp_Soc_Qiclose_Handler,0,0);
+    if (RIL_AT_SUCCESS == ret)
+    {
+        RIL_SOC_RECV_Purge(connectID);
+    }
 	
 	RIL_SOCKET_DEBUG(DBG_Buffer,"<--Send AT:%s, ret = %d -->\r\n",strAT, ret);
     return ret;
@@ -17,6 +17,8 @@
 ////////////////////////////////////////////////////////////////////////////
 
 #include "os_api.h"
+#include "os_wizio.h"
+#include "mt2625.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -206,26 +208,40 @@ int _gettimeofday_r(struct _reent *ignore, struct timeval *tv, void *tz)
 // MEMORY
 ////////////////////////////////////////////////////////////////////////////
 
+#define HEAP_OS_ALLOC(S) Ql_MEM_Alloc(S)
+#define HEAP_OS_FREE(P) Ql_MEM_Free(P)
+/* short sections, also safe from ISR */
+static uint32_t heap_primask;
+#define HEAP_LOCK()                      \
+    do                                   \
+    {                                    \
+        uint32_t m = __get_PRIMASK();    \
+        __disable_irq();                 \
+        heap_primask = m;                \
+    } while (0)
+#define HEAP_UNLOCK() __set_PRIMASK(heap_primask)
+
+#define HEAP_CLASS_IMPLEMENTATION
+#include "../../../../common/heap_class.h"
+
 void *malloc(size_t size)
 {
-    return Ql_MEM_Alloc(size);
+    return heap_alloc(size);
 }
 void *_malloc_r(struct _reent *ignore, size_t size) { return malloc(size); }
 
 void free(void *p)
 {
     if (p)
-        Ql_MEM_Free(p);
+        heap_release(p);
 }
 void _free_r(struct _reent *ignore, void *ptr) { free(ptr); }
 
 void *realloc(void *mem, size_t newsize)
 {
-    void *new = malloc(newsize);
-    if ((new) && (mem))
-        memcpy(new, mem, newsize);
-    free(mem);
-    return new;
+    if (NULL == mem)
+        return malloc(newsize);
+    return heap_resize(mem, newsize);
 }
 void *_realloc_r(struct _reent *ignored, void *ptr, size_t size) { return realloc(ptr, size); }
 
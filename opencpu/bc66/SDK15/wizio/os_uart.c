@@ -188,6 +188,36 @@ int uart_peek(UART uart)
     }
     return c;
 }
+size_t uart_borrow(UART uart, const char **data)
+{
+    size_t size = 0;
+    if (uart && data)
+    {
+        if (MUTEX_LOCK(uart->M_Ring))
+        {
+            /* the callback only writes past head + len, the span stays valid */
+            size = uart->ring.capacity - uart->ring.head;
+            if (size > uart->ring.len)
+                size = uart->ring.len;
+            *data = (const char *)uart->ring.buffer + uart->ring.head;
+            MUTEX_UNLOCK(uart->M_Ring);
+        }
+    }
+    return size;
+}
+
+void uart_release(UART uart, size_t consumed)
+{
+    if (uart)
+    {
+        if (MUTEX_LOCK(uart->M_Ring))
+        {
+            uart->ring.skip(&uart->ring, consumed);
+            MUTEX_UNLOCK(uart->M_Ring);
+        }
+    }
+}
+
 void uart_flush(UART uart)
 {
     if (uart)
@@ -62,6 +62,10 @@ extern "C"
     int uart_peek(UART uart);
     void uart_flush(UART uart);
 
+    /* zero copy: received bytes up to the end of the ring, drop them with uart_release() */
+    size_t uart_borrow(UART uart, const char **data);
+    void uart_release(UART uart, size_t consumed);
+
     void uart_callback(Enum_SerialPort port, Enum_UARTEventType msg, bool level, void *customizedPara);
 
 #ifdef __cplusplus
@@ -29,6 +29,7 @@ extern "C"
 #include <errno.h>
 #include <assert.h>
 #include "os_api.h"
+#include "../../../../common/heap_class.h"
 
 #define TICK_MS (10L)
 #define DELAY(T) Ql_Sleep(T)
@@ -0,0 +1,7 @@
+/* host stand-in for the application's feature switches, FOTA over HTTP only */
+#ifndef __CUSTOM_FEATURE_DEF_H__
+#define __CUSTOM_FEATURE_DEF_H__
+
+#define __OCPU_FOTA_BY_HTTP__
+
+#endif
@@ -0,0 +1 @@
+/* host stand-in for the application's task table, the harness has no tasks */
@@ -0,0 +1,296 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   fota_resume_fault.c
+ *
+ * Description:
+ * ------------
+ *   Runs the HTTP FOTA download against server.py, which drops the link
+ *   at fixed image offsets: a close, a reset, a server that ignores
+ *   "Range:", a chunked body cut inside a chunk and a server that goes
+ *   silent so the read timer has to fire. Each download sees more drops
+ *   than HTTP_RESUME_MAX_RETRY, separated by progress, and must still
+ *   write the image byte for byte through Ql_FOTA_WriteData and finish.
+ *   A server that never sends another image byte after the first drop
+ *   must fail the upgrade after exactly HTTP_RESUME_MAX_RETRY reconnects.
+ *   fota_http.c and fota_http_code.c are built as they are; sockets,
+ *   timers and the fota region are stubbed over the host, timers and
+ *   sleeps run TIME_SCALE times faster and the server is always at
+ *   127.0.0.1:
+ *
+ *   P=../../m66    # or ../../mc60
+ *   gcc -O2 -I. -I$P/include -I$P/ril/inc -I$P/fota/inc -I$P/fota/src \
+ *       fota_resume_fault.c -o fota_resume_fault
+ *   python3 server.py 18081 &
+ *   ./fota_resume_fault 18081
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "ql_type.h"
+#include "ql_stdlib.h"
+#include "ql_socket.h"
+#include "ql_timer.h"
+#include "ql_fota.h"
+#include "ql_gprs.h"
+#include "ql_uart.h"
+#include "fota_main.h"
+
+#define TIME_SCALE 100
+#define IMAGE_MAX (1024 * 1024)
+
+static int port;
+static int cur_sock = -1;
+static unsigned int sockets;
+static Callback_Timer_OnTimer timer_cb;
+static u32 timer_id;
+static void *timer_param;
+static double timer_due; // ms, 0 when stopped
+static unsigned int timer_fired;
+static u8 image[IMAGE_MAX];
+static u32 written, max_write;
+static bool finished, updated, failed;
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* stubs for what fota_http.c and fota_http_code.c call */
+void *Ql_memset(void *dest, u8 value, u32 size) { return memset(dest, value, size); }
+void *Ql_memcpy(void *dest, const void *src, u32 size) { return memcpy(dest, src, size); }
+s32 Ql_memcmp(const void *dest, const void *src, u32 size) { return memcmp(dest, src, size); }
+void *Ql_memmove(void *dest, const void *src, u32 size) { return memmove(dest, src, size); }
+char *Ql_strcpy(char *dest, const char *src) { return strcpy(dest, src); }
+char *Ql_strncpy(char *dest, const char *src, u32 size) { return strncpy(dest, src, size); }
+s32 Ql_strcmp(const char *s1, const char *s2) { return strcmp(s1, s2); }
+u32 Ql_strlen(const char *str) { return strlen(str); }
+char *Ql_strstr(const char *s1, const char *s2) { return strstr(s1, s2); }
+s32 Ql_tolower(s32 c) { return tolower(c); }
+s32 Ql_atoi(const char *s) { return atoi(s); }
+s32 (*Ql_sprintf)(char *, const char *, ...) = (void *)sprintf;
+char *Ql_StrToUpper(char *str)
+{
+    for (char *p = str; *p; p++)
+        *p = toupper(*p);
+    return str;
+}
+void *Ql_MEM_Alloc(u32 size) { return malloc(size); }
+void Ql_MEM_Free(void *ptr) { free(ptr); }
+s32 Ql_UART_Write(Enum_SerialPort port, u8 *data, u32 writeLen) { return writeLen; }
+u64 Ql_GetMsSincePwrOn(void) { return (u64)now_ms(); }
+void Ql_Sleep(u32 msec) { usleep(msec * 1000 / TIME_SCALE); }
+s32 Ql_OS_GetActiveTaskId(void) { return 0; }
+
+s32 Ql_GPRS_Register(u8 contextId, ST_PDPContxt_Callback *callback_func, void *customParam) { return GPRS_PDP_SUCCESS; }
+s32 Ql_GPRS_Config(u8 contextId, ST_GprsConfig *cfg) { return GPRS_PDP_SUCCESS; }
+s32 Ql_GPRS_ActivateEx(u8 contextId, bool isBlocking) { return GPRS_PDP_SUCCESS; }
+s32 Ql_IpHelper_ConvertIpAddr(u8 *addrString, u32 *ipAddr)
+{
+    return 1 == inet_pton(AF_INET, (char *)addrString, ipAddr) ? SOC_SUCCESS : SOC_ERROR;
+}
+s32 Ql_IpHelper_GetIPByHostName(u8 contextId, u8 requestId, u8 *hostName, Callback_IpHelper_GetIpByName callback_GetIpByName)
+{
+    return SOC_ERROR;
+}
+
+s32 Ql_SOC_CreateEx(u8 contextId, u8 socketType, s32 taskId, ST_SOC_Callback cb)
+{
+    cur_sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockets++;
+    return cur_sock;
+}
+s32 Ql_SOC_ConnectEx(s32 socketId, u32 remoteIP, u16 remotePort, bool isBlocking)
+{
+    struct sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_port = htons(remotePort);
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // remoteIP is a pointer squeezed into u32
+    if (connect(socketId, (struct sockaddr *)&a, sizeof(a)) < 0)
+        return SOC_ERROR;
+    fcntl(socketId, F_SETFL, O_NONBLOCK);
+    return SOC_SUCCESS;
+}
+s32 Ql_SOC_Send(s32 socketId, u8 *pData, s32 dataLen)
+{
+    return send(socketId, pData, dataLen, MSG_NOSIGNAL);
+}
+s32 Ql_SOC_Recv(s32 socketId, u8 *pBuffer, s32 bufferLen)
+{
+    ssize_t r = recv(socketId, pBuffer, bufferLen, 0);
+    if (r < 0)
+        return EAGAIN == errno ? SOC_WOULDBLOCK : SOC_ERROR;
+    return r;
+}
+s32 Ql_SOC_Close(s32 socketId)
+{
+    if (socketId == cur_sock)
+        cur_sock = -1;
+    return close(socketId);
+}
+
+s32 Ql_Timer_Register(u32 timerId, Callback_Timer_OnTimer callback_onTimer, void *param)
+{
+    timer_id = timerId;
+    timer_cb = callback_onTimer;
+    timer_param = param;
+    return 0;
+}
+s32 Ql_Timer_Start(u32 timerId, u32 interval, bool autoRepeat)
+{
+    timer_due = now_ms() + interval / TIME_SCALE;
+    return 0;
+}
+s32 Ql_Timer_Stop(u32 timerId)
+{
+    timer_due = 0;
+    return 0;
+}
+
+s32 Ql_FOTA_WriteData(s32 length, s8 *buffer)
+{
+    if (written + length > IMAGE_MAX)
+        return -1;
+    memcpy(image + written, buffer, length);
+    written += length;
+    if ((u32)length > max_write)
+        max_write = length;
+    return 0;
+}
+s32 Ql_FOTA_Finish(void)
+{
+    finished = TRUE;
+    return 0;
+}
+s32 Ql_FOTA_Update(void)
+{
+    updated = TRUE;
+    return 0;
+}
+
+ST_GprsConfig Fota_gprsCfg;
+u8 Fota_apn[10] = "CMNET";
+u8 Fota_userid[10] = "";
+u8 Fota_passwd[10] = "";
+Callback_Upgrade_State Fota_UpgardeState;
+ST_FotaDownloadStats g_FOTA_DownloadStats;
+
+#include "fota_http_code.c"
+#include "fota_http.c"
+
+static bool on_state(Upgrade_State state, s32 fileDLPercent)
+{
+    if (UP_UPGRADFAILED == state)
+        failed = TRUE;
+    return TRUE;
+}
+
+/* the task's message loop: socket reads and the read timer */
+static void run_loop(double limit)
+{
+    double end = now_ms() + limit;
+    while (!finished && !failed && now_ms() < end)
+    {
+        struct pollfd p = {cur_sock, POLLIN, 0};
+        int wait = 50;
+        if (timer_due > 0)
+        {
+            wait = (int)(timer_due - now_ms());
+            wait = wait < 0 ? 0 : wait > 50 ? 50 : wait;
+        }
+        if (cur_sock >= 0 && poll(&p, 1, wait) > 0)
+        {
+            Httpcallback_socket_read(cur_sock, SOC_SUCCESS, NULL);
+        }
+        else if (cur_sock < 0)
+        {
+            usleep(wait * 1000);
+        }
+        if (timer_due > 0 && now_ms() >= timer_due)
+        {
+            timer_due = 0;
+            timer_fired++;
+            timer_cb(timer_id, timer_param);
+        }
+    }
+}
+
+static bool image_ok(u32 size)
+{
+    for (u32 i = 0; i < written; i++)
+        if (image[i] != (u8)((i * 31 + 7) & 0xFF))
+            return FALSE;
+    return written == size;
+}
+
+/* downloads /kind/size/step, expect_ok tells whether the upgrade must finish */
+static int run(const char *kind, u32 size, u32 step, bool expect_ok)
+{
+    char url[128];
+    u32 drops = (size - 1) / step;
+    bool ok;
+
+    cur_sock = -1;
+    sockets = timer_fired = 0;
+    timer_due = 0;
+    written = max_write = 0;
+    finished = updated = failed = FALSE;
+    Ql_memset(&g_FOTA_DownloadStats, 0, sizeof(g_FOTA_DownloadStats));
+    Fota_UpgardeState = on_state;
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/%s/%u/%u", port, kind, size, step);
+    double t = now_ms();
+    HTTP_FotaMain(1, (u8 *)url);
+    run_loop(60000);
+    t = now_ms() - t;
+    if (cur_sock >= 0)
+        close(cur_sock);
+
+    if (expect_ok)
+    {
+        // more drops than the retry budget, every one must be resumed
+        ok = finished && updated && !failed && image_ok(size) && max_write <= HTTP_FOTA_BLOCK_SIZE &&
+             drops > HTTP_RESUME_MAX_RETRY && sockets >= drops + 1 && g_FOTA_DownloadStats.bodyBytes == size;
+    }
+    else
+    {
+        // one drop with progress, then HTTP_RESUME_MAX_RETRY reconnects that bring nothing
+        ok = failed && !finished && written == step && image_ok(step) && sockets == 1 + HTTP_RESUME_MAX_RETRY &&
+             NULL == httpMainContext.http_socketdata_p;
+    }
+    printf("%-8s %7u bytes, %2u connects, %u timeouts, %7u written, %6.0f ms%s\n",
+           kind, size, sockets, timer_fired, written, t, ok ? "" : "  FAILED");
+    return !ok;
+}
+
+int main(int argc, char **argv)
+{
+    int failed_checks = 0;
+    port = argc > 1 ? atoi(argv[1]) : 18081;
+
+    failed_checks += run("range", 300017, 40000, TRUE);
+    failed_checks += run("chunked", 300017, 40000, TRUE);
+    failed_checks += run("norange", 300017, 40000, TRUE);
+    failed_checks += run("stall", 150000, 20000, TRUE);
+    failed_checks += run("dead", 300017, 40960, FALSE);
+
+    if (failed_checks)
+    {
+        printf("%d checks failed\n", failed_checks);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
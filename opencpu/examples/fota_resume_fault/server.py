@@ -0,0 +1,129 @@
+#
+# HTTP server stub for fota_resume_fault.c
+#
+#   python3 server.py [port]
+#
+# One thread per connection, one request per connection. Image byte i is
+# (i * 31 + 7) & 0xFF everywhere. Every path is /<kind>/<size>/<step>: the
+# link drops each time the image offset reaches a multiple of <step>, so a
+# request with "Range: bytes=<start>-" gets the bytes up to the next
+# multiple and the connection goes away. Drops alternate between a plain
+# close and a reset (RST), which may lose bytes already sent.
+#
+#   GET /range/N/S     206 with Content-Length for a Range request
+#   GET /chunked/N/S   206 chunked, the drop lands inside a chunk
+#   GET /norange/N/S   ignores Range, always 200 from byte 0
+#   GET /stall/N/S     206, at a drop the server stops sending but keeps
+#                      the connection open
+#   GET /dead/N/S      the first request drops at S with a plain close,
+#                      every later one gets a 206 head and a close, no
+#                      image bytes
+#
+# Writes go out in random pieces so the client sees every kind of split.
+#
+
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+
+
+def pattern(start, end):
+    return bytes(((start + i) * 31 + 7) & 0xFF for i in range(end - start))
+
+
+def send_pieces(c, data, rnd):
+    off = 0
+    while off < len(data):
+        n = rnd.randint(1, 4096)
+        c.sendall(data[off:off + n])
+        off += n
+
+
+def read_request(c):
+    data = b''
+    while b'\r\n\r\n' not in data:
+        d = c.recv(4096)
+        if not d:
+            return None, None
+        data += d
+    lines = data.split(b'\r\n\r\n', 1)[0].decode('latin-1').split('\r\n')
+    start = 0
+    for line in lines[1:]:
+        k, v = line.split(':', 1)
+        if k.strip().lower() == 'range':
+            start = int(v.strip()[len('bytes='):].rstrip('-'))
+    return lines[0].split(' ')[1], start
+
+
+def chunked(start, end, size, rnd):
+    # chunks from start to size, cut off at end if that is short of size
+    out, off = [], start
+    while off < size:
+        n = rnd.randint(1, 3000)
+        n = min(n, size - off)
+        out.append(b'%x\r\n' % n)
+        if off + n > end:
+            out.append(pattern(off, end))
+            return b''.join(out)
+        out.append(pattern(off, off + n) + b'\r\n')
+        off += n
+    out.append(b'0\r\n\r\n')
+    return b''.join(out)
+
+
+def serve(c, seed):
+    rnd = random.Random(seed)
+    path = '?'
+    try:
+        path, start = read_request(c)
+        if path is None:
+            return
+        kind, size, step = path.strip('/').split('/')
+        size, step = int(size), int(step)
+        end = min(size, (start // step + 1) * step)
+        if kind == 'dead' and start > 0:
+            end = start
+        if kind == 'norange':
+            head = b'HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n' % size
+            data = head + pattern(0, end)
+        elif kind == 'chunked':
+            head = b'HTTP/1.1 206 Partial Content\r\nTransfer-Encoding: chunked\r\n\r\n'
+            data = head + chunked(start, end, size, rnd)
+        else:
+            head = b'HTTP/1.1 206 Partial Content\r\nContent-Length: %d\r\n' \
+                b'Content-Range: bytes %d-%d/%d\r\n\r\n' % (size - start, start, size - 1, size)
+            data = head + pattern(start, end)
+        send_pieces(c, data, rnd)
+        print('GET %s from %d, sent to %d' % (path, start, end))
+        sys.stdout.flush()
+        if end < size:
+            if kind == 'stall':
+                time.sleep(30)
+            elif seed % 2 and kind != 'dead':
+                c.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack('ii', 1, 0))
+    except (BrokenPipeError, ConnectionResetError):
+        print('GET %s: client went away' % path)
+    finally:
+        c.close()
+
+
+def main():
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 18081
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.bind(('127.0.0.1', port))
+    s.listen(4)
+    print('listening on %d' % port)
+    sys.stdout.flush()
+    seed = 0
+    while True:
+        c, _ = s.accept()
+        seed += 1
+        threading.Thread(target=serve, args=(c, seed), daemon=True).start()
+
+
+if __name__ == '__main__':
+    main()
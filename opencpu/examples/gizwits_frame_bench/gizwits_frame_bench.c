@@ -0,0 +1,189 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   gizwits_frame_bench.c
+ *
+ * Description:
+ * ------------
+ *   Round trip and speed of the GizWits MCU frame escaping. Random frames
+ *   with 0..100% 0xFF bytes are stuffed with Gagent_Local_DataAdapter,
+ *   fed through the UART ring in random chunks and unstuffed again with
+ *   HAL_Local_ExtractOnePacket, every packet must come back unchanged.
+ *   The real gagent.c and hal_uart.c are built for the host, only the
+ *   UART read and the allocator are stubbed:
+ *
+ *   P=../../m66    # or ../../mc60
+ *   G=$P/cloud/entity/gitwizs
+ *   gcc -O2 -ffunction-sections -fdata-sections \
+ *       -D__OCPU_SMART_CLOUD_SUPPORT__ -D__GITWIZS_SOLUTION__ \
+ *       -I../../../templates/m66 -I$G/inc -I$P/include -I$P/ril/inc \
+ *       -I$P/cloud/protocol/mqtt/inc gizwits_frame_bench.c \
+ *       $G/src/gagent.c $G/src/hal_uart.c -Wl,--gc-sections \
+ *       -o gizwits_frame_bench
+ *   ./gizwits_frame_bench [frames]
+ *
+ *   The bench compares the encoder against the old one shift per 0xFF
+ *   loop (still in gagent.c as GAgent_MoveOneByte).
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "custom_feature_def.h"
+#include "gagent_typedef.h"
+#include "gagent.h"
+#include "adapter.h"
+#include "hal_uart.h"
+
+#define PAYLOAD_MAX 400 /* stuffed frame stays below HAL_BUF_SIZE */
+#define CHUNK_MAX   64
+
+static const u8 *feed;
+static u32 feed_len;
+
+/* stubs for what the two files call on the way */
+void *Adapter_Mem_Alloc(u32 size)
+{
+    return malloc(size);
+}
+
+void Adapter_Sleep(u32 msec)
+{
+}
+
+s32 Adapter_UART_Read(s32 fd, u8 *data, u32 readlen)
+{
+    if (readlen > feed_len)
+        readlen = feed_len;
+    memcpy(data, feed, readlen);
+    feed += readlen;
+    feed_len -= readlen;
+    return readlen;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the encoder before the single pass version */
+static s32 adapter_old(u8 *pData, s32 dataLen)
+{
+    s32 i = 0, j = 0, len = 2 + dataLen;
+    for (i = 0; i < dataLen; i++)
+    {
+        if (0xFF == pData[i])
+        {
+            GAgent_MoveOneByte(&pData[i + 1], (dataLen - i), 0);
+            pData[i + 1] = 0x55;
+            j++;
+            dataLen++;
+        }
+    }
+    return len + j;
+}
+
+/* FF FF, length of the rest, data with about ff_pct percent 0xFF */
+static int make_packet(u8 *pkt, int n, int ff_pct)
+{
+    int i;
+    pkt[0] = pkt[1] = 0xFF;
+    pkt[2] = (n - 2) >> 8;
+    pkt[3] = (n - 2) & 0xFF;
+    for (i = 4; i < n + 2; i++)
+        pkt[i] = rand() % 100 < ff_pct ? 0xFF : rand();
+    return n + 2;
+}
+
+static int frame_of(u8 *frame, const u8 *pkt, int len)
+{
+    memcpy(frame, pkt, len);
+    return Gagent_Local_DataAdapter(frame + 2, len - 2);
+}
+
+/* pushes the frame in random chunks, returns the packets extracted */
+static int feed_frame(const u8 *frame, int len, u8 *out, int *out_len)
+{
+    gcontext gc;
+    int off = 0, packets = 0;
+    gc.rtinfo.local.uart_fd = 0;
+    while (off < len)
+    {
+        int r, c = 1 + rand() % CHUNK_MAX;
+        if (c > len - off)
+            c = len - off;
+        feed = frame + off;
+        feed_len = c;
+        while (feed_len)
+            off += Hal_Rcv_Data_Handle(&gc);
+        while ((r = HAL_Local_ExtractOnePacket(out)) > 0)
+        {
+            *out_len = r;
+            packets++;
+        }
+    }
+    return packets;
+}
+
+static void check(int frames)
+{
+    static u8 pkt[2 * PAYLOAD_MAX + 8], frame[2 * PAYLOAD_MAX + 8], out[2 * PAYLOAD_MAX + 8];
+    long bytes = 0, escaped = 0;
+    int k;
+    for (k = 0; k < frames; k++)
+    {
+        int out_len = 0;
+        int len = make_packet(pkt, 3 + rand() % (PAYLOAD_MAX - 2), rand() % 5 * 25);
+        int flen = frame_of(frame, pkt, len);
+        if (1 != feed_frame(frame, flen, out, &out_len) || out_len != len || memcmp(out, pkt, len))
+        {
+            printf("frame %d (%d bytes, %d stuffed): %d bytes back\n", k, len, flen, out_len);
+            exit(1);
+        }
+        bytes += len;
+        escaped += flen - len;
+    }
+    printf("%d frames, %ld bytes, %ld escapes, all unstuffed unchanged\n", frames, bytes, escaped);
+}
+
+static void bench(int ff_pct)
+{
+    static u8 pkt[2 * PAYLOAD_MAX + 8], frame[2 * PAYLOAD_MAX + 8], out[2 * PAYLOAD_MAX + 8];
+    int len = make_packet(pkt, 200, ff_pct), flen = 0, out_len, k, n = 20000;
+    double t_old, t_new, t_dec;
+
+    t_old = now();
+    for (k = 0; k < n; k++)
+    {
+        memcpy(frame, pkt, len);
+        flen = adapter_old(frame + 2, len - 2);
+    }
+    t_old = (now() - t_old) / n;
+    t_new = now();
+    for (k = 0; k < n; k++)
+        flen = frame_of(frame, pkt, len);
+    t_new = (now() - t_new) / n;
+    t_dec = now();
+    for (k = 0; k < n; k++)
+        feed_frame(frame, flen, out, &out_len);
+    t_dec = (now() - t_dec) / n;
+    printf("%3d%% 0xFF  %4d bytes on the wire  encode %6.2f -> %5.2f us  decode %6.2f us\n",
+           ff_pct, flen, t_old * 1e6, t_new * 1e6, t_dec * 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 100000;
+    gcontext gc;
+    srand(1);
+    Hal_UartBuffer_Init(&gc);
+    check(frames);
+    bench(0);
+    bench(10);
+    bench(50);
+    bench(100);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   mqtt_sendpkt_counters.c
+ *
+ * Description:
+ * ------------
+ *   Counts what packing and sending MQTT packets costs: Ql_MEM_Alloc calls,
+ *   writev calls (one socket send each) and the fragments handed to them.
+ *   A steady stream of QoS0 publishes must not touch the heap after the
+ *   arena of the first one and must go out in one writev of three
+ *   fragments. Short writes are resumed with the offset Mqtt_SendPkt takes,
+ *   the bytes on the wire must match what was packed, and an offset at or
+ *   past the end of the packet sends nothing and returns 0. A packet of
+ *   more extents than the embedded iovec slots takes one alloc and one
+ *   free. mqttbuffer.c and mqttlib_ext.c are built as they are, only the
+ *   OS is stubbed:
+ *
+ *   P=../../m66    # or ../../mc60
+ *   M=$P/cloud/protocol/mqtt
+ *   gcc -O2 -D__OCPU_SMART_CLOUD_SUPPORT__ -I../../../templates/m66 \
+ *       -I$P/include -I$M/inc -I$M/src mqtt_sendpkt_counters.c \
+ *       -o mqtt_sendpkt_counters
+ *   ./mqtt_sendpkt_counters [publishes]
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "custom_feature_def.h"
+#include "ql_type.h"
+
+static unsigned int allocs, frees;
+static unsigned int writevs, fragments, cap;
+static char wire[4096];
+static unsigned int wire_len;
+
+/* stubs for what the two files call on the way */
+void *Ql_MEM_Alloc(u32 size) { ++allocs; return malloc(size); }
+void Ql_MEM_Free(void *ptr) { ++frees; free(ptr); }
+void *Ql_memcpy(void *dest, const void *src, u32 size) { return memcpy(dest, src, size); }
+void *Ql_memmove(void *dest, const void *src, u32 size) { return memmove(dest, src, size); }
+void *Ql_memset(void *dest, u8 value, u32 size) { return memset(dest, value, size); }
+u32 Ql_strlen(const char *str) { return strlen(str); }
+char *Ql_strstr(const char *s1, const char *s2) { return strstr(s1, s2); }
+u64 Ql_GetMsSincePwrOn(void) { return 0; }
+s32 (*Ql_Debug_Trace)(char *fmt, ...) = (void *)printf;
+
+#include "mqttbuffer.c"
+#include "mqttlib_ext.c"
+
+/* the socket: takes at most cap bytes per call when cap is set */
+static int count_writev(void *arg, const struct iovec *iov, int iovcnt)
+{
+    unsigned int n = 0, room = cap ? cap : sizeof(wire);
+    int i;
+    ++writevs;
+    fragments += iovcnt;
+    for (i = 0; i < iovcnt && n < room; i++)
+    {
+        unsigned int len = iov[i].iov_len < room - n ? iov[i].iov_len : room - n;
+        memcpy(wire + wire_len + n, iov[i].iov_base, len);
+        n += len;
+    }
+    wire_len += n;
+    return n;
+}
+
+/* resumes from the bytes already written like the callers do */
+static int send_all(struct MqttContext *ctx, struct MqttBuffer *buf)
+{
+    unsigned int sent = 0;
+    int ret;
+    wire_len = 0;
+    while (sent < buf->buffered_bytes)
+    {
+        ret = Mqtt_SendPkt(ctx, buf, sent);
+        if (ret <= 0)
+            return -1;
+        sent += ret;
+    }
+    return sent;
+}
+
+static int expect(int ok, const char *what)
+{
+    if (!ok)
+        printf("FAILED: %s\n", what);
+    return !ok;
+}
+
+int main(int argc, char **argv)
+{
+    int publishes = argc > 1 ? atoi(argv[1]) : 10000;
+    static const char topic[] = "$sys/1234/device-1/dp/post/json";
+    static char payload[200];
+    struct MqttContext ctx;
+    struct MqttBuffer buf;
+    unsigned int a, w, f, packed;
+    int failed = 0, i;
+
+    memset(payload, 'p', sizeof(payload));
+    Mqtt_InitContext(&ctx, 256);
+    ctx.writev_func = count_writev;
+    MqttBuffer_Init(&buf);
+
+    /* warm up: the first packet allocates the arena */
+    Mqtt_PackPublishPkt(&buf, 1, topic, payload, sizeof(payload), MQTT_QOS_LEVEL0, 0, 0);
+    failed += expect(send_all(&ctx, &buf) == (int)buf.buffered_bytes, "first publish");
+    MqttBuffer_Reset(&buf);
+
+    /* steady state */
+    a = allocs;
+    writevs = fragments = 0;
+    for (i = 0; i < publishes; i++)
+    {
+        MqttBuffer_Reset(&buf);
+        if (Mqtt_PackPublishPkt(&buf, 1, topic, payload, 1 + i % sizeof(payload), MQTT_QOS_LEVEL0, 0, 0) < 0 ||
+            send_all(&ctx, &buf) != (int)buf.buffered_bytes)
+        {
+            failed += expect(0, "steady state publish");
+            break;
+        }
+    }
+    printf("%d QoS0 publishes: %u allocs, %u writev, %u fragments\n",
+           publishes, allocs - a, writevs, fragments);
+    failed += expect(allocs == a, "no allocation in the steady state");
+    failed += expect(writevs == (unsigned)publishes, "one writev per publish");
+    failed += expect(fragments == 3u * publishes, "three fragments per publish");
+
+    /* short writes, resumed at every offset */
+    MqttBuffer_Reset(&buf);
+    Mqtt_PackPublishPkt(&buf, 1, topic, payload, sizeof(payload), MQTT_QOS_LEVEL0, 0, 0);
+    packed = buf.buffered_bytes;
+    for (cap = 1; cap <= 64; cap++)
+    {
+        a = allocs;
+        writevs = 0;
+        if (send_all(&ctx, &buf) != (int)packed || wire_len != packed ||
+            writevs != (packed + cap - 1) / cap || allocs != a ||
+            memcmp(wire + wire_len - sizeof(payload), payload, sizeof(payload)) ||
+            memcmp(wire + buf.first_ext->len + 2, topic, sizeof(topic) - 1))
+        {
+            printf("cap %u: ", cap);
+            failed += expect(0, "resume after a short write");
+        }
+    }
+    cap = 0;
+    printf("short writes of 1..64 bytes resumed, %u byte packet intact\n", packed);
+
+    /* nothing left to send */
+    w = writevs;
+    failed += expect(0 == Mqtt_SendPkt(&ctx, &buf, packed), "offset == buffered_bytes returns 0");
+    failed += expect(0 == Mqtt_SendPkt(&ctx, &buf, packed + 10), "offset past the end returns 0");
+    buf.buffered_bytes += 5; /* counted, but in no extent */
+    failed += expect(0 == Mqtt_SendPkt(&ctx, &buf, packed), "offset past the last extent returns 0");
+    failed += expect(writevs == w, "no writev when nothing is left");
+
+    /* more extents than the embedded iovec slots */
+    MqttBuffer_Reset(&buf);
+    Mqtt_PackSubscribePkt(&buf, 2, "a/1", MQTT_QOS_LEVEL1);
+    Mqtt_AppendSubscribeTopic(&buf, "a/2", MQTT_QOS_LEVEL1);
+    Mqtt_AppendSubscribeTopic(&buf, "a/3", MQTT_QOS_LEVEL1);
+    Mqtt_AppendSubscribeTopic(&buf, "a/4", MQTT_QOS_LEVEL1);
+    a = allocs;
+    f = frees;
+    fragments = 0;
+    failed += expect(buf.ext_count > MQTT_BUFFER_IOV_COUNT, "subscribe spills the iovec slots");
+    failed += expect(send_all(&ctx, &buf) == (int)buf.buffered_bytes, "subscribe sent");
+    failed += expect(allocs - a == 1 && frees - f == 1 && fragments == buf.ext_count,
+                     "one iovec allocation, freed");
+    printf("subscribe of %u extents: %u alloc, %u free\n", buf.ext_count, allocs - a, frees - f);
+
+    MqttBuffer_Destroy(&buf);
+    Mqtt_DestroyContext(&ctx);
+    failed += expect(allocs == frees, "everything freed");
+    if (failed)
+    {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,297 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   ril_findline_bench.c
+ *
+ * Description:
+ * ------------
+ *   Unit tests and throughput of Ql_RIL_FindLine, Ql_RIL_FindString and
+ *   Ql_RIL_FindFinalResult. The implementations before the single scan
+ *   are kept here as the reference: fixed cases check each terminator
+ *   form and the precedence of <CR><LF>str<CR><LF>, random lines over a
+ *   small alphabet must give the same pointer from both, and
+ *   Ql_RIL_FindFinalResult must agree with the chained lookups of
+ *   Default_atRsp_callback. Then it reports the time per call and the
+ *   Ql_MEM_Alloc calls of both on typical responses. ril_util.c is built
+ *   as it is, only the OS is stubbed:
+ *
+ *   P=../../m66    # or ../../mc60, ../../bc66/SDK15
+ *   gcc -O2 -I$P/include -I$P/ril/inc -I$P/ril/src ril_findline_bench.c \
+ *       -o ril_findline_bench
+ *   ./ril_findline_bench [rounds]
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "ql_type.h"
+
+static unsigned int allocs;
+
+/* stubs for what ril_util.c and the reference call */
+void *Ql_MEM_Alloc(u32 size) { ++allocs; return malloc(size); }
+void Ql_MEM_Free(void *ptr) { free(ptr); }
+void *Ql_memset(void *dest, u8 value, u32 size) { return memset(dest, value, size); }
+s32 Ql_memcmp(const void *dest, const void *src, u32 size) { return memcmp(dest, src, size); }
+u32 Ql_strlen(const char *str) { return strlen(str); }
+s32 Ql_strncmp(const char *s1, const char *s2, u32 size) { return strncmp(s1, s2, size); }
+s32 Ql_toupper(s32 c) { return toupper(c); }
+s32 (*Ql_sprintf)(char *, const char *, ...) = (void *)sprintf;
+
+#include "ril_util.c"
+
+/* Ql_RIL_FindString before the first byte filter */
+static char *old_FindString(char *line, u32 len, char *str)
+{
+    s32 i;
+    s32 strlen;
+    char *p;
+
+    if ((NULL == line) || (NULL == str))
+        return NULL;
+    strlen = Ql_strlen(str);
+    if (strlen > len)
+        return NULL;
+    p = line;
+    for (i = 0; i < len - strlen + 1; i++)
+    {
+        if (0 == Ql_strncmp(p, str, strlen))
+            return p;
+        p++;
+    }
+    return NULL;
+}
+
+/* Ql_RIL_FindLine before the single scan */
+static char *old_FindLine(char *line, u32 len, char *str)
+{
+    s32 i = 0;
+    s32 strlen = 0;
+    char *p = NULL;
+    char *pStr = NULL;
+    char *pStr2 = NULL;
+    char *pStr3 = NULL;
+
+    if ((NULL == line) || (NULL == str))
+        return NULL;
+    strlen = Ql_strlen(str);
+    pStr = Ql_MEM_Alloc(strlen + 4 + 1);
+    if (NULL == pStr)
+        return NULL;
+    if (len >= strlen + 4)
+    {
+        p = line;
+        Ql_memset(pStr, 0, strlen + 5);
+        Ql_sprintf(pStr, "\r\n%s\r\n", str);
+        for (i = 0; i < len - (strlen + 4) + 1; i++)
+        {
+            if (0 == Ql_strncmp(p, pStr, strlen + 4))
+            {
+                Ql_MEM_Free(pStr);
+                return p;
+            }
+            p++;
+        }
+    }
+    if (len >= strlen + 2)
+    {
+        p = line;
+        Ql_memset(pStr, 0, strlen + 5);
+        Ql_sprintf(pStr, "\r%s\r", str);
+        pStr2 = (char *)Ql_MEM_Alloc(strlen + 5);
+        Ql_memset(pStr2, 0, strlen + 5);
+        Ql_sprintf(pStr2, "\n%s\n", str);
+        pStr3 = (char *)Ql_MEM_Alloc(strlen + 5);
+        Ql_memset(pStr3, 0, strlen + 5);
+        Ql_sprintf(pStr3, "%s\r\n", str);
+        for (i = 0; i < len - (strlen + 2) + 1; i++)
+        {
+            if ((0 == Ql_strncmp(p, pStr, strlen + 2)) ||
+                (0 == Ql_strncmp(p, pStr2, strlen + 2)) ||
+                (0 == Ql_strncmp(p, pStr3, strlen + 2)))
+            {
+                Ql_MEM_Free(pStr);
+                Ql_MEM_Free(pStr2);
+                Ql_MEM_Free(pStr3);
+                return p;
+            }
+            p++;
+        }
+        Ql_MEM_Free(pStr2);
+        Ql_MEM_Free(pStr3);
+    }
+    Ql_MEM_Free(pStr);
+    return NULL;
+}
+
+/* what Default_atRsp_callback did before Ql_RIL_FindFinalResult */
+static Enum_RILFinalResult old_FinalResult(char *line, u32 len)
+{
+    if (old_FindLine(line, len, "OK"))
+        return RIL_FINAL_OK;
+    if (old_FindLine(line, len, "ERROR"))
+        return RIL_FINAL_ERROR;
+    if (old_FindString(line, len, "+CME ERROR:"))
+        return RIL_FINAL_CME_ERROR;
+    if (old_FindString(line, len, "+CMS ERROR:"))
+        return RIL_FINAL_CMS_ERROR;
+    return RIL_FINAL_NONE;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int failed;
+
+static void expect_line(const char *line, const char *str, int at)
+{
+    char *p = Ql_RIL_FindLine((char *)line, strlen(line), (char *)str);
+    int got = p ? (int)(p - line) : -1;
+    if (got != at)
+    {
+        printf("FindLine(\"%s\") in \"", str);
+        for (; *line; line++)
+            printf(*line == '\r' ? "<CR>" : *line == '\n' ? "<LF>" : "%c", *line);
+        printf("\": %d, expected %d\n", got, at);
+        failed++;
+    }
+}
+
+static void expect_final(const char *line, Enum_RILFinalResult result)
+{
+    Enum_RILFinalResult got = Ql_RIL_FindFinalResult((char *)line, strlen(line));
+    if (got != result)
+    {
+        printf("FindFinalResult(\"");
+        for (; *line; line++)
+            printf(*line == '\r' ? "<CR>" : *line == '\n' ? "<LF>" : "%c", *line);
+        printf("\"): %d, expected %d\n", got, result);
+        failed++;
+    }
+}
+
+static void unit_tests(void)
+{
+    char buf[16] = "xxOKyy";
+
+    /* each form, and <CR><LF>str<CR><LF> over an earlier shorter one */
+    expect_line("\r\nOK\r\n", "OK", 0);
+    expect_line("+CSQ: 23,0\r\n\r\nOK\r\n", "OK", 12);
+    expect_line("\rOK\r", "OK", 0);
+    expect_line("\nOK\n", "OK", 0);
+    expect_line("OK\r\n", "OK", 0);
+    expect_line("ab\rOK\rcd\r\nOK\r\n", "OK", 8);
+    expect_line("OK\r\n\r\nOK\r\n", "OK", 4);
+    expect_line("\nOK\n\rOK\r", "OK", 0);
+    /* no line of its own */
+    expect_line("\r\nOKAY\r\n", "OK", -1);
+    expect_line("\r\nBOOK\r\n", "OK", 4); /* str<CR><LF> needs no line start */
+    expect_line("\r\nOK", "OK", -1);
+    expect_line("\rOK\n", "OK", -1);
+    expect_line("OK", "OK", -1);
+    expect_line("", "OK", -1);
+    expect_line("\r\nERROR\r\n", "ERROR", 0);
+    expect_line("\r\n+CME ERROR: 10\r\n", "ERROR", -1);
+    /* len bounds the search, the bytes past it are not looked at */
+    if (Ql_RIL_FindLine("OK\r\n", 3, "OK") || Ql_RIL_FindLine("\r\nOK\r\n", 5, "OK"))
+        failed++, printf("FindLine looked past len\n");
+    if (Ql_RIL_FindString(buf, 3, "OK") || Ql_RIL_FindString(buf, 4, "OK") != buf + 2)
+        failed++, printf("FindString len bounds\n");
+    if (Ql_RIL_FindString(buf, 6, "xxOKyyz") || Ql_RIL_FindString(buf, 6, "") != buf ||
+        Ql_RIL_FindString(NULL, 6, "OK") || Ql_RIL_FindLine(buf, 6, NULL))
+        failed++, printf("FindString edge cases\n");
+
+    expect_final("\r\nOK\r\n", RIL_FINAL_OK);
+    expect_final("\r\nERROR\r\n", RIL_FINAL_ERROR);
+    expect_final("ERROR\r\n", RIL_FINAL_ERROR);
+    expect_final("\r\n+CME ERROR: 10\r\n", RIL_FINAL_CME_ERROR);
+    expect_final("+CMS ERROR: 300\r\n", RIL_FINAL_CMS_ERROR);
+    expect_final("\r\n+CME ERROR: 3\r\n\r\nOK\r\n", RIL_FINAL_OK);
+    expect_final("\r\n+CMS ERROR: 3\r\n+CME ERROR: 4\r\n", RIL_FINAL_CME_ERROR);
+    expect_final("\r\nOKAY\r\n", RIL_FINAL_NONE);
+    expect_final("\r\n+CREG: 1,5\r\n", RIL_FINAL_NONE);
+    expect_final("OK", RIL_FINAL_NONE);
+    if (RIL_FINAL_NONE != Ql_RIL_FindFinalResult(NULL, 4))
+        failed++, printf("FindFinalResult(NULL)\n");
+}
+
+/* random lines over the bytes that matter, the old and the new must agree */
+static void differential(unsigned int lines)
+{
+    static const char alphabet[] = "\r\n\r\nOKERO+CMES :1x";
+    static char *strs[] = {"OK", "ERROR", "+CME ERROR:", "+CMS ERROR:", "E", "OKOK", "\r"};
+    char line[64];
+    unsigned int i, k, mismatches = 0;
+
+    srand(3);
+    for (i = 0; i < lines; i++)
+    {
+        u32 len = rand() % sizeof(line);
+        for (k = 0; k < len; k++)
+            line[k] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        for (k = 0; k < sizeof(strs) / sizeof(strs[0]); k++)
+        {
+            mismatches += Ql_RIL_FindLine(line, len, strs[k]) != old_FindLine(line, len, strs[k]);
+            mismatches += Ql_RIL_FindString(line, len, strs[k]) != old_FindString(line, len, strs[k]);
+        }
+        mismatches += Ql_RIL_FindFinalResult(line, len) != old_FinalResult(line, len);
+    }
+    printf("%u random lines, %u mismatches\n", lines, mismatches);
+    failed += mismatches != 0;
+}
+
+static void bench(const char *name, char *line, int rounds)
+{
+    u32 len = strlen(line);
+    volatile int sink = 0;
+    unsigned int a;
+    double t[2];
+    int r;
+
+    allocs = 0;
+    t[0] = now();
+    for (r = 0; r < rounds; r++)
+        sink += old_FinalResult(line, len);
+    t[0] = now() - t[0];
+    a = allocs;
+    allocs = 0;
+    t[1] = now();
+    for (r = 0; r < rounds; r++)
+        sink += Ql_RIL_FindFinalResult(line, len);
+    t[1] = now() - t[1];
+    printf("%-22s %4u bytes  chained %8.0f ns %u allocs  one scan %6.0f ns %u allocs  x%.1f\n",
+           name, len, t[0] * 1e9 / rounds, a / rounds, t[1] * 1e9 / rounds, allocs / rounds, t[0] / t[1]);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 200000;
+    static char qeng[512];
+    int i;
+
+    unit_tests();
+    differential(200000);
+
+    for (i = 0; i < 6; i++)
+        strcat(qeng, "+QENG: 1,460,00,1234,5678,38,51,-77,42,33,x,x,x,x\r\n");
+    strcat(qeng, "\r\nOK\r\n");
+    bench("OK", "\r\nOK\r\n", rounds);
+    bench("+CSQ, OK", "\r\n+CSQ: 23,0\r\n\r\nOK\r\n", rounds);
+    bench("+CME ERROR", "\r\n+CME ERROR: 10\r\n", rounds);
+    bench("URC, no result", "\r\n+CREG: 1,\"1234\",\"5678\"\r\n", rounds);
+    bench("+QENG, 6 lines, OK", qeng, rounds / 10);
+
+    if (failed)
+    {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,236 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   ril_socket_urc_replay.c
+ *
+ * Description:
+ * ------------
+ *   Replays recorded +QIURC "recv" / "closed" URCs of the BC66 through the
+ *   real URC handler and checks what ends up in the receive rings: text
+ *   data with CRLF and commas, hex and quoted hex data, coalesced
+ *   URC_SOCKET_RECV messages, truncated URCs, ring overflow with wrap
+ *   around, bad connect ids and the purge on RIL_SOC_QICLOSE. Sends
+ *   without RIL_SOC_Initialize must work as before it existed. Then it
+ *   reports how many 700 byte hex URCs per second the handler decodes.
+ *   ril_socket.c and ril_urc.c are included as they are, only the OS and
+ *   the AT channel are stubbed:
+ *
+ *   S=../../bc66/SDK15
+ *   gcc -O2 -D__OCPU_RIL_SOCKET_SUPPORT__ -I../../../templates/bc66 \
+ *       -I$S/include -I$S/ril/inc -I$S/ril/src \
+ *       ril_socket_urc_replay.c -o ril_socket_urc_replay
+ *   ./ril_socket_urc_replay [urcs]
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ql_type.h"
+#include "ql_stdlib.h"
+#include "ril.h"
+
+#define URC_MAX 4096
+
+static u32 msgs[64][3];
+static int msg_count;
+static s32 at_ret;
+
+/* stubs for what the two files call on the way */
+s32 Ql_OS_SendMessage(s32 destTaskId, u32 msgId, u32 param1, u32 param2)
+{
+    if (msg_count < 64)
+    {
+        msgs[msg_count][0] = msgId;
+        msgs[msg_count][1] = param1;
+        msgs[msg_count][2] = param2;
+    }
+    msg_count++;
+    return 0;
+}
+
+static char at_line[4096];
+
+s32 Ql_RIL_SendATCmd(char *atCmd, u32 atCmdLen, Callback_ATResponse atRsp_callBack, void *userData, u32 timeOut)
+{
+    memcpy(at_line, atCmd, atCmdLen);
+    at_line[atCmdLen] = 0;
+    return at_ret;
+}
+
+char *Ql_RIL_FindLine(char *line, u32 len, char *str) { return NULL; }
+char *Ql_RIL_FindString(char *line, u32 len, char *str) { return NULL; }
+s32 RIL_SIM_GetSimStateByName(char *simStat, u32 len) { return 0; }
+s32 Ql_StrPrefixMatch(const char *str, const char *prefix) { return 0; }
+
+static int mutexes;
+u32 Ql_OS_CreateMutex(void) { return ++mutexes; }
+void Ql_OS_DeleteMutex(u32 mutexId) { mutexes--; }
+bool Ql_OS_TakeMutex(u32 mutexId, u32 block_time) { return TRUE; }
+bool Ql_OS_GiveMutex(u32 mutexId) { return TRUE; }
+
+void *Ql_memcpy(void *dest, const void *src, u32 size) { return memcpy(dest, src, size); }
+void *Ql_memset(void *dest, u8 value, u32 size) { return memset(dest, value, size); }
+s32 Ql_memcmp(const void *dest, const void *src, u32 size) { return memcmp(dest, src, size); }
+u32 Ql_strlen(const char *str) { return strlen(str); }
+s32 Ql_atoi(const char *s) { return atoi(s); }
+char *Ql_strstr(const char *s1, const char *s2) { return strstr(s1, s2); }
+char *Ql_strchr(const char *s1, s32 ch) { return strchr(s1, ch); }
+s32 Ql_strncmp(const char *s1, const char *s2, u32 size) { return strncmp(s1, s2, size); }
+s32 (*Ql_sprintf)(char *, const char *, ...) = (void *)sprintf;
+
+bool QSDK_Get_Str(char *src, char *dest, unsigned char index)
+{
+    char *p = src;
+    int i = 0;
+    while (index-- && (p = strchr(p, ',')))
+        p++;
+    if (!p)
+        return FALSE;
+    while (p[i] && p[i] != ',')
+    {
+        dest[i] = p[i];
+        i++;
+    }
+    dest[i] = 0;
+    return TRUE;
+}
+
+#include "ril_socket.c"
+#include "ril_urc.c"
+
+static int failed;
+
+#define CHECK(c)                                                  \
+    do                                                            \
+    {                                                             \
+        if (!(c))                                                 \
+        {                                                         \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); \
+            failed++;                                             \
+        }                                                         \
+    } while (0)
+
+/* the handler parses in place, like the URC buffer of the RIL task */
+static void replay(const char *urc)
+{
+    static char line[URC_MAX + 64];
+    strcpy(line, urc);
+    OnURCHandler_SOCKET_QIURC(line, NULL);
+}
+
+static char *hex_urc(char *urc, u8 connectID, int length, int first)
+{
+    char *p = urc + sprintf(urc, "\r\n+QIURC: \"recv\",%d,%d,", connectID, length);
+    int i;
+    for (i = 0; i < length; i++)
+        p += sprintf(p, "%02X", (first + i) & 0xFF);
+    strcpy(p, "\r\n");
+    return urc;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void check(void)
+{
+    static char urc[URC_MAX];
+    u8 out[URC_MAX];
+    s32 n;
+    int before;
+
+    /* no RIL_SOC_Initialize, the first send creates the lock */
+    at_ret = RIL_AT_SUCCESS;
+    CHECK(RIL_SOC_QISEND(0, 5, (u8 *)"hello") == RIL_AT_SUCCESS && mutexes == 1);
+    CHECK(0 == strcmp(at_line, "AT+QISEND=0,5,\"hello\"\n"));
+    CHECK(RIL_SOC_QISENDEX(0, 2, (u8 *)"ABCD") == RIL_AT_SUCCESS && mutexes == 1);
+    CHECK(0 == strcmp(at_line, "AT+QISENDEX=0,2,\"ABCD\"\n"));
+
+    /* text mode, the data holds CRLF and commas */
+    replay("\r\n+QIURC: \"recv\",1,9,ab,\r\ncd,e\r\n");
+    CHECK(msg_count == 1 && msgs[0][1] == URC_SOCKET_RECV);
+    CHECK(SOCKET_RECV_CONNECTID(msgs[0][2]) == 1 && SOCKET_RECV_LENGTH(msgs[0][2]) == 9);
+    replay("\r\n+QIURC: \"recv\",1,3,xyz\r\n");
+    CHECK(msg_count == 1); /* coalesced, nothing read yet */
+    CHECK(RIL_SOC_RECV_Available(1) == 12);
+    n = RIL_SOC_RECV(1, out, sizeof(out));
+    CHECK(n == 12 && !memcmp(out, "ab,\r\ncd,exyz", 12));
+    CHECK(RIL_SOC_RECV(1, out, sizeof(out)) == 0);
+
+    /* hex mode, plain and quoted */
+    at_ret = RIL_AT_SUCCESS;
+    RIL_SOC_QICFG_FORMAT(0, 1);
+    CHECK(RIL_SOC_RECV_IsHex());
+    replay("\r\n+QIURC: \"recv\",0,4,00FF7a31\r\n");
+    CHECK(msg_count == 2 && SOCKET_RECV_CONNECTID(msgs[1][2]) == 0 && SOCKET_RECV_LENGTH(msgs[1][2]) == 4);
+    n = RIL_SOC_RECV(0, out, 2);
+    CHECK(n == 2 && out[0] == 0x00 && out[1] == 0xFF);
+    n = RIL_SOC_RECV(0, out, 9);
+    CHECK(n == 2 && out[0] == 0x7A && out[1] == 0x31);
+    CHECK(RIL_SOC_RECV(0, out, 9) == 0);
+    replay("\r\n+QIURC: \"recv\",0,2,\"ABCD\"\r\n");
+    CHECK(msg_count == 3);
+    n = RIL_SOC_RECV(0, out, 9);
+    CHECK(n == 2 && out[0] == 0xAB && out[1] == 0xCD);
+
+    /* a truncated URC stores what is there */
+    replay("\r\n+QIURC: \"recv\",0,10,ABCD\r\n");
+    CHECK(RIL_SOC_RECV(0, out, sizeof(out)) == 2);
+
+    /* overflow: the ring keeps the oldest bytes and counts the rest */
+    replay(hex_urc(urc, 2, 700, 0));
+    CHECK(RIL_SOC_RECV(2, out, 500) == 500);
+    replay(hex_urc(urc, 2, 700, 700));
+    replay(hex_urc(urc, 2, 700, 1400));
+    CHECK(RIL_SOC_RECV_Available(2) == SOCKET_RECV_BUFFER_LENGTH);
+    CHECK(RIL_SOC_RECV_Dropped(2) == 200 + 700 + 700 - SOCKET_RECV_BUFFER_LENGTH);
+    n = RIL_SOC_RECV(2, out, sizeof(out));
+    CHECK(n == SOCKET_RECV_BUFFER_LENGTH && out[0] == (500 & 0xFF) && out[199] == (699 & 0xFF) && out[200] == (700 & 0xFF));
+
+    /* closed still goes through, a bad connect id is ignored */
+    replay("\r\n+QIURC: \"closed\",3\r\n");
+    CHECK(msgs[msg_count - 1][1] == URC_SOCKET_CLOSE && msgs[msg_count - 1][2] == 3);
+    before = msg_count;
+    replay("\r\n+QIURC: \"recv\",9,2,ABCD\r\n");
+    CHECK(msg_count == before);
+
+    /* close purges */
+    replay("\r\n+QIURC: \"recv\",4,2,ABCD\r\n");
+    RIL_SOC_QICLOSE(4);
+    CHECK(RIL_SOC_RECV_Available(4) == 0);
+}
+
+static void bench(int urcs)
+{
+    static char urc[URC_MAX];
+    u8 out[URC_MAX];
+    double t;
+    int k;
+    hex_urc(urc, 0, 700, 0);
+    t = now();
+    for (k = 0; k < urcs; k++)
+    {
+        replay(urc);
+        RIL_SOC_RECV(0, out, sizeof(out));
+    }
+    t = now() - t;
+    printf("%d hex URCs of 700 bytes: %.0f URCs/s, %.1f MB/s decoded\n", urcs, urcs / t, urcs * 700 / t / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    int urcs = argc > 1 ? atoi(argv[1]) : 100000;
+    check();
+    if (failed)
+    {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("all URC checks passed\n");
+    bench(urcs);
+    return 0;
+}
@@ -0,0 +1,205 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   ril_urc_lookup_bench.c
+ *
+ * Description:
+ * ------------
+ *   Classifies URCs and AT responses of the BC66 with the dispatch index of
+ *   ril_urc.c and with the Ql_strstr loop it replaced, which is kept here
+ *   as the reference. Both must pick the same table entry for every
+ *   string, also when the keyword is not at the start or a string holds
+ *   two URCs. The SIM, network and CFUN handlers must still find their
+ *   value after the keyword. Then it reports lookups per second of both.
+ *   ril_urc.c is included as it is with every URC group enabled, only the
+ *   OS and the AT channel are stubbed:
+ *
+ *   S=../../bc66/SDK15
+ *   gcc -O2 -D__OCPU_RIL_SOCKET_SUPPORT__ -D__OCPU_RIL_MQTT_SUPPORT__ \
+ *       -D__OCPU_RIL_LWM2M_SUPPORT__ -D__OCPU_RIL_DFOTA_SUPPORT__ \
+ *       -I../../../templates/bc66 -I$S/include -I$S/ril/inc -I$S/ril/src \
+ *       ril_urc_lookup_bench.c -o ril_urc_lookup_bench
+ *   ./ril_urc_lookup_bench [rounds]
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ql_type.h"
+#include "ql_stdlib.h"
+#include "ril.h"
+#include "ril_socket.h"
+#include "ril_dfota.h"
+
+/* stubs for what ril_urc.c calls on the way */
+static u32 last_ind, last_value;
+s32 Ql_OS_SendMessage(s32 destTaskId, u32 msgId, u32 param1, u32 param2)
+{
+    last_ind = param1;
+    last_value = param2;
+    return 0;
+}
+s32 Ql_RIL_SendATCmd(char *atCmd, u32 atCmdLen, Callback_ATResponse atRsp_callBack, void *userData, u32 timeOut) { return 0; }
+s32 RIL_SIM_GetSimStateByName(char *simStat, u32 len) { return 5 == len && 0 == memcmp(simStat, "READY", 5) ? 1 : 0; }
+s32 Ql_StrPrefixMatch(const char *str, const char *prefix) { return 0 == strncmp(str, prefix, strlen(prefix)); }
+bool QSDK_Get_Str(char *src, char *dest, unsigned char index) { return FALSE; }
+s32 RIL_SOC_RECV_Store(u8 connectID, const char *data, u32 length, bool *notify) { return 0; }
+bool RIL_SOC_RECV_IsHex(void) { return FALSE; }
+void DFOTA_Analysis(u8 *buffer, Dfota_Upgrade_State *upgrade_state, s32 *errno) {}
+void Dfota_Upgrade_States(Dfota_Upgrade_State state, s32 errno) {}
+
+void *Ql_memcpy(void *dest, const void *src, u32 size) { return memcpy(dest, src, size); }
+void *Ql_memset(void *dest, u8 value, u32 size) { return memset(dest, value, size); }
+s32 Ql_memcmp(const void *dest, const void *src, u32 size) { return memcmp(dest, src, size); }
+u32 Ql_strlen(const char *str) { return strlen(str); }
+s32 Ql_atoi(const char *s) { return atoi(s); }
+char *Ql_strstr(const char *s1, const char *s2) { return strstr(s1, s2); }
+char *Ql_strchr(const char *s1, s32 ch) { return strchr(s1, ch); }
+s32 Ql_strncmp(const char *s1, const char *s2, u32 size) { return strncmp(s1, s2, size); }
+s32 (*Ql_sprintf)(char *, const char *, ...) = (void *)sprintf;
+
+#include "ril_urc.c"
+
+/* OnURCHandler / Ql_RIL_IsURCStr before the index */
+static const ST_URC_HDLENTRY *old_lookup(const char *strURC)
+{
+    s32 i;
+    for (i = 0; i < NUM_ELEMS(m_SysURCHdlEntry); i++)
+    {
+        if (Ql_strstr(strURC, m_SysURCHdlEntry[i].keyword))
+        {
+            return &m_SysURCHdlEntry[i];
+        }
+    }
+    for (i = 0; i < NUM_ELEMS(m_AtURCHdlEntry); i++)
+    {
+        if (Ql_strstr(strURC, m_AtURCHdlEntry[i].keyword))
+        {
+            return &m_AtURCHdlEntry[i];
+        }
+    }
+    return NULL;
+}
+
+static const char *corpus[] = {
+    /* URCs as the core passes them */
+    "\r\n+CEREG: 1\r\n",
+    "\r\n+CEREG: 5,\"1A2B\",\"0C3D4E5F\",9\r\n",
+    "\r\n+CPIN: READY\r\n",
+    "\r\n+CFUN: 1\r\n",
+    "\r\n+QNBIOTEVENT: \"ENTER PSM\"\r\n",
+    "\r\n+QIURC: \"recv\",0,4,ABCD\r\n",
+    "\r\n+QIURC: \"closed\",1\r\n",
+    "\r\n+QIOPEN: 0,0\r\n",
+    "\r\n+QIND: \"FOTA\",\"HTTPSTART\"\r\n",
+    "\r\n+QMTOPEN: 0,0\r\n",
+    "\r\n+QMTCONN: 0,0,0\r\n",
+    "\r\n+QMTSUB: 0,1,0,1\r\n",
+    "\r\n+QMTPUB: 0,2,0\r\n",
+    "\r\n+QMTUNS: 0,3,0\r\n",
+    "\r\n+QMTSTAT: 0,1\r\n",
+    "\r\n+QMTCLOSE: 0,0\r\n",
+    "\r\n+QMTDISC: 0,0\r\n",
+    "\r\n+QLWREG: 0\r\n",
+    "\r\n+QLWUPDATE: 0\r\n",
+    "\r\n+QLWDEREG: 0\r\n",
+    "\r\n+QLWURC: \"observe\",12345,0,3303,0,0\r\n",
+    "\r\n+QLWOBSRSP: 0\r\n",
+    "\r\n+QLWRDRSP: 0\r\n",
+    "\r\n+QLWWRRSP: 0\r\n",
+    "\r\n+QLWEXERSP: 0\r\n",
+    /* no URC */
+    "\r\nOK\r\n",
+    "\r\nERROR\r\n",
+    "\r\n+CSQ: 23,99\r\n",
+    "\r\n+CGATT: 1\r\n",
+    "\r\n+QIND: \"PSM\"\r\n",
+    "\r\n+CEREG 1\r\n",
+    "+CEREG: 1\r\n",
+    "",
+    /* the keyword is not at the start, or there are two */
+    "\r\n\r\n+CFUN: 0\r\n",
+    "junk\r\n+QIURC: \"closed\",2\r\n",
+    "\r\n+CSQ: 1,0\r\n+CEREG: 0\r\n",
+    "\r\n+QMTSTAT: 0,1\r\n+CPIN: NOT READY\r\n",
+    "\r\n+QLWURC: \"ping\"\r\n+QMTOPEN: 0,3\r\n",
+    "\r\n+QIURC: \"recv\",0,12,\r\n+CFUN: 1\r\n\r\n",
+};
+
+#define CORPUS (sizeof(corpus) / sizeof(corpus[0]))
+
+static const char *name(const ST_URC_HDLENTRY *entry)
+{
+    static char buf[RIL_MAX_URC_PREFIX_LEN];
+    if (NULL == entry)
+        return "none";
+    strcpy(buf, entry->keyword + 2);
+    return buf;
+}
+
+static int check_payload(const char *urc, u32 ind, u32 value)
+{
+    static char line[64];
+    strcpy(line, urc);
+    last_ind = last_value = 0xFFFF;
+    OnURCHandler(line, NULL);
+    if (last_ind == ind && last_value == value)
+        return 0;
+    printf("%s: indication %u value %u, expected %u %u\n", urc + 2, last_ind, last_value, ind, value);
+    return 1;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 200000;
+    int failed = 0, urcs = 0, r;
+    unsigned i;
+    unsigned long sum_old = 0, sum_new = 0;
+    double t_old, t_new;
+
+    for (i = 0; i < CORPUS; i++)
+    {
+        const ST_URC_HDLENTRY *a = old_lookup(corpus[i]), *b = URC_Lookup(corpus[i]);
+        if (a != b || (a != NULL) != Ql_RIL_IsURCStr(corpus[i]))
+        {
+            printf("string %u: Ql_strstr loop %s, index %s\n", i, name(a), name(b));
+            failed++;
+        }
+        urcs += a != NULL;
+    }
+    failed += check_payload("\r\n+CEREG: 5\r\n", URC_EGPRS_NW_STATE_IND, 5);
+    failed += check_payload("\r\n+CPIN: READY\r\n", URC_SIM_CARD_STATE_IND, 1);
+    failed += check_payload("\r\n+CFUN: 0\r\n", URC_CFUN_STATE_IND, 0);
+    failed += check_payload("\r\n\r\n+CFUN: 1\r\n", URC_CFUN_STATE_IND, 1);
+    if (failed)
+    {
+        printf("%d checks failed\n", failed);
+        return 1;
+    }
+    printf("%u strings, %d URCs, %u table entries: same entry as the Ql_strstr loop for all, payloads found\n",
+           (unsigned)CORPUS, urcs, (unsigned)URC_ENTRY_NUM);
+
+    t_old = now();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < CORPUS; i++)
+            sum_old += (unsigned long)old_lookup(corpus[i]);
+    t_old = now() - t_old;
+    t_new = now();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < CORPUS; i++)
+            sum_new += (unsigned long)URC_Lookup(corpus[i]);
+    t_new = now() - t_new;
+    if (sum_old != sum_new)
+        return 1;
+    printf("Ql_strstr loop %8.2f M lookups/s\n", rounds * CORPUS / t_old / 1e6);
+    printf("index          %8.2f M lookups/s\n", rounds * CORPUS / t_new / 1e6);
+    return 0;
+}
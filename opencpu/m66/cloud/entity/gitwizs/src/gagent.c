@@ -304,13 +304,22 @@ s32 Gagent_Local_DataAdapter( u8 *pData,s32 dataLen )
     {
         if( 0xFF==pData[i] )
         {
-            GAgent_MoveOneByte( &pData[i+1],(dataLen-i),0 );
-            pData[i+1] =0x55;
             j++;
-            dataLen++;
         }
     }
-    return len+j;
+    len += j;
+
+    /* fill from the end, every byte moves once to its final place */
+    for( i=dataLen-1;j>0;i-- )
+    {
+        if( 0xFF==pData[i] )
+        {
+            pData[i+j] = 0x55;
+            j--;
+        }
+        pData[i+j] = pData[i];
+    }
+    return len;
 }
 
 /****************************************************************
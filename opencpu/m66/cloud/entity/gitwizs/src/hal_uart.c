@@ -252,7 +252,9 @@ void HAL_Move_Data_Backward( u8 *buf, s32 pos_start, s32 pos_end, s32 move_len)
 /****************************************************************
 FunctionName    :   HAL_Local_ExtractOnePacket
 Description     :   extract one packet from local cycle buf, and 
-                    put data into buf.Will change pos_start
+                    put data into buf.Will change pos_start. Escaped
+                    bytes are decoded in the same pass as the copy,
+                    the ring itself is never shifted.
 buf             :   dest buf
 return          :   >0 the local packet data length.
                     <0 don't have one whole packet data
@@ -293,11 +295,8 @@ s32 HAL_Local_ExtractOnePacket(u8 *buf)
                 halRecKeyWord = 0;
                 if(0x55 == data)
                 {
+                    /* left in the ring, dropped when the packet is copied out */
                     data = 0xff;
-                    HAL_Move_Data_Backward(hal_RxBuffer, pos_start + 1, pos_current, 1);
-                    pos_current--;
-                    pos_start--;
-
                 }
                 else if(MCU_HDR_FF == data)
                 {
@@ -355,11 +354,18 @@ s32 HAL_Local_ExtractOnePacket(u8 *buf)
                 if(0 == gu16LocalPacketDataLen)
                 {
                     pos_start++;
-                    i = 0;
+                    /* header as is, then skip the 0x55 after every escaped 0xFF */
+                    buf[0] = __halbuf_read(guiLocalPacketStart++);
+                    buf[1] = __halbuf_read(guiLocalPacketStart++);
+                    i = 2;
                     while(guiLocalPacketStart != pos_start)
                     {
-                        buf[i] = __halbuf_read(guiLocalPacketStart++);
-                        i++;
+                        data = __halbuf_read(guiLocalPacketStart++);
+                        buf[i++] = data;
+                        if(MCU_HDR_FF == data)
+                        {
+                            guiLocalPacketStart++;
+                        }
                     }
 
                     return i;
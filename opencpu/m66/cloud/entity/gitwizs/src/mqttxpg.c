@@ -74,8 +74,8 @@ int Mqttxpg_HandlePublish(void *arg, unsigned char pkt_id, const char *topic,
      struct MqttGizwitContext * param =(struct MqttGizwitContext *)arg;
 
      resetPacket( PGC->rtinfo.Cloud_Rxbuf );
-     Adapter_Memcpy(PGC->rtinfo.Cloud_Rxbuf->phead,param->mqttctx->bgn,param->mqttctx->pos - param->mqttctx->bgn);
-     PGC->rtinfo.m2m_recvlen = param->mqttctx->pos - param->mqttctx->bgn;
+     Adapter_Memcpy(PGC->rtinfo.Cloud_Rxbuf->phead,param->mqttctx->cur_pkt,param->mqttctx->cur_pkt_len);
+     PGC->rtinfo.m2m_recvlen = param->mqttctx->cur_pkt_len;
      
      Ql_Debug_Trace("m2m_recvlen = %d\r\n",PGC->rtinfo.m2m_recvlen);
 
@@ -205,7 +205,7 @@ int Mqtt_SubLoginTopic(pgcontext pgc,short mqttstatus )
 
     Adapter_Memset(Sub_TopicBuf,0,100);
     Adapter_Memset(Topic,0,100);
-    MqttBuffer_Init(gw_ctx->mqttbuf);
+    MqttBuffer_Reset(gw_ctx->mqttbuf);
     switch(mqttstatus)
     {
     case MQTT_STATUS_REQ_LOGINTOPIC1:
@@ -252,7 +252,7 @@ int Mqtt_SubLoginTopic(pgcontext pgc,short mqttstatus )
     }
     
     APP_DEBUG("Mqtt_SendSubscribePacket OK, write:%d\r\n", ret); 
-    MqttBuffer_Destroy(gw_ctx->mqttbuf);
+    MqttBuffer_Reset(gw_ctx->mqttbuf);
     return 0;
 }
 
@@ -274,7 +274,7 @@ void MQTT_HeartbeatTime( void )
     //mqtt_ping(&g_stMQTTBroker);
     int ret;
     
-    MqttBuffer_Init(gw_ctx->mqttbuf);
+    MqttBuffer_Reset(gw_ctx->mqttbuf);
     ret = Mqtt_PackPingReqPkt(gw_ctx->mqttbuf);
     if (ret < 0)
     {
@@ -292,7 +292,7 @@ void MQTT_HeartbeatTime( void )
     
     APP_DEBUG("MQTT_HeartbeatTime OK, write:%d\r\n", ret); 
     
-    MqttBuffer_Destroy(gw_ctx->mqttbuf);
+    MqttBuffer_Reset(gw_ctx->mqttbuf);
 }
 
 
@@ -378,7 +378,7 @@ int MQTT_SenData( pgcontext pgc, char *szDID, ppacket pbuf,/*uint8 *buf,*/ int b
     for(i=0;i<sendpacklen;i++)
         APP_DEBUG(" %02X",sendpack[i] );
     APP_DEBUG(" \r\n");
-    MqttBuffer_Init(gw_ctx->mqttbuf);
+    MqttBuffer_Reset(gw_ctx->mqttbuf);
     //PubMsg( &g_stMQTTBroker,msgtopic,(char *)sendpack,sendpacklen,0 );
     
     pgc->rtinfo.waninfo.mqttMsgsubid ++;
@@ -399,7 +399,7 @@ int MQTT_SenData( pgcontext pgc, char *szDID, ppacket pbuf,/*uint8 *buf,*/ int b
     }
 
     
-    MqttBuffer_Destroy(gw_ctx->mqttbuf);
+    MqttBuffer_Reset(gw_ctx->mqttbuf);
     return 0;
 }
 
@@ -419,7 +419,7 @@ int Mqtt_SendConnetPacket(int socketid,const char* username,const char* password
     }
     gw_ctx->mqttfd = socketid;
     
-    MqttBuffer_Init(gw_ctx->mqttbuf);
+    MqttBuffer_Reset(gw_ctx->mqttbuf);
 
     ret = Mqtt_PackConnectPkt(gw_ctx->mqttbuf, CLOUD_MQTT_SET_ALIVE, username, 1, "WillTopic", "will message", 17,
                               MQTT_QOS_LEVEL0, 0, username,
@@ -440,7 +440,7 @@ int Mqtt_SendConnetPacket(int socketid,const char* username,const char* password
     }
     
     APP_DEBUG("Mqtt_SendConnetPacket OK, write:%d\r\n", ret); 
-    MqttBuffer_Destroy(gw_ctx->mqttbuf);
+    MqttBuffer_Reset(gw_ctx->mqttbuf);
     return 0;
 }
 
@@ -1,6 +1,23 @@
 #ifndef __MQTT_BUFFER_H__
 #define __MQTT_BUFFER_H__
 
+/* Size of the per-buffer arena, kept across MqttBuffer_Reset. Packets that
+   fit are built without touching the heap; larger ones spill to chunks
+   that are released on reset. */
+#ifndef MQTT_BUFFER_ARENA_SIZE
+#define MQTT_BUFFER_ARENA_SIZE 1024
+#endif
+
+/* iovec slots embedded in the buffer for Mqtt_SendPkt; a QoS0 publish
+   uses three (fixed header, variable header, payload). */
+#ifndef MQTT_BUFFER_IOV_COUNT
+#define MQTT_BUFFER_IOV_COUNT 4
+#endif
+
+struct iovec {
+    void *iov_base;
+    unsigned int iov_len;
+};
 
 struct MqttExtent {
     struct MqttExtent *next;
@@ -11,16 +28,29 @@ struct MqttExtent {
 
 
 
+/** Heap usage counters, to verify the steady state allocates nothing */
+struct MqttBufferStats {
+    unsigned int heap_allocs;   /**< Ql_MEM_Alloc calls made on behalf of the buffer */
+    unsigned int heap_frees;    /**< Ql_MEM_Free calls made on behalf of the buffer */
+    unsigned int spill_chunks;  /**< chunks allocated because the arena was full */
+    unsigned int resets;        /**< MqttBuffer_Reset calls */
+};
+
 struct MqttBuffer {
     struct MqttExtent *first_ext;
     struct MqttExtent *last_ext;
     unsigned int available_bytes;
 
-    char **allocations;
+    char **allocations;         /**< spill chunks, freed on reset */
     char *first_available;
     unsigned int alloc_count;
     unsigned int alloc_max_count;
     unsigned int buffered_bytes;
+
+    char *arena;                /**< MQTT_BUFFER_ARENA_SIZE bytes, freed on destroy only */
+    unsigned int ext_count;
+    struct iovec iov[MQTT_BUFFER_IOV_COUNT];
+    struct MqttBufferStats stats;
 };
 
 /**
@@ -31,7 +61,21 @@ Func:Init the buffer
 
 void MqttBuffer_Init(struct MqttBuffer *buf);
 
+/**
+Func:release all memory of the buffer, including the arena
+@param : the buf to save data packet
+@return : void
+**/
+
 void MqttBuffer_Destroy(struct MqttBuffer *buf);
+
+/**
+Func:drop the buffered packet and rewind the arena for the next one;
+     spill chunks are freed, the arena and the stats are kept
+@param : the buf to save data packet
+@return : void
+**/
+
 void MqttBuffer_Reset(struct MqttBuffer *buf);
 
 
@@ -70,17 +70,28 @@ enum MqttPacketType {
     MQTT_PKT_DISCONNECT   /**< Disconnect Request*/
 };
 
-struct iovec {
-    void *iov_base;
-    unsigned int iov_len;
-};
 
+/** MQTT Receive Statistics, used to size the Mqtt_InitContext buffer */
+struct MqttRecvStats {
+    unsigned int packets;        /**< packets dispatched */
+    unsigned int bytes_read;     /**< bytes returned by read_func */
+    unsigned int bytes_moved;    /**< bytes copied by window compaction */
+    unsigned int compactions;    /**< number of window compactions */
+    unsigned int max_occupancy;  /**< peak unconsumed bytes in the window */
+    unsigned long long since_ms; /**< Ql_GetMsSincePwrOn() at init/reset, for packets/sec */
+};
 
 /** MQTT Running Context */
 struct MqttContext {
-    char *bgn;
-    char *end;
-    char *pos;
+    char *bgn;  /**< receive window start */
+    char *end;  /**< receive window end */
+    char *pos;  /**< write cursor, end of received data */
+    char *rd;   /**< read cursor, start of the first undispatched packet */
+
+    const char *cur_pkt;      /**< raw packet being dispatched (fixed header included), NULL otherwise */
+    unsigned int cur_pkt_len; /**< length of cur_pkt */
+    struct MqttRecvStats stats;
+
     void *read_func_arg;
     int (*read_func)(void *arg, unsigned char *buf,int count);
     void *writev_func_arg;
@@ -135,6 +146,22 @@ int Mqtt_InitContext(struct MqttContext *ctx, unsigned int buf_size);
 
 void Mqtt_DestroyContext(struct MqttContext *ctx);
 
+/**
+*Func : Get the receive statistics of a context
+*@param : ctx : the mqtt context
+*@param : stats : output, a snapshot of the counters
+*@return :refer to enum MqttError
+**/
+
+int Mqtt_GetRecvStats(const struct MqttContext *ctx, struct MqttRecvStats *stats);
+
+/**
+*Func : Reset the receive statistics of a context
+*@param : ctx : the mqtt context
+**/
+
+void Mqtt_ResetRecvStats(struct MqttContext *ctx);
+
 
 /**
 *Func : Set packet dup flag
@@ -187,7 +214,7 @@ int Mqtt_RecvPkt(struct MqttContext *ctx);
 *@param : offset : the offset of buf start
 *@return :refer to enum MqttError
 **/
-int Mqtt_SendPkt(struct MqttContext *ctx, const struct MqttBuffer *buf, unsigned int offset);
+int Mqtt_SendPkt(struct MqttContext *ctx, struct MqttBuffer *buf, unsigned int offset);
 
 /**
 *Func:Packing MQTT Publish Packet
@@ -11,6 +11,8 @@
 
 static const unsigned int MQTT_MIN_EXTENT_SIZE = 1024;
 
+#define MQTT_EXTENT_ALIGN(n) (((n) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+
 /**
 Func:Init the buffer
 @param : the buf to save data packet
@@ -19,19 +21,19 @@ Func:Init the buffer
 
 void MqttBuffer_Init(struct MqttBuffer *buf)
 {
-    buf->first_ext = NULL;
-    buf->last_ext = NULL;
-    buf->available_bytes = 0;
-    buf->allocations = NULL;
-    buf->alloc_count = 0;
-    buf->alloc_max_count = 0;
-    buf->first_available = NULL;
-    buf->buffered_bytes = 0;
+    Ql_memset(buf, 0, sizeof(*buf));
 }
 
 void MqttBuffer_Destroy(struct MqttBuffer *buf)
 {
     MqttBuffer_Reset(buf);
+
+    if(NULL != buf->arena) {
+        Ql_MEM_Free(buf->arena);
+        ++buf->stats.heap_frees;
+    }
+
+    MqttBuffer_Init(buf);
 }
 
 void MqttBuffer_Reset(struct MqttBuffer *buf)
@@ -39,12 +41,70 @@ void MqttBuffer_Reset(struct MqttBuffer *buf)
     unsigned int i;
     for(i = 0; i < buf->alloc_count; ++i) {
         Ql_MEM_Free(buf->allocations[i]);
+        ++buf->stats.heap_frees;
+    }
+    if(NULL != buf->allocations) {
+        Ql_MEM_Free(buf->allocations);
+        ++buf->stats.heap_frees;
     }
 
-    MqttBuffer_Init(buf);
+    buf->first_ext = NULL;
+    buf->last_ext = NULL;
+    buf->allocations = NULL;
+    buf->alloc_count = 0;
+    buf->alloc_max_count = 0;
+    buf->buffered_bytes = 0;
+    buf->ext_count = 0;
+
+    buf->first_available = buf->arena;
+    buf->available_bytes = (NULL != buf->arena) ? MQTT_BUFFER_ARENA_SIZE : 0;
+    ++buf->stats.resets;
 }
 
+/**
+Func:allocate a spill chunk when the arena cannot hold the request
+@param : the buf to save data packet ,managed extents
+@param : the bytes needed, extent header included
+@return : 0 on success, -1 if out of memory
+**/
+static int MqttBuffer_Spill(struct MqttBuffer *buf, unsigned int bytes)
+{
+    unsigned int alloc_bytes;
+    char *chunk;
+
+    if(buf->alloc_count == buf->alloc_max_count) {
+        unsigned int max_count = buf->alloc_max_count * 2 + 1;
+        char **tmp = (char**)Ql_MEM_Alloc(max_count * sizeof(char*));
+        if(NULL == tmp) {
+            return -1;
+        }
+        ++buf->stats.heap_allocs;
 
+        Ql_memset(tmp, 0, max_count * sizeof(char*));
+        if(NULL != buf->allocations) {
+            Ql_memcpy(tmp, buf->allocations, buf->alloc_max_count * sizeof(char*));
+            Ql_MEM_Free(buf->allocations);
+            ++buf->stats.heap_frees;
+        }
+
+        buf->alloc_max_count = max_count;
+        buf->allocations = tmp;
+    }
+
+    alloc_bytes = bytes < MQTT_MIN_EXTENT_SIZE ? MQTT_MIN_EXTENT_SIZE : bytes;
+    chunk = (char*)Ql_MEM_Alloc(alloc_bytes);
+    if(NULL == chunk) {
+        return -1;
+    }
+    ++buf->stats.heap_allocs;
+    ++buf->stats.spill_chunks;
+
+    buf->allocations[buf->alloc_count++] = chunk;
+    buf->available_bytes = alloc_bytes;
+    buf->first_available = chunk;
+
+    return 0;
+}
 
 /**
 Func:allocate fixed header,variable header ,payload extent ,managed by the buffer
@@ -55,63 +115,36 @@ Func:allocate fixed header,variable header ,payload extent ,managed by the buffe
 struct MqttExtent *MqttBuffer_AllocExtent(struct MqttBuffer *buf, unsigned int bytes)
 {
     struct MqttExtent *ext;
+    unsigned int len = bytes;
 
+    // keep every extent header word aligned
+    bytes = MQTT_EXTENT_ALIGN(bytes + sizeof(struct MqttExtent));
 
-    bytes += sizeof(struct MqttExtent);
-
-    if(buf->available_bytes < bytes) {
-        unsigned int alloc_bytes;
-        char *chunk;
-
-        if(buf->alloc_count == buf->alloc_max_count) {
-            unsigned int max_count = buf->alloc_max_count * 2 + 1;
-            char **tmp = (char**)Ql_MEM_Alloc(max_count * sizeof(char**));
-            if(NULL == tmp) {
-                return NULL;
-            }
-
-            Ql_memset(tmp, 0, max_count * sizeof(char**));
-            Ql_memcpy(tmp, buf->allocations, buf->alloc_max_count);
-            Ql_MEM_Free(buf->allocations);
-
-            buf->alloc_max_count = max_count;
-            buf->allocations = tmp;
-        }
-
-        alloc_bytes = bytes < MQTT_MIN_EXTENT_SIZE ? MQTT_MIN_EXTENT_SIZE : bytes;
-        chunk = (char*)Ql_MEM_Alloc(alloc_bytes);
-        if(NULL == chunk) {
+    if((NULL == buf->arena) && (bytes <= MQTT_BUFFER_ARENA_SIZE)) {
+        buf->arena = (char*)Ql_MEM_Alloc(MQTT_BUFFER_ARENA_SIZE);
+        if(NULL == buf->arena) {
             return NULL;
         }
+        ++buf->stats.heap_allocs;
 
-        buf->alloc_count += 1;
-        buf->allocations[buf->alloc_count - 1] = chunk;
-        buf->available_bytes = alloc_bytes;
-        buf->first_available = chunk;
+        if(0 == buf->alloc_count) {
+            buf->first_available = buf->arena;
+            buf->available_bytes = MQTT_BUFFER_ARENA_SIZE;
+        }
     }
 
-    if(buf->available_bytes < bytes || buf->alloc_count <= 0)
-    {
-        return NULL;
-    }
- #if 0
-    if(((unsigned int)(buf->first_available)&& 0xff) != 0)
-    {
-        buf->first_available = (char *)(((unsigned int)buf->first_available + 3)&~2);
-    }
-#endif
-    if(((unsigned int)(buf->first_available)%2) != 0)
-    {
-       buf->first_available +=3;
+    if(buf->available_bytes < bytes) {
+        if(MqttBuffer_Spill(buf, bytes) < 0) {
+            return NULL;
+        }
     }
 
     ext = (struct MqttExtent*)(buf->first_available);
-    ext->len = bytes - sizeof(struct MqttExtent);
+    ext->len = len;
     ext->payload = buf->first_available + sizeof(struct MqttExtent);
     ext->next = NULL;
-    
-    buf->first_available += bytes;
 
+    buf->first_available += bytes;
     buf->available_bytes -= bytes;
 
     return ext;
@@ -126,29 +159,22 @@ Func:append a extent to a buffer,tail append
 
 void MqttBuffer_AppendExtent(struct MqttBuffer *buf, struct MqttExtent *ext)
 {
-   struct MqttExtent *cursor;
-       int i;
-   
     ext->next = NULL;
     if(NULL != buf->last_ext) {
-         buf->last_ext->next = ext;
-         
-         buf->last_ext = ext;
-         
+        buf->last_ext->next = ext;
+        buf->last_ext = ext;
     }
     else {
-        if(NULL != buf->first_ext || buf->alloc_count < 1)
-        {
+        if(NULL != buf->first_ext) {
             return;
         }
-       
+
         buf->first_ext = ext;
         buf->last_ext = ext;
     }
 
     buf->buffered_bytes += ext->len;
-   
-    
+    ++buf->ext_count;
 }
 
 /**
@@ -162,7 +188,7 @@ Func:append payload to a buffer
 
 int MqttBuffer_Append(struct MqttBuffer *buf, char *payload, unsigned int size, int own)
 {
-    const unsigned int bytes = own ? size : sizeof(struct MqttExtent);
+    const unsigned int bytes = own ? size : 0;
 
     struct MqttExtent *ext = MqttBuffer_AllocExtent(buf, bytes);
     if(NULL == ext) {
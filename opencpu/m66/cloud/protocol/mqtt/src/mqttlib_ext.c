@@ -8,6 +8,38 @@
 #include "ql_stdlib.h"
 #include "ql_memory.h"
 #include "ql_trace.h"
+#include "ql_system.h"
+
+/*
+ * Receive path trace level, fixed at compile time so that the release build
+ * carries no formatting cost in Mqtt_RecvPkt:
+ *   0 - off, 1 - protocol errors, 2 - + window/packet events,
+ *   3 - + handler flow, 4 - + hex dump of every received chunk.
+ */
+#ifndef MQTT_TRACE_LEVEL
+#define MQTT_TRACE_LEVEL 0
+#endif
+
+#define MQTT_TRACE_ERR      1
+#define MQTT_TRACE_INFO     2
+#define MQTT_TRACE_DEBUG    3
+#define MQTT_TRACE_DUMP     4
+
+#if MQTT_TRACE_LEVEL > 0
+#define MQTT_TRACE(LEVEL, ...) \
+    do { if((LEVEL) <= MQTT_TRACE_LEVEL) Ql_Debug_Trace(__VA_ARGS__); } while(0)
+#else
+#define MQTT_TRACE(LEVEL, ...)
+#endif
+
+/*
+ * Topics up to this length are NUL terminated on the stack, longer ones on
+ * the heap. The packet itself stays untouched: the byte after the topic is
+ * payload[0] for qos0, and handlers may copy the raw packet (cur_pkt).
+ */
+#ifndef MQTT_TOPIC_STACK_SIZE
+#define MQTT_TOPIC_STACK_SIZE 128
+#endif
 
 #define CMD_TOPIC_PREFIX "$SYS/cmdreq/"
 #define CMD_TOPIC_PREFIX_LEN 12 // strlen(CMD_TOPIC_PREFIX)
@@ -444,6 +476,87 @@ static int Mqtt_HandlePingResp(struct MqttContext *ctx, char flags,
     return ctx->handle_ping_resp(ctx->handle_ping_resp_arg);
 }
 
+/* topic is NUL terminated and no longer points into the packet */
+static int Mqtt_DispatchPublish(struct MqttContext *ctx, unsigned short pkt_id,
+                                char *topic, char *payload,
+                                unsigned int payload_len, char dup, char qos)
+{
+    const char *cursor;
+    int err = MQTTERR_NOERROR;
+
+    cursor = topic;
+ #ifdef __ONENET_SOLUTION__ 
+    while('\0' != *cursor) {
+
+        if(('+' == *cursor) || ('#' == *cursor)) {
+            
+            return MQTTERR_ILLEGAL_PKT;
+        }
+        ++cursor;
+    }
+
+    if('$' == *topic) {
+        if(topic == Ql_strstr(topic, CMD_TOPIC_PREFIX)) {
+            const char *cmdid = topic + CMD_TOPIC_PREFIX_LEN; // skip the $CMDREQ
+            char *arg = payload + 1;
+            unsigned int arg_len = payload_len - 1;
+            long long ts = 0;
+            char *desc = "";
+
+            if((payload_len < 1) || ((*payload & 0x1f) != 0x5)) {
+                return MQTTERR_ILLEGAL_PKT;
+            }
+
+            if(*payload & 0x40) {
+                if(arg_len < 8) {
+                    return MQTTERR_ILLEGAL_PKT;
+                }
+                ts = (long long)Mqtt_RB64(arg);
+                arg += 8;
+                arg_len -= 8;
+            }
+
+            if(*payload & 0x20) {
+                unsigned short desc_len;
+
+                if(arg_len < 2) {
+                    return MQTTERR_ILLEGAL_PKT;
+                }
+
+                desc_len = Mqtt_RB16(arg);
+                if(arg_len < 2 + desc_len) {
+                    return MQTTERR_ILLEGAL_PKT;
+                }
+
+                Ql_memmove(arg, arg + 2, desc_len);
+                desc = arg;
+                desc[desc_len] = '\0';
+
+                arg += desc_len + 2;
+                arg_len -= desc_len - 2;
+            }
+
+            err = ctx->handle_cmd(ctx->handle_cmd_arg, pkt_id, cmdid,
+                                  ts, desc, arg, arg_len, dup,
+                                  (enum MqttQosLevel)qos);
+        }
+    }
+    else {
+        err = ctx->handle_publish(ctx->handle_publish_arg, pkt_id, topic,
+                                  payload, payload_len, dup,
+                                  (enum MqttQosLevel)qos);
+    }
+#endif
+#ifdef __GITWIZS_SOLUTION__ 
+
+    err = ctx->handle_publish(ctx->handle_publish_arg, pkt_id, topic,
+                                  payload, payload_len, dup,
+                                  (enum MqttQosLevel)qos);
+#endif
+
+    return err;
+}
+
 static int Mqtt_HandlePublish(struct MqttContext *ctx, char flags,
                               char *pkt, unsigned int size)
 {
@@ -454,26 +567,27 @@ static int Mqtt_HandlePublish(struct MqttContext *ctx, char flags,
     unsigned short pkt_id = 0;
     unsigned int payload_len;
     char *payload;
-    char *topic, *cursor;
+    char *topic;
+    char topic_buf[MQTT_TOPIC_STACK_SIZE];
     int err = MQTTERR_NOERROR;
 
     if(size < 2) {
         
-        Ql_Debug_Trace("lebron:aaaaa\r\n");
+        MQTT_TRACE(MQTT_TRACE_ERR, "publish: packet too short\r\n");
         return MQTTERR_ILLEGAL_PKT;
     }
 
     if(retain) {
         
-        Ql_Debug_Trace("lebron:bbbbb\r\n");
+        MQTT_TRACE(MQTT_TRACE_ERR, "publish: retain flag not supported\r\n");
         return MQTTERR_ILLEGAL_PKT;
     }
 
     topic_len = Mqtt_RB16(pkt);
-    Ql_Debug_Trace("size = %d,topic_len = %d\r\n",size,topic_len);
+    MQTT_TRACE(MQTT_TRACE_DEBUG, "publish: size = %d,topic_len = %d\r\n",size,topic_len);
     if(size < (unsigned short)(2 + topic_len)) {
         
-        Ql_Debug_Trace("lebron:cccccc\r\n");
+        MQTT_TRACE(MQTT_TRACE_ERR, "publish: topic length exceeds packet\r\n");
         return MQTTERR_ILLEGAL_PKT;
     }
 
@@ -481,14 +595,14 @@ static int Mqtt_HandlePublish(struct MqttContext *ctx, char flags,
     case MQTT_QOS_LEVEL0: // qos0 have no packet identifier
         if(0 != dup) {
             
-            Ql_Debug_Trace("lebron:dddddd\r\n");
+            MQTT_TRACE(MQTT_TRACE_ERR, "publish: dup set on qos0\r\n");
             return MQTTERR_ILLEGAL_PKT;
         }
 
         //Ql_memmove(pkt, pkt + 2, topic_len); // reuse the space to store null terminate
         topic = pkt+2;
 
-        payload_len = size - 4 - topic_len;
+        payload_len = size - 2 - topic_len;
         payload = pkt + 2 + topic_len;
         break;
 
@@ -497,14 +611,14 @@ static int Mqtt_HandlePublish(struct MqttContext *ctx, char flags,
         topic = pkt + 2;
         if(topic_len + 4 > size) {
             
-            Ql_Debug_Trace("lebron:eeeee\r\n");
+            MQTT_TRACE(MQTT_TRACE_ERR, "publish: missing packet id\r\n");
             return MQTTERR_ILLEGAL_PKT;
         }
 
         pkt_id = Mqtt_RB16(pkt + topic_len + 2);
         if(0 == pkt_id) {
             
-            Ql_Debug_Trace("lebron:ffffff\r\n");
+            MQTT_TRACE(MQTT_TRACE_ERR, "publish: zero packet id\r\n");
             return MQTTERR_ILLEGAL_PKT;
         }
         payload_len = size - 4 - topic_len;
@@ -513,93 +627,44 @@ static int Mqtt_HandlePublish(struct MqttContext *ctx, char flags,
 
     default:
         
-        Ql_Debug_Trace("lebron:gggggg\r\n");
+        MQTT_TRACE(MQTT_TRACE_ERR, "publish: illegal qos\r\n");
         return MQTTERR_ILLEGAL_PKT;
     }
 
     if(NULL == topic)
     {
         
-        Ql_Debug_Trace("lebron:hhhhhh\r\n");
+        MQTT_TRACE(MQTT_TRACE_ERR, "publish: null topic\r\n");
         return MQTTERR_ASSERT_ERROR;
     }
-    topic[topic_len] = '\0';
 
-    if(Mqtt_CheckUtf8(topic, topic_len) != topic_len) {
-        
-        Ql_Debug_Trace("lebron:iiiiii\r\n");
-        return MQTTERR_ILLEGAL_PKT;
+    if(topic_len < sizeof(topic_buf)) {
+        Ql_memcpy(topic_buf, topic, topic_len);
+        topic = topic_buf;
     }
-
-    cursor = topic;
- #ifdef __ONENET_SOLUTION__ 
-    while('\0' != *cursor) {
-
-        if(('+' == *cursor) || ('#' == *cursor)) {
-            
-            return MQTTERR_ILLEGAL_PKT;
+    else {
+        char *copy = (char*)Ql_MEM_Alloc(topic_len + 1);
+        if(NULL == copy) {
+            return MQTTERR_OUTOFMEMORY;
         }
-        ++cursor;
+        Ql_memcpy(copy, topic, topic_len);
+        topic = copy;
     }
+    topic[topic_len] = '\0';
 
-    if('$' == *topic) {
-        if(topic == Ql_strstr(topic, CMD_TOPIC_PREFIX)) {
-            const char *cmdid = topic + CMD_TOPIC_PREFIX_LEN; // skip the $CMDREQ
-            char *arg = payload + 1;
-            unsigned int arg_len = payload_len - 1;
-            long long ts = 0;
-            char *desc = "";
-
-            if((payload_len < 1) || ((*payload & 0x1f) != 0x5)) {
-                return MQTTERR_ILLEGAL_PKT;
-            }
-
-            if(*payload & 0x40) {
-                if(arg_len < 8) {
-                    return MQTTERR_ILLEGAL_PKT;
-                }
-                ts = (long long)Mqtt_RB64(arg);
-                arg += 8;
-                arg_len -= 8;
-            }
-
-            if(*payload & 0x20) {
-                unsigned short desc_len;
-
-                if(arg_len < 2) {
-                    return MQTTERR_ILLEGAL_PKT;
-                }
-
-                desc_len = Mqtt_RB16(arg);
-                if(arg_len < 2 + desc_len) {
-                    return MQTTERR_ILLEGAL_PKT;
-                }
-
-                Ql_memmove(arg, arg + 2, desc_len);
-                desc = arg;
-                desc[desc_len] = '\0';
-
-                arg += desc_len + 2;
-                arg_len -= desc_len - 2;
-            }
-
-            err = ctx->handle_cmd(ctx->handle_cmd_arg, pkt_id, cmdid,
-                                  ts, desc, arg, arg_len, dup,
-                                  (enum MqttQosLevel)qos);
-        }
+    if(Mqtt_CheckUtf8(topic, topic_len) != topic_len) {
+        
+        MQTT_TRACE(MQTT_TRACE_ERR, "publish: topic not utf-8\r\n");
+        err = MQTTERR_ILLEGAL_PKT;
     }
     else {
-        err = ctx->handle_publish(ctx->handle_publish_arg, pkt_id, topic,
-                                  payload, payload_len, dup,
-                                  (enum MqttQosLevel)qos);
+        err = Mqtt_DispatchPublish(ctx, pkt_id, topic, payload, payload_len,
+                                   dup, qos);
+    }
+    if(topic != topic_buf) {
+        Ql_MEM_Free(topic);
     }
-#endif
-#ifdef __GITWIZS_SOLUTION__ 
 
-   err = ctx->handle_publish(ctx->handle_publish_arg, pkt_id, topic,
-                                  payload, payload_len, dup,
-                                  (enum MqttQosLevel)qos);
-#endif
     // send the publish response.
     if(err >= 0) {
         struct MqttBuffer response[1];
@@ -608,7 +673,7 @@ static int Mqtt_HandlePublish(struct MqttContext *ctx, char flags,
         switch(qos) {
         case MQTT_QOS_LEVEL2:
             
-            Ql_Debug_Trace("lebron:22222\r\n");
+            MQTT_TRACE(MQTT_TRACE_DEBUG, "publish: send pubrec\r\n");
             if(0 == pkt_id)
             {
                 return MQTTERR_ASSERT_ERROR;
@@ -618,7 +683,7 @@ static int Mqtt_HandlePublish(struct MqttContext *ctx, char flags,
 
         case MQTT_QOS_LEVEL1:
             
-            Ql_Debug_Trace("lebron:333333\r\n");
+            MQTT_TRACE(MQTT_TRACE_DEBUG, "publish: send puback\r\n");
             if(0 == pkt_id)
             {
                  return MQTTERR_ASSERT_ERROR;
@@ -627,7 +692,7 @@ static int Mqtt_HandlePublish(struct MqttContext *ctx, char flags,
             break;
 
         default:
-            Ql_Debug_Trace("lebron:1111\r\n");
+            MQTT_TRACE(MQTT_TRACE_DEBUG, "publish: qos0, no response\r\n");
             break;
         }
 
@@ -691,27 +756,27 @@ static int Mqtt_Dispatch(struct MqttContext *ctx, char fh,  char *pkt, unsigned
 
     case MQTT_PKT_PUBLISH:
         
-        Ql_Debug_Trace("lebron:4444444\r\n");
+        MQTT_TRACE(MQTT_TRACE_DEBUG, "dispatch: publish\r\n");
         return Mqtt_HandlePublish(ctx, flags, pkt, size);
 
     case MQTT_PKT_PUBACK:
         
-        Ql_Debug_Trace("lebron:555555\r\n");
+        MQTT_TRACE(MQTT_TRACE_DEBUG, "dispatch: puback\r\n");
         return Mqtt_HandlePubAck(ctx, flags, pkt, size);
 
     case MQTT_PKT_PUBREC:
         
-        Ql_Debug_Trace("lebron:666666\r\n");
+        MQTT_TRACE(MQTT_TRACE_DEBUG, "dispatch: pubrec\r\n");
         return Mqtt_HandlePubRec(ctx, flags, pkt, size);
 
     case MQTT_PKT_PUBREL:
         
-        Ql_Debug_Trace("lebron:777777\r\n");
+        MQTT_TRACE(MQTT_TRACE_DEBUG, "dispatch: pubrel\r\n");
         return Mqtt_HandlePubRel(ctx, flags, pkt, size);
 
     case MQTT_PKT_PUBCOMP:
         
-        Ql_Debug_Trace("lebron:888888\r\n");
+        MQTT_TRACE(MQTT_TRACE_DEBUG, "dispatch: pubcomp\r\n");
         return Mqtt_HandlePubComp(ctx, flags, pkt, size);
 
     case MQTT_PKT_SUBACK:
@@ -722,11 +787,10 @@ static int Mqtt_Dispatch(struct MqttContext *ctx, char fh,  char *pkt, unsigned
 
     default:
         
-        Ql_Debug_Trace("lebron:999999\r\n");
+        MQTT_TRACE(MQTT_TRACE_ERR, "dispatch: unknown packet type 0x%x\r\n", (unsigned char)fh);
         break;
     }
-    
-    Ql_Debug_Trace("lebron:00000\r\n");
+
     return MQTTERR_ILLEGAL_PKT;
 }
 
@@ -750,6 +814,8 @@ int Mqtt_InitContext(struct MqttContext *ctx, unsigned int buf_size)
 
     ctx->end = ctx->bgn + buf_size;
     ctx->pos = ctx->bgn;
+    ctx->rd = ctx->bgn;
+    ctx->stats.since_ms = Ql_GetMsSincePwrOn();
 
     return MQTTERR_NOERROR;
 }
@@ -879,8 +945,36 @@ int Mqtt_AppendUnsubscribeTopic(struct MqttBuffer *buf, const char *topic)
 
 
 
+/**
+*Func : Move the unconsumed bytes [rd, pos) to the front of the window
+*@param : ctx : the mqtt context
+**/
+
+static void Mqtt_CompactWindow(struct MqttContext *ctx)
+{
+    unsigned int movebytes = ctx->pos - ctx->rd;
+
+    if(ctx->rd == ctx->bgn) {
+        return;
+    }
+
+    if(movebytes > 0) {
+        Ql_memmove(ctx->bgn, ctx->rd, movebytes);
+        ctx->stats.bytes_moved += movebytes;
+    }
+    ++ctx->stats.compactions;
+
+    ctx->rd = ctx->bgn;
+    ctx->pos = ctx->bgn + movebytes;
+
+    MQTT_TRACE(MQTT_TRACE_INFO, "mqtt rx: compact %d bytes\r\n", movebytes);
+}
+
 /**
 *Func : Recieve MQTT Packet
+*       Packets are dispatched in place from the read cursor; the window is
+*       only compacted when the free tail runs out, so a burst of small
+*       packets costs no copying at all.
 *@param : ctx : the mqtt context
 *@return :refer to enum MqttError
 **/
@@ -889,27 +983,32 @@ int Mqtt_RecvPkt(struct MqttContext *ctx)
 {
     int bytes;
     unsigned int remaining_len = 0;
-    char *pkt, *cursor;
-    int i;
-
-    
-    Ql_Debug_Trace("bgn = 0x%x\r\n",ctx->bgn);
-    Ql_Debug_Trace("pos = 0x%x\r\n",ctx->pos);
-    Ql_Debug_Trace("end = 0x%x\r\n",ctx->end);
+    unsigned int occupancy;
+    char *pkt;
 
-    bytes = ctx->read_func(ctx->read_func_arg, ctx->pos, ctx->end - ctx->pos);
+    if(ctx->pos == ctx->end) {
+        if(ctx->rd == ctx->bgn) {
+            return MQTTERR_BUF_OVERFLOW;
+        }
+        Mqtt_CompactWindow(ctx);
+    }
 
-    Ql_Debug_Trace("bytes = %d\r\n",bytes);
+    bytes = ctx->read_func(ctx->read_func_arg, (unsigned char *)ctx->pos, ctx->end - ctx->pos);
 
-    for(i = 0 ; i < bytes;i++)
+#if MQTT_TRACE_LEVEL >= MQTT_TRACE_DUMP
     {
-        Ql_Debug_Trace("0x%x ",(ctx->bgn)[i]);
+        int i;
+        MQTT_TRACE(MQTT_TRACE_DUMP, "mqtt rx: %d bytes at +%d\r\n", bytes, ctx->pos - ctx->bgn);
+        for(i = 0; i < bytes; i++) {
+            MQTT_TRACE(MQTT_TRACE_DUMP, "0x%x ", (unsigned char)ctx->pos[i]);
+        }
+        MQTT_TRACE(MQTT_TRACE_DUMP, "\r\n");
     }
-    Ql_Debug_Trace("\r\n");
-
+#endif
 
     if(0 == bytes) {
         ctx->pos = ctx->bgn; // clear the buffer
+        ctx->rd = ctx->bgn;
         return MQTTERR_ENDOFFILE;
     }
 
@@ -922,55 +1021,99 @@ int Mqtt_RecvPkt(struct MqttContext *ctx)
         return MQTTERR_BUF_OVERFLOW;
     }
 
-    cursor = ctx->bgn;
+    ctx->stats.bytes_read += bytes;
+    occupancy = ctx->pos - ctx->rd;
+    if(occupancy > ctx->stats.max_occupancy) {
+        ctx->stats.max_occupancy = occupancy;
+    }
+
     while(1) {
+        unsigned int pkt_len;
         int errcode;
 
-        if(ctx->pos - cursor  < 2) {
+        if(ctx->pos - ctx->rd < 2) {
             break;
         }
 
-        bytes = Mqtt_ReadLength(cursor + 1, ctx->pos - cursor - 1, &remaining_len);
+        bytes = Mqtt_ReadLength(ctx->rd + 1, ctx->pos - ctx->rd - 1, &remaining_len);
 
         if(-1 == bytes) {
             break;
         }
         else if(-2 == bytes) {
+            MQTT_TRACE(MQTT_TRACE_ERR, "mqtt rx: bad remaining length\r\n");
             return MQTTERR_ILLEGAL_PKT;
         }
 
         // one byte for the fixed header
-        if(cursor + remaining_len + bytes + 1 > ctx->pos) {
+        pkt_len = remaining_len + bytes + 1;
+        if(pkt_len > (unsigned int)(ctx->end - ctx->bgn)) {
+            MQTT_TRACE(MQTT_TRACE_ERR, "mqtt rx: packet of %d bytes exceeds window\r\n", pkt_len);
+            return MQTTERR_PKT_TOO_LARGE;
+        }
+
+        if(ctx->rd + pkt_len > ctx->pos) {
+            // incomplete; make room now if the rest cannot land behind it
+            if(ctx->rd + pkt_len > ctx->end) {
+                Mqtt_CompactWindow(ctx);
+            }
             break;
         }
 
-        pkt = cursor + bytes + 1; 
-        Ql_Debug_Trace("remain_len = %d\r\n",remaining_len);
-        errcode = Mqtt_Dispatch(ctx, cursor[0], pkt, remaining_len);
+        pkt = ctx->rd + bytes + 1;
+        ctx->cur_pkt = ctx->rd;
+        ctx->cur_pkt_len = pkt_len;
+        MQTT_TRACE(MQTT_TRACE_INFO, "mqtt rx: type %d, remain_len = %d\r\n",
+                   ((unsigned char)ctx->rd[0]) >> 4, remaining_len);
+
+        errcode = Mqtt_Dispatch(ctx, ctx->rd[0], pkt, remaining_len);
+        ctx->cur_pkt = NULL;
+        ctx->cur_pkt_len = 0;
         if(errcode < 0) {
             return errcode;
         }
-		
-		cursor += bytes + 1 + remaining_len;
-    }
-   // Ql_memset(ctx->bgn,0,ctx->end-ctx->bgn);
-   // ctx->pos = ctx->bgn;
-#if 1
-    if(cursor > ctx->bgn) {
-        unsigned int movebytes = cursor - ctx->bgn;
-        Ql_memmove(ctx->bgn, cursor, movebytes);
-        ctx->pos -= movebytes;
-        
-        Ql_Debug_Trace("pos_after = 0x%x\r\n",ctx->pos);
-        if(ctx->pos < ctx->bgn)
-        {
-            return MQTTERR_ASSERT_ERROR;
-        }
+
+        ctx->rd += pkt_len;
+        ++ctx->stats.packets;
     }
-#endif
+
+    if(ctx->rd == ctx->pos) {
+        // everything consumed, rewind for free
+        ctx->rd = ctx->bgn;
+        ctx->pos = ctx->bgn;
+    }
+
     return MQTTERR_NOERROR;
 }
 
+/**
+*Func : Get the receive statistics of a context
+*@param : ctx : the mqtt context
+*@param : stats : output, a snapshot of the counters
+*@return :refer to enum MqttError
+**/
+
+int Mqtt_GetRecvStats(const struct MqttContext *ctx, struct MqttRecvStats *stats)
+{
+    if((NULL == ctx) || (NULL == stats)) {
+        return MQTTERR_INVALID_PARAMETER;
+    }
+
+    Ql_memcpy(stats, &ctx->stats, sizeof(*stats));
+    return MQTTERR_NOERROR;
+}
+
+/**
+*Func : Reset the receive statistics of a context
+*@param : ctx : the mqtt context
+**/
+
+void Mqtt_ResetRecvStats(struct MqttContext *ctx)
+{
+    Ql_memset(&ctx->stats, 0, sizeof(ctx->stats));
+    ctx->stats.since_ms = Ql_GetMsSincePwrOn();
+}
+
 /**
 *Func : Send MQTT Packet
 *@param : ctx : the mqtt context
@@ -978,11 +1121,11 @@ int Mqtt_RecvPkt(struct MqttContext *ctx)
 *@param : offset : the offset of buf start
 *@return :refer to enum MqttError
 **/
-int Mqtt_SendPkt(struct MqttContext *ctx, const struct MqttBuffer *buf, unsigned int offset)
+int Mqtt_SendPkt(struct MqttContext *ctx, struct MqttBuffer *buf, unsigned int offset)
 {
     const struct MqttExtent *cursor;
-    const struct MqttExtent *first_ext;
     unsigned int bytes;
+    unsigned int skipped;
     int ext_count;
     int i;
     struct iovec *iov;
@@ -991,48 +1134,49 @@ int Mqtt_SendPkt(struct MqttContext *ctx, const struct MqttBuffer *buf, unsigned
         return 0;
     }
 
+    // skip the extents that were already sent completely
     cursor = buf->first_ext;
     bytes = 0;
-    
-    while(cursor && bytes < offset) {
+    skipped = 0;
+    while(cursor && (bytes + cursor->len <= offset)) {
         bytes += cursor->len;
         cursor = cursor->next;
+        ++skipped;
     }
 
-    first_ext = cursor;
-    ext_count = 0;
-    for(; cursor; cursor = cursor->next) {
-        ++ext_count;
-    }
-
-    if(0 == ext_count) {
+    // buffered_bytes may count more than the extents hold (Mqtt_EraseLength)
+    if(NULL == cursor)
+    {
         return 0;
     }
 
-    if(NULL == first_ext)
-    {
-        return MQTTERR_ASSERT_ERROR;
+    ext_count = buf->ext_count - skipped;
+    if(ext_count <= MQTT_BUFFER_IOV_COUNT) {
+        iov = buf->iov;
     }
-
-    iov = (struct iovec*)Ql_MEM_Alloc(sizeof(struct iovec) * ext_count);
-    if(!iov) {
-        return MQTTERR_OUTOFMEMORY;
+    else {
+        iov = (struct iovec*)Ql_MEM_Alloc(sizeof(struct iovec) * ext_count);
+        if(!iov) {
+            return MQTTERR_OUTOFMEMORY;
+        }
+        ++buf->stats.heap_allocs;
     }
- 
-    iov[0].iov_base = first_ext->payload + (offset - bytes);
-    iov[0].iov_len = first_ext->len - (offset - bytes);
-    
+
+    iov[0].iov_base = cursor->payload + (offset - bytes);
+    iov[0].iov_len = cursor->len - (offset - bytes);
 
     i = 1;
-    for(cursor = first_ext->next; cursor; cursor = cursor->next) {
+    for(cursor = cursor->next; cursor; cursor = cursor->next) {
         iov[i].iov_base = cursor->payload;
         iov[i].iov_len = cursor->len;
         ++i;
     }
-    
 
     i = ctx->writev_func(ctx->writev_func_arg, iov, ext_count);
-    Ql_MEM_Free(iov);
+    if(iov != buf->iov) {
+        Ql_MEM_Free(iov);
+        ++buf->stats.heap_frees;
+    }
 
     return i;
 }
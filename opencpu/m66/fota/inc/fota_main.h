@@ -77,7 +77,18 @@ typedef enum{
 }Upgrade_State;
 
 typedef bool (* Callback_Upgrade_State)(Upgrade_State state, s32 fileDLPercent);
+
+typedef struct {
+    u32 bodyBytes;      // image bytes written to the fota region
+    u32 elapsedMs;      // since the first body byte
+    u32 bytesPerSec;    // bodyBytes over elapsedMs, flash time included
+    u32 flashWrites;    // Ql_FOTA_WriteData calls
+    u32 flashStallMs;   // total time spent in Ql_FOTA_WriteData
+    u32 flashMaxStallMs;// longest single Ql_FOTA_WriteData
+}ST_FotaDownloadStats;
+
 extern Upgrade_State  g_FOTA_State;
+extern ST_FotaDownloadStats g_FOTA_DownloadStats;
 extern Callback_Upgrade_State Fota_UpgardeState;
 #define FOTA_UPGRADE_IND(x,y,z)  if(NULL != Fota_UpgardeState) {z=Fota_UpgardeState(x,y);}
 
@@ -131,4 +142,21 @@ s32 Ql_FOTA_StartUpgrade(u8* url, ST_GprsConfig* apnCfg, Callback_Upgrade_State
 *****************************************************************/
 s32 Ql_FOTA_StopUpgrade(void);
 
+/*****************************************************************
+* Function:     Ql_FOTA_GetDownloadStats
+*
+* Description:
+*               This function gets the download statistics of the current upgrade.
+*               It may be called from the upgrade state callback, the values are
+*               refreshed before each UP_GETTING_FILE and UP_GET_FILE_OK report.
+*
+* Parameters:
+*               stats:
+*                   [out] the throughput and flash write statistics.
+* Return:
+*                0 indicates this function successes.
+*               -1 indicates this function failure.
+*****************************************************************/
+s32 Ql_FOTA_GetDownloadStats(ST_FotaDownloadStats* stats);
+
 #endif  //__FOTA_MAIN_H__
@@ -6,6 +6,7 @@
 #include "ql_timer.h"
 #include "ql_fota.h"
 #include "ql_gprs.h"
+#include "ql_system.h"
 #include "fota_http.h"
 #include "fota_http_code.h"
 #include "fota_main.h"
@@ -53,6 +54,7 @@ char* HttpGetHead[] =
     "User-Agent: QUECTEL_MODULE\r\n", 
     "Connection: Keep-Alive\r\n",
     "\r\n",
+    "Range: bytes=%d-\r\n",          // "%d"   resume offset, only sent when resuming
 };
 
 
@@ -111,6 +113,7 @@ s32 HTTP_FotaMain(u8 contextId, u8* URL)
     FOTA_DBG_PRINT("<-- Successfully activate GPRS -->\r\n");
     
     http_initialize();
+    httpContext_p->contextId = contextId;
     httpContext_p->socketid = Ql_SOC_CreateEx(contextId,SOC_TYPE_TCP, Ql_OS_GetActiveTaskId(), Httpcallback_SOC_func);
     if(httpContext_p->socketid <0)
     {
@@ -201,13 +204,23 @@ void http_initialize(void)
     httpContext_p->httpGettimerstate = FALSE;
     
     httpContext_p->http_socketdata_p = NULL;
-    httpContext_p->genhttp_dstconstsize = QUECTEL_HTTP_DATABUFFER_SIZE;
+    httpContext_p->genhttp_dstconstsize = HTTP_FOTA_BLOCK_SIZE;
     httpContext_p->genhttp_dstpos = 0;
     httpContext_p->genhttp_dstvaliddatalen = 0;
         
     httpContext_p->ContentLength = 0;
     httpContext_p->getbody = FALSE;
     httpContext_p->receivedbodydata = 0;
+    httpContext_p->resumeoffset = 0;
+    httpContext_p->skipbytes = 0;
+    httpContext_p->resumeretry = 0;
+    httpContext_p->lastpercent = 0;
+
+    httpContext_p->chunkstate = HTTP_CHUNK_SIZE;
+    httpContext_p->chunkremain = 0;
+    httpContext_p->chunklinelen = 0;
+    httpContext_p->bodyfill = 0;
+    httpContext_p->dlstarttime = 0;
     
     httpContext_p->httpversion = 1;
     
@@ -329,6 +342,19 @@ s32 http_SendHttpGetHead( s32 socketId)
     FOTA_DBG_PRINT(sendBuffer);
     if(ret != Ql_strlen(sendBuffer))
     {return -1;}
+
+    // http  head:  (Range: ........ ) , continue from the last checkpoint
+    if(httpContext_p->resumeoffset > 0)
+    {
+        Ql_memset(sendBuffer, 0x00, sizeof(sendBuffer));
+        Ql_sprintf(sendBuffer, HttpGetHead[6], httpContext_p->resumeoffset);
+        ret =  Ql_SOC_Send(socketId, sendBuffer, Ql_strlen(sendBuffer));
+        UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--send Range:<%s> \r\n",sendBuffer);
+        FOTA_DBG_PRINT("<--send Range: ");
+        FOTA_DBG_PRINT(sendBuffer);
+        if(ret != Ql_strlen(sendBuffer))
+        {return -1;}
+    }
     
     // http  head:  (  \r\n    )
     Ql_memset(sendBuffer, 0x00, sizeof(sendBuffer));
@@ -341,7 +367,11 @@ s32 http_SendHttpGetHead( s32 socketId)
     {return -1;}
 
     // send http head successfully , malloc a buffer for http data form the socket now!!
-    httpContext_p->http_socketdata_p = (u8 *)Ql_MEM_Alloc(QUECTEL_HTTP_DATABUFFER_SIZE);
+    // (a resumed request keeps the buffer of the dropped one)
+    if(NULL == httpContext_p->http_socketdata_p)
+    {
+        httpContext_p->http_socketdata_p = (u8 *)Ql_MEM_Alloc(HTTP_FOTA_BLOCK_SIZE);
+    }
     if(NULL == httpContext_p->http_socketdata_p)
     {
         UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--Malloc memory buffer for http socket buffer failed !--> \r\n");
@@ -353,6 +383,15 @@ s32 http_SendHttpGetHead( s32 socketId)
     return TRUE;
 }
 
+static void http_StartReadTimer(HttpMainContext_t *httpContext_p)
+{
+    if(FALSE == httpContext_p->httpGettimerstate)
+    {
+        Ql_Timer_Start(httpContext_p->httpGetHeadTimer,httpContext_p->httpGettimeout,FALSE);
+        httpContext_p->httpGettimerstate = TRUE;
+    }
+}
+
 s8 http_RecvHttpHead(s32 socketid, bool bContinue)
 {
     HttpMainContext_t *httpContext_p  = &httpMainContext;
@@ -377,14 +416,16 @@ s8 http_RecvHttpHead(s32 socketid, bool bContinue)
 
 cuntinuerecvdata:
 
-    if(httpContext_p->genhttp_dstpos)
+    // move the undecoded part of a header line to the front only once the free tail is used up
+    if(httpContext_p->genhttp_dstpos &&
+       (httpContext_p->genhttp_dstpos + httpContext_p->genhttp_dstvaliddatalen >= httpContext_p->genhttp_dstconstsize))
     {
-        Ql_memcpy(httpContext_p->genhttp_dstconstptr, httpContext_p->genhttp_dstconstptr + httpContext_p->genhttp_dstpos , httpContext_p->genhttp_dstvaliddatalen);
+        Ql_memmove(httpContext_p->genhttp_dstconstptr, httpContext_p->genhttp_dstconstptr + httpContext_p->genhttp_dstpos , httpContext_p->genhttp_dstvaliddatalen);
         httpContext_p->genhttp_dstpos =  0;
     }
 
-    recvbuffer = httpContext_p->genhttp_dstconstptr+httpContext_p->genhttp_dstvaliddatalen;
-    willrecvlength = httpContext_p->genhttp_dstconstsize  - httpContext_p->genhttp_dstvaliddatalen;
+    recvbuffer = httpContext_p->genhttp_dstconstptr + httpContext_p->genhttp_dstpos + httpContext_p->genhttp_dstvaliddatalen;
+    willrecvlength = httpContext_p->genhttp_dstconstsize - httpContext_p->genhttp_dstpos - httpContext_p->genhttp_dstvaliddatalen;
 
     recvlength = 0;
     UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--want read socket datalength=%d-->\r\n", willrecvlength);
@@ -397,11 +438,7 @@ cuntinuerecvdata:
         //UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--http head:%s -->\r\n", recvbuffer);//if receive http head fail, you can debug via this message log.
         if(recvlength == SOC_WOULDBLOCK)
         {
-            if(FALSE == httpContext_p->httpGettimerstate)
-            {
-                Ql_Timer_Start(httpContext_p->httpGetHeadTimer,httpContext_p->httpGettimeout,FALSE);
-                httpContext_p->httpGettimerstate = FALSE;
-            }
+            http_StartReadTimer(httpContext_p);
             return HTTP_RESULT_ERROR_WOULDBLOCK;
         }
         else if(recvlength <= 0)
@@ -447,7 +484,7 @@ cuntinuerecvdata:
             {
                 UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--httpRecvHttpHead not exist ContentLength !-->\r\n");
                 FOTA_DBG_PRINT("<--httpRecvHttpHead not exist ContentLength !-->\r\n");
-                httpheader->ContentLength = 0xFFFFFFFF;
+                httpheader->ContentLength = HTTP_LENGTH_UNKNOWN;
             }
             else
             {
@@ -455,9 +492,34 @@ cuntinuerecvdata:
             }
             /*http head receive end, start to receive the body data now! */
             httpContext_p->ContentLength = httpheader->ContentLength;
-            UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--httpRecvHttpHead() Get ContentLength= %d-->\r\n",httpContext_p->ContentLength); 
+            if(httpheader->Transfer_Encoding_Is_chunked)
+            {
+                httpContext_p->ContentLength = HTTP_LENGTH_UNKNOWN;
+            }
+            if(httpContext_p->resumeoffset > 0)
+            {
+                if(206 == httpheader->httpresponse)
+                {
+                    // partial content: the length only covers what is left
+                    if(HTTP_LENGTH_UNKNOWN != httpContext_p->ContentLength)
+                    {
+                        httpContext_p->ContentLength += httpContext_p->resumeoffset;
+                    }
+                }
+                else
+                {
+                    // the server ignored "Range:", drop what is already in the fota region
+                    httpContext_p->skipbytes = httpContext_p->resumeoffset;
+                }
+            }
+            UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--httpRecvHttpHead() Get ContentLength= %d, resume at %d-->\r\n",httpContext_p->ContentLength, httpContext_p->resumeoffset); 
             httpContext_p->getbody = TRUE;
-            if(0xFFFFFFFF ==httpContext_p->ContentLength)
+            httpContext_p->bodyfill = 0;
+            if(0 == httpContext_p->dlstarttime)
+            {
+                httpContext_p->dlstarttime = Ql_GetMsSincePwrOn();
+            }
+            if(httpheader->Transfer_Encoding_Is_chunked)
             {
                 iret = http_RecvHttpChunkedBody(httpContext_p->socketid, FALSE);  
                 return iret;
@@ -495,140 +557,476 @@ cuntinuerecvdata:
     return HTTP_RESULT_OK; 
 }
 
-s8 http_RecvHttpChunkedBody(s32 socketid, bool bContinue)
-{
-    bool retValue;
-    FOTA_UPGRADE_IND(UP_UPGRADFAILED,0,retValue) ;
-    UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--Don't support http chuned encode !!-->\r\n");
-    FOTA_DBG_PRINT("<--Don't support http chuned encode !!-->\r\n");
-    return -1;
-}
-s8 http_RecvHttpBody(s32 socketid, bool bContinue)
+/*****************************************************************
+* Function:     http_FlushBlock
+*
+* Description:
+*               Program the accumulated block into the fota region, then
+*               refresh the download statistics and report the progress.
+* Return:
+*               HTTP_RESULT_OK, or -1 if the flash write failed.
+*****************************************************************/
+static s8 http_FlushBlock(HttpMainContext_t *httpContext_p)
 {
-    HttpMainContext_t *httpContext_p  = &httpMainContext;
     s32 ret;
-    bool retValue;
     s32 fileDLpresent;
-    s32 fileDLpresentReport;
-    u8 *recvbuffer;
-    s32 recvlength;
-    s32 willrecvlength;
+    bool retValue;
+    u64 now;
+    u32 stall;
+    u32 len = httpContext_p->bodyfill;
 
-cuntinuerecvbodydata:
+    if(0 == len)
+    {
+        return HTTP_RESULT_OK;
+    }
 
-    if(httpContext_p->genhttp_dstpos)
+    now = Ql_GetMsSincePwrOn();
+    ret = Ql_FOTA_WriteData(len, (s8*)httpContext_p->genhttp_dstconstptr);
+    stall = (u32)(Ql_GetMsSincePwrOn() - now);
+    UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<-- Fota write, len=%d, ret=%d, totlesize=%d, %dms -->\r\n", httpContext_p->receivedbodydata + len, ret, httpContext_p->ContentLength, stall);
+    if(ret != 0)
     {
-        Ql_memcpy(httpContext_p->genhttp_dstconstptr, httpContext_p->genhttp_dstconstptr + httpContext_p->genhttp_dstpos , httpContext_p->genhttp_dstvaliddatalen);
-        httpContext_p->genhttp_dstpos =  0;
+        UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--Ql_FOTA_WriteData failed(ret =%d)-->\r\n",ret); 
+        FOTA_DBG_PRINT("<-- Ql_FOTA_WriteData failed -->\r\n");
+        FOTA_UPGRADE_IND(UP_UPGRADFAILED,0,retValue);
+        return -1;
     }
-        
-    recvbuffer = httpContext_p->genhttp_dstconstptr+httpContext_p->genhttp_dstvaliddatalen;
-    willrecvlength = httpContext_p->genhttp_dstconstsize  - httpContext_p->genhttp_dstvaliddatalen;
+    httpContext_p->receivedbodydata += len;
+    httpContext_p->bodyfill = 0;
 
-    recvlength = 0;
-    UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--socket read body willrecvlength=%d-->\r\n", willrecvlength);
+    g_FOTA_DownloadStats.bodyBytes = httpContext_p->receivedbodydata;
+    g_FOTA_DownloadStats.elapsedMs = (u32)(now + stall - httpContext_p->dlstarttime);
+    g_FOTA_DownloadStats.bytesPerSec = g_FOTA_DownloadStats.elapsedMs ?
+        (u32)((u64)g_FOTA_DownloadStats.bodyBytes * 1000 / g_FOTA_DownloadStats.elapsedMs) : 0;
+    g_FOTA_DownloadStats.flashWrites++;
+    g_FOTA_DownloadStats.flashStallMs += stall;
+    if(stall > g_FOTA_DownloadStats.flashMaxStallMs)
+    {
+        g_FOTA_DownloadStats.flashMaxStallMs = stall;
+    }
 
-    if(willrecvlength && (!httpContext_p->bpeersocketclose))
+    if(HTTP_LENGTH_UNKNOWN != httpContext_p->ContentLength)
     {
-        recvlength = Ql_SOC_Recv(httpContext_p->socketid, recvbuffer, willrecvlength);
-        UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--socket read body recvlength = %d -->\r\n", recvlength);
-        if(recvlength == SOC_WOULDBLOCK)
+        fileDLpresent = (100*(httpContext_p->receivedbodydata))/httpContext_p->ContentLength;
+        if(fileDLpresent >= httpContext_p->lastpercent + 5)
+        {
+            httpContext_p->lastpercent = fileDLpresent - fileDLpresent%5;
+            FOTA_UPGRADE_IND(UP_GETTING_FILE,httpContext_p->lastpercent,retValue);
+        }
+    }
+    return HTTP_RESULT_OK;
+}
+
+/*****************************************************************
+* Function:     http_AppendBody
+*
+* Description:
+*               Add image bytes to the block at the front of the socket
+*               buffer; Ql_FOTA_WriteData is only called on full blocks
+*               of HTTP_FOTA_BLOCK_SIZE. The plain body is received in
+*               place so nothing moves; the chunked decoder passes its
+*               payload from further up the same buffer. Bytes the server
+*               sent again because it ignored "Range:" are dropped first.
+*               New image bytes reset the resume retry count.
+* Return:
+*               HTTP_RESULT_OK, or -1 if the flash write failed.
+*****************************************************************/
+static s8 http_AppendBody(HttpMainContext_t *httpContext_p, u8 *data, u32 len)
+{
+    s8 ret;
+    u32 n;
+    u8 *dst;
+
+    while(len > 0)
+    {
+        if(httpContext_p->skipbytes > 0)
+        {
+            n = (len < httpContext_p->skipbytes) ? len : httpContext_p->skipbytes;
+            httpContext_p->skipbytes -= n;
+            data += n;
+            len -= n;
+            continue;
+        }
+        if(HTTP_LENGTH_UNKNOWN != httpContext_p->ContentLength)
         {
-                if(FALSE == httpContext_p->httpGettimerstate)
+            n = httpContext_p->ContentLength - httpContext_p->receivedbodydata - httpContext_p->bodyfill;
+            if(len > n)
+            {
+                len = n;
+                if(0 == len)
                 {
-                    Ql_Timer_Start(httpContext_p->httpGetHeadTimer,httpContext_p->httpGettimeout,FALSE);
-                    httpContext_p->httpGettimerstate = FALSE;
+                    break;
                 }
-                return HTTP_RESULT_ERROR_WOULDBLOCK;
+            }
         }
-        else if(recvlength <= 0)
-        {
-            UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--body http soc_recv == 0-->");
-            FOTA_DBG_PRINT("<--body http soc_recv == 0-->\r\n");
-            httpContext_p->bpeersocketclose = TRUE;
 
-            return HTTP_RESULT_ERROR_SOC_CLOSE;
+        n = httpContext_p->genhttp_dstconstsize - httpContext_p->bodyfill;
+        if(n > len)
+        {
+            n = len;
         }
-        
-        httpContext_p->genhttp_dstvaliddatalen += recvlength;
-        //Ql_UART_Write(UART_PORT2, httpContext_p->genhttp_dstconstptr+httpContext_p->genhttp_dstpos,httpContext_p->genhttp_dstvaliddatalen );
-        /************  write the data to fota temp region*********************/
-        if(httpContext_p->receivedbodydata <= httpContext_p->ContentLength)
+        dst = httpContext_p->genhttp_dstconstptr + httpContext_p->bodyfill;
+        if(dst != data)
         {
-            ret = Ql_FOTA_WriteData(httpContext_p->genhttp_dstvaliddatalen,(s8*)(httpContext_p->genhttp_dstconstptr+httpContext_p->genhttp_dstpos));
-            UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<-- Fota write, len=%d, ret=%d, totlesize=%d -->\r\n", httpContext_p->receivedbodydata +httpContext_p->genhttp_dstvaliddatalen, ret, httpContext_p->ContentLength);
-            if(ret != 0)
+            Ql_memmove(dst, data, n);
+        }
+        httpContext_p->bodyfill += n;
+        data += n;
+        len -= n;
+        // image bytes flow again, the retry budget only counts drops in a row
+        httpContext_p->resumeretry = 0;
+
+        if(httpContext_p->bodyfill == httpContext_p->genhttp_dstconstsize)
+        {
+            ret = http_FlushBlock(httpContext_p);
+            if(HTTP_RESULT_OK != ret)
             {
-                UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--Ql_FOTA_WriteData failed(ret =%d)-->\r\n",ret); 
-                FOTA_DBG_PRINT("<-- Ql_FOTA_WriteData failed -->\r\n");
-                FOTA_UPGRADE_IND(UP_UPGRADFAILED,0,retValue);
-                return -1;
+                return ret;
             }
-            //Ql_Sleep(100);
-        }       
-        /*************************************************************/
-        httpContext_p->receivedbodydata += httpContext_p->genhttp_dstvaliddatalen;
-        httpContext_p->genhttp_dstvaliddatalen = 0;
-        httpContext_p->genhttp_dstpos =  0;
+        }
     }
+    return HTTP_RESULT_OK;
+}
+
+/*****************************************************************
+* Function:     http_FinishDownload
+*
+* Description:
+*               The whole image is in the fota region: finish it and
+*               ask the callback whether to upgrade now.
+*****************************************************************/
+static s8 http_FinishDownload(HttpMainContext_t *httpContext_p)
+{
+    s32 ret;
+    bool retValue;
 
-    fileDLpresent = (100*(httpContext_p->receivedbodydata))/httpContext_p->ContentLength;
-    if((0 == fileDLpresent%5) && (fileDLpresent != fileDLpresentReport))
+    // the tail of the image is a partial block
+    if(HTTP_RESULT_OK != http_FlushBlock(httpContext_p))
     {
-        fileDLpresentReport = fileDLpresent;
-        FOTA_UPGRADE_IND(UP_GETTING_FILE,fileDLpresentReport,retValue);
+        return -1;
     }
-    if(httpContext_p->receivedbodydata >= httpContext_p->ContentLength)
+
+    if(TRUE == httpContext_p->httpGettimerstate)
     {
-        //Ql_SOC_Close(httpContext_p->socketid);
-        FOTA_DBG_PRINT("<-- Close socket -->\r\n");
-        httpContext_p->socketid = -1;
-        httpContext_p->bpeersocketclose = TRUE;
-        UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--bodydata received End (%d)-->\r\n",httpContext_p->receivedbodydata);
-        FOTA_DBG_PRINT("<-- bodydata received End -->\r\n");
-        //FOTA_UPGRADE_IND(UP_GET_FILE_OK,100,retValue);
-        FOTA_DBG_PRINT("<-- Downloading finished -->\r\n");
-        if(NULL != httpContext_p->http_socketdata_p)
-        {
-            Ql_MEM_Free((void *)(httpContext_p->http_socketdata_p) );
-            httpContext_p->http_socketdata_p = NULL;
-        }
+        Ql_Timer_Stop(httpContext_p->httpGetHeadTimer);
+        httpContext_p->httpGettimerstate = FALSE;
+    }
+
+    //Ql_SOC_Close(httpContext_p->socketid);
+    FOTA_DBG_PRINT("<-- Close socket -->\r\n");
+    httpContext_p->socketid = -1;
+    httpContext_p->bpeersocketclose = TRUE;
+    UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--bodydata received End (%d)-->\r\n",httpContext_p->receivedbodydata);
+    FOTA_DBG_PRINT("<-- bodydata received End -->\r\n");
+    FOTA_UPGRADE_IND(UP_GET_FILE_OK,100,retValue);
+    FOTA_DBG_PRINT("<-- Downloading finished -->\r\n");
+    if(NULL != httpContext_p->http_socketdata_p)
+    {
+        Ql_MEM_Free((void *)(httpContext_p->http_socketdata_p) );
+        httpContext_p->http_socketdata_p = NULL;
+    }
+    Ql_Sleep(300);
+    ret = Ql_FOTA_Finish();     //Finish the upgrade operation ending with calling this API
+    if(ret !=0)
+    {
+        UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--Ql_FOTA_Finish failed(ret =%d)-->\r\n",ret); 
+        FOTA_DBG_PRINT("<-- Ql_FOTA_Finish failed -->\r\n");
+        FOTA_UPGRADE_IND(UP_UPGRADFAILED,0,retValue);
+        return -1;
+    }
+
+    FOTA_UPGRADE_IND(UP_SYSTEM_REBOOT,100,retValue);
+    if((NULL == Fota_UpgardeState) ||retValue)  //  if fota upgrade callback function return TRUE in the UP_SYSTEM_REBOOT case ,the system upgrade app at once.
+    {
+        UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--Fota upgrade callback return TRUE!!, system reboot for upgrade now-->\r\n");
+        FOTA_DBG_PRINT("<--Fota upgrade callback return TRUE!!, system reboot for upgrade now-->\r\n");
         Ql_Sleep(300);
-        ret = Ql_FOTA_Finish();     //Finish the upgrade operation ending with calling this API
-        if(ret !=0)
+        ret = Ql_FOTA_Update();  // set a flag then reboot the system , then the will  auto upgrade app.bin. 
+        if(ret != 0)
         {
-            UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--Ql_FOTA_Finish failed(ret =%d)-->\r\n",ret); 
-            FOTA_DBG_PRINT("<-- Ql_FOTA_Finish failed -->\r\n");
             FOTA_UPGRADE_IND(UP_UPGRADFAILED,0,retValue);
+            UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--Ql_FOTA_Update(ret =%d)-->\r\n",ret);     
+            FOTA_DBG_PRINT("<-- Ql_FOTA_Finish failed -->\r\n");
             return -1;
         }
+        ////If update OK, module will reboot automaticly
+    }
+    // if  upgrade state callback function return false, you must call Ql_FOTA_Update function  before you reboot the system
+    return HTTP_RESULT_OK;
+}
+
+/*****************************************************************
+* Function:     http_ResumeDownload
+*
+* Description:
+*               The link dropped in the middle of the image. Reconnect
+*               and ask for the rest with "Range:", starting at the
+*               checkpoint (receivedbodydata). Ql_FOTA_WriteData only
+*               writes sequentially, so the checkpoint lives as long as
+*               this upgrade session; a reboot starts over.
+* Return:
+*               TRUE if a resumed request was issued.
+*****************************************************************/
+static bool http_ResumeDownload(HttpMainContext_t *httpContext_p)
+{
+    s32 socketid;
+    bool retValue;
 
-        FOTA_UPGRADE_IND(UP_SYSTEM_REBOOT,100,retValue);
-        if((NULL == Fota_UpgardeState) ||retValue)  //  if fota upgrade callback function return TRUE in the UP_SYSTEM_REBOOT case ,the system upgrade app at once.
+    if((!httpContext_p->getbody && 0 == httpContext_p->resumeoffset) ||
+       (httpContext_p->resumeretry >= HTTP_RESUME_MAX_RETRY) ||
+       (NULL == httpContext_p->http_socketdata_p))
+    {
+        return FALSE;
+    }
+    httpContext_p->resumeretry++;
+
+    // the next response head is parsed in the same buffer, so the partial block goes out first
+    if(HTTP_RESULT_OK != http_FlushBlock(httpContext_p))
+    {
+        return FALSE;
+    }
+
+    if(TRUE == httpContext_p->httpGettimerstate)
+    {
+        Ql_Timer_Stop(httpContext_p->httpGetHeadTimer);
+        httpContext_p->httpGettimerstate = FALSE;
+    }
+    Ql_SOC_Close(httpContext_p->socketid);
+
+    UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--http link lost at %d, resume (%d/%d)-->\r\n", httpContext_p->receivedbodydata, httpContext_p->resumeretry, HTTP_RESUME_MAX_RETRY);
+    FOTA_DBG_PRINT("<--http link lost, resume download-->\r\n");
+    Ql_Sleep(HTTP_RESUME_RETRY_DELAY);
+
+    httpContext_p->getbody = FALSE;
+    httpContext_p->genhttp_dstpos = 0;
+    httpContext_p->genhttp_dstvaliddatalen = 0;
+    httpContext_p->resumeoffset = httpContext_p->receivedbodydata;
+    httpContext_p->skipbytes = 0;
+    httpContext_p->chunkstate = HTTP_CHUNK_SIZE;
+    httpContext_p->chunkremain = 0;
+    httpContext_p->chunklinelen = 0;
+    httpContext_p->httpheader.ContentLength_Exist_InHttpResponse = FALSE;
+    httpContext_p->httpheader.Transfer_Encoding_Is_chunked = FALSE;
+
+    socketid = Ql_SOC_CreateEx(httpContext_p->contextId, SOC_TYPE_TCP, Ql_OS_GetActiveTaskId(), Httpcallback_SOC_func);
+    if(socketid < 0)
+    {
+        UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--Create socket  FAILD return(err =%d) -->\r\n", socketid);
+        return FALSE;
+    }
+    httpContext_p->socketid = socketid;
+
+    FOTA_UPGRADE_IND(UP_CONNECTING,0,retValue);
+    http_GetImagefilefromServer();
+    return TRUE;
+}
+
+/*****************************************************************
+* Function:     http_DecodeChunked
+*
+* Description:
+*               Streaming decoder for "Transfer-Encoding: chunked".
+*               Keeps its state in the context so a chunk header may be
+*               split over any number of socket reads; chunk payload goes
+*               straight to the fota region.
+*****************************************************************/
+static s8 http_DecodeChunked(HttpMainContext_t *httpContext_p, u8 *data, u32 len)
+{
+    s8 ret;
+    u8 c;
+
+    while(len > 0 && HTTP_CHUNK_DONE != httpContext_p->chunkstate)
+    {
+        if(HTTP_CHUNK_DATA == httpContext_p->chunkstate)
         {
-            UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--Fota upgrade callback return TRUE!!, system reboot for upgrade now-->\r\n");
-            FOTA_DBG_PRINT("<--Fota upgrade callback return TRUE!!, system reboot for upgrade now-->\r\n");
-			Ql_Sleep(300);
-			ret = Ql_FOTA_Update();  // set a flag then reboot the system , then the will  auto upgrade app.bin. 
-            if(ret != 0)
+            u32 n = (len < httpContext_p->chunkremain) ? len : httpContext_p->chunkremain;
+            ret = http_AppendBody(httpContext_p, data, n);
+            if(HTTP_RESULT_OK != ret)
             {
-                FOTA_UPGRADE_IND(UP_UPGRADFAILED,0,retValue);
-                UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--Ql_FOTA_Update(ret =%d)-->\r\n",ret);     
-                FOTA_DBG_PRINT("<-- Ql_FOTA_Finish failed -->\r\n");
-                return -1;
-// fota update failed
+                return ret;
+            }
+            data += n;
+            len -= n;
+            httpContext_p->chunkremain -= n;
+            if(0 == httpContext_p->chunkremain)
+            {
+                httpContext_p->chunkstate = HTTP_CHUNK_DATA_END;
+            }
+            continue;
+        }
+
+        c = *data++;
+        len--;
+        switch(httpContext_p->chunkstate)
+        {
+        case HTTP_CHUNK_SIZE:
+        case HTTP_CHUNK_EXT:
+            if('\n' == c)
+            {
+                if(0 == httpContext_p->chunklinelen)
+                {
+                    return HTTP_RESULT_ERROR_DECODEERROR;
+                }
+                httpContext_p->chunklinelen = 0;
+                httpContext_p->chunkstate = httpContext_p->chunkremain ? HTTP_CHUNK_DATA : HTTP_CHUNK_TRAILER;
+            }
+            else if(HTTP_CHUNK_EXT == httpContext_p->chunkstate || '\r' == c)
+            {
+                // extension or line end, nothing to keep
+            }
+            else if(';' == c || ' ' == c || '\t' == c)
+            {
+                httpContext_p->chunkstate = HTTP_CHUNK_EXT;
             }
             else
             {
-                ////If update OK, module will reboot automaticly
+                u8 v;
+                if(c >= '0' && c <= '9')      v = c - '0';
+                else if(c >= 'a' && c <= 'f') v = c - 'a' + 10;
+                else if(c >= 'A' && c <= 'F') v = c - 'A' + 10;
+                else return HTTP_RESULT_ERROR_DECODEERROR;
+
+                if(httpContext_p->chunkremain > 0x0FFFFFFF)
+                {
+                    return HTTP_RESULT_ERROR_DECODEERROR;
+                }
+                httpContext_p->chunkremain = (httpContext_p->chunkremain << 4) | v;
+                httpContext_p->chunklinelen++;
+            }
+            break;
+
+        case HTTP_CHUNK_DATA_END:
+            if('\n' == c)
+            {
+                httpContext_p->chunkstate = HTTP_CHUNK_SIZE;
             }
+            else if('\r' != c)
+            {
+                return HTTP_RESULT_ERROR_DECODEERROR;
+            }
+            break;
+
+        case HTTP_CHUNK_TRAILER:
+            if('\n' == c)
+            {
+                if(0 == httpContext_p->chunklinelen)
+                {
+                    httpContext_p->chunkstate = HTTP_CHUNK_DONE;
+                }
+                httpContext_p->chunklinelen = 0;
+            }
+            else if('\r' != c)
+            {
+                httpContext_p->chunklinelen++;
+            }
+            break;
+
+        default:
+            break;
         }
-        else
+    }
+    return HTTP_RESULT_OK;
+}
+
+s8 http_RecvHttpChunkedBody(s32 socketid, bool bContinue)
+{
+    HttpMainContext_t *httpContext_p  = &httpMainContext;
+    s8 ret;
+    u8 *recvbuffer;
+    s32 recvlength;
+
+    // the bytes behind the http head are the start of the body
+    recvbuffer = httpContext_p->genhttp_dstconstptr + httpContext_p->genhttp_dstpos;
+    recvlength = httpContext_p->genhttp_dstvaliddatalen;
+    httpContext_p->genhttp_dstpos = 0;
+    httpContext_p->genhttp_dstvaliddatalen = 0;
+
+continuerecvchunkdata:
+
+    if(recvlength > 0)
+    {
+        ret = http_DecodeChunked(httpContext_p, recvbuffer, recvlength);
+        if(HTTP_RESULT_OK != ret)
         {
-            // if  upgrade state callback function return false, you must call Ql_FOTA_Update function  before you reboot the system
-            return HTTP_RESULT_OK;
+            UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--http chunked decode failed(ret =%d)-->\r\n", ret);
+            FOTA_DBG_PRINT("<--http chunked decode failed-->\r\n");
+            return ret;
         }
-    }      
+    }
+    if(HTTP_CHUNK_DONE == httpContext_p->chunkstate)
+    {
+        return http_FinishDownload(httpContext_p);
+    }
+
+    // receive behind the pending block, the decoder compacts the payload onto it
+    recvbuffer = httpContext_p->genhttp_dstconstptr + httpContext_p->bodyfill;
+    recvlength = Ql_SOC_Recv(httpContext_p->socketid, recvbuffer, httpContext_p->genhttp_dstconstsize - httpContext_p->bodyfill);
+    UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--socket read chunk recvlength = %d -->\r\n", recvlength);
+    if(recvlength == SOC_WOULDBLOCK)
+    {
+        http_StartReadTimer(httpContext_p);
+        return HTTP_RESULT_ERROR_WOULDBLOCK;
+    }
+    else if(recvlength <= 0)
+    {
+        UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--chunk http soc_recv == 0-->");
+        FOTA_DBG_PRINT("<--chunk http soc_recv == 0-->\r\n");
+        httpContext_p->bpeersocketclose = TRUE;
+        return HTTP_RESULT_ERROR_SOC_CLOSE;
+    }
+    goto continuerecvchunkdata;
+}
+
+s8 http_RecvHttpBody(s32 socketid, bool bContinue)
+{
+    HttpMainContext_t *httpContext_p  = &httpMainContext;
+    s8 ret;
+    u8 *recvbuffer;
+    s32 recvlength;
+
+    // the bytes behind the http head are the start of the body
+    recvbuffer = httpContext_p->genhttp_dstconstptr + httpContext_p->genhttp_dstpos;
+    recvlength = httpContext_p->genhttp_dstvaliddatalen;
+    httpContext_p->genhttp_dstpos = 0;
+    httpContext_p->genhttp_dstvaliddatalen = 0;
+
+cuntinuerecvbodydata:
+
+    if(recvlength > 0)
+    {
+        /************  write the data to fota temp region*********************/
+        ret = http_AppendBody(httpContext_p, recvbuffer, recvlength);
+        if(HTTP_RESULT_OK != ret)
+        {
+            return ret;
+        }
+    }
+    if(httpContext_p->receivedbodydata + httpContext_p->bodyfill >= httpContext_p->ContentLength)
+    {
+        return http_FinishDownload(httpContext_p);
+    }
+
+    // receive straight into the pending block
+    recvbuffer = httpContext_p->genhttp_dstconstptr + httpContext_p->bodyfill;
+    recvlength = Ql_SOC_Recv(httpContext_p->socketid, recvbuffer, httpContext_p->genhttp_dstconstsize - httpContext_p->bodyfill);
+    UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--socket read body recvlength = %d -->\r\n", recvlength);
+    if(recvlength == SOC_WOULDBLOCK)
+    {
+        http_StartReadTimer(httpContext_p);
+        return HTTP_RESULT_ERROR_WOULDBLOCK;
+    }
+    else if(recvlength <= 0)
+    {
+        UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--body http soc_recv == 0-->");
+        FOTA_DBG_PRINT("<--body http soc_recv == 0-->\r\n");
+        httpContext_p->bpeersocketclose = TRUE;
+        if(HTTP_LENGTH_UNKNOWN == httpContext_p->ContentLength)
+        {
+            // neither length nor chunked: the body ends with the connection
+            return http_FinishDownload(httpContext_p);
+        }
+        return HTTP_RESULT_ERROR_SOC_CLOSE;
+    }
     goto cuntinuerecvbodydata;
 }
 
@@ -641,6 +1039,10 @@ void Httpcallback_socket_read(s32 socketId, s32 errCode, void* customParam )
     UPGRADE_APP_DEBUG(FOTA_DBGBuffer, "<--callback socket read (socketId=%d, errCode=%d)--> \r\n",socketId, errCode);
     if(SOC_SUCCESS != errCode)
     {
+        if(http_ResumeDownload(httpContext_p))
+        {
+            return;
+        }
         FOTA_UPGRADE_IND(UP_UPGRADFAILED,0,retValue);
         Ql_MEM_Free(httpContext_p->http_socketdata_p);  // read socket data error ,end the foat upgrade.
         httpContext_p->http_socketdata_p = NULL;
@@ -658,11 +1060,11 @@ void Httpcallback_socket_read(s32 socketId, s32 errCode, void* customParam )
         httpContext_p->httpGettimerstate = FALSE;
     }
 
-    if(0 == httpContext_p->ContentLength) // head received END
+    if(!httpContext_p->getbody) // head not received END yet
     {
         ret = http_RecvHttpHead(httpContext_p->socketid, TRUE);
     }
-    else if(0xFFFFFFFF == httpContext_p->ContentLength)// chunked 
+    else if(httpContext_p->httpheader.Transfer_Encoding_Is_chunked)// chunked 
     {
         ret = http_RecvHttpChunkedBody(httpContext_p->socketid, TRUE);
     }
@@ -671,6 +1073,12 @@ void Httpcallback_socket_read(s32 socketId, s32 errCode, void* customParam )
         ret = http_RecvHttpBody(httpContext_p->socketid, TRUE);
     }
 
+    // the link dropped in the middle of the image, continue from the checkpoint
+    if(HTTP_RESULT_ERROR_SOC_CLOSE == ret && http_ResumeDownload(httpContext_p))
+    {
+        return;
+    }
+
     // Read http head (or http Body )failed . exit the upgrade.
     if(HTTP_RESULT_OK !=ret && HTTP_RESULT_ERROR_WOULDBLOCK != ret) //receive failed 
     {
@@ -703,7 +1111,13 @@ void Httpcallback_socket_connect(s32 socketId, s32 errCode, void* customParam )
 
 void Httpcallback_socket_close(s32 socketId, s32 errCode, void* customParam )
 {
-    
+    HttpMainContext_t *httpContext_p  = &httpMainContext;
+
+    // peer closed while downloading: drain what is left, then finish or resume from the read path
+    if((socketId == httpContext_p->socketid) && (NULL != httpContext_p->http_socketdata_p))
+    {
+        Httpcallback_socket_read(socketId, SOC_SUCCESS, customParam);
+    }
     return;
 }
 void Httpcallback_socket_accept(s32 listenSocketId, s32 errCode, void* customParam )
@@ -747,6 +1161,11 @@ void http_TimerCallback(u32 timerId, void* param)
     HttpMainContext_t *httpContext_p  = &httpMainContext;
     if(HTTP_GETREADTIMERID == timerId)// http send get head ,but server no response. or read data form http server no response
     {
+        httpContext_p->httpGettimerstate = FALSE;
+        if(http_ResumeDownload(httpContext_p))
+        {
+            return;
+        }
         FOTA_UPGRADE_IND(UP_UPGRADFAILED,0,retValue);
         UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--Http server no response !!-->\r\n");
         FOTA_DBG_PRINT("<--Http server no response !!-->\r\n");
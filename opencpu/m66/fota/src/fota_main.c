@@ -12,6 +12,7 @@
 #ifdef __OCPU_FOTA_APP__  
 Upgrade_State  g_FOTA_State = FOTA_STATE_END;
 Callback_Upgrade_State Fota_UpgardeState = NULL ;
+ST_FotaDownloadStats g_FOTA_DownloadStats;
 ST_FotaConfig  FotaConfig;
 ST_GprsConfig  Fota_gprsCfg;
 u8 Fota_apn[MAX_GPRS_APN_LEN] = "CMNET\0";
@@ -57,6 +58,7 @@ s32 Ql_FOTA_StartUpgrade(u8* url, ST_GprsConfig* apnCfg, Callback_Upgrade_State
         return -1;
     }
     /*---------------------------------------------------*/    
+    Ql_memset((void *)(&g_FOTA_DownloadStats), 0, sizeof(ST_FotaDownloadStats));
 
     if(NULL != callbcak_UpgradeState_Ind)
     {
@@ -105,6 +107,16 @@ s32 Ql_FOTA_StopUpgrade(void)
     return QL_RET_OK;
 }
 
+s32 Ql_FOTA_GetDownloadStats(ST_FotaDownloadStats* stats)
+{
+    if(NULL == stats)
+    {
+        return -1;
+    }
+    Ql_memcpy((void *)stats, (void *)(&g_FOTA_DownloadStats), sizeof(ST_FotaDownloadStats));
+    return 0;
+}
+
 /*****************************************************************
 * Function:     Fota_Upgrade_States
 *
@@ -144,11 +156,14 @@ static bool Fota_Upgrade_States(Upgrade_State state, s32 fileDLPercent)
             FOTA_DBG_PRINT("<-- conneced to the server now -->\r\n");
             break; 
         case UP_GETTING_FILE:
-            UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<-- getting the bin file (%d) -->\r\n", fileDLPercent);
+            UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<-- getting the bin file (%d), %d B/s, flash %d/%dms -->\r\n", fileDLPercent,
+                g_FOTA_DownloadStats.bytesPerSec, g_FOTA_DownloadStats.flashStallMs, g_FOTA_DownloadStats.flashMaxStallMs);
             FOTA_DBG_PRINT("<-- getting the bin file  -->\r\n");
             break;     
         case UP_GET_FILE_OK:
-            UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--file down OK (%d) -->\r\n", fileDLPercent);
+            UPGRADE_APP_DEBUG(FOTA_DBGBuffer,"<--file down OK (%d), %d bytes in %dms, %d writes, flash %d/%dms -->\r\n", fileDLPercent,
+                g_FOTA_DownloadStats.bodyBytes, g_FOTA_DownloadStats.elapsedMs, g_FOTA_DownloadStats.flashWrites,
+                g_FOTA_DownloadStats.flashStallMs, g_FOTA_DownloadStats.flashMaxStallMs);
             FOTA_DBG_PRINT("<--file down OK -->\r\n");
             break;  
         case UP_UPGRADFAILED:
@@ -187,20 +187,120 @@ const static ST_URC_HDLENTRY m_AtURCHdlEntry[] = {
     {"\r\n+QNTP:",							  	  OnURCHandler_NTPCMD},
 };
 
+/****************************************************/
+/* URC dispatch index                               */
+/* -------------------------------------------------*/
+/* Every keyword starts with "\r\n". Entries are    */
+/* hashed on their head (up to ':' or end of line), */
+/* a URC is looked up once per "\r\n" it contains  */
+/* with one Ql_strncmp per bucket entry. Table      */
+/* order (system URCs first) is kept inside each    */
+/* bucket, so the result is that of Ql_strstr with  */
+/* every keyword in table order, as before.         */
+/****************************************************/
+#define URC_ENTRY_NUM       (NUM_ELEMS(m_SysURCHdlEntry) + NUM_ELEMS(m_AtURCHdlEntry))
+#define URC_HASH_BUCKETS    32
+#define URC_INDEX_NIL       0xFF
+
+typedef struct {
+    const ST_URC_HDLENTRY* entry;
+    u8  keyLen;     // keyword length without the leading "\r\n"
+    u8  next;       // next entry in the same bucket, or URC_INDEX_NIL
+}ST_URC_INDEX;
+
+static ST_URC_INDEX m_URCIndex[URC_ENTRY_NUM];
+static u8   m_URCBucket[URC_HASH_BUCKETS];
+static bool m_URCIndexReady = FALSE;
+
+static u32 URC_HashHead(const char* head)
+{
+    u32 hash = 0;
+    while (*head != '\0' && *head != '\r' && *head != '\n')
+    {
+        hash = hash * 31 + (u8)*head;
+        if (*head++ == ':')
+        {
+            break;
+        }
+    }
+    return hash % URC_HASH_BUCKETS;
+}
+
+static void URC_BuildIndex(void)
+{
+    s32 i;
+    u8 bucket;
+
+    Ql_memset(m_URCBucket, URC_INDEX_NIL, sizeof(m_URCBucket));
+    // Insert backwards so that each bucket keeps the table order
+    for (i = URC_ENTRY_NUM - 1; i >= 0; i--)
+    {
+        if (i < (s32)NUM_ELEMS(m_SysURCHdlEntry))
+        {
+            m_URCIndex[i].entry = &m_SysURCHdlEntry[i];
+        }else{
+            m_URCIndex[i].entry = &m_AtURCHdlEntry[i - NUM_ELEMS(m_SysURCHdlEntry)];
+        }
+        m_URCIndex[i].keyLen = Ql_strlen(m_URCIndex[i].entry->keyword) - 2;
+        bucket = URC_HashHead(m_URCIndex[i].entry->keyword + 2);
+        m_URCIndex[i].next = m_URCBucket[bucket];
+        m_URCBucket[bucket] = (u8)i;
+    }
+    m_URCIndexReady = TRUE;
+}
+
+static const ST_URC_HDLENTRY* URC_Lookup(const char* strURC)
+{
+    const char* head;
+    u8 i, found = URC_INDEX_NIL;
+
+    if (!m_URCIndexReady)
+    {
+        URC_BuildIndex();
+    }
+    // a keyword may sit anywhere in the string, the lowest table index wins
+    for (head = Ql_strstr(strURC, "\r\n"); head && found != 0; head = Ql_strstr(head + 2, "\r\n"))
+    {
+        for (i = m_URCBucket[URC_HashHead(head + 2)]; i < found; i = m_URCIndex[i].next)
+        {
+            if (0 == Ql_strncmp(head + 2, m_URCIndex[i].entry->keyword + 2, m_URCIndex[i].keyLen))
+            {
+                found = i;
+            }
+        }
+    }
+    return (found != URC_INDEX_NIL) ? m_URCIndex[found].entry : NULL;
+}
+
+// What follows keyword in strURC, leading spaces skipped; NULL if it is not there
+static const char* URC_Payload(const char* strURC, const char* keyword)
+{
+    const char* p = Ql_strstr(strURC, keyword);
+
+    if (NULL == p)
+    {
+        return NULL;
+    }
+    p += Ql_strlen(keyword);
+    while (*p == ' ')
+    {
+        p++;
+    }
+    return p;
+}
+
 static void OnURCHandler_SIM(const char* strURC, void* reserved)
 {
     char* p1 = NULL;
     char* p2 = NULL;
     char strTmp[20];
-    s32 len;
     extern s32 RIL_SIM_GetSimStateByName(char* simStat, u32 len);
 
     Ql_memset(strTmp, 0x0, sizeof(strTmp));
-    len = Ql_sprintf(strTmp, "\r\n+CPIN: ");
+    Ql_sprintf(strTmp, "\r\n+CPIN: ");
     if (Ql_StrPrefixMatch(strURC, strTmp))
     {
-        p1 = Ql_strstr(strURC, "\r\n+CPIN: ");
-        p1 += len;
+        p1 = (char*)URC_Payload(strURC, "\r\n+CPIN:");
         p2 = Ql_strstr(p1, "\r\n");
         if (p1 && p2)
         {
@@ -221,8 +321,7 @@ static void OnURCHandler_Network(const char* strURC, void* reserved)
     if (Ql_StrPrefixMatch(strURC, "\r\n+CREG: "))
     {
         u32 nwStat;
-        p1 = Ql_strstr(strURC, "\r\n+CREG: ");
-        p1 += Ql_strlen("\r\n+CREG: ");
+        p1 = (char*)URC_Payload(strURC, "\r\n+CREG:");
 		if(*(p1+1) == 0x2C)          //Active query network status without reporting URCS
 		{
 		   return;
@@ -239,8 +338,7 @@ static void OnURCHandler_Network(const char* strURC, void* reserved)
     else if (Ql_StrPrefixMatch(strURC, "\r\n+CGREG: "))
     {
         u32 nwStat;
-        p1 = Ql_strstr(strURC, "\r\n+CGREG: ");
-        p1 += Ql_strlen("\r\n+CGREG: ");
+        p1 = (char*)URC_Payload(strURC, "\r\n+CGREG:");
 		if(*(p1+1) == 0x2C)          //Active query network status without reporting URCS
 		{
 		   return;
@@ -406,13 +504,10 @@ static void OnURCHandler_CFUN(const char* strURC, void* reserved)
     char* p1 = NULL;
     char* p2 = NULL;
     char strTmp[10];
-    s32 len;
     u32 cfun;
 
-    len = Ql_strlen("\r\n+CFUN: ");
-    p1 = Ql_strstr(strURC, "\r\n+CFUN: ");
-    p1 += len;
-    p2 = Ql_strstr(p1, "\r\n");
+    p1 = (char*)URC_Payload(strURC, "\r\n+CFUN:");
+    p2 = p1 ? Ql_strstr(p1, "\r\n") : NULL;
     if (p1 && p2)
     {
         Ql_memset(strTmp, 0x0, sizeof(strTmp));
@@ -539,31 +634,18 @@ static void OnURCHandler_AudPlayInd(const char* strURC, void* reserved)
 *****************************************************************/
 void OnURCHandler(const char* strURC, void* reserved)
 {
-    s32 i;
+    const ST_URC_HDLENTRY* pEntry;
     
     if (NULL == strURC)
     {
         return;
     }
 
-    // For system URCs
-    for (i = 0; i < NUM_ELEMS(m_SysURCHdlEntry); i++)
-    {
-        if (Ql_strstr(strURC, m_SysURCHdlEntry[i].keyword))
-        {
-            m_SysURCHdlEntry[i].handler(strURC, reserved);
-            return;
-        }
-    }
-
-    // For AT URCs
-    for (i = 0; i < NUM_ELEMS(m_AtURCHdlEntry); i++)
+    pEntry = URC_Lookup(strURC);
+    if (pEntry)
     {
-        if (Ql_strstr(strURC, m_AtURCHdlEntry[i].keyword))
-        {
-            m_AtURCHdlEntry[i].handler(strURC, reserved);
-            return;
-        }
+        pEntry->handler(strURC, reserved);
+        return;
     }
 
     // For undefined URCs
@@ -586,22 +668,11 @@ void OnURCHandler(const char* strURC, void* reserved)
 ******************************************************************************/
 s32 Ql_RIL_IsURCStr(const char* strRsp)
 {
-    s32 i;
-    for (i = 0; i < NUM_ELEMS(m_SysURCHdlEntry); i++) 
+    if (NULL == strRsp)
     {
-        if (Ql_strstr(strRsp, m_SysURCHdlEntry[i].keyword)) 
-        {
-            return 1;
-        }
-    }
-    for (i = 0; i < NUM_ELEMS(m_AtURCHdlEntry); i++) 
-    {
-        if (Ql_strstr(strRsp, m_AtURCHdlEntry[i].keyword)) 
-        {
-            return 1;
-        }
+        return 0;
     }
-    return 0;
+    return (URC_Lookup(strRsp) != NULL) ? 1 : 0;
 }
 
 #endif  // __OCPU_RIL_SUPPORT__
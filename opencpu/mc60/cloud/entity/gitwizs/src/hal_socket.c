@@ -257,7 +257,8 @@ void Hal_Login_MQTT_TCP_Init(void)
     gw_ctx->mqttctx->handle_cmd_arg = (void *)gw_ctx;
 
     gw_ctx->cmdid[0] = '\0';
-    MqttBuffer_Init(gw_ctx->mqttbuf);  
+    // gw_ctx is static, so Reset is a valid first init and keeps the arena on reconnect
+    MqttBuffer_Reset(gw_ctx->mqttbuf);
 }
 
 
@@ -11,9 +11,23 @@
 #define QUECTEL_HTTP_URL_LENGTH 200
 #define QUECTEL_HTTP_DOMAINNAME_LENGTH 150
 #define QUECTEL_HTTP_DATABUFFER_SIZE 512
+#define HTTP_FOTA_BLOCK_SIZE    (2*QUECTEL_HTTP_DATABUFFER_SIZE) // socket buffer, and the unit handed to Ql_FOTA_WriteData
 #define HTTP_SERVICE_PORT 80
 #define HTTP_GETREADTIMEROUT  120000 // 2 mins for read socket timerout
 #define HTTP_GETREADTIMERID  0x2F
+#define HTTP_LENGTH_UNKNOWN  0xFFFFFFFF
+#define HTTP_RESUME_MAX_RETRY   5     // reconnect with "Range:" this many times in a row without progress before giving up
+#define HTTP_RESUME_RETRY_DELAY 2000  // ms to wait before reconnecting
+
+typedef enum HttpChunkStateTag
+{
+    HTTP_CHUNK_SIZE = 0,    // hex chunk size
+    HTTP_CHUNK_EXT,         // chunk extension, skipped up to LF
+    HTTP_CHUNK_DATA,        // chunk payload
+    HTTP_CHUNK_DATA_END,    // CRLF after the payload
+    HTTP_CHUNK_TRAILER,     // trailer lines after the last chunk
+    HTTP_CHUNK_DONE
+}HttpChunkState_e;
 
 
 typedef enum HttpResultTag
@@ -48,10 +62,21 @@ typedef struct HttpMainContextTag
     u8       Address[QUECTEL_HTTP_URL_LENGTH+1];
     u32     AddressValidLegth;
 
-    u32     ContentLength;
+    u32     ContentLength;  // whole image length, HTTP_LENGTH_UNKNOWN if the server did not tell
 
     bool    getbody;
-    u32     receivedbodydata;
+    u32     receivedbodydata;   // bytes written to the fota region, the resume checkpoint
+    u32     resumeoffset;       // receivedbodydata when the current request was sent
+    u32     skipbytes;          // body bytes to drop when the server ignored "Range:"
+    u8      resumeretry;        // reconnects since the last new image byte
+    s32     lastpercent;
+
+    HttpChunkState_e chunkstate;
+    u32     chunkremain;
+    u32     chunklinelen;
+
+    u32     bodyfill;       // image bytes pending at the front of the socket buffer
+    u64     dlstarttime;    // ms, first body byte of this upgrade
     
     u8   	hostip[30];
     u16      hostport;
@@ -41,6 +41,14 @@ typedef enum {
     CHAR_F = 'F',
     END_OF_STR = '\0'
 }Enum_Char;
+typedef enum {
+    RIL_FINAL_NONE = 0,
+    RIL_FINAL_OK,
+    RIL_FINAL_ERROR,
+    RIL_FINAL_CME_ERROR,
+    RIL_FINAL_CMS_ERROR
+}Enum_RILFinalResult;
+
 #define IS_NUMBER(alpha_char)   \
     (((alpha_char >= CHAR_0) && (alpha_char <= CHAR_9) ) ? 1 : 0)
 
@@ -91,4 +99,23 @@ extern char* Ql_RIL_FindString(char *line, u32 len,char *str);
 ******************************************************************************/
 extern char* Ql_RIL_FindLine(char *line, u32 len,char *str);
 
+/******************************************************************************
+* Function:     Ql_RIL_FindFinalResult
+*  
+* Description:
+*                This function looks for the final result of an AT command
+*                ("OK", "ERROR", "+CME ERROR:", "+CMS ERROR:") in one scan.
+*                "OK" and "ERROR" are matched line by line like Ql_RIL_FindLine.
+*
+* Parameters:    
+*                line:  
+*                    [in]The address of the string.
+*                len:   
+*                    [in]The length of the string.
+*
+* Return:  
+                One of Enum_RILFinalResult, RIL_FINAL_NONE if no final result is found.
+******************************************************************************/
+extern Enum_RILFinalResult Ql_RIL_FindFinalResult(char *line, u32 len);
+
 #endif
@@ -72,21 +72,20 @@ s32 Ql_RIL_AT_SetErrCode(s32 errCode) {m_iErrCode = errCode;}
 ******************************************************************************/
 s32 Default_atRsp_callback(char* line, u32 len, void* userdata)
 {
-    if (Ql_RIL_FindLine(line, len, "OK"))// find <CR><LF>OK<CR><LF>,OK<CR><LF>, <CR>OK<CR>£¬<LF>OK<LF>
+    switch (Ql_RIL_FindFinalResult(line, len))
     {
+    case RIL_FINAL_OK:
         m_iErrCode = RIL_ATRSP_SUCCESS;
         return  RIL_ATRSP_SUCCESS;
-    }
-    else if (Ql_RIL_FindLine(line, len, "ERROR")) // find <CR><LF>ERROR<CR><LF>, <CR>ERROR<CR>£¬<LF>ERROR<LF>
-    {
+    case RIL_FINAL_ERROR:
         m_iErrCode = RIL_ATRSP_FAILED;
         return  RIL_ATRSP_FAILED;
-    }
-    else if (Ql_RIL_FindString(line, len, "+CME ERROR:") || 
-              Ql_RIL_FindString(line, len, "+CMS ERROR:"))
-    {
+    case RIL_FINAL_CME_ERROR:
+    case RIL_FINAL_CMS_ERROR:
         Ql_sscanf(line, "%*[^:]: %d\r\n", &m_iErrCode);
         return  RIL_ATRSP_FAILED;
+    default:
+        break;
     }
     return RIL_ATRSP_CONTINUE; //continue wait
 }
@@ -257,28 +257,22 @@ static char sg_aDbgBuf[DBG_BUF_MAX_LEN];
 #define SMS_HDLR_CHECK_ERROR(pLine,uLen,DbgFunName) \
     do  \
     {   \
-        if(NULL != Ql_RIL_FindLine((pLine),(uLen),"OK"))    \
+        switch(Ql_RIL_FindFinalResult((pLine),(uLen)))  \
         {   \
+        case RIL_FINAL_OK:  \
             DBG_TRACE(sg_aDbgBuf,"Enter " DbgFunName ",SUCCESS. Find string: \"OK\"\r\n"); \
             return RIL_ATRSP_SUCCESS;   \
-        }   \
-            \
-        if(NULL != Ql_RIL_FindLine((pLine), (uLen), "ERROR"))   \
-        {   \
+        case RIL_FINAL_ERROR:   \
             DBG_TRACE(sg_aDbgBuf,"Enter " DbgFunName ",SUCCESS. Find string: \"ERROR\"\r\n"); \
             return RIL_ATRSP_FAILED;    \
-        }   \
-            \
-        if(NULL != Ql_RIL_FindString((pLine), (uLen), "+CME ERROR:")) \
-        {   \
+        case RIL_FINAL_CME_ERROR:   \
             DBG_TRACE(sg_aDbgBuf,"Enter " DbgFunName ",SUCCESS. Find string: \"+CME ERROR:\"\r\n"); \
             return RIL_ATRSP_FAILED;    \
-        }   \
-            \
-        if(NULL != Ql_RIL_FindString((pLine), (uLen), "+CMS ERROR:"))   \
-        {   \
+        case RIL_FINAL_CMS_ERROR:   \
             DBG_TRACE(sg_aDbgBuf,"Enter " DbgFunName ",SUCCESS. Find string: \"+CMS ERROR:\"\r\n"); \
             return RIL_ATRSP_FAILED;    \
+        default:    \
+            break;  \
         }   \
     } while(0);
 
@@ -112,32 +112,63 @@ bool Ql_HexStrToInt(u8* str, u32* val)
 ******************************************************************************/
 char* Ql_RIL_FindString(char *line, u32 len,char *str)
 {
-    s32 i;
-    s32 strlen;
-    char *p;
+    u32 i;
+    u32 strlen;
 
     if ((NULL == line) || (NULL == str))
         return NULL;
     
     strlen = Ql_strlen(str);
-    if(strlen > len)
+    if (strlen > len)
     {
         return NULL;
     }
+    if (0 == strlen)
+    {
+        return line;
+    }
 
-    p = line;
-    for (i = 0;i < len - strlen + 1; i++)
+    for (i = 0; i + strlen <= len; i++)
     {
-        if (0 == Ql_strncmp (p, str, strlen))
+        if ((line[i] == str[0]) && (0 == Ql_memcmp(line + i, str, strlen)))
         {
-            return p;
-        }else{
-            p++;
+            return line + i;
         }
     }
     return NULL;
 }
 
+/*
+ * Checks the terminators around an occurrence of a string (strlen bytes) at line[pos].
+ * Returns the start of <CR><LF>str<CR><LF>, or -1. The start of the first
+ * <CR>str<CR>, <LF>str<LF> or str<CR><LF> form is stored in *pPart if not set yet.
+ */
+static s32 RIL_MatchLineAt(char *line, u32 len, u32 pos, u32 strlen, s32 *pPart)
+{
+    u32 end = pos + strlen;
+
+    if ((pos >= 2) && (end + 2 <= len) &&
+        (line[pos - 2] == '\r') && (line[pos - 1] == '\n') &&
+        (line[end] == '\r') && (line[end + 1] == '\n'))
+    {
+        return pos - 2;
+    }
+    if (*pPart < 0)
+    {
+        if ((pos >= 1) && (end + 1 <= len) &&
+            (((line[pos - 1] == '\r') && (line[end] == '\r')) ||
+             ((line[pos - 1] == '\n') && (line[end] == '\n'))))
+        {
+            *pPart = pos - 1;
+        }
+        else if ((end + 2 <= len) && (line[end] == '\r') && (line[end + 1] == '\n'))
+        {
+            *pPart = pos;
+        }
+    }
+    return -1;
+}
+
 /******************************************************************************
 * Function:     Ql_RIL_FindLine
 *  
@@ -161,83 +192,111 @@ char* Ql_RIL_FindString(char *line, u32 len,char *str)
 ******************************************************************************/
 char* Ql_RIL_FindLine(char *line, u32 len,char *str)
 {
-    s32 i = 0;
-    s32 strlen = 0;
-    char *p = NULL;
-    char *pStr = NULL;
-    char *pStr2 = NULL;
-    char *pStr3 = NULL;
+    u32 i;
+    u32 strlen;
+    s32 full;
+    s32 part = -1;
 
     if ((NULL == line) || (NULL == str))
         return NULL;
     
-    strlen = Ql_strlen (str);
-    
-    pStr = Ql_MEM_Alloc(strlen + 4 + 1);
-    if (NULL == pStr)
-         return NULL;
-    
-    if (len >= strlen + 4)//two \r\n
+    strlen = Ql_strlen(str);
+    if (len < strlen + 2)
+    {
+        return NULL;
+    }
+
+    // One scan: <CR><LF>str<CR><LF> wins, otherwise the first of the shorter forms
+    for (i = 0; i + strlen <= len; i++)
     {
-        p = line;
-        Ql_memset(pStr, 0, strlen + 5);
-        Ql_sprintf(pStr,"\r\n%s\r\n",str);
-        for (i = 0;i < len - (strlen + 4) + 1; i++)
+        if ((0 == strlen) || ((line[i] == str[0]) && (0 == Ql_memcmp(line + i, str, strlen))))
         {
-            if (0 == Ql_strncmp(p, pStr, strlen + 4))
+            full = RIL_MatchLineAt(line, len, i, strlen, &part);
+            if (full >= 0)
             {
-                Ql_MEM_Free(pStr);
-                return p;
-            }else{
-                p++;
+                return line + full;
             }
         }
     }
+    return (part >= 0) ? (line + part) : NULL;
+}
 
-    if (len >= strlen + 2)//two \r or two\n
-    {
-        p = line;
-
-        // <CR>xx<CR>
-        Ql_memset(pStr, 0, strlen + 5);
-        Ql_sprintf(pStr,"\r%s\r",str);
-
-        // <LF>xx<LF>
-        pStr2 = (char*)Ql_MEM_Alloc(strlen + 5);
-        Ql_memset(pStr2, 0, strlen + 5);
-        Ql_sprintf(pStr2,"\n%s\n",str);
+/******************************************************************************
+* Function:     Ql_RIL_FindFinalResult
+*  
+* Description:
+*                This function looks for the final result of an AT command in one
+*                scan. It is equivalent to checking, in this order,
+*                Ql_RIL_FindLine(line, len, "OK"), Ql_RIL_FindLine(line, len, "ERROR"),
+*                Ql_RIL_FindString(line, len, "+CME ERROR:") and
+*                Ql_RIL_FindString(line, len, "+CMS ERROR:").
+*
+* Parameters:    
+*                line:  
+*                    [in]The address of the string.
+*                len:   
+*                    [in]The length of the string.
+*
+* Return:  
+*                One of Enum_RILFinalResult, RIL_FINAL_NONE if no final result is found.
+******************************************************************************/
+Enum_RILFinalResult Ql_RIL_FindFinalResult(char *line, u32 len)
+{
+    u32 i;
+    s32 partOK = -1;
+    s32 partError = -1;
+    bool error = FALSE;
+    bool cmeError = FALSE;
+    bool cmsError = FALSE;
 
-        // xx<CR><LF>
-        pStr3 = (char*)Ql_MEM_Alloc(strlen + 5);
-        Ql_memset(pStr3, 0, strlen + 5);
-        Ql_sprintf(pStr3,"%s\r\n",str);
+    if (NULL == line)
+        return RIL_FINAL_NONE;
 
-        for (i = 0;i < len - (strlen + 2) + 1; i++)
+    for (i = 0; i < len; i++)
+    {
+        switch (line[i])
         {
-            if ((0 == Ql_strncmp (p, pStr, strlen + 2)) ||
-                (0 == Ql_strncmp (p, pStr2, strlen + 2)) ||
-                (0 == Ql_strncmp (p, pStr3, strlen + 2)))
+        case 'O':
+            if ((i + 2 <= len) && (line[i + 1] == 'K'))
             {
-                Ql_MEM_Free(pStr);
-                Ql_MEM_Free(pStr2);
-                Ql_MEM_Free(pStr3);
-                pStr = NULL;
-                pStr2 = NULL;
-                pStr3 = NULL;
-                return p;
-            }else{
-                p++;
+                if (RIL_MatchLineAt(line, len, i, 2, &partOK) >= 0)
+                {
+                    return RIL_FINAL_OK;
+                }
             }
+            break;
+        case 'E':
+            if (!error && (i + 5 <= len) && (0 == Ql_memcmp(line + i, "ERROR", 5)))
+            {
+                error = (RIL_MatchLineAt(line, len, i, 5, &partError) >= 0);
+            }
+            break;
+        case '+':
+            if ((i + 11 <= len) && (0 == Ql_memcmp(line + i + 4, " ERROR:", 7)))
+            {
+                if (0 == Ql_memcmp(line + i + 1, "CME", 3))
+                {
+                    cmeError = TRUE;
+                }
+                else if (0 == Ql_memcmp(line + i + 1, "CMS", 3))
+                {
+                    cmsError = TRUE;
+                }
+            }
+            break;
+        default:
+            break;
         }
-        Ql_MEM_Free(pStr2);
-        Ql_MEM_Free(pStr3);
-        pStr2 = NULL;
-        pStr3 = NULL;
     }
-    Ql_MEM_Free(pStr);
-    pStr = NULL;
-    
-    return NULL;
+    if (partOK >= 0)
+        return RIL_FINAL_OK;
+    if (error || (partError >= 0))
+        return RIL_FINAL_ERROR;
+    if (cmeError)
+        return RIL_FINAL_CME_ERROR;
+    if (cmsError)
+        return RIL_FINAL_CMS_ERROR;
+    return RIL_FINAL_NONE;
 }
 
 u32 Ql_GenHash(char* strSrc, u32 len)
@@ -0,0 +1,257 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   gpio_sysfs_bench.c
+ *
+ * Description:
+ * ------------
+ *   GPIO value and register access rates, old per call open/close paths
+ *   against the cached fds and the single register mapping. It runs on
+ *   a host against a fake sysfs tree and a sparse file for /dev/mem:
+ *
+ *   gcc -O2 -pthread -I../../interface gpio_sysfs_bench.c \
+ *       ../../interface/gpioSysfs.c ../../interface/ql_gpio.c -o gpio_sysfs_bench
+ *   ./gpio_sysfs_bench [iterations]
+ *
+ *   On the module it can use the real tree: ./gpio_sysfs_bench N /sys/class/gpio
+ *   (the pins below must be free). Edge waiting needs the real tree,
+ *   regular files can not be polled.
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ql_oe.h"
+#include "gpioSysfs.h"
+
+static const Enum_PinName pins[] = {
+    PINNAME_GPIO1, PINNAME_GPIO2, PINNAME_GPIO3, PINNAME_GPIO4,
+    PINNAME_GPIO5, PINNAME_GPIO6, PINNAME_GPIO7, PINNAME_GPIO8
+};
+#define PINS (sizeof(pins) / sizeof(pins[0]))
+
+static char root[64];
+static char mem[80];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int open_fds(void)
+{
+    int n = 0;
+    DIR* dir = opendir("/proc/self/fd");
+    while (dir && readdir(dir))
+    {
+        n++;
+    }
+    if (dir)
+    {
+        closedir(dir);
+    }
+    return n;
+}
+
+static void report(const char* name, int iterations, double sec)
+{
+    printf("%-22s %10.0f ops/s  %7.2f us/op\n", name, iterations / sec, sec * 1e6 / iterations);
+}
+
+static void fake_file(const char* dir, const char* name, const char* content)
+{
+    char path[128];
+    FILE* fp;
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    fp = fopen(path, "w");
+    fputs(content, fp);
+    fclose(fp);
+}
+
+static void fake_tree(void)
+{
+    unsigned int i;
+    int fd;
+
+    strcpy(root, "/tmp/gpio_sysfs_bench.XXXXXX");
+    if (!mkdtemp(root))
+    {
+        perror("mkdtemp");
+        exit(1);
+    }
+    fake_file(root, "export", "");
+    fake_file(root, "unexport", "");
+    for (i = 0; i < PINS; i++)
+    {
+        char dir[96];
+        snprintf(dir, sizeof(dir), "%s/%s", root, GetGpioItemByPin(pins[i])->gpioName);
+        mkdir(dir, 0755);
+        fake_file(dir, "value", "0\n");
+        fake_file(dir, "direction", "out\n");
+        fake_file(dir, "edge", "none\n");
+        fake_file(dir, "active_low", "0\n");
+    }
+    snprintf(mem, sizeof(mem), "%s/mem", root);
+    fd = open(mem, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || ftruncate(fd, 0x1000000 + 128 * 0x1000))
+    {
+        perror(mem);
+        exit(1);
+    }
+    close(fd);
+}
+
+/* what GpioSysfs_WriteValue did: opendir check, fopen, fwrite, fclose */
+static void old_write(const char* gpioName, int level)
+{
+    char path[128];
+    char attr[16];
+    DIR* dir;
+    FILE* fp;
+    snprintf(path, sizeof(path), "%s/%s/%s", root, gpioName, "value");
+    snprintf(attr, sizeof(attr), "%d", level);
+    dir = opendir(path);
+    if (dir)
+    {
+        closedir(dir);
+    }
+    fp = fopen(path, "w");
+    fwrite(attr, 1, strlen(attr), fp);
+    fflush(fp);
+    fclose(fp);
+}
+
+static int old_read(const char* gpioName)
+{
+    char path[128];
+    char result[17];
+    int c, i = 0;
+    DIR* dir;
+    FILE* fp;
+    snprintf(path, sizeof(path), "%s/%s/%s", root, gpioName, "value");
+    dir = opendir(path);
+    if (dir)
+    {
+        closedir(dir);
+    }
+    fp = fopen(path, "r");
+    while (((c = fgetc(fp)) != EOF) && (i < 16))
+    {
+        result[i++] = c;
+    }
+    result[i] = 0;
+    fclose(fp);
+    return atoi(result);
+}
+
+/* what Ql_Write_Register did, plus the munmap/close it was missing */
+static void old_register(unsigned char gpio, unsigned char val)
+{
+    uintptr_t addr = 0x1000000 + 0x1000 * gpio;
+    int fd = open(mem, O_RDWR | O_SYNC);
+    void* page = mmap(0, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, addr & ~4095);
+    volatile uint32_t* x = (volatile uint32_t*)page;
+    *x = (*x & ~3u) | val;
+    munmap(page, 4096);
+    close(fd);
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    const char* gpioName = GetGpioItemByPin(pins[0])->gpioName;
+    unsigned char gpio = GetGpioItemByPin(pins[0])->gpioNum;
+    int i, fds, edge;
+    double t;
+
+    if (argc > 2)
+    {
+        strncpy(root, argv[2], sizeof(root) - 1);
+        strcpy(mem, "/dev/mem");
+        for (i = 0; i < (int)PINS; i++)
+        {
+            Ql_GPIO_Init(pins[i], PINDIRECTION_OUT, PINLEVEL_LOW, PINPULLSEL_DISABLE);
+        }
+    }
+    else
+    {
+        fake_tree();
+    }
+    GpioSysfs_SetPaths(root, mem);
+    printf("%d iterations on %s\n", iterations, root);
+
+    t = now();
+    for (i = 0; i < iterations; i++)
+    {
+        old_write(gpioName, i & 1);
+    }
+    report("write, open/close", iterations, now() - t);
+
+    fds = open_fds();
+    t = now();
+    for (i = 0; i < iterations; i++)
+    {
+        GpioSysfs_WriteValue(pins[0], i & 1);
+    }
+    report("write, cached fd", iterations, now() - t);
+
+    t = now();
+    for (i = 0; i < iterations; i++)
+    {
+        old_read(gpioName);
+    }
+    report("read, open/close", iterations, now() - t);
+
+    t = now();
+    for (i = 0; i < iterations; i++)
+    {
+        GpioSysfs_ReadValue(pins[0]);
+    }
+    report("read, cached fd", iterations, now() - t);
+
+    t = now();
+    for (i = 0; i < iterations; i++)
+    {
+        Ql_GPIO_SetLevels(pins, PINS, i & 1 ? 0xAA : 0x55);
+    }
+    report("set 8 pins, batched", iterations, now() - t);
+
+    t = now();
+    for (i = 0; i < iterations; i++)
+    {
+        old_register(gpio, i & 3);
+    }
+    report("register, mmap/call", iterations, now() - t);
+
+    t = now();
+    for (i = 0; i < iterations; i++)
+    {
+        Ql_Write_Register(gpio, i & 3);
+    }
+    report("register, one mapping", iterations, now() - t);
+
+    printf("fds opened by the cached paths: %d (one per pin)\n", open_fds() - fds);
+
+    edge = GpioSysfs_EdgeOpen(pins, 1);
+    if (edge < 0)
+    {
+        printf("edge wait: not available here (%d)\n", edge);
+    }
+    else
+    {
+        Enum_PinName pin;
+        int level;
+        printf("edge wait 100 ms: %d\n", GpioSysfs_EdgeWait(edge, 100, &pin, &level));
+        GpioSysfs_EdgeClose(edge);
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   nw_events.c
+ *
+ * Description:
+ * ------------
+ *   Prints the netlink interface events of Ql_NW_Subscribe with the
+ *   delay since the start. On the module: ./nw_events rmnet_data0 60
+ *
+ *   On a host it runs in a network namespace driven by a veth pair,
+ *   no root needed:
+ *
+ *   gcc -O2 -pthread -I../../interface nw_events.c \
+ *       ../../interface/ql_network.c -o nw_events
+ *   unshare -rn sh -c '
+ *       ./nw_events v0 3 & sleep 0.2
+ *       ip link add v0 type veth peer name v1
+ *       ip addr add 10.9.0.1/24 dev v0
+ *       ip link set v1 up; ip link set v0 up; sleep 0.2
+ *       ip link set v0 down; sleep 0.2
+ *       ip link set v0 up; sleep 0.2
+ *       ip addr del 10.9.0.1/24 dev v0; sleep 0.2
+ *       ip link del v0; wait'
+ *
+ *   expected: up 10.9.0.1, down, up 10.9.0.1, down, then nothing
+ *   more (no timeout, the link came up in time).
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "ql_oe.h"
+#include "ql_network.h"
+
+static struct timespec start;
+
+static void on_event(const char* ifname, Enum_NW_IfEvent event, const char* address, void* param)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    printf("%8.3f %s %s %s\n",
+           (ts.tv_sec - start.tv_sec) + (ts.tv_nsec - start.tv_nsec) / 1e9, ifname,
+           NW_IF_UP == event ? "up" : NW_IF_DOWN == event ? "down" : "timeout", address);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    const char* ifname = argc > 1 ? argv[1] : "rmnet_data0";
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+    int handle;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    handle = Ql_NW_Subscribe(ifname, seconds * 1000 / 2, on_event, NULL);
+    if (handle < 0)
+    {
+        printf("Ql_NW_Subscribe(%s) = %d\n", ifname, handle);
+        return 1;
+    }
+    sleep(seconds);
+    Ql_NW_Unsubscribe(handle);
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   uart_loop_bench.c
+ *
+ * Description:
+ * ------------
+ *   Throughput and syscalls per KB of the UART loop against the old
+ *   one byte read / 64 byte write paths. A pty stands in for the tty,
+ *   so it runs on any Linux box:
+ *
+ *   gcc -O2 -pthread -I../../interface uart_loop_bench.c \
+ *       ../../interface/ql_uart_loop.c -lutil -o uart_loop_bench
+ *   ./uart_loop_bench [MB]
+ *
+ *   The loop side counts its own syscalls (readv/writev, epoll_wait,
+ *   epoll_ctl, eventfd), the old paths count every read/write/ioctl.
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <termios.h>
+#include <pty.h>
+#include <sys/ioctl.h>
+#include "ql_uart_loop.h"
+
+#define CHUNK       4096    /* peer side read/write size */
+#define PRINT_SIZE  256     /* application write size */
+
+static size_t total;
+static volatile size_t received;
+
+typedef struct {
+    int fd;
+    size_t bytes;
+} ST_Peer;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void pty_open(int *master, int *slave)
+{
+    struct termios term;
+    if (openpty(master, slave, NULL, NULL, NULL))
+    {
+        perror("openpty");
+        exit(1);
+    }
+    tcgetattr(*slave, &term);
+    cfmakeraw(&term);
+    tcsetattr(*slave, TCSANOW, &term);
+    tcgetattr(*master, &term);
+    cfmakeraw(&term);
+    tcsetattr(*master, TCSANOW, &term);
+}
+
+static void *peer_writer(void *arg)
+{
+    ST_Peer *peer = (ST_Peer *)arg;
+    static char buf[CHUNK];
+    memset(buf, 0x55, sizeof(buf));
+    while (peer->bytes < total)
+    {
+        size_t n = total - peer->bytes < CHUNK ? total - peer->bytes : CHUNK;
+        ssize_t w = write(peer->fd, buf, n);
+        if (w < 0 && EINTR != errno)
+            break;
+        if (w > 0)
+            peer->bytes += w;
+    }
+    return NULL;
+}
+
+static void *peer_reader(void *arg)
+{
+    ST_Peer *peer = (ST_Peer *)arg;
+    static char buf[CHUNK];
+    while (peer->bytes < total)
+    {
+        ssize_t r = read(peer->fd, buf, sizeof(buf));
+        if (r < 0 && EINTR != errno)
+            break;
+        if (r > 0)
+            peer->bytes += r;
+    }
+    return NULL;
+}
+
+static void report(const char *name, double sec, unsigned long long calls)
+{
+    printf("%-16s %8.1f KB/s  %8.3f syscalls/KB\n", name,
+           total / 1024.0 / sec, calls / (total / 1024.0));
+}
+
+static unsigned long long loop_calls(const ST_UARTLoopStats *a, const ST_UARTLoopStats *b)
+{
+    return (b->waits - a->waits) + (b->ctls - a->ctls) + (b->wakes - a->wakes);
+}
+
+/* old HardwareSerial: FIONREAD per available(), one read per byte */
+static void rx_bytewise(void)
+{
+    int master, slave, avail;
+    unsigned long long calls = 0;
+    size_t count = 0;
+    ST_Peer peer;
+    pthread_t th;
+    char c;
+    double t;
+
+    pty_open(&master, &slave);
+    fcntl(slave, F_SETFL, fcntl(slave, F_GETFL) | O_NONBLOCK);
+    peer.fd = master;
+    peer.bytes = 0;
+    t = now();
+    pthread_create(&th, NULL, peer_writer, &peer);
+    while (count < total)
+    {
+        calls++;
+        if (ioctl(slave, FIONREAD, &avail) || 0 == avail)
+            continue;
+        calls++;
+        if (1 == read(slave, &c, 1))
+            count++;
+    }
+    t = now() - t;
+    pthread_join(th, NULL);
+    report("rx byte", t, calls);
+    close(master);
+    close(slave);
+}
+
+static void rx_callback(ST_UARTPort *port, const char *data, unsigned int len, void *user)
+{
+    __atomic_add_fetch(&received, len, __ATOMIC_RELEASE);
+}
+
+static void rx_loop(int ring)
+{
+    int master, slave;
+    ST_UARTLoopStats a, b;
+    ST_UARTPortStats ps;
+    ST_UARTPort *port;
+    ST_Peer peer;
+    pthread_t th;
+    static char buf[CHUNK];
+    double t;
+
+    pty_open(&master, &slave);
+    received = 0;
+    port = Ql_UART_Loop_Attach(slave, 0, 0, ring ? NULL : rx_callback, NULL);
+    Ql_UART_Loop_GetStats(&a);
+    peer.fd = master;
+    peer.bytes = 0;
+    t = now();
+    pthread_create(&th, NULL, peer_writer, &peer);
+    if (ring)
+    {
+        while (received < total)
+        {
+            int n = Ql_UART_Loop_Read(port, buf, sizeof(buf));
+            if (n)
+                received += n;
+            else
+                usleep(1000); /* the sketch loop() */
+        }
+    }
+    else
+    {
+        while (__atomic_load_n(&received, __ATOMIC_ACQUIRE) < total)
+            usleep(1000);
+    }
+    t = now() - t;
+    pthread_join(th, NULL);
+    Ql_UART_Loop_GetStats(&b);
+    Ql_UART_Loop_GetPortStats(port, &ps);
+    report(ring ? "rx loop ring" : "rx loop callback", t, ps.rx_calls + loop_calls(&a, &b));
+    Ql_UART_Loop_Detach(port);
+    close(master);
+}
+
+/* old Ql_UART_Write: 64 byte write() per chunk */
+static void tx_chunked(void)
+{
+    int master, slave;
+    unsigned long long calls = 0;
+    size_t sent = 0;
+    ST_Peer peer;
+    pthread_t th;
+    static char buf[PRINT_SIZE];
+    double t;
+
+    pty_open(&master, &slave);
+    peer.fd = master;
+    peer.bytes = 0;
+    t = now();
+    pthread_create(&th, NULL, peer_reader, &peer);
+    while (sent < total)
+    {
+        unsigned int i;
+        for (i = 0; i < PRINT_SIZE; i += 64)
+        {
+            ssize_t w = write(slave, buf + i, 64);
+            calls++;
+            if (w > 0)
+                sent += w;
+        }
+    }
+    pthread_join(th, NULL);
+    t = now() - t;
+    report("tx 64 byte", t, calls);
+    close(master);
+    close(slave);
+}
+
+static void tx_loop(void)
+{
+    int master, slave;
+    ST_UARTLoopStats a, b;
+    ST_UARTPortStats ps;
+    ST_UARTPort *port;
+    size_t sent = 0;
+    ST_Peer peer;
+    pthread_t th;
+    static char buf[PRINT_SIZE];
+    double t;
+
+    pty_open(&master, &slave);
+    port = Ql_UART_Loop_Attach(slave, 0, 0, NULL, NULL);
+    Ql_UART_Loop_GetStats(&a);
+    peer.fd = master;
+    peer.bytes = 0;
+    t = now();
+    pthread_create(&th, NULL, peer_reader, &peer);
+    while (sent < total)
+        sent += Ql_UART_Loop_Write(port, buf, PRINT_SIZE, -1);
+    Ql_UART_Loop_Drain(port, -1);
+    pthread_join(th, NULL);
+    t = now() - t;
+    Ql_UART_Loop_GetStats(&b);
+    Ql_UART_Loop_GetPortStats(port, &ps);
+    report("tx loop", t, ps.tx_calls + loop_calls(&a, &b));
+    printf("                 %u EAGAIN\n", ps.tx_eagain);
+    Ql_UART_Loop_Detach(port);
+    close(master);
+}
+
+int main(int argc, char **argv)
+{
+    total = (argc > 1 ? atoi(argv[1]) : 8) << 20;
+    total -= total % PRINT_SIZE;
+    printf("%zu KB through a pty\n", total / 1024);
+    rx_bytewise();
+    rx_loop(0);
+    rx_loop(1);
+    tx_chunked();
+    tx_loop();
+    Ql_UART_Loop_Stop();
+    return 0;
+}
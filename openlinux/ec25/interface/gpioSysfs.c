@@ -54,6 +54,21 @@
 //--------------------------------------------------------------------------------------------------
 #define SYSFS_GPIO_PATH    "/sys/class/gpio"
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * TLMM config registers, one 4K page per GPIO. Mapped once on first use.
+ */
+//--------------------------------------------------------------------------------------------------
+#define GPIO_MEM_PATH      "/dev/mem"
+#define GPIO_TLMM_BASE     0x1000000
+#define GPIO_TLMM_STRIDE   0x1000
+#define GPIO_TLMM_COUNT    128
+
+static const char* SysfsGpioRoot = SYSFS_GPIO_PATH;
+static const char* GpioMemPath = GPIO_MEM_PATH;
+static volatile uint32_t* GpioTlmm = NULL;
+static pthread_mutex_t GpioTlmmLock = PTHREAD_MUTEX_INITIALIZER;
+
 static ST_GpioSysfs SysfsGpioPins[] = {
 	/*PIN-1*/  {PINNAME_GPIO1, 		25, "gpio25\0", FALSE, 0, NULL, NULL},
 	/*PIN-2*/  {PINNAME_GPIO2,  	10, "gpio10\0", FALSE, 0, NULL, NULL},
@@ -117,6 +132,10 @@ ST_GpioSysfs* GetGpioItemByPin(const Enum_PinName pinName)
 {
 	int nCnt = sizeof(SysfsGpioPins) / sizeof(SysfsGpioPins[0]);
 	int i;
+	if (pinName >= 0 && pinName < nCnt && pinName == SysfsGpioPins[pinName].pinName)
+	{// the table follows Enum_PinName
+		return &SysfsGpioPins[pinName];
+	}
 	for (i = 0; i < nCnt; i++)
 	{
 		if (pinName == SysfsGpioPins[i].pinName)
@@ -147,6 +166,54 @@ static ST_GpioSysfs* GetGpioItemByFd(const int monFd)
 	return NULL;    
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cached "value" fd of a pin, opened on first use and kept until unexport.
+ * Reads and writes go through pread/pwrite at offset 0, no path, no open/close.
+ *
+ * @return
+ *      The fd, or -1 if the value file can not be opened.
+ */
+//--------------------------------------------------------------------------------------------------
+static int GpioSysfs_ValueFd(ST_GpioSysfs* pstGpioItem)
+{
+    char path[128];
+    int fd = pstGpioItem->valueFd - 1;
+
+    if (fd >= 0)
+    {
+        return fd;
+    }
+    snprintf(path, sizeof(path), "%s/%s/%s", SysfsGpioRoot, pstGpioItem->gpioName, "value");
+    do
+    {
+        fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd < 0 && (EACCES == errno || EROFS == errno))
+        {// input only pin
+            fd = open(path, O_RDONLY | O_CLOEXEC);
+        }
+    } while ((fd < 0) && (EINTR == errno));
+    if (fd < 0)
+    {
+        _DEBUG("Error opening file %s\n", path);
+        return -1;
+    }
+    if (!__sync_bool_compare_and_swap(&pstGpioItem->valueFd, 0, fd + 1))
+    {// another thread was faster
+        close(fd);
+    }
+    return pstGpioItem->valueFd - 1;
+}
+
+static void GpioSysfs_CloseValueFd(ST_GpioSysfs* pstGpioItem)
+{
+    int fd = __sync_lock_test_and_set(&pstGpioItem->valueFd, 0) - 1;
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Check if sysfs gpio path exists.
@@ -204,14 +271,14 @@ int GpioSysfs_ExportGpio(const Enum_PinName pinName)
 	}
 
     // First check if the GPIO has already been exported
-    snprintf(path, sizeof(path), "%s/%s", SYSFS_GPIO_PATH, pstGpioItem->gpioName);
+    snprintf(path, sizeof(path), "%s/%s", SysfsGpioRoot, pstGpioItem->gpioName);
     if (GpioSysfs_CheckExist(path))
     {
         return RES_OK;
     }
 
     // Write the GPIO number to the export file
-    snprintf(export, sizeof(export), "%s/%s", SYSFS_GPIO_PATH, "export");
+    snprintf(export, sizeof(export), "%s/%s", SysfsGpioRoot, "export");
     snprintf(gpioStr, sizeof(gpioStr), "%d", pstGpioItem->gpioNum);
     do
     {
@@ -262,15 +329,17 @@ int GpioSysfs_UnexportGpio(const Enum_PinName pinName)
 		return RES_IO_NOT_SUPPORT;
 	}
 
+    GpioSysfs_CloseValueFd(pstGpioItem);
+
     // First check if the GPIO has already been exported
-    snprintf(path, sizeof(path), "%s/%s", SYSFS_GPIO_PATH, pstGpioItem->gpioName);
+    snprintf(path, sizeof(path), "%s/%s", SysfsGpioRoot, pstGpioItem->gpioName);
     if (!GpioSysfs_CheckExist(path))
     {
         return RES_OK;
     }
 
     // Write the GPIO number to the unexport file
-    snprintf(export, sizeof(export), "%s/%s", SYSFS_GPIO_PATH, "unexport");
+    snprintf(export, sizeof(export), "%s/%s", SysfsGpioRoot, "unexport");
     snprintf(gpioStr, sizeof(gpioStr), "%d", pstGpioItem->gpioNum);
     do
     {
@@ -447,7 +516,7 @@ int GpioSysfs_WriteDirection(
     Enum_GPIO_Dir dir         // [IN] gpio direction input/output mode
 )
 {
-    char path[64];
+    char path[128];
     char attr[16];
 	ST_GpioSysfs* pstGpioItem = GetGpioItemByPin(pinName);
 	if (!pstGpioItem)
@@ -455,7 +524,7 @@ int GpioSysfs_WriteDirection(
 		return RES_IO_NOT_SUPPORT;
 	}
 
-    snprintf(path, sizeof(path), "%s/%s/%s", SYSFS_GPIO_PATH, pstGpioItem->gpioName, "direction");
+    snprintf(path, sizeof(path), "%s/%s/%s", SysfsGpioRoot, pstGpioItem->gpioName, "direction");
     snprintf(attr, sizeof(attr), "%s", (GPIO_DIR_OUTPUT == dir) ? "out": "in");
     _DEBUG("path:%s, attr:%s\n", path, attr);
 
@@ -479,7 +548,7 @@ int GpioSysfs_WriteDirection(
 //--------------------------------------------------------------------------------------------------
 int GpioSysfs_ReadDirection(Enum_PinName pinName)
 {
-    char path[64];
+    char path[128];
     char result[17];
     int dir_value;
 	ST_GpioSysfs* pstGpioItem = GetGpioItemByPin(pinName);
@@ -488,7 +557,7 @@ int GpioSysfs_ReadDirection(Enum_PinName pinName)
 		return RES_IO_NOT_SUPPORT;
 	}
 
-    snprintf(path, sizeof(path), "%s/%s/%s", SYSFS_GPIO_PATH, pstGpioItem->gpioName, "direction");
+    snprintf(path, sizeof(path), "%s/%s/%s", SysfsGpioRoot, pstGpioItem->gpioName, "direction");
 	memset(result, 0x0, sizeof(result));
     GpioSysfs_ReadAttr(path, sizeof(result), result);
     dir_value = atoi(result);
@@ -507,19 +576,57 @@ int GpioSysfs_WriteValue(
     Enum_GPIO_Level level           // [IN] High or low
 )
 {
-    char path[64];
-    char attr[16];
+    char attr = level ? '1' : '0';
+    ssize_t written;
+    int fd;
 	ST_GpioSysfs* pstGpioItem = GetGpioItemByPin(pinName);
 	if (!pstGpioItem)
 	{// pin not support
 		return RES_IO_NOT_SUPPORT;
 	}
 
-    snprintf(path, sizeof(path), "%s/%s/%s", SYSFS_GPIO_PATH, pstGpioItem->gpioName, "value");
-    snprintf(attr, sizeof(attr), "%d", level);
-    _DEBUG("path:%s, attr:%s\n", path, attr);
+    fd = GpioSysfs_ValueFd(pstGpioItem);
+    if (fd < 0)
+    {
+        return RES_IO_ERROR;
+    }
+    do
+    {
+        written = pwrite(fd, &attr, 1, 0);
+    } while ((written < 0) && (EINTR == errno));
+    if (written != 1)
+    {
+        _DEBUG("Failed to write %c to %s value. Error %s\n", attr, pstGpioItem->gpioName, strerror(errno));
+        return RES_IO_ERROR;
+    }
+    return RES_OK;
+}
 
-    return GpioSysfs_WriteAttr(path, attr);
+//--------------------------------------------------------------------------------------------------
+/**
+ * write the levels of several GPIO outputs, bit i of levels goes to pins[i]
+ */
+//--------------------------------------------------------------------------------------------------
+int GpioSysfs_WriteValues(
+    const Enum_PinName* pins,       // [IN] pin names
+    int count,                      // [IN] number of pins, up to 32
+    uint32_t levels                 // [IN] bit mask of levels
+)
+{
+    int i, iRet = RES_OK;
+    if (!pins || count < 0 || count > 32)
+    {
+        return RES_BAD_PARAMETER;
+    }
+    for (i = 0; i < count; i++)
+    {
+        int res = GpioSysfs_WriteValue(pins[i], (levels >> i) & 1);
+        if (res < RES_OK)
+        {// keep going, report the first error
+            iRet = (RES_OK == iRet) ? res : iRet;
+        }
+    }
+    return iRet;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -537,22 +644,112 @@ int GpioSysfs_WriteValue(
 //--------------------------------------------------------------------------------------------------
 int GpioSysfs_ReadValue(Enum_PinName pinName)
 {
-    char path[64];
-    char result[17];
-    int level_value;
+    char result[2];
+    ssize_t size;
+    int fd;
 	ST_GpioSysfs* pstGpioItem = GetGpioItemByPin(pinName);
 	if (!pstGpioItem)
 	{// pin not support
 		return RES_IO_NOT_SUPPORT;
 	}
 
-    snprintf(path, sizeof(path), "%s/%s/%s", SYSFS_GPIO_PATH, pstGpioItem->gpioName, "value");
-	memset(result, 0x0, sizeof(result));
-    GpioSysfs_ReadAttr(path, sizeof(result), result);
-    level_value = atoi(result);
-    _DEBUG("result:%s, value:%s\n", result, (level_value==1) ? "high": "low");
+    fd = GpioSysfs_ValueFd(pstGpioItem);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    do
+    {
+        size = pread(fd, result, sizeof(result), 0);
+    } while ((size < 0) && (EINTR == errno));
+    _DEBUG("%s value:%c\n", pstGpioItem->gpioName, size > 0 ? result[0] : '?');
 
-    return level_value;
+    return (size > 0 && '1' == result[0]) ? 1 : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Edge events on the cached value fds. The pins must have an edge set
+ * (GpioSysfs_SetEdgeSense), sysfs reports the edge as POLLPRI.
+ */
+//--------------------------------------------------------------------------------------------------
+int GpioSysfs_EdgeOpen(const Enum_PinName* pins, int count)
+{
+    struct epoll_event ev;
+    int i, epfd;
+
+    if (!pins || count <= 0)
+    {
+        return RES_BAD_PARAMETER;
+    }
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+    {
+        return RES_IO_ERROR;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ST_GpioSysfs* pstGpioItem = GetGpioItemByPin(pins[i]);
+        int fd = pstGpioItem ? GpioSysfs_ValueFd(pstGpioItem) : -1;
+        if (fd < 0)
+        {
+            close(epfd);
+            return pstGpioItem ? RES_IO_ERROR : RES_IO_NOT_SUPPORT;
+        }
+        GpioSysfs_ReadValue(pins[i]); // an unread value counts as an edge
+        ev.events = EPOLLPRI | EPOLLERR;
+        ev.data.u32 = pins[i];
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) && EEXIST != errno)
+        {
+            _DEBUG("epoll_ctl(%s): %s\n", pstGpioItem->gpioName, strerror(errno));
+            close(epfd);
+            return RES_IO_ERROR;
+        }
+    }
+    return epfd;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait for an edge on one of the pins of GpioSysfs_EdgeOpen.
+ *
+ * @return
+ * - 1: edge, pinName and level are set
+ * - 0: timeout
+ * - RES_IO_ERROR
+ */
+//--------------------------------------------------------------------------------------------------
+int GpioSysfs_EdgeWait(int edgeFd, int timeout_ms, Enum_PinName* pinName, int* level)
+{
+    struct epoll_event ev;
+    int n;
+
+    do
+    {
+        n = epoll_wait(edgeFd, &ev, 1, timeout_ms);
+    } while ((n < 0) && (EINTR == errno));
+    if (n <= 0)
+    {
+        return n < 0 ? RES_IO_ERROR : 0;
+    }
+    n = GpioSysfs_ReadValue((Enum_PinName)ev.data.u32); // re-arms the edge
+    if (pinName)
+    {
+        *pinName = (Enum_PinName)ev.data.u32;
+    }
+    if (level)
+    {
+        *level = n;
+    }
+    return 1;
+}
+
+void GpioSysfs_EdgeClose(int edgeFd)
+{
+    if (edgeFd >= 0)
+    {
+        close(edgeFd);
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -583,13 +780,13 @@ int GpioSysfs_OpenValue(Enum_PinName pinName)
 	}
 
     // Start monitoring the fd for the correct GPIO
-    snprintf(monFile, sizeof(monFile), "%s/%s/%s", SYSFS_GPIO_PATH, pstGpioItem->gpioName, "value");
+    snprintf(monFile, sizeof(monFile), "%s/%s/%s", SysfsGpioRoot, pstGpioItem->gpioName, "value");
 
     do
     {
         valueFd = open(monFile, O_RDONLY);
-    } while ((0 == valueFd) && (EINTR == errno));
-    if (0 == valueFd)
+    } while ((valueFd < 0) && (EINTR == errno));
+    if (valueFd < 0)
     {
         _DEBUG("Fail to open GPIO file for monitoring\n");
         return -2;
@@ -616,7 +813,7 @@ int GpioSysfs_SetEdgeSense(
     Enum_GpioEdgeSenseMode edgeSense        // [IN] The mode of GPIO Edge Sensivity.
 )
 {
-    char path[64];
+    char path[128];
     char attr[11];
 
 	ST_GpioSysfs* pstGpioItem = GetGpioItemByPin(pinName);
@@ -625,7 +822,7 @@ int GpioSysfs_SetEdgeSense(
 		return RES_IO_NOT_SUPPORT;
 	}
 
-    snprintf(path, sizeof(path), "%s/%s/%s", SYSFS_GPIO_PATH, pstGpioItem->gpioName, "edge");
+    snprintf(path, sizeof(path), "%s/%s/%s", SysfsGpioRoot, pstGpioItem->gpioName, "edge");
     switch (edgeSense)
     {
         case GPIO_EDGE_SENSE_RISING:
@@ -656,7 +853,7 @@ int GpioSysfs_WritePolarity(
     Enum_GPIO_Polarity_Level level   // [IN] Active-high or active-low
 )
 {
-    char path[64];
+    char path[128];
     char attr[16];
 	ST_GpioSysfs* pstGpioItem = GetGpioItemByPin(pinName);
 	if (!pstGpioItem)
@@ -664,7 +861,7 @@ int GpioSysfs_WritePolarity(
 		return RES_IO_NOT_SUPPORT;
 	}
 
-    snprintf(path, sizeof(path), "%s/%s/%s", SYSFS_GPIO_PATH, pstGpioItem->gpioName, "active_low");
+    snprintf(path, sizeof(path), "%s/%s/%s", SysfsGpioRoot, pstGpioItem->gpioName, "active_low");
     snprintf(attr, sizeof(attr), "%d", level);
     _DEBUG("path:%s, attr:%s\n", path, attr);
 
@@ -680,7 +877,7 @@ int GpioSysfs_WritePolarity(
 //--------------------------------------------------------------------------------------------------
 int GpioSysfs_ReadPolarity(Enum_PinName  pinName)
 {
-    char path[64];
+    char path[128];
     char result[17];
     Enum_GpioEdgeSenseMode type;
 
@@ -690,7 +887,7 @@ int GpioSysfs_ReadPolarity(Enum_PinName  pinName)
 		return RES_IO_NOT_SUPPORT;
 	}
 
-    snprintf(path, sizeof(path), "%s/%s/%s", SYSFS_GPIO_PATH, pstGpioItem->gpioName, "active_low");
+    snprintf(path, sizeof(path), "%s/%s/%s", SysfsGpioRoot, pstGpioItem->gpioName, "active_low");
     GpioSysfs_ReadAttr(path, sizeof(result), result);
     type = atoi(result);
     _DEBUG("result:%s", result);
@@ -704,72 +901,93 @@ int GpioSysfs_ReadPolarity(Enum_PinName  pinName)
 */    
 //--------------------------------------------------------------------------------------------------
 
-int Ql_Write_Register(unsigned char gpio,unsigned char val)
+static volatile uint32_t* GpioSysfs_Register(unsigned char gpio)
 {
-    uintptr_t addr = 0x1000000+0x1000*gpio;
-    uintptr_t endaddr = addr +3;
-    uint32_t reg_val,temp;
-
-    int fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if(fd < 0) {
-        //fprintf(stderr,"cannot open /dev/mem\n");
-	printf("cannot open /dev/mem\n");
-        return -1;
+    if (gpio >= GPIO_TLMM_COUNT)
+    {
+        return NULL;
     }
-	
-    off64_t mmap_start = addr & ~(PAGE_SIZE - 1);
-    size_t mmap_size = endaddr - mmap_start + 1;
-    mmap_size = (mmap_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
-
-    void* page = mmap(0, mmap_size, PROT_READ | PROT_WRITE,
-                        MAP_SHARED, fd, mmap_start);
+    pthread_mutex_lock(&GpioTlmmLock);
+    if (!GpioTlmm)
+    {
+        int fd = open(GpioMemPath, O_RDWR | O_SYNC | O_CLOEXEC);
+        if (fd < 0)
+        {
+            printf("cannot open %s\n", GpioMemPath);
+        }
+        else
+        {
+            void* page = mmap(0, GPIO_TLMM_COUNT * GPIO_TLMM_STRIDE, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, GPIO_TLMM_BASE);
+            close(fd); // the mapping stays
+            if (page == MAP_FAILED)
+            {
+                printf("cannot mmap region\n");
+            }
+            else
+            {
+                GpioTlmm = (volatile uint32_t*)page;
+            }
+        }
+    }
+    pthread_mutex_unlock(&GpioTlmmLock);
+    return GpioTlmm ? GpioTlmm + gpio * (GPIO_TLMM_STRIDE / sizeof(uint32_t)) : NULL;
+}
 
-    if(page == MAP_FAILED){
-      //  fprintf(stderr,"cannot mmap region\n");
-	printf("cannot mmap region\n");
+int Ql_Write_Register(unsigned char gpio,unsigned char val)
+{
+    volatile uint32_t* x = GpioSysfs_Register(gpio);
+    if (!x)
+    {
         return -1;
     }
-
-    uint32_t* x = (uint32_t*) (((uintptr_t) page) + (addr & 4095));
-	reg_val =*x;
-	temp =reg_val >>2;
-	*x =(temp <<2) +val;
-	printf("width 4 ---%08"PRIxPTR": %08x\n", addr, *x);
+    *x = (*x & ~3u) | val;
+    _DEBUG("width 4 ---%08x: %08x\n", GPIO_TLMM_BASE + GPIO_TLMM_STRIDE * gpio, *x);
     return 1;
 }
 
 int Ql_Write_Register_all(unsigned char gpio,unsigned char val)
 {
-    uintptr_t addr = 0x1000000+0x1000*gpio;
-    uintptr_t endaddr = addr +3;
-
-    int fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if(fd < 0) {
-        //fprintf(stderr,"cannot open /dev/mem\n");
-	printf("cannot open /dev/mem\n");
-        return -1;
-    }
-	
-    off64_t mmap_start = addr & ~(PAGE_SIZE - 1);
-    size_t mmap_size = endaddr - mmap_start + 1;
-    mmap_size = (mmap_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
-
-    void* page = mmap(0, mmap_size, PROT_READ | PROT_WRITE,
-                        MAP_SHARED, fd, mmap_start);
-
-    if(page == MAP_FAILED){
-      //  fprintf(stderr,"cannot mmap region\n");
-	printf("cannot mmap region\n");
+    volatile uint32_t* x = GpioSysfs_Register(gpio);
+    if (!x)
+    {
         return -1;
     }
-
-    uint32_t* x = (uint32_t*) (((uintptr_t) page) + (addr & 4095));
-	*x =val;
-	printf("width 4 ---%08"PRIxPTR": %08x\n", addr, *x);
+    *x = val;
+    _DEBUG("width 4 ---%08x: %08x\n", GPIO_TLMM_BASE + GPIO_TLMM_STRIDE * gpio, *x);
     return 1;
 }
 
-
+//--------------------------------------------------------------------------------------------------
+/**
+ * Point sysfs and the register device somewhere else (NULL keeps the current one).
+ * Drops the cached fds and the register mapping, call it before the pins are used.
+ */
+//--------------------------------------------------------------------------------------------------
+void GpioSysfs_SetPaths(const char* sysfsPath, const char* memPath)
+{
+	int nCnt = sizeof(SysfsGpioPins) / sizeof(SysfsGpioPins[0]);
+	int i;
+	for (i = 0; i < nCnt; i++)
+	{
+		GpioSysfs_CloseValueFd(&SysfsGpioPins[i]);
+	}
+    pthread_mutex_lock(&GpioTlmmLock);
+    if (GpioTlmm)
+    {
+        munmap((void*)GpioTlmm, GPIO_TLMM_COUNT * GPIO_TLMM_STRIDE);
+        GpioTlmm = NULL;
+    }
+    if (sysfsPath)
+    {
+        SysfsGpioRoot = sysfsPath;
+    }
+    if (memPath)
+    {
+        GpioMemPath = memPath;
+    }
+    pthread_mutex_unlock(&GpioTlmmLock);
+}
 
 //--------------------------------------------------------------------------------------------------
 /**
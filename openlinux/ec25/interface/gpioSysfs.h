@@ -114,6 +114,7 @@ typedef struct {
     int monitorFd;                              // The FD of the file bing monitored
     _fdMonitor_CB fdMonitor_proc;               // fdMonitor_cb Object associated to this GPIO
     void* param_cb;                             // the parameter can be passed into fdMonitor_cb
+    int valueFd;                                // cached "value" fd + 1, 0 = not open
 }ST_GpioSysfs;
 
 
@@ -206,6 +207,37 @@ int GpioSysfs_WriteValue(
 //--------------------------------------------------------------------------------------------------
 int GpioSysfs_ReadValue(Enum_PinName pinName);
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * write the levels of several GPIO outputs, bit i of levels goes to pins[i]
+ */
+//--------------------------------------------------------------------------------------------------
+int GpioSysfs_WriteValues(
+    const Enum_PinName* pins,       // [IN] pin names
+    int count,                      // [IN] number of pins, up to 32
+    uint32_t levels                 // [IN] bit mask of levels
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Edge events through epoll on the cached value fds.
+ *
+ * GpioSysfs_EdgeOpen returns a handle for the pins (their edge must be set),
+ * GpioSysfs_EdgeWait returns 1 with the pin and its level, 0 on timeout.
+ */
+//--------------------------------------------------------------------------------------------------
+int GpioSysfs_EdgeOpen(const Enum_PinName* pins, int count);
+int GpioSysfs_EdgeWait(int edgeFd, int timeout_ms, Enum_PinName* pinName, int* level);
+void GpioSysfs_EdgeClose(int edgeFd);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Use another sysfs gpio directory / register device, NULL keeps the current one.
+ * For a fake tree on a host, call before the pins are used.
+ */
+//--------------------------------------------------------------------------------------------------
+void GpioSysfs_SetPaths(const char* sysfsPath, const char* memPath);
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Open the device file of level value.
@@ -56,6 +56,11 @@ int Ql_GPIO_SetLevel(Enum_PinName pinName, Enum_PinLevel level)
 	return GpioSysfs_WriteValue(pinName, level);
 }
 
+int Ql_GPIO_SetLevels(const Enum_PinName* pins, int count, uint32_t levels)
+{
+	return GpioSysfs_WriteValues(pins, count, levels);
+}
+
 int Ql_GPIO_GetLevel(Enum_PinName pinName)
 {
 	return GpioSysfs_ReadValue(pinName);
@@ -96,6 +96,26 @@ int Ql_GPIO_Init(Enum_PinName       pinName,
 *               QL_RET_ERR_NOGPIOMODE, the input GPIO is not GPIO mode
 *****************************************************************/
 int Ql_GPIO_SetLevel(Enum_PinName pinName, Enum_PinLevel level);
+/*****************************************************************
+* Function:     Ql_GPIO_SetLevels 
+* 
+* Description:
+*               This function sets the levels of several GPIOs in
+*               one call, bit i of levels is the level of pins[i].
+*
+* Parameters:
+*               pins:
+*                   Pin names, values of Enum_PinName.
+*               count:
+*                   Number of pins, up to 32.
+*               levels:
+*                   Bit mask of Enum_PinLevel values.
+* Return:        
+*               QL_RET_OK, this function succeeds.
+*               Otherwise the error of the first pin that failed,
+*               the other pins are still set.
+*****************************************************************/
+int Ql_GPIO_SetLevels(const Enum_PinName* pins, int count, uint32_t levels);
 
 /*****************************************************************
 * Function:     Ql_GPIO_GetLevel 
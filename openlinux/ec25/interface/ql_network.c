@@ -10,135 +10,311 @@
 #include "ql_network.h"
 
 
+#include <net/if.h>
+#include <sys/eventfd.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#define NW_NL_BUFFER    8192
+
+typedef struct {
+    boolean inUse;
+    char ifname[IFNAMSIZ];
+    NW_If_CB cb;
+    void* param;
+    long long deadline;             // ms, 0 = no timeout
+    boolean link;                   // IFF_UP and IFF_RUNNING
+    boolean up;                     // last state reported
+    char addr[INET_ADDRSTRLEN];     // "" = no IPv4 address
+}ST_NW_Subscriber;
+
+static ST_NW_Subscriber nwSubscribers[NW_MAX_SUBSCRIBERS];
+static pthread_mutex_t nwLock;      // recursive, callbacks may unsubscribe
+static pthread_once_t nwOnce = PTHREAD_ONCE_INIT;
+static int nwNetlinkFd = -1;
+static int nwWakeFd = -1;
+
 static NW_Status_CB cb_nw_sts_ind = NULL;
-static boolean bThrdContinued = TRUE;
-static int nCounter = 0;
+static int nwMobileAP = -1;         // subscriber handle
+static boolean nwMobileAPDone = FALSE;
 
-static void callback_onTimer(int param);
 static void* thrd_nw_detect(void* arg);
 
-int Ql_NW_EnableMobileAP(int timeout, NW_Status_CB nw_status_cb)
+static long long nw_now_ms(void)
 {
-    pid_t status;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static void nw_init(void)
+{
+    pthread_mutexattr_t attr;
+    struct sockaddr_nl sa;
     pthread_t thrd_nw;
-    //void* thrdRet;
+    int fd;
 
-    nCounter = timeout;
-    cb_nw_sts_ind = nw_status_cb;
-    
-    status = system("start-stop-daemon -S -b -a Quectel_QCMAP_CLI &");
-    if (-1 == status)
-    {
-        printf("system error!");
-    } else {
-        printf("exit status value = [0x%x]\n", status);
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&nwLock, &attr);
+    pthread_mutexattr_destroy(&attr);
 
-        if (WIFEXITED(status))
-        {
-            if (0 == WEXITSTATUS(status))
-            {
-                printf("Starting MobileAP, please waiting...\n");
+    fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
+    {
+        perror("netlink");
+        return;
+    }
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
+    if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0)
+    {
+        perror("netlink bind");
+        close(fd);
+        return;
+    }
+    nwWakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    nwNetlinkFd = fd;
+    if (pthread_create(&thrd_nw, NULL, thrd_nw_detect, NULL) != 0)
+    {
+        printf("Fail to create thread!\n");
+        close(fd);
+        nwNetlinkFd = -1;
+        return;
+    }
+    pthread_detach(thrd_nw);
+}
 
-                // Start a thread to detect linux network status
-                if (pthread_create(&thrd_nw, NULL, thrd_nw_detect, NULL) != 0)
-                {
-                    printf("Fail to create thread!\n");
-                    return -1;
-                }
-/*
-                // Wait for the end of thread, and put the return value in "tret"
-                if (pthread_join(thrd_nw, &thrdRet) != 0)
-                {
-                    printf("Join thrd_nw error!\n");
-                    return -3;
-                }
-                printf("thrd_nw exit code: %d\n", *((int *)thrdRet));
-*/                
-            } else {
-                printf("Fail to start Quectel_QCMAP_CLI, error code: %d\n", WEXITSTATUS(status));
-                return -2;
-            }
-        } else {
-            printf("exit status = [%d]\n", WEXITSTATUS(status));
-        }
+// nwLock held. reports only changes
+static void nw_update(ST_NW_Subscriber* sub)
+{
+    boolean up = sub->link && sub->addr[0];
+    if (up == sub->up)
+    {
+        return;
     }
-    return 0;
+    sub->up = up;
+    if (up)
+    {
+        sub->deadline = 0;
+    }
+    sub->cb(sub->ifname, up ? NW_IF_UP : NW_IF_DOWN, up ? sub->addr : "", sub->param);
 }
 
-static void callback_onTimer(int param)
+// nwLock held. current state of one interface, the events keep it from here
+static void nw_query(ST_NW_Subscriber* sub)
 {
     struct ifaddrs *ifaddr, *ifa;
-    int family, s, n;
-    char host[NI_MAXHOST];
-    boolean bIpFound = 0;
 
-    nCounter--;
-    
     if (getifaddrs(&ifaddr) == -1)
     {
        perror("getifaddrs");
        return;
     }
-
-    /* Walk through linked list, maintaining head pointer so we can free list later */
-    for (ifa = ifaddr, n = 0; ifa != NULL; ifa = ifa->ifa_next, n++)
+    for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next)
     {
-        if (ifa->ifa_addr == NULL)
-           continue;
-
-        family = ifa->ifa_addr->sa_family;
+        if (strcmp(ifa->ifa_name, sub->ifname))
+        {
+            continue;
+        }
+        sub->link = (ifa->ifa_flags & (IFF_UP | IFF_RUNNING)) == (IFF_UP | IFF_RUNNING);
+        if (ifa->ifa_addr && AF_INET == ifa->ifa_addr->sa_family && !sub->addr[0])
+        {
+            inet_ntop(AF_INET, &((struct sockaddr_in*)ifa->ifa_addr)->sin_addr, sub->addr, sizeof(sub->addr));
+        }
+    }
+    freeifaddrs(ifaddr);
+}
 
-        /* Display interface name and family (including symbolic
-        * form of the latter for the common families)
-        */
-        printf("%-8s %s (%d)\n",
-              ifa->ifa_name,
-              (family == AF_PACKET) ? "AF_PACKET" :
-              (family == AF_INET) ? "AF_INET" :
-              (family == AF_INET6) ? "AF_INET6" : "???",
-              family);
+static void nw_on_link(struct nlmsghdr* nh)
+{
+    struct ifinfomsg* ifi = (struct ifinfomsg*)NLMSG_DATA(nh);
+    struct rtattr* rta = IFLA_RTA(ifi);
+    int len = IFLA_PAYLOAD(nh);
+    const char* name = NULL;
+    int i;
 
-        /* Find the "rmnet_data0" network adapter */
-        if (strncmp(ifa->ifa_name, "rmnet_data0", 11) == 0)
+    for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
+    {
+        if (IFLA_IFNAME == rta->rta_type)
         {
-            bIpFound = 1;
-            break;
+            name = (const char*)RTA_DATA(rta);
         }
     }
+    if (!name)
+    {
+        return;
+    }
+    for (i = 0; i < NW_MAX_SUBSCRIBERS; i++)
+    {
+        ST_NW_Subscriber* sub = &nwSubscribers[i];
+        if (!sub->inUse || strcmp(sub->ifname, name))
+        {
+            continue;
+        }
+        if (RTM_DELLINK == nh->nlmsg_type)
+        {
+            sub->link = FALSE;
+            sub->addr[0] = 0;
+        }
+        else
+        {
+            sub->link = (ifi->ifi_flags & (IFF_UP | IFF_RUNNING)) == (IFF_UP | IFF_RUNNING);
+        }
+        nw_update(sub);
+    }
+}
+
+static void nw_on_addr(struct nlmsghdr* nh)
+{
+    struct ifaddrmsg* ifa = (struct ifaddrmsg*)NLMSG_DATA(nh);
+    struct rtattr* rta = IFA_RTA(ifa);
+    int len = IFA_PAYLOAD(nh);
+    char name[IFNAMSIZ] = "";
+    char addr[INET_ADDRSTRLEN] = "";
+    int i;
 
-    if (bIpFound)
+    if (AF_INET != ifa->ifa_family)
+    {
+        return;
+    }
+    for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
     {
-        s = getnameinfo(ifa->ifa_addr,
-               (family == AF_INET) ? sizeof(struct sockaddr_in) :
-                                     sizeof(struct sockaddr_in6),
-               host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
-        if (s != 0)
+        if (IFA_LOCAL == rta->rta_type || (IFA_ADDRESS == rta->rta_type && !addr[0]))
+        {// IFA_LOCAL wins on point to point links
+            inet_ntop(AF_INET, RTA_DATA(rta), addr, sizeof(addr));
+        }
+    }
+    if (!if_indextoname(ifa->ifa_index, name) && RTM_NEWADDR == nh->nlmsg_type)
+    {
+        return;
+    }
+    for (i = 0; i < NW_MAX_SUBSCRIBERS; i++)
+    {
+        ST_NW_Subscriber* sub = &nwSubscribers[i];
+        if (!sub->inUse || strcmp(sub->ifname, name))
         {
-           printf("getnameinfo() failed: %s\n", gai_strerror(s));
+            continue;
         }
-        printf("< Retrived IP, address:%s >\n", host);
-        if (cb_nw_sts_ind)
+        if (RTM_NEWADDR == nh->nlmsg_type)
         {
-            cb_nw_sts_ind(1);
-            bThrdContinued = FALSE;
+            if (!sub->addr[0])
+            {
+                strcpy(sub->addr, addr);
+            }
         }
-    } else {
-        printf("< Not find IP, nCounter:%d >\n", nCounter);
-        if (nCounter > 0)
+        else if (!strcmp(sub->addr, addr))
         {
-            alarm(1);
-        } else {
-            printf("< timeout >\n");
-            cb_nw_sts_ind(0);
-            bThrdContinued = FALSE;
+            sub->addr[0] = 0;
+        }
+        nw_update(sub);
+    }
+}
+
+static void nw_on_timeout(long long now)
+{
+    int i;
+    for (i = 0; i < NW_MAX_SUBSCRIBERS; i++)
+    {
+        ST_NW_Subscriber* sub = &nwSubscribers[i];
+        if (sub->inUse && sub->deadline && now >= sub->deadline)
+        {
+            sub->deadline = 0;
+            sub->cb(sub->ifname, NW_IF_TIMEOUT, "", sub->param);
         }
     }
-   freeifaddrs(ifaddr);
-      
-#if 0
-    pid_t status = system("ifconfig | grep rmnet_data0 &");
-    nCounter--;
+}
+
+int Ql_NW_Subscribe(const char* ifname, int timeout_ms, NW_If_CB cb, void* param)
+{
+    uint64_t one = 1;
+    int i;
+
+    if (!ifname || !cb || strlen(ifname) >= IFNAMSIZ)
+    {
+        return RES_BAD_PARAMETER;
+    }
+    pthread_once(&nwOnce, nw_init);
+    if (nwNetlinkFd < 0)
+    {
+        return RES_IO_ERROR;
+    }
+    pthread_mutex_lock(&nwLock);
+    for (i = 0; i < NW_MAX_SUBSCRIBERS; i++)
+    {
+        ST_NW_Subscriber* sub = &nwSubscribers[i];
+        if (sub->inUse)
+        {
+            continue;
+        }
+        memset(sub, 0, sizeof(*sub));
+        strcpy(sub->ifname, ifname);
+        sub->cb = cb;
+        sub->param = param;
+        sub->deadline = timeout_ms > 0 ? nw_now_ms() + timeout_ms : 0;
+        sub->inUse = TRUE;
+        // under nwLock, so an event that raced with the query finds the state already set
+        nw_query(sub);
+        nw_update(sub);
+        pthread_mutex_unlock(&nwLock);
+        if (timeout_ms > 0 && write(nwWakeFd, &one, sizeof(one)) < 0)
+        {// new deadline for the poll timeout
+            perror("eventfd");
+        }
+        return i;
+    }
+    pthread_mutex_unlock(&nwLock);
+    return RES_IO_ERROR;
+}
+
+int Ql_NW_Unsubscribe(int handle)
+{
+    if (handle < 0 || handle >= NW_MAX_SUBSCRIBERS || nwNetlinkFd < 0)
+    {
+        return RES_BAD_PARAMETER;
+    }
+    pthread_mutex_lock(&nwLock);
+    nwSubscribers[handle].inUse = FALSE;
+    pthread_mutex_unlock(&nwLock);
+    return RES_OK;
+}
+
+// Quectel_QCMAP_CLI brings up rmnet_data0
+static void nw_on_mobileap(const char* ifname, Enum_NW_IfEvent event, const char* address, void* param)
+{
+    if (NW_IF_DOWN == event)
+    {
+        return;
+    }
+    if (NW_IF_UP == event)
+    {
+        printf("< Retrived IP, address:%s >\n", address);
+    }
+    else
+    {
+        printf("< timeout >\n");
+    }
+    nwMobileAPDone = TRUE;
+    if (nwMobileAP >= 0)
+    {
+        Ql_NW_Unsubscribe(nwMobileAP);
+        nwMobileAP = -1;
+    }
+    if (cb_nw_sts_ind)
+    {
+        cb_nw_sts_ind(NW_IF_UP == event);
+    }
+}
+
+int Ql_NW_EnableMobileAP(int timeout, NW_Status_CB nw_status_cb)
+{
+    pid_t status;
+    int handle;
+
+    cb_nw_sts_ind = nw_status_cb;
     
+    status = system("start-stop-daemon -S -b -a Quectel_QCMAP_CLI &");
     if (-1 == status)
     {
         printf("system error!");
@@ -149,39 +325,119 @@ static void callback_onTimer(int param)
         {
             if (0 == WEXITSTATUS(status))
             {
-                printf("< Retrived IP, cb_nw_sts_ind=%X >\n", (uint32_t)cb_nw_sts_ind);
-                if (cb_nw_sts_ind)
-                {
-                    cb_nw_sts_ind(1);
+                printf("Starting MobileAP, please waiting...\n");
 
-                    bThrdContinued = FALSE;
+                // Wait for rmnet_data0 through netlink, it may be up already
+                pthread_once(&nwOnce, nw_init);
+                pthread_mutex_lock(&nwLock);
+                if (nwMobileAP >= 0)
+                {
+                    Ql_NW_Unsubscribe(nwMobileAP);
+                    nwMobileAP = -1;
                 }
-            } else {
-                printf("Not find IP, shell error code: %d\n", WEXITSTATUS(status));
-                if (nCounter > 0)
+                nwMobileAPDone = FALSE;
+                handle = Ql_NW_Subscribe("rmnet_data0", timeout * 1000, nw_on_mobileap, NULL);
+                if (handle >= 0 && nwMobileAPDone)
+                {
+                    Ql_NW_Unsubscribe(handle);
+                }
+                else if (handle >= 0)
                 {
-                    alarm(1);
-                } else {
-                    printf("< timeout >\n");
-                    cb_nw_sts_ind(0);
-                    bThrdContinued = FALSE;
+                    nwMobileAP = handle;
                 }
+                pthread_mutex_unlock(&nwLock);
+                if (handle < 0)
+                {
+                    printf("Fail to watch rmnet_data0!\n");
+                    return -1;
+                }
+            } else {
+                printf("Fail to start Quectel_QCMAP_CLI, error code: %d\n", WEXITSTATUS(status));
+                return -2;
             }
         } else {
             printf("exit status = [%d]\n", WEXITSTATUS(status));
         }
     }
-#endif
+    return 0;
 }
 
 static void* thrd_nw_detect(void* arg)
 {
-    signal(SIGALRM, callback_onTimer);
-    alarm(1);
+    static char buf[NW_NL_BUFFER];
+    struct pollfd fds[2];
 
-    while (bThrdContinued)
+    fds[0].fd = nwNetlinkFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = nwWakeFd;
+    fds[1].events = POLLIN;
+    for (;;)
     {
-    }
+        long long next = 0, now = nw_now_ms();
+        int i, timeout = -1;
 
-    pthread_exit((void *)1);  // Explicitly exit the thread, and return (void *)1
+        pthread_mutex_lock(&nwLock);
+        for (i = 0; i < NW_MAX_SUBSCRIBERS; i++)
+        {
+            if (nwSubscribers[i].inUse && nwSubscribers[i].deadline
+                && (!next || nwSubscribers[i].deadline < next))
+            {
+                next = nwSubscribers[i].deadline;
+            }
+        }
+        pthread_mutex_unlock(&nwLock);
+        if (next)
+        {
+            timeout = next > now ? (int)(next - now) : 0;
+        }
+
+        if (poll(fds, 2, timeout) < 0 && EINTR != errno)
+        {
+            perror("poll");
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            uint64_t cnt;
+            if (read(nwWakeFd, &cnt, sizeof(cnt)) < 0)
+            {
+                perror("eventfd");
+            }
+        }
+        pthread_mutex_lock(&nwLock);
+        if (fds[0].revents & POLLIN)
+        {
+            int len = recv(nwNetlinkFd, buf, sizeof(buf), MSG_DONTWAIT);
+            struct nlmsghdr* nh;
+            if (len < 0 && ENOBUFS == errno)
+            {// events were dropped, start over from the current state
+                for (i = 0; i < NW_MAX_SUBSCRIBERS; i++)
+                {
+                    if (nwSubscribers[i].inUse)
+                    {
+                        nwSubscribers[i].addr[0] = 0;
+                        nw_query(&nwSubscribers[i]);
+                        nw_update(&nwSubscribers[i]);
+                    }
+                }
+            }
+            for (nh = (struct nlmsghdr*)buf; len > 0 && NLMSG_OK(nh, (unsigned int)len); nh = NLMSG_NEXT(nh, len))
+            {
+                switch (nh->nlmsg_type)
+                {
+                case RTM_NEWLINK:
+                case RTM_DELLINK:
+                    nw_on_link(nh);
+                    break;
+                case RTM_NEWADDR:
+                case RTM_DELADDR:
+                    nw_on_addr(nh);
+                    break;
+                }
+            }
+        }
+        nw_on_timeout(nw_now_ms());
+        pthread_mutex_unlock(&nwLock);
+    }
+    return NULL;
 }
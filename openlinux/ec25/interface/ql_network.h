@@ -45,4 +45,75 @@ typedef void (*NW_Status_CB)(int result);
 //------------------------------------------------------------------------------
 int Ql_NW_EnableMobileAP(int timeout, NW_Status_CB nw_status_cb);
 
+//------------------------------------------------------------------------------
+/*
+* Function:     NW_If_CB 
+* 
+* Description:
+*               Interface state callback, called from the netlink thread 
+*               when the state of the subscribed interface changes.
+*
+* Parameters:
+*               ifname:
+*                   interface name, e.g. "rmnet_data0".
+*
+*               event:
+*                   NW_IF_UP, the link is up and has an IPv4 address.
+*                   NW_IF_DOWN, the link or the address is gone.
+*                   NW_IF_TIMEOUT, not up within the timeout (once).
+*
+*               address:
+*                   IPv4 address for NW_IF_UP, else "".
+*/
+//------------------------------------------------------------------------------
+typedef enum {
+    NW_IF_DOWN = 0,
+    NW_IF_UP,
+    NW_IF_TIMEOUT
+}Enum_NW_IfEvent;
+
+typedef void (*NW_If_CB)(const char* ifname, Enum_NW_IfEvent event, const char* address, void* param);
+
+#define NW_MAX_SUBSCRIBERS  8
+
+//------------------------------------------------------------------------------
+/*
+* Function:     Ql_NW_Subscribe 
+* 
+* Description:
+*               Watch an interface through rtnetlink (link and IPv4 address
+*               events). If the interface is already up, the callback is
+*               called before this function returns.
+*
+* Parameters:
+*               ifname:
+*                   interface name.
+*
+*               timeout_ms:
+*                   report NW_IF_TIMEOUT if not up in time, 0 = no timeout.
+*
+*               cb, param:
+*                   state callback and its parameter.
+*
+* Return:        
+*               subscriber handle (>= 0), to be passed to Ql_NW_Unsubscribe.
+*               else failed to execute the function. 
+*/
+//------------------------------------------------------------------------------
+int Ql_NW_Subscribe(const char* ifname, int timeout_ms, NW_If_CB cb, void* param);
+
+//------------------------------------------------------------------------------
+/*
+* Function:     Ql_NW_Unsubscribe 
+* 
+* Description:
+*               Stop watching, may be called from the callback. 
+*
+* Return:        
+*               RES_OK, this function succeeds.
+*               else failed to execute the function. 
+*/
+//------------------------------------------------------------------------------
+int Ql_NW_Unsubscribe(int handle);
+
 #endif  //__QL_NETWORK_H__
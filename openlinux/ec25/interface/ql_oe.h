@@ -43,6 +43,7 @@ extern "C" {
 #include "ql_i2c.h"
 #include "ql_audio.h"
 #include "ql_uart.h"
+#include "ql_uart_loop.h"
 #include "ql_network.h"
 
 //#include "gpioSysfs.h"
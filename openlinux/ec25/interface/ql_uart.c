@@ -102,29 +102,21 @@ int Ql_UART_GetDCBConfig(int fd, ST_UARTDCB *dcb)
 
 int Ql_UART_Write(int fd, const char* buf, unsigned int buf_len)
 {
-#define QL_UART_WRITE_MAX_SIZE 64
+    /* one syscall for the whole buffer, the tty takes what fits */
     size_t size;
-    size_t size_to_wr;
     ssize_t size_written;
 
     for(size = 0; size < buf_len;)
-	{
-        size_to_wr = buf_len - size;
-        if( size_to_wr > QL_UART_WRITE_MAX_SIZE)
-            size_to_wr = QL_UART_WRITE_MAX_SIZE;
-
-        size_written = write(fd, &buf[size], size_to_wr);
-
-        if (size_written==-1) {
-            printf("Cannot write on uart: %s",strerror(errno));
-            return 0;
+    {
+        size_written = write(fd, &buf[size], buf_len - size);
+        if (size_written == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                printf("Cannot write on uart: %s\n", strerror(errno));
+            break;
         }
-
-        printf("Uart Write: %zd", size_written);
         size += size_written;
-
-        if(size_written != size_to_wr)
-            break;
     }
 
     return size;
@@ -132,7 +124,11 @@ int Ql_UART_Write(int fd, const char* buf, unsigned int buf_len)
 
 int Ql_UART_Read (int fd, char* buf, unsigned int buf_len)
 {
-    return read(fd, buf, buf_len);
+    int size;
+    do {
+        size = read(fd, buf, buf_len);
+    } while (size == -1 && errno == EINTR);
+    return size;
 }
 
 int Ql_UART_IoCtl(int fd, unsigned int cmd, void* pValue)
@@ -0,0 +1,681 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   ql_uart_loop.c
+ *
+ * Project:
+ * --------
+ *   OpenLinux
+ *
+ * Description:
+ * ------------
+ *   Asynchronous UART I/O engine, epoll + eventfd.
+ ****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "ql_uart_loop.h"
+
+#define DEBUG_EN  0
+#if DEBUG_EN
+#define _DEBUG(fmtString, ...)     printf(fmtString, ##__VA_ARGS__)
+#else
+#define _DEBUG(fmtString, ...)
+#endif
+
+#define LOOP_EVENTS     8
+
+struct ql_uart_port {
+    struct ql_uart_port *next;
+    int                 fd;
+    int                 dead;       /* detached, freed by the loop */
+    int                 users;      /* Write/Drain inside, under lock */
+    int                 hup;        /* EOF or error, out of epoll */
+    uint32_t            events;     /* epoll mask, under lock */
+
+    /* RX: loop thread produces, the reader consumes. free running indices */
+    char                *rx;
+    unsigned int        rx_mask;
+    unsigned int        rx_head;
+    unsigned int        rx_tail;
+    int                 rx_paused;  /* ring full, EPOLLIN dropped */
+    CallBack_UART_Rx    cb;
+    void                *user;
+
+    /* TX: under lock */
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;       /* space or empty */
+    char                *tx;
+    unsigned int        tx_mask;
+    unsigned int        tx_head;
+    unsigned int        tx_tail;
+
+    ST_UARTPortStats    stats;
+};
+
+static struct {
+    pthread_mutex_t     lock;       /* recursive, held while events are dispatched */
+    pthread_t           thread;
+    int                 running;
+    int                 epfd;
+    int                 evfd;
+    ST_UARTPort         *ports;
+    ST_UARTLoopStats    stats;
+} loop = { .epfd = -1, .evfd = -1 };
+
+static pthread_mutex_t loop_start = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t loop_once = PTHREAD_ONCE_INIT;
+
+static void loop_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE); /* Detach from a callback */
+    pthread_mutex_init(&loop.lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static unsigned int ring_size(unsigned int size, unsigned int def)
+{
+    unsigned int n = 64;
+    if (0 == size)
+        size = def;
+    while (n < size)
+        n <<= 1;
+    return n;
+}
+
+static void loop_wake(void)
+{
+    uint64_t one = 1;
+    if (write(loop.evfd, &one, sizeof(one)) < 0)
+    {
+        _DEBUG("[UART] wake: %s\n", strerror(errno));
+    }
+    __atomic_add_fetch(&loop.stats.wakes, 1, __ATOMIC_RELAXED);
+}
+
+/* port->lock held */
+static void port_events(ST_UARTPort *port, uint32_t events)
+{
+    struct epoll_event ev;
+    if (events == port->events || port->hup)
+        return;
+    port->events = events;
+    ev.events = events;
+    ev.data.ptr = port;
+    epoll_ctl(loop.epfd, EPOLL_CTL_MOD, port->fd, &ev);
+    __atomic_add_fetch(&loop.stats.ctls, 1, __ATOMIC_RELAXED);
+}
+
+static void port_free(ST_UARTPort *port)
+{
+    close(port->fd);
+    pthread_cond_destroy(&port->cond);
+    pthread_mutex_destroy(&port->lock);
+    free(port->rx);
+    free(port->tx);
+    free(port);
+}
+
+/* Write/Drain hold a reference so that Detach can wait for them to leave */
+static void port_enter(ST_UARTPort *port)
+{
+    pthread_mutex_lock(&port->lock);
+    port->users++;
+}
+
+static void port_leave(ST_UARTPort *port)
+{
+    int last = 0 == --port->users && port->dead;
+    if (last)
+        pthread_cond_broadcast(&port->cond);
+    pthread_mutex_unlock(&port->lock);
+    if (last)
+        loop_wake(); /* reap it */
+}
+
+/* port->lock held, marks it dead and waits until no Write/Drain is inside */
+static void port_kill(ST_UARTPort *port)
+{
+    port->dead = 1;
+    pthread_cond_broadcast(&port->cond);
+    while (port->users)
+        pthread_cond_wait(&port->cond, &port->lock);
+}
+
+static int timeout_at(struct timespec *ts, int timeout_ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+    return 0;
+}
+
+/* port->lock held, 0 or ETIMEDOUT */
+static int port_wait(ST_UARTPort *port, int timeout_ms, const struct timespec *ts)
+{
+    if (timeout_ms < 0)
+        return pthread_cond_wait(&port->cond, &port->lock);
+    return pthread_cond_timedwait(&port->cond, &port->lock, ts);
+}
+
+static void rx_deliver(ST_UARTPort *port)
+{
+    unsigned int head = port->rx_head, tail = port->rx_tail;
+    while (head != tail)
+    {
+        unsigned int pos = tail & port->rx_mask;
+        unsigned int len = head - tail;
+        if (len > port->rx_mask + 1 - pos)
+            len = port->rx_mask + 1 - pos;
+        port->cb(port, port->rx + pos, len, port->user);
+        tail += len;
+    }
+    __atomic_store_n(&port->rx_tail, tail, __ATOMIC_RELEASE);
+}
+
+static void rx_event(ST_UARTPort *port)
+{
+    for (;;)
+    {
+        unsigned int head = port->rx_head;
+        unsigned int used = head - __atomic_load_n(&port->rx_tail, __ATOMIC_ACQUIRE);
+        unsigned int size = port->rx_mask + 1;
+        unsigned int pos = head & port->rx_mask;
+        unsigned int room = size - used;
+        struct iovec iov[2];
+        int cnt = 1;
+        ssize_t n;
+
+        if (0 == room)
+        {
+            /* stop reading, the tty driver holds the rest. Dekker with Release */
+            port->stats.rx_stalls++;
+            __atomic_store_n(&port->rx_paused, 1, __ATOMIC_SEQ_CST);
+            pthread_mutex_lock(&port->lock);
+            port_events(port, port->events & ~EPOLLIN);
+            pthread_mutex_unlock(&port->lock);
+            if (head - __atomic_load_n(&port->rx_tail, __ATOMIC_SEQ_CST) > port->rx_mask)
+                return; /* still full, Release wakes the loop */
+            __atomic_store_n(&port->rx_paused, 0, __ATOMIC_SEQ_CST);
+            pthread_mutex_lock(&port->lock);
+            port_events(port, port->events | EPOLLIN);
+            pthread_mutex_unlock(&port->lock);
+            continue;
+        }
+
+        iov[0].iov_base = port->rx + pos;
+        iov[0].iov_len = room < size - pos ? room : size - pos;
+        if (iov[0].iov_len < room)
+        {
+            iov[1].iov_base = port->rx;
+            iov[1].iov_len = room - iov[0].iov_len;
+            cnt = 2;
+        }
+        n = readv(port->fd, iov, cnt);
+        port->stats.rx_calls++;
+        if (n < 0 && EINTR == errno)
+            continue;
+        if (n <= 0)
+        {
+            if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+                return;
+            /* EOF or hangup, HUP is reported whatever the mask, so leave epoll */
+            _DEBUG("[UART] fd %d rx: %s\n", port->fd, n ? strerror(errno) : "eof");
+            port->stats.errors++;
+            pthread_mutex_lock(&port->lock);
+            port->hup = 1;
+            epoll_ctl(loop.epfd, EPOLL_CTL_DEL, port->fd, NULL);
+            __atomic_add_fetch(&loop.stats.ctls, 1, __ATOMIC_RELAXED);
+            port->tx_tail = port->tx_head;
+            pthread_cond_broadcast(&port->cond);
+            pthread_mutex_unlock(&port->lock);
+            return;
+        }
+        port->stats.rx_bytes += n;
+        __atomic_store_n(&port->rx_head, head + n, __ATOMIC_RELEASE);
+        if (port->cb)
+            rx_deliver(port);
+        if ((size_t)n < room)
+            return; /* drained, no extra EAGAIN read */
+    }
+}
+
+/* port->lock held */
+static void tx_flush(ST_UARTPort *port)
+{
+    while (port->tx_head != port->tx_tail)
+    {
+        unsigned int size = port->tx_mask + 1;
+        unsigned int pos = port->tx_tail & port->tx_mask;
+        unsigned int len = port->tx_head - port->tx_tail;
+        struct iovec iov[2];
+        int cnt = 1;
+        ssize_t n;
+
+        iov[0].iov_base = port->tx + pos;
+        iov[0].iov_len = len < size - pos ? len : size - pos;
+        if (iov[0].iov_len < len)
+        {
+            iov[1].iov_base = port->tx;
+            iov[1].iov_len = len - iov[0].iov_len;
+            cnt = 2;
+        }
+        n = writev(port->fd, iov, cnt);
+        port->stats.tx_calls++;
+        if (n < 0)
+        {
+            if (EINTR == errno)
+                continue;
+            if (EAGAIN == errno || EWOULDBLOCK == errno)
+            {
+                port->stats.tx_eagain++;
+                return;
+            }
+            _DEBUG("[UART] fd %d tx: %s\n", port->fd, strerror(errno));
+            port->stats.errors++;
+            port->tx_tail = port->tx_head; /* drop, nobody will take it */
+            break;
+        }
+        port->stats.tx_bytes += n;
+        port->tx_tail += n;
+        pthread_cond_broadcast(&port->cond);
+        if ((size_t)n < len)
+            return; /* tty full, wait for EPOLLOUT */
+    }
+    port_events(port, port->events & ~EPOLLOUT);
+    pthread_cond_broadcast(&port->cond);
+}
+
+static void loop_resume(void)
+{
+    ST_UARTPort *port;
+    for (port = loop.ports; port; port = port->next)
+    {
+        if (port->dead || 0 == __atomic_load_n(&port->rx_paused, __ATOMIC_SEQ_CST))
+            continue;
+        if (port->rx_head - __atomic_load_n(&port->rx_tail, __ATOMIC_SEQ_CST) > port->rx_mask)
+            continue; /* still full */
+        __atomic_store_n(&port->rx_paused, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_lock(&port->lock);
+        port_events(port, port->events | EPOLLIN);
+        pthread_mutex_unlock(&port->lock);
+    }
+}
+
+static void loop_reap(void)
+{
+    ST_UARTPort **pp = &loop.ports;
+    while (*pp)
+    {
+        ST_UARTPort *port = *pp;
+        int users = 0;
+        if (port->dead)
+        {
+            pthread_mutex_lock(&port->lock);
+            users = port->users; /* entered after Detach, leaves at once */
+            pthread_mutex_unlock(&port->lock);
+        }
+        if (port->dead && 0 == users)
+        {
+            *pp = port->next;
+            port_free(port);
+        }
+        else
+            pp = &port->next;
+    }
+}
+
+static void *loop_thread(void *arg)
+{
+    struct epoll_event ev[LOOP_EVENTS];
+    while (__atomic_load_n(&loop.running, __ATOMIC_ACQUIRE))
+    {
+        int i, n = epoll_wait(loop.epfd, ev, LOOP_EVENTS, -1);
+        __atomic_add_fetch(&loop.stats.waits, 1, __ATOMIC_RELAXED);
+        if (n < 0)
+        {
+            if (EINTR != errno)
+                break;
+            continue;
+        }
+        pthread_mutex_lock(&loop.lock);
+        for (i = 0; i < n; i++)
+        {
+            ST_UARTPort *port = (ST_UARTPort *)ev[i].data.ptr;
+            if (NULL == port)
+            {
+                uint64_t cnt;
+                if (read(loop.evfd, &cnt, sizeof(cnt)) < 0)
+                {
+                    _DEBUG("[UART] wake: %s\n", strerror(errno));
+                }
+                __atomic_add_fetch(&loop.stats.wakes, 1, __ATOMIC_RELAXED);
+                loop_resume();
+                continue;
+            }
+            if (port->dead)
+                continue;
+            if (ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                rx_event(port);
+            if ((ev[i].events & EPOLLOUT) && 0 == port->dead)
+            {
+                pthread_mutex_lock(&port->lock);
+                tx_flush(port);
+                pthread_mutex_unlock(&port->lock);
+            }
+        }
+        loop_reap();
+        pthread_mutex_unlock(&loop.lock);
+    }
+    return NULL;
+}
+
+int Ql_UART_Loop_Start(void)
+{
+    struct epoll_event ev;
+    int res = 0;
+    pthread_once(&loop_once, loop_init);
+    pthread_mutex_lock(&loop_start);
+    if (loop.running)
+        goto done;
+    loop.epfd = epoll_create1(EPOLL_CLOEXEC);
+    loop.evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop.epfd < 0 || loop.evfd < 0)
+        goto error;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(loop.epfd, EPOLL_CTL_ADD, loop.evfd, &ev))
+        goto error;
+    loop.running = 1;
+    if (0 == pthread_create(&loop.thread, NULL, loop_thread, NULL))
+        goto done;
+    loop.running = 0;
+error:
+    printf("[UART] loop start: %s\n", strerror(errno));
+    if (loop.epfd >= 0)
+        close(loop.epfd);
+    if (loop.evfd >= 0)
+        close(loop.evfd);
+    loop.epfd = loop.evfd = -1;
+    res = -1;
+done:
+    pthread_mutex_unlock(&loop_start);
+    return res;
+}
+
+/* not from a callback. closes the ports that are still attached */
+void Ql_UART_Loop_Stop(void)
+{
+    ST_UARTPort *port;
+    pthread_mutex_lock(&loop_start);
+    if (loop.running)
+    {
+        __atomic_store_n(&loop.running, 0, __ATOMIC_RELEASE);
+        loop_wake();
+        pthread_join(loop.thread, NULL);
+        while ((port = loop.ports))
+        {
+            loop.ports = port->next;
+            pthread_mutex_lock(&port->lock);
+            port_kill(port);
+            pthread_mutex_unlock(&port->lock);
+            port_free(port);
+        }
+        close(loop.epfd);
+        close(loop.evfd);
+        loop.epfd = loop.evfd = -1;
+    }
+    pthread_mutex_unlock(&loop_start);
+}
+
+int Ql_UART_Loop_GetStats(ST_UARTLoopStats *stats)
+{
+    if (NULL == stats)
+        return -1;
+    stats->waits = __atomic_load_n(&loop.stats.waits, __ATOMIC_RELAXED);
+    stats->ctls = __atomic_load_n(&loop.stats.ctls, __ATOMIC_RELAXED);
+    stats->wakes = __atomic_load_n(&loop.stats.wakes, __ATOMIC_RELAXED);
+    return 0;
+}
+
+ST_UARTPort *Ql_UART_Loop_Attach(int fd, unsigned int rx_size, unsigned int tx_size, CallBack_UART_Rx cb, void *user)
+{
+    pthread_condattr_t attr;
+    struct epoll_event ev;
+    ST_UARTPort *port;
+
+    if (fd < 0 || Ql_UART_Loop_Start())
+        return NULL;
+    port = (ST_UARTPort *)calloc(1, sizeof(ST_UARTPort));
+    if (NULL == port)
+        return NULL;
+    rx_size = ring_size(rx_size, QL_UART_LOOP_RX_SIZE);
+    tx_size = ring_size(tx_size, QL_UART_LOOP_TX_SIZE);
+    port->rx = (char *)malloc(rx_size);
+    port->tx = (char *)malloc(tx_size);
+    if (NULL == port->rx || NULL == port->tx)
+    {
+        free(port->rx);
+        free(port->tx);
+        free(port);
+        return NULL;
+    }
+    port->fd = fd;
+    port->rx_mask = rx_size - 1;
+    port->tx_mask = tx_size - 1;
+    port->cb = cb;
+    port->user = user;
+    port->events = EPOLLIN;
+    pthread_mutex_init(&port->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&port->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    pthread_mutex_lock(&loop.lock);
+    ev.events = port->events;
+    ev.data.ptr = port;
+    if (epoll_ctl(loop.epfd, EPOLL_CTL_ADD, fd, &ev))
+    {
+        printf("[UART] attach fd %d: %s\n", fd, strerror(errno));
+        pthread_mutex_unlock(&loop.lock);
+        port->fd = -1;
+        port_free(port);
+        return NULL;
+    }
+    __atomic_add_fetch(&loop.stats.ctls, 1, __ATOMIC_RELAXED);
+    port->next = loop.ports;
+    loop.ports = port;
+    pthread_mutex_unlock(&loop.lock);
+    return port;
+}
+
+int Ql_UART_Loop_Detach(ST_UARTPort *port)
+{
+    if (NULL == port)
+        return -1;
+    pthread_mutex_lock(&loop.lock);
+    if (0 == port->hup)
+        epoll_ctl(loop.epfd, EPOLL_CTL_DEL, port->fd, NULL);
+    __atomic_add_fetch(&loop.stats.ctls, 1, __ATOMIC_RELAXED);
+    /* events already fetched are skipped, the loop frees it */
+    pthread_mutex_lock(&port->lock);
+    port_kill(port);
+    pthread_mutex_unlock(&port->lock);
+    pthread_mutex_unlock(&loop.lock);
+    loop_wake();
+    return 0;
+}
+
+int Ql_UART_Loop_Write(ST_UARTPort *port, const char *buf, unsigned int len, int timeout_ms)
+{
+    struct timespec ts;
+    unsigned int done = 0;
+    int res = 0;
+
+    if (NULL == port || NULL == buf)
+        return -1;
+    if (timeout_ms > 0)
+        timeout_at(&ts, timeout_ms);
+    port_enter(port);
+    while (done < len && 0 == port->dead)
+    {
+        unsigned int size = port->tx_mask + 1;
+        unsigned int room, pos, n;
+
+        if (port->tx_head == port->tx_tail)
+        {
+            /* nothing pending, straight to the tty */
+            ssize_t w = write(port->fd, buf + done, len - done);
+            port->stats.tx_calls++;
+            if (w > 0)
+            {
+                port->stats.tx_bytes += w;
+                done += w;
+                continue;
+            }
+            if (w < 0 && EINTR == errno)
+                continue;
+            if (w < 0 && EAGAIN != errno && EWOULDBLOCK != errno)
+            {
+                port->stats.errors++;
+                res = -1;
+                break;
+            }
+            port->stats.tx_eagain++;
+        }
+
+        room = size - (port->tx_head - port->tx_tail);
+        if (room)
+        {
+            n = len - done < room ? len - done : room;
+            pos = port->tx_head & port->tx_mask;
+            if (n <= size - pos)
+                memcpy(port->tx + pos, buf + done, n);
+            else
+            {
+                memcpy(port->tx + pos, buf + done, size - pos);
+                memcpy(port->tx, buf + done + size - pos, n - (size - pos));
+            }
+            port->tx_head += n;
+            done += n;
+            port_events(port, port->events | EPOLLOUT);
+            continue;
+        }
+        if (0 == timeout_ms || port_wait(port, timeout_ms, &ts))
+            break;
+    }
+    port_leave(port);
+    return done ? (int)done : res;
+}
+
+int Ql_UART_Loop_Drain(ST_UARTPort *port, int timeout_ms)
+{
+    struct timespec ts;
+    int res = 0;
+    if (NULL == port)
+        return -1;
+    if (timeout_ms > 0)
+        timeout_at(&ts, timeout_ms);
+    port_enter(port);
+    while (port->tx_head != port->tx_tail && 0 == port->dead)
+    {
+        if (0 == timeout_ms || port_wait(port, timeout_ms, &ts))
+        {
+            res = -1;
+            break;
+        }
+    }
+    port_leave(port);
+    return res;
+}
+
+int Ql_UART_Loop_Available(ST_UARTPort *port)
+{
+    if (NULL == port)
+        return 0;
+    return __atomic_load_n(&port->rx_head, __ATOMIC_ACQUIRE) - port->rx_tail;
+}
+
+int Ql_UART_Loop_Borrow(ST_UARTPort *port, const char **data)
+{
+    unsigned int len, pos;
+    if (NULL == port || NULL == data)
+        return 0;
+    len = __atomic_load_n(&port->rx_head, __ATOMIC_ACQUIRE) - port->rx_tail;
+    pos = port->rx_tail & port->rx_mask;
+    if (len > port->rx_mask + 1 - pos)
+        len = port->rx_mask + 1 - pos;
+    *data = port->rx + pos;
+    return len;
+}
+
+void Ql_UART_Loop_Release(ST_UARTPort *port, unsigned int len)
+{
+    unsigned int avail;
+    if (NULL == port || 0 == len)
+        return;
+    avail = Ql_UART_Loop_Available(port);
+    if (len > avail)
+        len = avail;
+    __atomic_store_n(&port->rx_tail, port->rx_tail + len, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&port->rx_paused, __ATOMIC_SEQ_CST))
+        loop_wake(); /* ring has room again, re-arm EPOLLIN */
+}
+
+int Ql_UART_Loop_Read(ST_UARTPort *port, char *buf, unsigned int len)
+{
+    unsigned int done = 0;
+    while (done < len)
+    {
+        const char *data;
+        unsigned int n = Ql_UART_Loop_Borrow(port, &data);
+        if (0 == n)
+            break;
+        if (n > len - done)
+            n = len - done;
+        memcpy(buf + done, data, n);
+        Ql_UART_Loop_Release(port, n);
+        done += n;
+    }
+    return done;
+}
+
+void Ql_UART_Loop_Purge(ST_UARTPort *port)
+{
+    Ql_UART_Loop_Release(port, Ql_UART_Loop_Available(port));
+}
+
+int Ql_UART_Loop_GetPortStats(ST_UARTPort *port, ST_UARTPortStats *stats)
+{
+    if (NULL == port || NULL == stats)
+        return -1;
+    pthread_mutex_lock(&loop.lock);
+    pthread_mutex_lock(&port->lock);
+    *stats = port->stats;
+    pthread_mutex_unlock(&port->lock);
+    pthread_mutex_unlock(&loop.lock);
+    return 0;
+}
+
+int Ql_UART_Loop_GetFd(ST_UARTPort *port)
+{
+    return port ? port->fd : -1;
+}
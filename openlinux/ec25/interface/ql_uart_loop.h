@@ -0,0 +1,89 @@
+/*****************************************************************************
+ *
+ * Filename:
+ * ---------
+ *   ql_uart_loop.h
+ *
+ * Project:
+ * --------
+ *   OpenLinux
+ *
+ * Description:
+ * ------------
+ *   Asynchronous UART I/O engine.
+ *
+ *   One thread owns the tty fds through epoll, an eventfd wakes it up.
+ *   RX is read in bulk (readv) into a per port ring and either handed to
+ *   a callback or left in the ring for Read/Borrow. TX is written
+ *   directly while nothing is pending, the rest is buffered and sent
+ *   with writev when the fd is writable again (EAGAIN is not an error).
+ *
+ *   Read/Available/Borrow/Release are for one consumer thread per port,
+ *   Write/Drain may be called from any thread.
+ ****************************************************************************/
+#ifndef __QL_UART_LOOP_H__
+#define __QL_UART_LOOP_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef QL_UART_LOOP_RX_SIZE
+#define QL_UART_LOOP_RX_SIZE    4096 /* default ring sizes, power of 2 */
+#endif
+#ifndef QL_UART_LOOP_TX_SIZE
+#define QL_UART_LOOP_TX_SIZE    4096
+#endif
+
+typedef struct ql_uart_port ST_UARTPort;
+
+/* called from the loop thread, data is valid only during the call */
+typedef void (*CallBack_UART_Rx)(ST_UARTPort *port, const char *data, unsigned int len, void *user);
+
+typedef struct {
+    uint64_t    rx_bytes;
+    uint64_t    tx_bytes;
+    uint32_t    rx_calls;       /* read/readv syscalls */
+    uint32_t    tx_calls;       /* write/writev syscalls */
+    uint32_t    tx_eagain;      /* writes that found the tty full */
+    uint32_t    rx_stalls;      /* times the ring was full, RX paused */
+    uint32_t    errors;
+}ST_UARTPortStats;
+
+typedef struct {
+    uint32_t    waits;          /* epoll_wait */
+    uint32_t    ctls;           /* epoll_ctl */
+    uint32_t    wakes;          /* eventfd read + write */
+}ST_UARTLoopStats;
+
+int  Ql_UART_Loop_Start(void);
+void Ql_UART_Loop_Stop(void);
+int  Ql_UART_Loop_GetStats(ST_UARTLoopStats *stats);
+
+/* the loop owns fd after this, Detach closes it. sizes are rounded up to a power of 2, 0 = default */
+ST_UARTPort *Ql_UART_Loop_Attach(int fd, unsigned int rx_size, unsigned int tx_size, CallBack_UART_Rx cb, void *user);
+/* wakes blocked Write/Drain and returns once they have left, the port is invalid afterwards */
+int  Ql_UART_Loop_Detach(ST_UARTPort *port);
+
+/* timeout_ms: 0 = accept what fits, -1 = wait for room. returns bytes accepted or -1 */
+int  Ql_UART_Loop_Write(ST_UARTPort *port, const char *buf, unsigned int len, int timeout_ms);
+/* waits until the TX buffer is empty, 0 or -1 on timeout */
+int  Ql_UART_Loop_Drain(ST_UARTPort *port, int timeout_ms);
+
+int  Ql_UART_Loop_Read(ST_UARTPort *port, char *buf, unsigned int len);
+int  Ql_UART_Loop_Available(ST_UARTPort *port);
+/* contiguous received bytes without a copy, consume them with Release */
+int  Ql_UART_Loop_Borrow(ST_UARTPort *port, const char **data);
+void Ql_UART_Loop_Release(ST_UARTPort *port, unsigned int len);
+void Ql_UART_Loop_Purge(ST_UARTPort *port);
+
+int  Ql_UART_Loop_GetPortStats(ST_UARTPort *port, ST_UARTPortStats *stats);
+int  Ql_UART_Loop_GetFd(ST_UARTPort *port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__QL_UART_LOOP_H__
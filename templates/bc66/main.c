@@ -3,6 +3,9 @@
 #include "ql_stdlib.h"
 #include "ql_uart.h"
 #include "ril.h"
+#ifdef __OCPU_RIL_SOCKET_SUPPORT__
+#include "ril_socket.h"
+#endif
 #include <stdint.h>
 #include <stddef.h>
 
@@ -33,6 +36,9 @@ void proc_main_task(s32 taskId)
         {
         case MSG_ID_RIL_READY:
             Ql_RIL_Initialize();
+#ifdef __OCPU_RIL_SOCKET_SUPPORT__
+            RIL_SOC_Initialize();
+#endif
             DBG("[APP] Ril Ready\n");
             break;
         }
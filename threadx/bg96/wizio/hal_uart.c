@@ -19,9 +19,16 @@
 #include <hal_uart.h>
 
 #define UART_STACK_SIZE     (2048)
-#define UART_RX_EVENT_MASK  (0x00000003)
+#define UART_RX_EVENT_MASK  (0x00000001) /* a buffer is filled */
+#define UART_ARM_EVENT_MASK (0x00000002) /* the reader gave a buffer back */
 #define UART_TX_EVENT_MASK  (0x80000000)
 
+#define UART_RX_BUF(U, N)   (&(U)->uart_buffers[(N) % UART_RX_BUFFERS])
+
+#if UART_RX_BUFFERS < UART_RX_QUEUED
+#error UART_RX_BUFFERS must be at least UART_RX_QUEUED
+#endif
+
 static void uart_transmit_isr(uint32_t num_bytes, void *user)
 {
     if (user && num_bytes)
@@ -34,11 +41,41 @@ static void uart_transmit_isr(uint32_t num_bytes, void *user)
 
 static void uart_receive_isr(uint32_t num_bytes, void *user)
 {
-    if (user && num_bytes)
+    if (user)
     {
         UART_BUF_T *p = (UART_BUF_T *)user;
         p->size = num_bytes;
-        EVENT_SEND(p->event, p->index);
+        p->ready = 1;
+        EVENT_SEND(p->event, UART_RX_EVENT_MASK);
+    }
+}
+
+/* keep UART_RX_QUEUED buffers in the driver, qapi wants this from a thread, not from the isr */
+static void uart_rx_arm(UART uart)
+{
+    while (uart->handle &&
+           uart->rx_arm - uart->rx_done < UART_RX_QUEUED &&
+           uart->rx_arm - uart->rx_read < UART_RX_BUFFERS)
+    {
+        UART_BUF_T *p = UART_RX_BUF(uart, uart->rx_arm);
+        p->size = 0;
+        p->ready = 0;
+        if (qapi_UART_Receive(uart->handle, (char *)p->data, UART_BUFFER_SIZE, p))
+        {
+            //DEBUG_UART("[ERROR] uart_rx_arm() receive\n");
+            break;
+        }
+        uart->rx_arm++;
+    }
+    if (uart->handle && uart->rx_arm - uart->rx_done < UART_RX_QUEUED)
+    {
+        if (0 == uart->rx_starved)
+            uart->stats.overruns++; // once per episode
+        uart->rx_starved = 1;
+    }
+    else
+    {
+        uart->rx_starved = 0;
     }
 }
 
@@ -47,24 +84,26 @@ static void uart_thread_entry(void *p)
     UART uart = (UART)p;
     while (uart)
     {
-        DELAY(10);
-        if (uart->handle) // wait open
+        ULONG signal = 0;
+        EVENT_WAIT(uart->E_Signal, UART_RX_EVENT_MASK | UART_ARM_EVENT_MASK);
+        /* the driver completes the buffers in queue order */
+        while (uart->rx_done != uart->rx_arm)
         {
-            ULONG signal = 0;
-            EVENT_WAIT(uart->E_Signal, UART_RX_EVENT_MASK);
-            signal &= 0xF; // ignore tx
-            if (signal)
-            {
-                /* GET BUFFER & COPY TO RING */
-                UART_BUF_T *p = &uart->uart_buffers[signal >> 1];
-                if (0 == MUTEX_LOCK(uart->M_Ring))
-                    uart->ring->write(uart->ring, p->data, p->size);
-                MUTEX_UNLOCK(uart->M_Ring);
-                p->size = 0;
-                if (uart->handle)
-                    qapi_UART_Receive(uart->handle, p->data, UART_BUFFER_SIZE, p);
-            }
+            UART_BUF_T *b = UART_RX_BUF(uart, uart->rx_done);
+            if (0 == b->ready)
+                break;
+            uart->stats.rx_bytes += b->size;
+            uart->stats.rx_buffers++;
+            uart->rx_total += b->size;
+            uart->rx_done++;
         }
+        uint32_t pending = uart->rx_total - uart->rd_total;
+        if (pending > uart->stats.high_water)
+            uart->stats.high_water = pending;
+        pending = uart->rx_done - uart->rx_read;
+        if (pending > uart->stats.high_water_buffers)
+            uart->stats.high_water_buffers = pending;
+        uart_rx_arm(uart);
     }
 }
 
@@ -76,7 +115,6 @@ static int uart_stop_receive(UART uart) /* called from uart_stop_receive() */
         tx_thread_terminate(uart->Thread);
         DELAY(10);
         tx_thread_delete(uart->Thread);
-        uart->Thread = NULL;
         return 0;
     }
     return -1;
@@ -86,6 +124,20 @@ static int uart_start_receive(UART uart) /* called form uart_open() */
 {
     if (uart->handle)
     {
+        ULONG signal;
+        tx_event_flags_get(uart->E_Signal, UART_RX_EVENT_MASK | UART_ARM_EVENT_MASK, TX_OR_CLEAR, &signal, TX_NO_WAIT);
+        uart->rx_arm = uart->rx_done = uart->rx_read = 0;
+        uart->rx_pos = 0;
+        uart->rx_total = uart->rd_total = 0;
+        uart->rx_starved = 0;
+        for (int i = 0; i < UART_RX_BUFFERS; i++)
+            uart->uart_buffers[i].event = uart->E_Signal; // instance of event
+        uart_rx_arm(uart); /* SET QUEUE RX BUFFERS */
+        if (uart->rx_arm != UART_RX_QUEUED)
+        {
+            //DEBUG_UART("[ERROR] uart_start_receive() receive\n");
+            return -1;
+        }
         if (tx_thread_create(uart->Thread, "thread-uart",
                              uart_thread_entry, uart,
                              uart->Stack, UART_STACK_SIZE,
@@ -94,24 +146,43 @@ static int uart_start_receive(UART uart) /* called form uart_open() */
             //DEBUG_UART("[ERROR] uart_start_receive() thread\n");
             return -1;
         }
-        for (int i = 0; i < UART_MAX_BUFFERS /* MAX 2 */; i++) /* SET QUEUE RX BUFFERS */
-        {
-            uart->uart_buffers[i].size = 0;
-            uart->uart_buffers[i].index = 1 << i;         // mark buffers
-            uart->uart_buffers[i].event = uart->E_Signal; // instance of event
-
-            if (qapi_UART_Receive(uart->handle, (char *)uart->uart_buffers[i].data, UART_BUFFER_SIZE, &uart->uart_buffers[i]))
-            {
-                //DEBUG_UART("[ERROR] uart_start_receive() receive\n");
-                return -1;
-            }
-        }
         return 0;
     }
     //DEBUG_UART("[ERROR] uart_start_receive() handle\n");
     return -1;
 }
 
+/* the unread part of the oldest filled buffer, reader lock held */
+static size_t uart_rx_head(UART uart, const char **data)
+{
+    while (uart->rx_read != uart->rx_done)
+    {
+        UART_BUF_T *b = UART_RX_BUF(uart, uart->rx_read);
+        if (uart->rx_pos < (uint32_t)b->size)
+        {
+            *data = (const char *)b->data + uart->rx_pos;
+            return b->size - uart->rx_pos;
+        }
+        uart->rx_pos = 0; // empty completion
+        uart->rx_read++;
+        EVENT_SEND(uart->E_Signal, UART_ARM_EVENT_MASK);
+    }
+    return 0;
+}
+
+static void uart_rx_consume(UART uart, size_t size)
+{
+    UART_BUF_T *b = UART_RX_BUF(uart, uart->rx_read);
+    uart->rx_pos += size;
+    uart->rd_total += size;
+    if (uart->rx_pos >= (uint32_t)b->size)
+    {
+        uart->rx_pos = 0;
+        uart->rx_read++;
+        EVENT_SEND(uart->E_Signal, UART_ARM_EVENT_MASK); // one per buffer, the thread may wait for it to re-arm
+    }
+}
+
 void uart_destroy(UART uart)
 {
     if (uart)
@@ -127,11 +198,6 @@ void uart_destroy(UART uart)
             tx_mutex_delete(uart->M_Transmiter);
             txm_module_object_deallocate(uart->M_Transmiter);
         }
-        if (uart->M_Ring)
-        {
-            tx_mutex_delete(uart->M_Ring);
-            txm_module_object_deallocate(uart->M_Ring);
-        }
         if (uart->E_Signal)
         {
             tx_event_flags_delete(uart->E_Signal);
@@ -141,10 +207,6 @@ void uart_destroy(UART uart)
             txm_module_object_deallocate(uart->Thread);
         if (uart->uart_buffers)
             free(uart->uart_buffers);
-        if (uart->rx_buffer)
-            free(uart->rx_buffer);
-        if (uart->ring)
-            free(uart->ring);
         if (uart->Stack)
             free(uart->Stack);
         memset(uart, 0, sizeof(UART_CONTEX_T)); 
@@ -178,20 +240,15 @@ UART uart_create(int port, void *config)
         if (NULL == uart->cfg.tx_CB_ISR)
             uart->cfg.tx_CB_ISR = uart_transmit_isr;
 
-        assert(0 == txm_module_object_allocate(&uart->M_Ring, sizeof(TX_MUTEX)));
         assert(0 == txm_module_object_allocate(&uart->M_Receiver, sizeof(TX_MUTEX)));
         assert(0 == txm_module_object_allocate(&uart->M_Transmiter, sizeof(TX_MUTEX)));
         assert(0 == txm_module_object_allocate(&uart->E_Signal, sizeof(TX_EVENT_FLAGS_GROUP)));
         assert(0 == txm_module_object_allocate(&uart->Thread, sizeof(TX_THREAD)));
-        assert(0 == tx_mutex_create(uart->M_Ring, "mutex-uart-ring", TX_INHERIT));
         assert(0 == tx_mutex_create(uart->M_Receiver, "mutex-uart-rx", TX_INHERIT));
         assert(0 == tx_mutex_create(uart->M_Transmiter, "mutext-uart-tx", TX_INHERIT));
         assert(0 == tx_event_flags_create(uart->E_Signal, "event-uart"));
         assert((uart->Stack = (UCHAR *)malloc(UART_STACK_SIZE)));
-        assert((uart->uart_buffers = (UART_BUF_T *)calloc(1, sizeof(UART_BUF_T) * UART_MAX_BUFFERS)));
-        assert((uart->rx_buffer = (char *)calloc(1, UART_RING_SIZE)));
-        assert((uart->ring = (ring_buffer_t *)calloc(1, sizeof(ring_buffer_t))));
-        ring_buffer_init(uart->ring, UART_RING_SIZE, uart->rx_buffer);
+        assert((uart->uart_buffers = (UART_BUF_T *)calloc(1, sizeof(UART_BUF_T) * UART_RX_BUFFERS)));
     }
     return uart;
 }
@@ -207,7 +264,6 @@ int uart_close(UART uart)
             qapi_UART_Close(uart->handle);
             uart->handle = NULL;
             uart_stop_receive(uart); // remove thread
-            uart->ring->reset(uart->ring);
             //MUTEX_UNLOCK
             return 0;
         }
@@ -289,9 +345,18 @@ size_t uart_read(UART uart, char *dst, size_t size)
         {
             if (0 == MUTEX_LOCK(uart->M_Receiver))
             {
-                if (0 == MUTEX_LOCK(uart->M_Ring))
-                    result = uart->ring->read(uart->ring, dst, size);
-                MUTEX_UNLOCK(uart->M_Ring);
+                const char *src;
+                size_t n;
+                while (size && (n = uart_rx_head(uart, &src)))
+                {
+                    if (n > size)
+                        n = size;
+                    memcpy(dst, src, n);
+                    uart_rx_consume(uart, n);
+                    dst += n;
+                    size -= n;
+                    result += n;
+                }
             }
             MUTEX_UNLOCK(uart->M_Receiver);
         }
@@ -299,41 +364,73 @@ size_t uart_read(UART uart, char *dst, size_t size)
     return result;
 }
 
-int uart_peek(UART uart)
+size_t uart_borrow(UART uart, const char **data)
 {
-    int c = -1;
-    if (uart)
+    size_t size = 0;
+    if (uart && data)
     {
-        if (uart->handle)
+        if (uart->handle && 0 == MUTEX_LOCK(uart->M_Receiver))
         {
-            if (0 == MUTEX_LOCK(uart->M_Ring))
-                if (1 == uart->ring->peek(uart->ring, &c, 1))
-                    c &= 0xFF;
-            MUTEX_UNLOCK(uart->M_Ring);
+            size = uart_rx_head(uart, data);
+            if (0 == size)
+                MUTEX_UNLOCK(uart->M_Receiver); // nothing to release
         }
     }
-    return c;
+    return size;
 }
 
-size_t uart_available(UART uart)
+void uart_release(UART uart, size_t consumed)
 {
-    size_t available = 0;
+    if (uart)
+    {
+        const char *src;
+        size_t n = uart_rx_head(uart, &src);
+        uart_rx_consume(uart, consumed < n ? consumed : n);
+        MUTEX_UNLOCK(uart->M_Receiver);
+    }
+}
+
+int uart_peek(UART uart)
+{
+    int c = -1;
     if (uart)
     {
         if (uart->handle)
         {
-            if (0 == MUTEX_LOCK(uart->M_Ring))
-                available = UART_RING_SIZE - uart->ring->available(uart->ring);
-            MUTEX_UNLOCK(uart->M_Ring);
+            const char *src;
+            if (0 == MUTEX_LOCK(uart->M_Receiver))
+                if (uart_rx_head(uart, &src))
+                    c = *src & 0xFF;
+            MUTEX_UNLOCK(uart->M_Receiver);
         }
     }
-    return available;
+    return c;
+}
+
+size_t uart_available(UART uart)
+{
+    if (uart && uart->handle)
+        return uart->rx_total - uart->rd_total;
+    return 0;
 }
 
 int uart_ioctl(UART uart, int command, void *param)
 {
     if (uart)
-        return (uart->handle) ? qapi_UART_Ioctl(uart->handle, (qapi_UART_Ioctl_Command_e)command, param) : -1;
+    {
+        switch (command)
+        {
+        case UART_IOCTL_GET_STATS:
+            if (NULL == param)
+                return -1;
+            memcpy(param, &uart->stats, sizeof(UART_STATS_T));
+            return 0;
+        case UART_IOCTL_RESET_STATS:
+            memset(&uart->stats, 0, sizeof(UART_STATS_T));
+            return 0;
+        default:
+            return (uart->handle) ? qapi_UART_Ioctl(uart->handle, (qapi_UART_Ioctl_Command_e)command, param) : -1;
+        }
+    }
     return -1;
 }
-
@@ -35,31 +35,51 @@ extern "C"
 #include "interface.h"
 #include "ring-buffer.h"
 
-#define UART_BUFFER_SIZE    (1024)
-#define UART_RING_SIZE      (4096)
-#define UART_MAX_BUFFERS    (2) /* MAX 2 DONT TOUCH */
+#define UART_BUFFER_SIZE    (1024) /* multiple of 4 */
+#ifndef UART_RX_BUFFERS
+#define UART_RX_BUFFERS     (4) /* receive pool, at least UART_RX_QUEUED */
+#endif
+#define UART_RX_QUEUED      (2) /* qapi_UART_Receive takes at most two buffers */
+
+#define UART_IOCTL_GET_STATS    (0x100) /* param: UART_STATS_T*, works closed too */
+#define UART_IOCTL_RESET_STATS  (0x101)
 
     typedef struct UART_BUF_S
     {
-        int index;
         TX_EVENT_FLAGS_GROUP *event;
-        int32_t size;
+        volatile int32_t size;
+        volatile int ready; /* set by the receive isr */
         uint8_t data[UART_BUFFER_SIZE];
     } UART_BUF_T;
 
+    typedef struct UART_STATS_S
+    {
+        uint32_t rx_bytes;
+        uint32_t rx_buffers;         /* completed driver buffers */
+        uint32_t overruns;           /* the driver ran short of buffers, every free one was held by the reader */
+        uint32_t high_water;         /* most bytes waiting for the reader */
+        uint32_t high_water_buffers; /* most filled buffers waiting for the reader */
+    } UART_STATS_T;
+
     typedef struct UART_CONTEX_S
     {
         qapi_UART_Port_Id_e port_id;
         qapi_UART_Open_Config_t cfg;
         qapi_UART_Handle_t handle;
-        TX_MUTEX *M_Transmiter, *M_Receiver, *M_Ring;
+        TX_MUTEX *M_Transmiter, *M_Receiver;
         TX_EVENT_FLAGS_GROUP *E_Signal;
         UCHAR *Stack;
         TX_THREAD *Thread;
         size_t wr_size;
-        UART_BUF_T *uart_buffers; // [UART_MAX_BUFFERS];
-        char *rx_buffer;          // [UART_RING_SIZE];
-        ring_buffer_t *ring;
+        UART_BUF_T *uart_buffers; // [UART_RX_BUFFERS], used in queue order
+        /* free running buffer counters: rx_read <= rx_done <= rx_arm <= rx_read + UART_RX_BUFFERS */
+        volatile uint32_t rx_arm;  // next to give to the driver, uart thread
+        volatile uint32_t rx_done; // next to complete, uart thread
+        volatile uint32_t rx_read; // buffer of the reader
+        uint32_t rx_pos;           // read offset in rx_read
+        volatile uint32_t rx_total, rd_total; // bytes received, bytes consumed
+        int rx_starved;
+        UART_STATS_T stats;
     } UART_CONTEX_T;
     typedef UART_CONTEX_T *UART;
 
@@ -89,6 +109,10 @@ extern "C"
 
     size_t uart_available(UART uart);
 
+    /* zero copy: the unread part of the oldest filled buffer, the reader lock is held until uart_release() */
+    size_t uart_borrow(UART uart, const char **data);
+    void uart_release(UART uart, size_t consumed);
+
 #ifdef __cplusplus
 }
 #endif